@@ -12,22 +12,25 @@
 #endif
 #define LOGGER_LEVEL 2
 
-void init_db(const char* filename){
+pager_t* init_db(const char* filename){
     /* Init new db file */
-    if(pg_init(filename) != FILE_SUCCESS){
+    pager_t* pager = pg_init(filename);
+    if(pager == NULL){
         printf("Failed to init file\n");
         exit(EXIT_FAILURE);
     }
-    if(pg_file_size() != 0){
-        if(pg_delete() != 0){
+    if(pg_file_size(pager) != 0){
+        if(pg_delete(pager) != 0){
             printf("Failed to delete file\n");
             exit(EXIT_FAILURE);
         }
-        if(pg_init("test.db") != 0){
+        pager = pg_init(filename);
+        if(pager == NULL){
             printf("Failed to init file\n");
             exit(EXIT_FAILURE);
         }
     }
+    return pager;
 }
 
 int out_file(const char* filename){
@@ -48,30 +51,30 @@ int out_file(const char* filename){
 int main(){
     struct timespec start, end;
 
-    init_db("test.db");
+    pager_t* pager = init_db("test.db");
     char str[] = "2345678";
     int fd = out_file("linked_blocks_wide_insert.csv");
     FILE *file = fdopen(fd, "w");
     fprintf(file, "Time;BlocksCount\n");
     int64_t block_size = 8;
-    int64_t ppidx = lb_ppl_init(block_size);
-    page_pool_t* ppl = ppl_load(ppidx);
+    int64_t ppidx = lb_ppl_init(pager, block_size);
+    page_pool_t* ppl = ppl_load(pager, ppidx);
     uint64_t max_file_size =  (uint64_t)1024 * 1024; // 1 mb
     uint64_t allocate_count = max_file_size / ppl->block_size;
     uint64_t block_count = 0;
     while(allocate_count > block_count){
         chblix_t blocks[allocate_count];
-        chblix_t block = lb_alloc(ppidx);
+        chblix_t block = lb_alloc(pager, ppidx);
         blocks[block_count] = block;
         block_count++;
         clock_gettime(CLOCK_UPTIME_RAW, &start);
-        lb_write(ppidx, &block, str, sizeof(str), 10);
+        lb_write(pager, ppidx, &block, str, sizeof(str), 10);
         clock_gettime(CLOCK_UPTIME_RAW, &end);
         uint64_t delta_us = (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000;
         fprintf(file, "%llu;%llu\n", delta_us, block_count);
         fflush(file);
-        logger(LL_WARN, __func__, "File size: %llu, blocks count: %llu", pg_file_size(), block_count);
+        logger(LL_WARN, __func__, "File size: %llu, blocks count: %llu", pg_file_size(pager), block_count);
     }
     close(fd);
-    pg_delete();
+    pg_delete(pager);
 }
\ No newline at end of file
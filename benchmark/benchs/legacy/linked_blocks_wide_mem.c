@@ -10,22 +10,25 @@
 #endif
 #define LOGGER_LEVEL 2
 
-void init_db(const char* filename){
+pager_t* init_db(const char* filename){
     /* Init new db file */
-    if(pg_init(filename) != FILE_SUCCESS){
+    pager_t* pager = pg_init(filename);
+    if(pager == NULL){
         printf("Failed to init file\n");
         exit(EXIT_FAILURE);
     }
-    if(pg_file_size() != 0){
-        if(pg_delete() != 0){
+    if(pg_file_size(pager) != 0){
+        if(pg_delete(pager) != 0){
             printf("Failed to delete file\n");
             exit(EXIT_FAILURE);
         }
-        if(pg_init("test.db") != 0){
+        pager = pg_init(filename);
+        if(pager == NULL){
             printf("Failed to init file\n");
             exit(EXIT_FAILURE);
         }
     }
+    return pager;
 }
 
 int out_file(const char* filename){
@@ -45,33 +48,33 @@ int out_file(const char* filename){
 
 int main(){
 
-    init_db("test.db");
+    pager_t* pager = init_db("test.db");
     char str[] = "12345678";
     int fd = out_file("linked_blocks_wide_mem.csv");
     FILE *file = fdopen(fd, "w");
     fprintf(file, "FileSize;BlocksCount\n");
     int64_t block_size = 9;
-    int64_t ppidx = lb_ppl_init(block_size);
+    int64_t ppidx = lb_ppl_init(pager, block_size);
     uint64_t max_file_size =  (uint64_t)1024 * 1024; // 1 mb
     uint64_t allocate_count = 500;
     uint64_t deallocate_count = 400;
     uint64_t block_count = 0;
-    while(pg_file_size() < max_file_size){
+    while(pg_file_size(pager) < max_file_size){
         chblix_t blocks[allocate_count];
         for(int64_t i = 0; i < allocate_count; i++){
-            chblix_t block = lb_alloc(ppidx);
+            chblix_t block = lb_alloc(pager, ppidx);
             blocks[i] = block;
             block_count++;
-            lb_write(ppidx, &block, str, sizeof(str), 10);
+            lb_write(pager, ppidx, &block, str, sizeof(str), 10);
         }
         for(int64_t i = 0; i < deallocate_count; i++){
-            lb_dealloc(ppidx, &blocks[i]);
+            lb_dealloc(pager, ppidx, &blocks[i]);
             block_count--;
         }
-        fprintf(file, "%llu;%llu\n", pg_file_size(), block_count);
+        fprintf(file, "%llu;%llu\n", pg_file_size(pager), block_count);
         fflush(file);
-        logger(LL_WARN, __func__, "File size: %llu, blocks count: %llu", pg_file_size(), block_count);
+        logger(LL_WARN, __func__, "File size: %llu, blocks count: %llu", pg_file_size(pager), block_count);
     }
     close(fd);
-    pg_delete();
+    pg_delete(pager);
 }
\ No newline at end of file
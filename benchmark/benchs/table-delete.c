@@ -16,7 +16,7 @@ const int TEST_TIME = 2*60;
 const int ALLOCATION = 500;
 const int DEALLOCATION = 300;
 
-void insert_rows(table_t* table, schema_t* schema, int64_t start_index, int64_t number_of_rows) {
+void insert_rows(pager_t* pager, table_t* table, schema_t* schema, int64_t start_index, int64_t number_of_rows) {
     tab_row(
             int64_t ID;
             char NAME[10];
@@ -29,19 +29,19 @@ void insert_rows(table_t* table, schema_t* schema, int64_t start_index, int64_t
         row.SCORE = 9.9f;
         row.AGE = index;
         row.PASS = true;
-        chblix_t block = tab_insert(table, schema, &row);
+        rowid_t block = tab_insert(pager, table, schema, &row);
 //            printf("id: %lld\n", j);
-        if (chblix_cmp(&block, &CHBLIX_FAIL) == 0) {
+        if (block == ROWID_FAIL) {
             logger(LL_ERROR, __func__, "Failed to insert row ");
             return;
         }
     }
 }
 
-void delete_rows(FILE* file, db_t* db, table_t* table, schema_t* schema, field_t* field, int64_t start_index, int64_t number_of_rows) {
+void delete_rows(pager_t* pager, FILE* file, db_t* db, table_t* table, schema_t* schema, field_t* field, int64_t start_index, int64_t number_of_rows) {
     for (int64_t index = start_index; index < start_index + number_of_rows; ++index) {
         int64_t value = index;
-        int res = tab_delete_op(db, table, schema, field, COND_EQ, &value);
+        int res = tab_delete_op(pager, db, table, schema, field, COND_EQ, &value);
 
         if (res == TABLE_FAIL) {
             logger(LL_ERROR, __func__, "Failed to delete row ");
@@ -54,22 +54,23 @@ void delete_rows(FILE* file, db_t* db, table_t* table, schema_t* schema, field_t
 int main(){
     struct timespec start, end;
 
-    db_t* db = db_init(TEST_DB);
-    if(pg_file_size() > 0){
-        db_drop();
-        db = db_init(TEST_DB);
+    pager_t* pager = db_init(TEST_DB);
+    if(pg_file_size(pager) > 0){
+        db_drop(pager);
+        pager = db_init(TEST_DB);
     }
+    db_t* db = db_get(pager);
     sleep(5);
     FILE* file = fopen(CSV_FILE, "w+");
     fprintf(file, "%s", CSV_HEADER);
     /* Create table */
-    schema_t* schema = sch_init();
-    sch_add_int_field(schema, "ID");
-    sch_add_char_field(schema, "NAME", 10);
-    sch_add_float_field(schema, "SCORE");
-    sch_add_int_field(schema, "AGE");
-    sch_add_bool_field(schema, "PASS");
-    table_t* table = tab_init(db, "STUDENT", schema);
+    schema_t* schema = sch_init(pager);
+    sch_add_int_field(pager, schema, "ID");
+    sch_add_char_field(pager, schema, "NAME", 10);
+    sch_add_float_field(pager, schema, "SCORE");
+    sch_add_int_field(pager, schema, "AGE");
+    sch_add_bool_field(pager, schema, "PASS");
+    table_t* table = tab_init(pager, db, "STUDENT", schema);
     tab_row(
             int64_t ID;
             char NAME[10];
@@ -78,9 +79,9 @@ int main(){
             bool PASS;
     );
     field_t field;
-    if(sch_get_field(schema, "ID", &field) == SCHEMA_FAIL){
+    if(sch_get_field(pager, schema, "ID", &field) == SCHEMA_FAIL){
         fclose(file);
-        db_drop();
+        db_drop(pager);
         return TABLE_FAIL;
     }
     time_t test_start = time(NULL);
@@ -89,10 +90,10 @@ int main(){
     int64_t rows_inserted = 0;
     int64_t next_insert_start = 0;
     while(test_end - test_start < TEST_TIME) {
-        insert_rows(table, schema, next_insert_start, ALLOCATION);
+        insert_rows(pager, table, schema, next_insert_start, ALLOCATION);
         printf("Blocks allocated before delete: %"PRId64"\n", rows_inserted + ALLOCATION);
         clock_gettime(CLOCK_UPTIME_RAW, &start);
-        delete_rows(file, db, table, schema, &field, next_insert_start, DEALLOCATION);
+        delete_rows(pager, file, db, table, schema, &field, next_insert_start, DEALLOCATION);
         clock_gettime(CLOCK_UPTIME_RAW, &end);
         double delta_us = (double)(end.tv_sec - start.tv_sec) * 1000000 + (double)(end.tv_nsec - start.tv_nsec) / 1000;
         delta_us /= DEALLOCATION;
@@ -101,11 +102,11 @@ int main(){
         printf("Blocks allocated after delete: %"PRId64"\n", rows_inserted);
         fprintf(file, "%f;%"PRId64"\n", delta_us, rows_inserted);
         fflush(file);
-//        logger(LL_WARN, __func__, "File size: %llu, blocks count: %llu", pg_file_size(), deallocation);
+//        logger(LL_WARN, __func__, "File size: %llu, blocks count: %llu", pg_file_size(pager), deallocation);
         i++;
         test_end = time(NULL);
     }
     printf("Test time: %jd\n", test_end - test_start);
     fclose(file);
-    db_drop();
+    db_drop(pager);
 }
\ No newline at end of file
@@ -10,8 +10,27 @@ const int TEST_TIME = 20*60;
 const int ALLOCATION = 500;
 const int DEALLOCATION = 400;
 
+/* Write-ahead log overhead: log is committed every commit_rows inserted rows, 0 - never,
+ * cache budget in pages, 0 - default */
+typedef struct insert_mode{
+    const char* name;
+    bool wal;
+    syn_mode_t sync;
+    int commit_rows;
+    size_t budget;
+} insert_mode_t;
 
-void insert_rows(table_t* table, schema_t* schema, int64_t start_index, int64_t number_of_rows) {
+static const insert_mode_t MODES[] = {
+        {"plain", false, SYN_MODE_NONE, 0, 0},
+        {"wal", true, SYN_MODE_NONE, ALLOCATION, 0},
+        {"wal-row", true, SYN_MODE_NONE, 1, 0},
+        {"wal-sync", true, SYN_MODE_COMMIT, ALLOCATION, 0},
+        {"wal-sync-row", true, SYN_MODE_COMMIT, 1, 0},
+        /* pages which aren't committed outgrow cache and are spilled to log */
+        {"wal-spill", true, SYN_MODE_NONE, 0, 64},
+};
+
+void insert_rows(pager_t* pager, table_t* table, schema_t* schema, int64_t start_index, int64_t number_of_rows, int commit_rows) {
     tab_row(
             int64_t ID;
             char NAME[10];
@@ -24,18 +43,22 @@ void insert_rows(table_t* table, schema_t* schema, int64_t start_index, int64_t
         row.SCORE = 9.9f;
         row.AGE = index;
         row.PASS = true;
-        chblix_t block = tab_insert(table, schema,&row);
-        if (chblix_cmp(&block, &CHBLIX_FAIL) == 0) {
+        rowid_t block = tab_insert(pager, table, schema,&row);
+        if (block == ROWID_FAIL) {
             logger(LL_ERROR, __func__, "Failed to insert row ");
             return;
         }
+        if (commit_rows && (index - start_index + 1) % commit_rows == 0 && db_commit(pager) == DB_FAIL) {
+            logger(LL_ERROR, __func__, "Failed to commit");
+            return;
+        }
     }
 }
 
-void delete_rows(db_t* db, table_t* table, schema_t* schema, field_t* field, int64_t start_index, int64_t number_of_rows) {
+void delete_rows(pager_t* pager, db_t* db, table_t* table, schema_t* schema, field_t* field, int64_t start_index, int64_t number_of_rows) {
     for (int64_t index = start_index; index < start_index + number_of_rows; ++index) {
         int64_t value = index;
-        int res = tab_delete_op(db, table, schema, field, COND_EQ, &value);
+        int res = tab_delete_op(pager, db, table, schema, field, COND_EQ, &value);
         if (res == TABLE_FAIL) {
             logger(LL_ERROR, __func__, "Failed to delete row ");
             return;
@@ -43,23 +66,34 @@ void delete_rows(db_t* db, table_t* table, schema_t* schema, field_t* field, int
     }
 }
 
-int main(){
-    db_t* db = db_init(TEST_DB);
-    if(pg_file_size() > 0){
-        db_drop();
-        db = db_init(TEST_DB);
+/* Usage: bench_table-insert [mode [seconds]] */
+int main(int argc, char** argv){
+    const insert_mode_t* mode = &MODES[0];
+    for(size_t i = 0; argc > 1 && i < sizeof(MODES) / sizeof(MODES[0]); ++i){
+        if(strcmp(argv[1], MODES[i].name) == 0){
+            mode = &MODES[i];
+        }
+    }
+    int test_time = argc > 2 ? atoi(argv[2]) : TEST_TIME;
+    db_options_t opt = {.cache = {.wal = mode->wal, .sync = {.mode = mode->sync}, .budget = mode->budget * PAGE_SIZE}};
+    pager_t* pager = db_init_opt(TEST_DB, &opt);
+    if(pg_file_size(pager) > 0){
+        db_drop(pager);
+        pager = db_init_opt(TEST_DB, &opt);
     }
+    db_t* db = db_get(pager);
+    printf("Mode: %s\n", mode->name);
     FILE* file = fopen(CSV_FILE, "w+");
     fprintf(file, "%s", CSV_HEADER);
 
     /* Create table */
-    schema_t* schema = sch_init();
-    sch_add_int_field(schema, "ID");
-    sch_add_char_field(schema, "NAME", 10);
-    sch_add_float_field(schema, "SCORE");
-    sch_add_int_field(schema, "AGE");
-    sch_add_bool_field(schema, "PASS");
-    table_t* table = tab_init(db, "STUDENT", schema);
+    schema_t* schema = sch_init(pager);
+    sch_add_int_field(pager, schema, "ID");
+    sch_add_char_field(pager, schema, "NAME", 10);
+    sch_add_float_field(pager, schema, "SCORE");
+    sch_add_int_field(pager, schema, "AGE");
+    sch_add_bool_field(pager, schema, "PASS");
+    table_t* table = tab_init(pager, db, "STUDENT", schema);
     tab_row(
             int64_t ID;
             char NAME[10];
@@ -72,7 +106,7 @@ int main(){
     row.AGE = 20;
     row.PASS = true;
     field_t field;
-    sch_get_field(schema, "ID", &field);
+    sch_get_field(pager, schema, "ID", &field);
 
     time_t test_start = time(NULL);
     time_t test_end = time(NULL);
@@ -85,25 +119,25 @@ int main(){
 
     struct timespec start, end;
 
-    while(test_end - test_start < TEST_TIME) {
+    while(test_end - test_start < test_time) {
         clock_gettime(CLOCK_UPTIME_RAW, &start);
-        insert_rows(table, schema, next_insert_start, ALLOCATION);
+        insert_rows(pager, table, schema, next_insert_start, ALLOCATION, mode->commit_rows);
         clock_gettime(CLOCK_UPTIME_RAW, &end);
-        int64_t delta_us = (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000;
-        delta_us /= ALLOCATION;
+        int64_t delta_ns = (end.tv_sec - start.tv_sec) * 1000000000 + (end.tv_nsec - start.tv_nsec);
+        int64_t delta_us = delta_ns / 1000 / ALLOCATION;
         times_count++;
-        times_sum += delta_us;
+        times_sum += delta_ns / ALLOCATION;
         avg = times_sum / times_count;
-        delete_rows(db, table, schema, &field, next_insert_start, DEALLOCATION);
+        delete_rows(pager, db, table, schema, &field, next_insert_start, DEALLOCATION);
         rows_inserted = rows_inserted + ALLOCATION - DEALLOCATION;
         next_insert_start += ALLOCATION;
         fprintf(file, "%"PRIu64";%llu\n", delta_us, rows_inserted);
         fflush(file);
-        logger(LL_WARN, __func__, "File size: %"PRId64", blocks count: %"PRId64, pg_file_size(), rows_inserted);
+        logger(LL_WARN, __func__, "File size: %"PRId64", blocks count: %"PRId64, pg_file_size(pager), rows_inserted);
         test_end = time(NULL);
     }
     printf("Test time: %jd\n", test_end - test_start);
-    printf("Avg insertion time: %"PRId64"\n", avg);
+    printf("Avg insertion time: %"PRId64" ns\n", avg);
     fclose(file);
-    db_drop();
+    db_drop(pager);
 }
\ No newline at end of file
@@ -1,15 +1,16 @@
 #include "../src/bench.h"
 #include "backend/table/table.h"
 #include "utils/logger.h"
+#include <inttypes.h>
 
 const char* TEST_DB = "test.db";
 const char* CSV_FILE = "table-mem.csv";
-const char* CSV_HEADER= "FileSize;Rows\n";
+const char* CSV_HEADER= "FileSize;DiskSize;Rows\n";
 const int TEST_TIME = 2*60;
 const int ALLOCATION = 500;
 const int DEALLOCATION = 400;
 
-void insert_rows(table_t* table, schema_t* schema, int64_t start_index, int64_t number_of_rows) {
+void insert_rows(pager_t* pager, table_t* table, schema_t* schema, int64_t start_index, int64_t number_of_rows) {
     tab_row(
             int64_t ID;
             char NAME[10];
@@ -22,18 +23,18 @@ void insert_rows(table_t* table, schema_t* schema, int64_t start_index, int64_t
         row.SCORE = 9.9f;
         row.AGE = index;
         row.PASS = true;
-        chblix_t block = tab_insert(table, schema,&row);
-        if (chblix_cmp(&block, &CHBLIX_FAIL) == 0) {
+        rowid_t block = tab_insert(pager, table, schema,&row);
+        if (block == ROWID_FAIL) {
             logger(LL_ERROR, __func__, "Failed to insert row ");
             return;
         }
     }
 }
 
-void delete_rows(db_t* db, table_t* table, schema_t* schema, field_t* field, int64_t start_index, int64_t number_of_rows) {
+void delete_rows(pager_t* pager, db_t* db, table_t* table, schema_t* schema, field_t* field, int64_t start_index, int64_t number_of_rows) {
     for (int64_t index = start_index; index < start_index + number_of_rows; ++index) {
         int64_t value = index;
-        int res = tab_delete_op(db, table, schema, field, COND_EQ, &value);
+        int res = tab_delete_op(pager, db, table, schema, field, COND_EQ, &value);
 
         if (res == TABLE_FAIL) {
             logger(LL_ERROR, __func__, "Failed to delete row ");
@@ -42,23 +43,28 @@ void delete_rows(db_t* db, table_t* table, schema_t* schema, field_t* field, int
     }
 }
 
-int main(){
-    db_t* db = db_init(TEST_DB);
-    if(pg_file_size() > 0){
-        db_drop();
-        db = db_init(TEST_DB);
+/* Usage: bench_table-mem [punch], punch - blocks of freed pages are released */
+int main(int argc, char** argv){
+    bool punch = argc > 1 && strcmp(argv[1], "punch") == 0;
+    db_options_t opt = {.cache = {.punch_holes = punch}};
+    pager_t* pager = db_init_opt(TEST_DB, &opt);
+    if(pg_file_size(pager) > 0){
+        db_drop(pager);
+        pager = db_init_opt(TEST_DB, &opt);
     }
+    db_t* db = db_get(pager);
+    printf("Hole punching: %s\n", punch ? "on" : "off");
     FILE* file = fopen(CSV_FILE, "w+");
     fprintf(file, "%s", CSV_HEADER);
     /* Create table */
 
-    schema_t* schema = sch_init();
-    sch_add_int_field(schema, "ID");
-    sch_add_char_field(schema, "NAME", 10);
-    sch_add_float_field(schema, "SCORE");
-    sch_add_int_field(schema, "AGE");
-    sch_add_bool_field(schema, "PASS");
-    table_t* table = tab_init(db, "STUDENT", schema);
+    schema_t* schema = sch_init(pager);
+    sch_add_int_field(pager, schema, "ID");
+    sch_add_char_field(pager, schema, "NAME", 10);
+    sch_add_float_field(pager, schema, "SCORE");
+    sch_add_int_field(pager, schema, "AGE");
+    sch_add_bool_field(pager, schema, "PASS");
+    table_t* table = tab_init(pager, db, "STUDENT", schema);
     tab_row(
             int64_t ID;
             char NAME[10];
@@ -76,17 +82,19 @@ int main(){
     int64_t next_insert_start = 0;
 
     field_t field;
-    sch_get_field(schema, "ID", &field);
+    sch_get_field(pager, schema, "ID", &field);
 
-    while(pg_file_size() < max_file_size){
-        insert_rows(table, schema, next_insert_start, ALLOCATION);
-        delete_rows(db, table, schema, &field, next_insert_start, DEALLOCATION);
+    while(pg_file_size(pager) < max_file_size){
+        insert_rows(pager, table, schema, next_insert_start, ALLOCATION);
+        delete_rows(pager, db, table, schema, &field, next_insert_start, DEALLOCATION);
         rows_inserted = rows_inserted + ALLOCATION - DEALLOCATION;
         next_insert_start += ALLOCATION;
-        fprintf(file, "%llu;%llu\n", pg_file_size(), rows_inserted);
+        fprintf(file, "%"PRId64";%"PRId64";%"PRId64"\n",
+                (int64_t)pg_file_size(pager), (int64_t)pg_disk_size(pager), rows_inserted);
         fflush(file);
-        logger(LL_WARN, __func__, "File size: %llu, blocks count: %llu", pg_file_size(), rows_inserted);
+        logger(LL_WARN, __func__, "File size: %"PRId64", disk size: %"PRId64", blocks count: %"PRId64,
+               (int64_t)pg_file_size(pager), (int64_t)pg_disk_size(pager), rows_inserted);
     }
     fclose(file);
-    db_drop();
+    db_drop(pager);
 }
@@ -9,7 +9,7 @@ const int TEST_TIME = 2*60;
 const int ALLOCATION = 500;
 const int DEALLOCATION = 400;
 
-void insert_rows(table_t* table, schema_t* schema, int64_t start_index, int64_t number_of_rows) {
+void insert_rows(pager_t* pager, table_t* table, schema_t* schema, int64_t start_index, int64_t number_of_rows) {
     tab_row(
             int64_t ID;
     char NAME[10];
@@ -22,18 +22,18 @@ void insert_rows(table_t* table, schema_t* schema, int64_t start_index, int64_t
         row.SCORE = 9.9f;
         row.AGE = index;
         row.PASS = true;
-        chblix_t block = tab_insert(table, schema,&row);
-        if (chblix_cmp(&block, &CHBLIX_FAIL) == 0) {
+        rowid_t block = tab_insert(pager, table, schema,&row);
+        if (block == ROWID_FAIL) {
             logger(LL_ERROR, __func__, "Failed to insert row ");
             return;
         }
     }
 }
 
-void delete_rows(db_t* db, table_t* table, schema_t* schema, field_t* field, int64_t start_index, int64_t number_of_rows) {
+void delete_rows(pager_t* pager, db_t* db, table_t* table, schema_t* schema, field_t* field, int64_t start_index, int64_t number_of_rows) {
     for (int64_t index = start_index; index < start_index + number_of_rows; ++index) {
         int64_t value = index;
-        int res = tab_delete_op(db, table, schema, field, COND_EQ, &value);
+        int res = tab_delete_op(pager, db, table, schema, field, COND_EQ, &value);
 
         if (res == TABLE_FAIL) {
             logger(LL_ERROR, __func__, "Failed to delete row ");
@@ -43,22 +43,23 @@ void delete_rows(db_t* db, table_t* table, schema_t* schema, field_t* field, int
 }
 
 int main(){
-    db_t* db = db_init(TEST_DB);
-    if(pg_file_size() > 0){
-        db_drop();
-        db = db_init(TEST_DB);
+    pager_t* pager = db_init(TEST_DB);
+    if(pg_file_size(pager) > 0){
+        db_drop(pager);
+        pager = db_init(TEST_DB);
     }
+    db_t* db = db_get(pager);
     FILE* file = fopen(CSV_FILE, "w+");
     fprintf(file, "%s", CSV_HEADER);
     /* Create table */
 
-    schema_t* schema = sch_init();
-    sch_add_int_field(schema, "ID");
-    sch_add_char_field(schema, "NAME", 10);
-    sch_add_float_field(schema, "SCORE");
-    sch_add_int_field(schema, "AGE");
-    sch_add_bool_field(schema, "PASS");
-    table_t* table = tab_init(db, "STUDENT", schema);
+    schema_t* schema = sch_init(pager);
+    sch_add_int_field(pager, schema, "ID");
+    sch_add_char_field(pager, schema, "NAME", 10);
+    sch_add_float_field(pager, schema, "SCORE");
+    sch_add_int_field(pager, schema, "AGE");
+    sch_add_bool_field(pager, schema, "PASS");
+    table_t* table = tab_init(pager, db, "STUDENT", schema);
     tab_row(
             int64_t ID;
     char NAME[10];
@@ -76,17 +77,17 @@ int main(){
     int64_t next_insert_start = 0;
 
     field_t field;
-    sch_get_field(schema, "ID", &field);
+    sch_get_field(pager, schema, "ID", &field);
 
-    while(pg_file_size() < max_file_size){
-        insert_rows(table, schema, next_insert_start, ALLOCATION);
-        delete_rows(db, table, schema, &field, next_insert_start, DEALLOCATION);
+    while(pg_file_size(pager) < max_file_size){
+        insert_rows(pager, table, schema, next_insert_start, ALLOCATION);
+        delete_rows(pager, db, table, schema, &field, next_insert_start, DEALLOCATION);
         rows_inserted = rows_inserted + ALLOCATION - DEALLOCATION;
         next_insert_start += ALLOCATION;
-        fprintf(file, "%zu;%llu\n", pg_cached_size() * PAGE_SIZE, rows_inserted);
+        fprintf(file, "%zu;%llu\n", pg_cached_size(pager) * PAGE_SIZE, rows_inserted);
         fflush(file);
-        logger(LL_WARN, __func__, "File size: %llu, blocks count: %llu", pg_file_size(), rows_inserted);
+        logger(LL_WARN, __func__, "File size: %llu, blocks count: %llu", pg_file_size(pager), rows_inserted);
     }
     fclose(file);
-    db_drop();
+    db_drop(pager);
 }
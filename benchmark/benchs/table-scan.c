@@ -0,0 +1,114 @@
+#include "../src/bench.h"
+#include "backend/table/table.h"
+#include "utils/logger.h"
+#include <inttypes.h>
+
+const char* TEST_DB = "test.db";
+const char* CSV_FILE = "table-scan.csv";
+const char* CSV_HEADER = "Mode;Rows;Time;HugeBytes\n";
+const int64_t ROWS = 500000;
+const int SCANS = 10;
+const int64_t BATCH = 256;
+
+struct timespec start, end;
+
+typedef struct scan_mode{
+    const char* name;
+    fl_backend_t backend;
+    bool huge_pages;
+} scan_mode_t;
+
+static const scan_mode_t MODES[] = {
+        {"mmap", FL_BACKEND_MMAP, false},
+        {"mmap-huge", FL_BACKEND_MMAP, true},
+        {"pread", FL_BACKEND_PREAD, false},
+        {"pread-huge", FL_BACKEND_PREAD, true},
+};
+
+tab_row(
+        int64_t ID;
+        char NAME[10];
+        float SCORE;
+        int64_t AGE;
+        bool PASS;
+);
+
+static pager_t* open_db(const scan_mode_t* mode){
+    db_options_t opt = {.cache = {.file = {.backend = mode->backend, .huge_pages = mode->huge_pages}}};
+    pager_t* pager = db_init_opt(TEST_DB, &opt);
+    if(pager == NULL){
+        printf("Failed to init file\n");
+        exit(EXIT_FAILURE);
+    }
+    return pager;
+}
+
+static void fill_table(const scan_mode_t* mode){
+    pager_t* pager = open_db(mode);
+    if(pg_file_size(pager) > 0){
+        db_drop(pager);
+        pager = open_db(mode);
+    }
+    db_t* db = db_get(pager);
+    schema_t* schema = sch_init(pager);
+    sch_add_int_field(pager, schema, "ID");
+    sch_add_char_field(pager, schema, "NAME", 10);
+    sch_add_float_field(pager, schema, "SCORE");
+    sch_add_int_field(pager, schema, "AGE");
+    sch_add_bool_field(pager, schema, "PASS");
+    table_t* table = tab_init(pager, db, "STUDENT", schema);
+    for(int64_t index = 0; index < ROWS; ++index){
+        row.ID = index;
+        row.SCORE = 9.9f;
+        row.AGE = index;
+        row.PASS = true;
+        rowid_t block = tab_insert(pager, table, schema, &row);
+        if(block == ROWID_FAIL){
+            logger(LL_ERROR, __func__, "Failed to insert row");
+            exit(EXIT_FAILURE);
+        }
+    }
+    db_close(pager);
+}
+
+static void scan_table(FILE* file, const scan_mode_t* mode){
+    pager_t* pager = open_db(mode);
+    db_t* db = db_get(pager);
+    int64_t tablix = mtab_find_table_by_name(pager, db->meta_table_idx, "STUDENT");
+    table_t* table = tab_read(pager, tablix);
+    schema_t* schema = sch_read(pager, table->schidx);
+    int64_t sum = 0;
+    row_t* rows = malloc(BATCH * schema->slot_size);
+    clock_gettime(CLOCK_UPTIME_RAW, &start);
+    for(int scan = 0; scan < SCANS; ++scan){
+        tab_cursor_t cursor;
+        if(tab_cursor_open(pager, &cursor, table) == TABLE_FAIL){
+            logger(LL_ERROR, __func__, "Failed to open cursor");
+            exit(EXIT_FAILURE);
+        }
+        for(int64_t count; (count = tab_cursor_next_batch(pager, &cursor, NULL, rows, BATCH)) > 0;){
+            for(int64_t i = 0; i < count; ++i){
+                sum += rows[i].AGE;
+            }
+        }
+        tab_cursor_close(pager, &cursor);
+    }
+    clock_gettime(CLOCK_UPTIME_RAW, &end);
+    free(rows);
+    int64_t delta_us = (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000;
+    printf("%s: %f us per scan, checksum %"PRId64", huge pages %zu bytes\n",
+           mode->name, (double)delta_us / SCANS, sum, pg_huge_bytes(pager));
+    fprintf(file, "%s;%"PRId64";%f;%zu\n", mode->name, ROWS, (double)delta_us / SCANS, pg_huge_bytes(pager));
+    fflush(file);
+    db_drop(pager);
+}
+
+int main(){
+    FILE* file = fopen(CSV_FILE, "w+");
+    fprintf(file, "%s", CSV_HEADER);
+    for(size_t i = 0; i < sizeof(MODES) / sizeof(MODES[0]); ++i){
+        fill_table(&MODES[i]);
+        scan_table(file, &MODES[i]);
+    }
+    fclose(file);
+}
@@ -18,7 +18,7 @@ const int SELECT = 30;
 
 struct timespec start, end;
 
-void insert_rows(table_t* table, schema_t* schema, int64_t start_index, int64_t number_of_rows) {
+void insert_rows(pager_t* pager, table_t* table, schema_t* schema, int64_t start_index, int64_t number_of_rows) {
     tab_row(
             int64_t ID;
             char NAME[10];
@@ -31,16 +31,16 @@ void insert_rows(table_t* table, schema_t* schema, int64_t start_index, int64_t
         row.SCORE = 9.9f;
         row.AGE = index;
         row.PASS = true;
-        chblix_t block = tab_insert(table, schema, &row);
+        rowid_t block = tab_insert(pager, table, schema, &row);
 //            printf("id: %lld\n", j);
-        if (chblix_cmp(&block, &CHBLIX_FAIL) == 0) {
+        if (block == ROWID_FAIL) {
             logger(LL_ERROR, __func__, "Failed to insert row ");
             return;
         }
     }
 }
 
-int select_rows(FILE* file, db_t* db, table_t* table, schema_t* schema, field_t* field, int64_t start_index, int64_t number_of_rows, int64_t rows_inserted) {
+int select_rows(pager_t* pager, FILE* file, db_t* db, table_t* table, schema_t* schema, field_t* field, int64_t start_index, int64_t number_of_rows, int64_t rows_inserted) {
     tab_row(
             int64_t ID;
             char NAME[10];
@@ -50,13 +50,13 @@ int select_rows(FILE* file, db_t* db, table_t* table, schema_t* schema, field_t*
     );
     for (int64_t index = start_index; index < start_index + number_of_rows; ++index) {
         clock_gettime(CLOCK_UPTIME_RAW, &start);
-        table_t* sel_table = tab_select_op(db, table, schema, field, "SELECT", COND_EQ, &index, DT_INT);
+        table_t* sel_table = tab_select_op(pager, db, table, schema, field, "SELECT", COND_EQ, &index, DT_INT);
         clock_gettime(CLOCK_UPTIME_RAW, &end);
         if (sel_table == NULL) {
             logger(LL_ERROR, __func__, "Failed to delete row ");
             return -1;
         }
-        tab_drop(db,sel_table);
+        tab_drop(pager, db,sel_table);
     }
     int64_t delta_us = (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000;
     fprintf(file, "%f;%"PRId64"\n", (double)delta_us / (double)SELECT, rows_inserted);
@@ -66,22 +66,23 @@ int select_rows(FILE* file, db_t* db, table_t* table, schema_t* schema, field_t*
 
 
 int main(){
-    db_t* db = db_init(TEST_DB);
-    if(pg_file_size() > 0){
-        db_drop();
-        db = db_init(TEST_DB);
+    pager_t* pager = db_init(TEST_DB);
+    if(pg_file_size(pager) > 0){
+        db_drop(pager);
+        pager = db_init(TEST_DB);
     }
+    db_t* db = db_get(pager);
     sleep(5);
     FILE* file = fopen(CSV_FILE, "w+");
     fprintf(file, "%s", CSV_HEADER);
     /* Create table */
-    schema_t* schema = sch_init();
-    sch_add_int_field(schema, "ID");
-    sch_add_char_field(schema, "NAME", 10);
-    sch_add_float_field(schema, "SCORE");
-    sch_add_int_field(schema, "AGE");
-    sch_add_bool_field(schema, "PASS");
-    table_t* table = tab_init(db, "STUDENT", schema);
+    schema_t* schema = sch_init(pager);
+    sch_add_int_field(pager, schema, "ID");
+    sch_add_char_field(pager, schema, "NAME", 10);
+    sch_add_float_field(pager, schema, "SCORE");
+    sch_add_int_field(pager, schema, "AGE");
+    sch_add_bool_field(pager, schema, "PASS");
+    table_t* table = tab_init(pager, db, "STUDENT", schema);
     tab_row(
             int64_t ID;
             char NAME[10];
@@ -90,7 +91,7 @@ int main(){
             bool PASS;
     );
     field_t field;
-    if(sch_get_field(schema, "ID", &field) == SCHEMA_FAIL){
+    if(sch_get_field(pager, schema, "ID", &field) == SCHEMA_FAIL){
         return TABLE_FAIL;
     }
     time_t test_start = time(NULL);
@@ -99,18 +100,18 @@ int main(){
     int64_t rows_inserted = 0;
     int64_t next_insert_start = 0;
     while(test_end - test_start < TEST_TIME) {
-        insert_rows(table, schema, next_insert_start, ALLOCATION);
+        insert_rows(pager, table, schema, next_insert_start, ALLOCATION);
         rows_inserted = rows_inserted + ALLOCATION;
-        if(select_rows(file, db, table, schema, &field, next_insert_start, SELECT, rows_inserted) == -1){
+        if(select_rows(pager, file, db, table, schema, &field, next_insert_start, SELECT, rows_inserted) == -1){
             exit(EXIT_FAILURE);
         };
         next_insert_start += ALLOCATION;
         printf("Blocks allocated: %"PRId64"\n", rows_inserted);
-//        logger(LL_WARN, __func__, "File size: %llu, blocks count: %llu", pg_file_size(), deallocation);
+//        logger(LL_WARN, __func__, "File size: %llu, blocks count: %llu", pg_file_size(pager), deallocation);
         i++;
         test_end = time(NULL);
     }
     printf("Test time: %jd\n", test_end - test_start);
     fclose(file);
-    db_drop();
+    db_drop(pager);
 }
\ No newline at end of file
@@ -17,7 +17,7 @@ const int TEST_TIME = 2*60;
 const int ALLOCATION = 500;
 const int UPDATE = 300;
 
-void insert_rows(table_t* table, schema_t* schema, int64_t start_index, int64_t number_of_rows) {
+void insert_rows(pager_t* pager, table_t* table, schema_t* schema, int64_t start_index, int64_t number_of_rows) {
     tab_row(
             int64_t ID;
             char NAME[10];
@@ -30,16 +30,16 @@ void insert_rows(table_t* table, schema_t* schema, int64_t start_index, int64_t
         row.SCORE = 9.9f;
         row.AGE = index;
         row.PASS = true;
-        chblix_t block = tab_insert(table, schema, &row);
+        rowid_t block = tab_insert(pager, table, schema, &row);
 //            printf("id: %lld\n", j);
-        if (chblix_cmp(&block, &CHBLIX_FAIL) == 0) {
+        if (block == ROWID_FAIL) {
             logger(LL_ERROR, __func__, "Failed to insert row ");
             return;
         }
     }
 }
 
-void update_rows(db_t* db, table_t* table, schema_t* schema, field_t* field, int64_t start_index, int64_t number_of_rows) {
+void update_rows(pager_t* pager, db_t* db, table_t* table, schema_t* schema, field_t* field, int64_t start_index, int64_t number_of_rows) {
     tab_row(
             int64_t ID;
             char NAME[10];
@@ -54,7 +54,7 @@ void update_rows(db_t* db, table_t* table, schema_t* schema, field_t* field, int
         row.PASS = true;
         int64_t value = index;
         printf("index: %lld ", index);
-        int res = tab_update_row_op(db, table, schema, field, COND_EQ, &value, DT_INT,&row);
+        int res = tab_update_row_op(pager, db, table, schema, field, COND_EQ, &value, DT_INT,&row);
         if (res == TABLE_FAIL) {
             logger(LL_ERROR, __func__, "Failed to delete row ");
             return;
@@ -66,22 +66,23 @@ void update_rows(db_t* db, table_t* table, schema_t* schema, field_t* field, int
 int main(){
     struct timespec start, end;
 
-    db_t* db = db_init(TEST_DB);
-    if(pg_file_size() > 0){
-        db_drop();
-        db = db_init(TEST_DB);
+    pager_t* pager = db_init(TEST_DB);
+    if(pg_file_size(pager) > 0){
+        db_drop(pager);
+        pager = db_init(TEST_DB);
     }
+    db_t* db = db_get(pager);
     sleep(5);
     FILE* file = fopen(CSV_FILE, "w+");
     fprintf(file, "%s", CSV_HEADER);
     /* Create table */
-    schema_t* schema = sch_init();
-    sch_add_int_field(schema, "ID");
-    sch_add_char_field(schema, "NAME", 10);
-    sch_add_float_field(schema, "SCORE");
-    sch_add_int_field(schema, "AGE");
-    sch_add_bool_field(schema, "PASS");
-    table_t* table = tab_init(db, "STUDENT", schema);
+    schema_t* schema = sch_init(pager);
+    sch_add_int_field(pager, schema, "ID");
+    sch_add_char_field(pager, schema, "NAME", 10);
+    sch_add_float_field(pager, schema, "SCORE");
+    sch_add_int_field(pager, schema, "AGE");
+    sch_add_bool_field(pager, schema, "PASS");
+    table_t* table = tab_init(pager, db, "STUDENT", schema);
     tab_row(
             int64_t ID;
     char NAME[10];
@@ -90,7 +91,7 @@ int main(){
     bool PASS;
     );
     field_t field;
-    if(sch_get_field(schema, "ID", &field) == SCHEMA_FAIL){
+    if(sch_get_field(pager, schema, "ID", &field) == SCHEMA_FAIL){
         return TABLE_FAIL;
     }
     time_t test_start = time(NULL);
@@ -99,11 +100,11 @@ int main(){
     int64_t rows_inserted = 0;
     int64_t next_insert_start = 0;
     while(test_end - test_start < TEST_TIME) {
-        insert_rows(table, schema, next_insert_start, ALLOCATION);
-        int64_t count = lb_print_used(&table->ppl_header);
+        insert_rows(pager, table, schema, next_insert_start, ALLOCATION);
+        int64_t count = lb_print_used(pager, &table->ppl_header);
         printf("Used: %"PRId64"\n", count);
         clock_gettime(CLOCK_UPTIME_RAW, &start);
-        update_rows(db, table, schema, &field, next_insert_start, UPDATE);
+        update_rows(pager, db, table, schema, &field, next_insert_start, UPDATE);
         clock_gettime(CLOCK_UPTIME_RAW, &end);
         double delta_us = (double)(end.tv_sec - start.tv_sec) * 1000000 + (double)(end.tv_nsec - start.tv_nsec) / 1000;
         delta_us /= (double)UPDATE;
@@ -112,11 +113,11 @@ int main(){
         printf("Blocks allocated: %"PRId64"\n", rows_inserted);
         fprintf(file, "%f;%"PRId64"\n", delta_us, rows_inserted);
         fflush(file);
-//        logger(LL_WARN, __func__, "File size: %llu, blocks count: %llu", pg_file_size(), deallocation);
+//        logger(LL_WARN, __func__, "File size: %llu, blocks count: %llu", pg_file_size(pager), deallocation);
         i++;
         test_end = time(NULL);
     }
     printf("Test time: %jd\n", test_end - test_start);
     fclose(file);
-    db_drop();
+    db_drop(pager);
 }
\ No newline at end of file
@@ -1 +1,7 @@
-#include "bench-utils.c"
\ No newline at end of file
+#define _GNU_SOURCE
+#include <time.h>
+/* CLOCK_UPTIME_RAW is macOS only */
+#ifndef CLOCK_UPTIME_RAW
+#define CLOCK_UPTIME_RAW CLOCK_MONOTONIC_RAW
+#endif
+#include "bench-utils.c"
@@ -2,6 +2,7 @@
 
 /**
  * @brief       Compare two values
+ * @param[in]   pager: handle of database
  * @param[in]   db: pointer to database
  * @param[in]   type: type of the values
  * @param[in]   val1: pointer to the first value
@@ -9,7 +10,7 @@
  * @return      data_t: the result of the comparison
  */
 
-data_t comp_cmp(db_t* db, datatype_t type, void* val1, void* val2){
+data_t comp_cmp(pager_t* pager, db_t* db, datatype_t type, void* val1, void* val2){
     data_t data;
     switch (type) {
         case DT_INT: {
@@ -32,9 +33,9 @@ data_t comp_cmp(db_t* db, datatype_t type, void* val1, void* val2){
             vch_ticket_t* vch1 = val1;
             vch_ticket_t* vch2 = val2;
             char* str1 = malloc(vch1->size);
-            vch_get(db->varchar_mgr_idx, vch1, str1);
+            vch_get(pager, db->varchar_mgr_idx, vch1, str1);
             char* str2 = malloc(vch2->size);
-            vch_get(db->varchar_mgr_idx, vch2, str2);
+            vch_get(pager, db->varchar_mgr_idx, vch2, str2);
             int res = strcmp(str1, str2);
             free(str1);
             free(str2);
@@ -50,6 +51,7 @@ data_t comp_cmp(db_t* db, datatype_t type, void* val1, void* val2){
 
 /**
  * @brief       Compare two values on equality
+ * @param       pager: handle of database
  * @param       db: pointer to db
  * @param       type: type of the values
  * @param       val1: pointer to the first value
@@ -57,8 +59,8 @@ data_t comp_cmp(db_t* db, datatype_t type, void* val1, void* val2){
  * @return      1 if equal, 0 if not
  */
 
-bool comp_eq(db_t* db, datatype_t type, void* val1, void* val2){
-    data_t data = comp_cmp(db, type, val1, val2);
+bool comp_eq(pager_t* pager, db_t* db, datatype_t type, void* val1, void* val2){
+    data_t data = comp_cmp(pager, db, type, val1, val2);
     switch (type) {
         case DT_INT: {
             return data.int_val == 0;
@@ -78,6 +80,7 @@ bool comp_eq(db_t* db, datatype_t type, void* val1, void* val2){
 
 /**
  * @brief       Compare two values on inequality
+ * @param       pager: handle of database
  * @param       db: pointer to db
  * @param       type: type of the values
  * @param       val1: pointer to the first value
@@ -85,12 +88,13 @@ bool comp_eq(db_t* db, datatype_t type, void* val1, void* val2){
  * @return      1 if not equal, 0 if equal
  */
 
-bool comp_neq(db_t* db, datatype_t type, void* val1, void* val2) {
-    return !comp_eq(db, type, val1, val2);
+bool comp_neq(pager_t* pager, db_t* db, datatype_t type, void* val1, void* val2) {
+    return !comp_eq(pager, db, type, val1, val2);
 }
 
 /**
  * @brief       Compare two values on less
+ * @param       pager: handle of database
  * @param       db: pointer to db
  * @param       type: type of the values
  * @param       val1: pointer to the first value
@@ -98,8 +102,8 @@ bool comp_neq(db_t* db, datatype_t type, void* val1, void* val2) {
  * @return      1 if less, 0 if not
  */
 
-bool comp_lt(db_t* db, datatype_t type, void* val1, void* val2) {
-    data_t data = comp_cmp(db, type, val1, val2);
+bool comp_lt(pager_t* pager, db_t* db, datatype_t type, void* val1, void* val2) {
+    data_t data = comp_cmp(pager, db, type, val1, val2);
     switch (type) {
         case DT_INT: {
             return data.int_val < 0;
@@ -119,6 +123,7 @@ bool comp_lt(db_t* db, datatype_t type, void* val1, void* val2) {
 
 /**
  * @brief       Compare two values on less or equal
+ * @param       pager: handle of database
  * @param       db: pointer to db
  * @param       type: type of the values
  * @param       val1: pointer to the first value
@@ -126,12 +131,13 @@ bool comp_lt(db_t* db, datatype_t type, void* val1, void* val2) {
  * @return      1 if less or equal, 0 if not
  */
 
-bool comp_le(db_t* db, datatype_t type, void* val1, void* val2) {
-    return comp_lt(db, type, val1, val2) || comp_eq(db, type, val1, val2);
+bool comp_le(pager_t* pager, db_t* db, datatype_t type, void* val1, void* val2) {
+    return comp_lt(pager, db, type, val1, val2) || comp_eq(pager, db, type, val1, val2);
 }
 
 /**
  * @brief       Compare two values on greater
+ * @param       pager: handle of database
  * @param       db: pointer to db
  * @param       type: type of the values
  * @param       val1: pointer to the first value
@@ -139,12 +145,13 @@ bool comp_le(db_t* db, datatype_t type, void* val1, void* val2) {
  * @return      1 if greater, 0 if not
  */
 
-bool comp_gt(db_t* db, datatype_t type, void* val1, void* val2) {
-    return !comp_le(db, type, val1, val2);
+bool comp_gt(pager_t* pager, db_t* db, datatype_t type, void* val1, void* val2) {
+    return !comp_le(pager, db, type, val1, val2);
 }
 
 /**
  * @brief       Compare two values on greater or equal
+ * @param       pager: handle of database
  * @param       db: pointer to db
  * @param       type: type of the values
  * @param       val1: pointer to the first value
@@ -152,12 +159,13 @@ bool comp_gt(db_t* db, datatype_t type, void* val1, void* val2) {
  * @return      1 if greater or equal, 0 if not
  */
 
-bool comp_ge(db_t* db, datatype_t type, void* val1, void* val2) {
-    return !comp_lt(db, type, val1, val2);
+bool comp_ge(pager_t* pager, db_t* db, datatype_t type, void* val1, void* val2) {
+    return !comp_lt(pager, db, type, val1, val2);
 }
 
 /**
  * @brief       Compare two values
+ * @param       pager: handle of database
  * @param       db: pointer to db
  * @param[in]   type: type of data
  * @param[in]   val1: value 1
@@ -166,25 +174,25 @@ bool comp_ge(db_t* db, datatype_t type, void* val1, void* val2) {
  * @return      true, or false depends on comparison condition
  */
 
-bool comp_compare(db_t* db, datatype_t type, void* val1, void* val2, condition_t cond) {
+bool comp_compare(pager_t* pager, db_t* db, datatype_t type, void* val1, void* val2, condition_t cond) {
     switch (cond) {
         case COND_EQ: {
-            return comp_eq(db, type, val1, val2);
+            return comp_eq(pager, db, type, val1, val2);
         }
         case COND_NEQ: {
-            return comp_neq(db, type, val1, val2);
+            return comp_neq(pager, db, type, val1, val2);
         }
         case COND_LT: {
-            return comp_lt(db, type, val1, val2);
+            return comp_lt(pager, db, type, val1, val2);
         }
         case COND_LTE: {
-            return comp_le(db, type, val1, val2);
+            return comp_le(pager, db, type, val1, val2);
         }
         case COND_GT: {
-            return comp_gt(db, type, val1, val2);
+            return comp_gt(pager, db, type, val1, val2);
         }
         case COND_GTE: {
-            return comp_ge(db, type, val1, val2);
+            return comp_ge(pager, db, type, val1, val2);
         }
         default:
             return 0;
@@ -6,11 +6,11 @@
 #include <stdbool.h>
 #include <string.h>
 
-data_t comp_cmp(db_t* db, datatype_t type, void* val1, void* val2);
-bool comp_eq(db_t* db, datatype_t type, void* val1, void* val2);
-bool comp_compare(db_t* db, datatype_t type, void* val1, void* val2, condition_t cond);
-bool comp_neq(db_t* db, datatype_t type, void* val1, void* val2);
-bool comp_lt(db_t* db, datatype_t type, void* val1, void* val2);
-bool comp_le(db_t* db, datatype_t type, void* val1, void* val2);
-bool comp_gt(db_t* db, datatype_t type, void* val1, void* val2);
-bool comp_ge(db_t* db, datatype_t type, void* val1, void* val2);
+data_t comp_cmp(pager_t* pager, db_t* db, datatype_t type, void* val1, void* val2);
+bool comp_eq(pager_t* pager, db_t* db, datatype_t type, void* val1, void* val2);
+bool comp_compare(pager_t* pager, db_t* db, datatype_t type, void* val1, void* val2, condition_t cond);
+bool comp_neq(pager_t* pager, db_t* db, datatype_t type, void* val1, void* val2);
+bool comp_lt(pager_t* pager, db_t* db, datatype_t type, void* val1, void* val2);
+bool comp_le(pager_t* pager, db_t* db, datatype_t type, void* val1, void* val2);
+bool comp_gt(pager_t* pager, db_t* db, datatype_t type, void* val1, void* val2);
+bool comp_ge(pager_t* pager, db_t* db, datatype_t type, void* val1, void* val2);
@@ -1,17 +1,17 @@
 #include "db.h"
 
-static void* db_create(void){
-    pg_alloc();
-    db_t* db = pg_load_page(1);
+static void* db_create(pager_t* pager){
+    pg_alloc(pager);
+    db_t* db = pg_load_page(pager, 1);
     if(!db){
         return NULL;
     }
-    table_t* meta_tab = mtab_init();
+    table_t* meta_tab = mtab_init(pager);
     if(meta_tab == NULL){
         return NULL;
     }
     db->meta_table_idx = table_index(meta_tab);
-    db->varchar_mgr_idx = vch_init();
+    db->varchar_mgr_idx = vch_init(pager);
     if(db->varchar_mgr_idx == TABLE_FAIL){
         return NULL;
     }
@@ -19,37 +19,103 @@ static void* db_create(void){
 }
 
 /**
- * @brief       Initialize database
+ * @brief       Initialize database, it is created if file is empty
  * @param[in]   filename: name of the file
- * @return      pointer to database on success, NULL on failure
+ * @return      handle of database on success, NULL on failure
  */
-void* db_init(const char* filename){
-    if(pg_init(filename) != PAGER_SUCCESS){
+pager_t* db_init(const char* filename){
+    return db_init_opt(filename, NULL);
+}
+
+/**
+ * @brief       Initialize database with options
+ * @details     Each open database has its own file and cache, its handle is passed to every
+ *              call working with its tables and other storage.
+ * @param[in]   filename: name of the file
+ * @param[in]   opt: database options or NULL for defaults
+ * @return      handle of database on success, NULL on failure
+ */
+pager_t* db_init_opt(const char* filename, const db_options_t* opt){
+    pager_t* pager = pg_init_opt(filename, opt ? &opt->cache : NULL);
+    if(!pager){
         return NULL;
     }
-    if(pg_max_page_index() == 0){
-        return db_create();
-    }
-    db_t* db = pg_load_page(1);
+    db_t* db = pg_max_page_index(pager) == 0 ? db_create(pager) : pg_load_page(pager, 1);
     if(!db){
+        pg_close(pager);
         return NULL;
     }
-    return db;
+    return pager;
+}
+
+/**
+ * @brief       Attach calling thread to database
+ * @details     Thread other than the one which opened database attaches before it works with
+ *              database and detaches when it is done.
+ * @param[in]   pager: handle of database
+ */
+void db_attach(pager_t* pager){
+    pg_attach(pager);
+}
+
+/**
+ * @brief       Detach calling thread from database
+ * @param[in]   pager: handle of database
+ */
+void db_detach(pager_t* pager){
+    pg_detach(pager);
+}
+
+/**
+ * @brief       Get header of database
+ * @param[in]   pager: handle of database
+ * @return      pointer to database, it is valid until the next page is loaded
+ */
+db_t* db_get(pager_t* pager){
+    return pg_load_page(pager, 1);
+}
+
+/**
+ * @brief       Commit changes
+ * @details     Without durability nothing is done, with periodic durability changes are written
+ *              to file and become durable within sync interval, with commit durability they are
+ *              durable on return. Concurrent commits share one sync of file.
+ * @param[in]   pager: handle of database
+ * @return      DB_SUCCESS on success, DB_FAIL on failure
+ */
+int db_commit(pager_t* pager){
+    return pg_commit(pager) == PAGER_SUCCESS ? DB_SUCCESS : DB_FAIL;
+}
+
+/**
+ * @brief       Compact database file by moving pages from its end to free pages
+ * @details     Can be called repeatedly between other work until it returns 0, changes become
+ *              durable with the next commit. Pages of loaded tables and schemas stay in place,
+ *              so their handles stay valid. Database with write-ahead log isn't compacted.
+ * @param[in]   pager: handle of database
+ * @param[in]   max_moves: maximal number of pages to move by this call
+ * @return      number of moved pages, 0 if nothing can be moved, DB_FAIL on failure
+ */
+int64_t db_compact(pager_t* pager, int64_t max_moves){
+    int64_t moves = pg_compact(pager, max_moves);
+    return moves == PAGER_FAIL ? DB_FAIL : moves;
 }
 
 /**
  * @brief       Close database
+ * @param[in]   pager: handle of database
  * @return      DB_SUCCESS on success, DB_FAIL on failure
  */
-int db_close(void){
-    int res =  pg_close() == PAGER_SUCCESS ? DB_SUCCESS : DB_FAIL;
+int db_close(pager_t* pager){
+    int res =  pg_close(pager) == PAGER_SUCCESS ? DB_SUCCESS : DB_FAIL;
     return res;
 }
 /**
  * @brief       Drop database
+ * @param[in]   pager: handle of database
  * @return      DB_SUCCESS on success, DB_FAIL on failure
  */
-int db_drop(void){
-    int res = pg_delete() == PAGER_SUCCESS ? DB_SUCCESS : DB_FAIL;
+int db_drop(pager_t* pager){
+    int res = pg_delete(pager) == PAGER_SUCCESS ? DB_SUCCESS : DB_FAIL;
     return res;
 }
@@ -8,8 +8,19 @@ typedef struct db{
     int64_t varchar_mgr_idx;
 } db_t;
 
-void* db_init(const char* filename);
-int db_close(void);
-int db_drop(void);
+typedef struct db_options{
+    ch_options_t cache;         /* durability is set by cache.sync, write-ahead log by cache.wal,
+                                 * hole punching of freed pages by cache.punch_holes */
+} db_options_t;
+
+pager_t* db_init(const char* filename);
+pager_t* db_init_opt(const char* filename, const db_options_t* opt);
+void db_attach(pager_t* pager);
+void db_detach(pager_t* pager);
+db_t* db_get(pager_t* pager);
+int db_close(pager_t* pager);
+int db_commit(pager_t* pager);
+int64_t db_compact(pager_t* pager, int64_t max_moves);
+int db_drop(pager_t* pager);
 
 enum dbsts_t {DB_SUCCESS = 0, DB_FAIL = -1};
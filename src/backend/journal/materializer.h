@@ -13,6 +13,6 @@ typedef struct matertab{
     int64_t next_index;
 } matertab_t;
 
-int64_t materializer_init(void);
-table_t* materializer_materialize(int64_t mater_idx, schema_t* input_schema);
+int64_t materializer_init(pager_t* pager);
+table_t* materializer_materialize(pager_t* pager, int64_t mater_idx, schema_t* input_schema);
 
@@ -4,23 +4,24 @@
 
 /**
  * @brief       Initialize the metatable
+ * @param[in]   pager: handle of database
  * @param[out]  table: pointer to table;
  * @return      pointer to table on success, NULL otherwise
  */
 
-table_t* mtab_init(void){
-    schema_t* schema = sch_init();
-    sch_add_char_field(schema, "NAME", MAX_NAME_LENGTH);
-    sch_add_int_field(schema, "INDEX");
-    table_t* table = tab_base_init("METATABLE", schema);
+table_t* mtab_init(pager_t* pager){
+    schema_t* schema = sch_init(pager);
+    sch_add_char_field(pager, schema, "NAME", MAX_NAME_LENGTH);
+    sch_add_int_field(pager, schema, "INDEX");
+    table_t* table = tab_base_init(pager, "METATABLE", schema);
     tab_row(
             char NAME[MAX_NAME_LENGTH];
             int64_t INDEX;
             );
     strncpy(row.NAME, "METATABLE", MAX_NAME_LENGTH);
     row.INDEX = table_index(table);
-    chblix_t res = tab_insert(table, schema, &row);
-    if(chblix_cmp(&res, &CHBLIX_FAIL) == 0){
+    rowid_t res = tab_insert(pager, table, schema, &row);
+    if(res == ROWID_FAIL){
         logger(LL_ERROR, __func__, "Failed to insert row ");
         return NULL;
     }
@@ -29,13 +30,19 @@ table_t* mtab_init(void){
 
 /**
  * @brief       Find table index by name
+ * @param       pager: handle of database
  * @param       metatab_idx: index of metatab
  * @param       name: name of the table
  * @return      index of the table on success, TABLE_FAIL on failure
  */
 
-int64_t mtab_find_table_by_name(int64_t metatab_idx, const char* name){
-    table_t* meta_table = tab_load(metatab_idx);
+int64_t mtab_find_table_by_name(pager_t* pager, int64_t metatab_idx, const char* name){
+    pg_scoped_t latch pg_latched = {pager, pg_latch(pager, metatab_idx, false)};
+    if(latch.page_index == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to latch metatable %ld", metatab_idx);
+        return TABLE_FAIL;
+    }
+    table_t* meta_table = tab_read(pager, metatab_idx);
     if(meta_table == NULL){
         logger(LL_ERROR, __func__, "Invalid argument: meta_table is NULL");
         return TABLE_FAIL;
@@ -44,8 +51,8 @@ int64_t mtab_find_table_by_name(int64_t metatab_idx, const char* name){
             char NAME[MAX_NAME_LENGTH];
             int64_t INDEX;
             );
-    schema_t* schema = sch_load(meta_table->schidx);
-    tab_for_each_row(meta_table, chunk, chblix, &row, schema){
+    schema_t* schema = sch_read(pager, meta_table->schidx);
+    tab_for_each_row(pager, meta_table, chunk, chblix, &row, schema){
         if(strcmp(name,row.NAME) == 0){
             return row.INDEX;
         }
@@ -55,14 +62,20 @@ int64_t mtab_find_table_by_name(int64_t metatab_idx, const char* name){
 
 /**
  * @brief       Add a table to the metatable
+ * @param[in]   pager: handle of database
  * @param[in]   metatab_idx: index of metatab
  * @param[in]   name: name of the table
  * @param[in]   index: index of the table
  * @return      TABLE_SUCCESS on success, TABLE_FAIL on failure
  */
 
-int mtab_add(int64_t metatab_idx, const char* name, int64_t index){
-    table_t* meta_table = tab_load(metatab_idx);
+int mtab_add(pager_t* pager, int64_t metatab_idx, const char* name, int64_t index){
+    pg_scoped_t latch pg_latched = {pager, pg_latch(pager, metatab_idx, true)};
+    if(latch.page_index == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to latch metatable %ld", metatab_idx);
+        return TABLE_FAIL;
+    }
+    table_t* meta_table = tab_load(pager, metatab_idx);
     if(meta_table == NULL){
         logger(LL_ERROR, __func__, "Invalid argument: meta_table is NULL");
         return TABLE_FAIL;
@@ -74,9 +87,9 @@ int mtab_add(int64_t metatab_idx, const char* name, int64_t index){
     );
     strncpy(row.NAME, name, MAX_NAME_LENGTH);
     row.INDEX = index;
-    schema_t* schema = sch_load(meta_table->schidx);
-    chblix_t res = tab_insert(meta_table, schema, &row);
-    if(chblix_cmp(&res, &CHBLIX_FAIL) == 0){
+    schema_t* schema = sch_read(pager, meta_table->schidx);
+    rowid_t res = tab_insert(pager, meta_table, schema, &row);
+    if(res == ROWID_FAIL){
         logger(LL_ERROR, __func__, "Failed to insert row ");
         return TABLE_FAIL;
     }
@@ -85,13 +98,19 @@ int mtab_add(int64_t metatab_idx, const char* name, int64_t index){
 
 /**
  * @brief       Delete a table from the metatable
+ * @param[in]   pager: handle of database
  * @param[in]   metatab_idx: index of metatab
  * @param[in]   index: index of the table
  * @return      TABLE_SUCCESS on success, TABLE_FAIL on failure
  */
 
-int mtab_delete(int64_t metatab_idx, int64_t index){
-    table_t* meta_table = tab_load(metatab_idx);
+int mtab_delete(pager_t* pager, int64_t metatab_idx, int64_t index){
+    pg_scoped_t latch pg_latched = {pager, pg_latch(pager, metatab_idx, true)};
+    if(latch.page_index == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to latch metatable %ld", metatab_idx);
+        return TABLE_FAIL;
+    }
+    table_t* meta_table = tab_load(pager, metatab_idx);
     if(meta_table == NULL){
         logger(LL_ERROR, __func__, "Invalid argument: meta_table is NULL");
         return TABLE_FAIL;
@@ -100,10 +119,10 @@ int mtab_delete(int64_t metatab_idx, int64_t index){
             char NAME[MAX_NAME_LENGTH];
             int64_t INDEX;
     );
-    schema_t* schema = sch_load(meta_table->schidx);
-    tab_for_each_row(meta_table, chunk, rowix, &row, schema) {
+    schema_t* schema = sch_read(pager, meta_table->schidx);
+    tab_for_each_row(pager, meta_table, chunk, rowix, &row, schema) {
         if(row.INDEX == index){
-            if (tab_delete_nova(meta_table,chunk, &rowix) == TABLE_FAIL) {
+            if (tab_delete_nova(pager, meta_table,chunk, rowid_pack(rowix)) == TABLE_FAIL) {
                 logger(LL_ERROR, __func__, "Failed to delete row ");
                 return TABLE_FAIL;
             }
@@ -2,29 +2,41 @@
 
 /**
  * @brief       Initialize the varchar manager
+ * @param[in]   pager: handle of database
  * @return      index of the varchar manager index on success, TABLE_FAIL on failure
  */
 
-int64_t vch_init(void){
-    int64_t vch_vachar_mgr_idx =  lb_ppl_init(VCH_BLOCK_SIZE);
+int64_t vch_init(pager_t* pager){
+    int64_t vch_vachar_mgr_idx =  lb_ppl_init(pager, VCH_BLOCK_SIZE);
     return vch_vachar_mgr_idx;
 }
 
 /**
  * @brief       Add a varchar
+ * @param[in]   pager: handle of database
  * @param[in]   vachar_mgr_idx: varchar manager index
  * @param[in]   varchar: string to add
- * @return      vch_ticket_t of varchar on success, CHBLIX_FAIL on failure
+ * @return      vch_ticket_t of varchar on success, ticket with ROWID_FAIL block on failure
  */
 
-vch_ticket_t vch_add(int64_t vachar_mgr_idx, char* varchar){
-    vch_ticket_t ticket;
-    page_pool_t* vch = lb_ppl_load(vachar_mgr_idx);
-    ticket.block = lb_alloc(vch);
+vch_ticket_t vch_add(pager_t* pager, int64_t vachar_mgr_idx, char* varchar){
+    vch_ticket_t ticket = {.block = ROWID_FAIL, .size = 0};
+    pg_scoped_t latch pg_latched = {pager, pg_latch(pager, vachar_mgr_idx, true)};
+    if(latch.page_index == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to latch varchar manager %ld", vachar_mgr_idx);
+        return ticket;
+    }
+    page_pool_t* vch = lb_ppl_load(pager, vachar_mgr_idx);
+    chblix_t block = lb_alloc(pager, vch);
+    if(chblix_cmp(&block, &CHBLIX_FAIL) == 0){
+        logger(LL_ERROR, __func__, "Unable to allocate varchar");
+        return ticket;
+    }
+    ticket.block = rowid_pack(block);
     ticket.size = (int64_t)strlen(varchar)+1;
-    lb_write(
+    lb_write(pager, 
             vch,
-            &ticket.block,
+            &block,
             varchar,
             ticket.size,
             0
@@ -34,17 +46,24 @@ vch_ticket_t vch_add(int64_t vachar_mgr_idx, char* varchar){
 
 /**
  * @brief       Get a varchar
+ * @param[in]   pager: handle of database
  * @param[in]   vachar_mgr_idx: varchar manager index
  * @param[in]   ticket: ticket of varchar
  * @param[out]  varchar: string destination
  * @return      LB_SUCCESS on success, LB_FAIL on failure
  */
 
-int vch_get(int64_t vachar_mgr_idx, vch_ticket_t* ticket, char* varchar){
-    logger(LL_DEBUG, __func__, "ticket->block: %ld", ticket->block);
-    return lb_read(
+int vch_get(pager_t* pager, int64_t vachar_mgr_idx, vch_ticket_t* ticket, char* varchar){
+    logger(LL_DEBUG, __func__, "ticket->block: %lu", ticket->block);
+    pg_scoped_t latch pg_latched = {pager, pg_latch(pager, vachar_mgr_idx, false)};
+    if(latch.page_index == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to latch varchar manager %ld", vachar_mgr_idx);
+        return LB_FAIL;
+    }
+    chblix_t block = rowid_unpack(ticket->block);
+    return lb_read(pager, 
             vachar_mgr_idx,
-            &ticket->block,
+            &block,
             varchar,
             ticket->size,
             0
@@ -53,13 +72,20 @@ int vch_get(int64_t vachar_mgr_idx, vch_ticket_t* ticket, char* varchar){
 
 /**
  * @brief       Delete a varchar
+ * @param[in]   pager: handle of database
  * @param[in]   vachar_mgr_idx: varchar manager index
  * @param[in]   ticket: ticket of varchar
  * @return      LB_SUCCESS on success, LB_FAIL on failure
  */
 
-int vch_delete(int64_t vachar_mgr_idx, vch_ticket_t* ticket){
-    return lb_dealloc(vachar_mgr_idx, &ticket->block);
+int vch_delete(pager_t* pager, int64_t vachar_mgr_idx, vch_ticket_t* ticket){
+    pg_scoped_t latch pg_latched = {pager, pg_latch(pager, vachar_mgr_idx, true)};
+    if(latch.page_index == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to latch varchar manager %ld", vachar_mgr_idx);
+        return LB_FAIL;
+    }
+    chblix_t block = rowid_unpack(ticket->block);
+    return lb_dealloc(pager, vachar_mgr_idx, &block);
 }
 
 
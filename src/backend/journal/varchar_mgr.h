@@ -7,11 +7,11 @@
 #define VCH_BLOCK_SIZE 30
 
 typedef struct vch_ticket{
-    chblix_t block;
+    rowid_t block;
     int64_t size;
 }vch_ticket_t;
 
-int64_t vch_init(void);
-vch_ticket_t vch_add(int64_t vachar_mgr_idx, char* varchar);
-int vch_get(int64_t vachar_mgr_idx, vch_ticket_t* ticket, char* varchar);
-int vch_delete(int64_t vachar_mgr_idx, vch_ticket_t* ticket);
+int64_t vch_init(pager_t* pager);
+vch_ticket_t vch_add(pager_t* pager, int64_t vachar_mgr_idx, char* varchar);
+int vch_get(pager_t* pager, int64_t vachar_mgr_idx, vch_ticket_t* ticket, char* varchar);
+int vch_delete(pager_t* pager, int64_t vachar_mgr_idx, vch_ticket_t* ticket);
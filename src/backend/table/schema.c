@@ -2,12 +2,22 @@
 
 /**
  * @brief       Initialize a schema
+ * @param[in]   pager: handle of database
  * @return      pointer to schema on success, NULL on failure
  */
 
-void* sch_init(void){
-    int64_t schidx = lb_ppl_init(sizeof(field_t) - sizeof(linked_block_t));
-    schema_t* sch = (schema_t*)lb_ppl_load(schidx);
+void* sch_init(pager_t* pager){
+    int64_t schidx = lb_ppl_init(pager, sizeof(field_t) - sizeof(linked_block_t));
+    if(schidx == LB_FAIL){
+        logger(LL_ERROR, __func__, "Failed to initialize schema");
+        return NULL;
+    }
+    pg_scoped_t latch pg_latched = {pager, pg_latch(pager, schidx, true)};
+    if(latch.page_index == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to latch schema %ld", schidx);
+        return NULL;
+    }
+    schema_t* sch = (schema_t*)lb_ppl_load(pager, schidx);
     if(sch == NULL) {
         logger(LL_ERROR, __func__, "Failed to load schema %ld", schidx);
         return NULL;
@@ -18,6 +28,7 @@ void* sch_init(void){
 
 /**
  * @brief       Add a field
+ * @param[in]   pager: handle of database
  * @param[in]   schema: pointer to schema
  * @param[in]   name: name of the field
  * @param[in]   type: type of the field
@@ -25,19 +36,30 @@ void* sch_init(void){
  * @return      SCHEMA_SUCCESS on success, SCHEMA_FAIL on failure
  */
 
-int sch_add_field(schema_t* schema, const char* name, datatype_t type, int64_t size){
+int sch_add_field(pager_t* pager, schema_t* schema, const char* name, datatype_t type, int64_t size){
     if(schema == NULL) {
         logger(LL_ERROR, __func__, "Invalid argument: schema is NULL");
         return SCHEMA_FAIL;
     }
+    pg_scoped_t latch pg_latched = {pager, pg_latch(pager, schema_index(schema), true)};
+    if(latch.page_index == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to latch schema %ld", schema_index(schema));
+        return SCHEMA_FAIL;
+    }
+    /* slot size is modified, schema is pinned till latch is released */
+    schema = sch_load(pager, latch.page_index);
+    if(schema == NULL){
+        logger(LL_ERROR, __func__, "Failed to load schema %ld", latch.page_index);
+        return SCHEMA_FAIL;
+    }
 
-    chblix_t fieldix = lb_alloc_m(&schema->ppl_header, sizeof(field_t));
+    chblix_t fieldix = lb_alloc(pager, &schema->ppl_header);
     if(chblix_cmp(&fieldix, &CHBLIX_FAIL) == 0){
         logger(LL_ERROR, __func__, "Failed to allocate field %s", name);
         return SCHEMA_FAIL;
     }
     field_t field;
-    if(sch_field_load(schema_index(schema), &fieldix, &field) == LB_FAIL){
+    if(sch_field_load(pager, schema_index(schema), &fieldix, &field) == LB_FAIL){
         logger(LL_ERROR, __func__, "Failed to load field %s", name);
         return SCHEMA_FAIL;
     }
@@ -46,7 +68,7 @@ int sch_add_field(schema_t* schema, const char* name, datatype_t type, int64_t s
     field.size = size;
     field.offset = schema->slot_size;
     schema->slot_size += size;
-    if(sch_field_update(schema_index(schema), &fieldix, &field) == LB_FAIL){
+    if(sch_field_update(pager, schema_index(schema), &fieldix, &field) == LB_FAIL){
         logger(LL_ERROR, __func__, "Failed to update field %s", name);
         return SCHEMA_FAIL;
     }
@@ -55,19 +77,25 @@ int sch_add_field(schema_t* schema, const char* name, datatype_t type, int64_t s
 
 /**
  * @brief       Get a field
+ * @param[in]   pager: handle of database
  * @param[in]   schema: pointer to the schema
  * @param[in]   name: name of the field
  * @param[out]  field: pointer to destination field
  * @return      SCHEMA_SUCCESS on success, SCHEMA_FAIL on failure
  */
 
-int sch_get_field(schema_t* schema, const char* name, field_t* field){
+int sch_get_field(pager_t* pager, schema_t* schema, const char* name, field_t* field){
     if(schema == NULL) {
         logger(LL_ERROR, __func__, "Invalid argument: schema os NULL");
         return SCHEMA_FAIL;
     }
+    pg_scoped_t latch pg_latched = {pager, pg_latch(pager, schema_index(schema), false)};
+    if(latch.page_index == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to latch schema %ld", schema_index(schema));
+        return SCHEMA_FAIL;
+    }
 
-    sch_for_each(schema, chunk, fieldi, chblix, schema->ppl_header.lp_header.page_index){
+    sch_for_each(pager, schema, chunk, fieldi, chblix, schema->ppl_header.lp_header.page_index){
         if(strcmp(fieldi.name, name) == 0){
             *field = fieldi;
             return SCHEMA_SUCCESS;
@@ -81,20 +109,26 @@ int sch_get_field(schema_t* schema, const char* name, field_t* field){
 /**
  * @brief       Delete a field
  * @warning     This function delete field, but dont touch offsets in other fields in schema.
+ * @param[in]   pager: handle of database
  * @param[in]   schema: pointer to schema
  * @param[in]   name: name of the field
  * @return      SCHEMA_SUCCESS on success, SCHEMA_FAIL on failure
  */
 
-int sch_delete_field(schema_t* schema, const char* name){
+int sch_delete_field(pager_t* pager, schema_t* schema, const char* name){
     if(schema == NULL) {
         logger(LL_ERROR, __func__, "Invalid argument: schema is NULL");
         return SCHEMA_FAIL;
     }
+    pg_scoped_t latch pg_latched = {pager, pg_latch(pager, schema_index(schema), true)};
+    if(latch.page_index == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to latch schema %ld", schema_index(schema));
+        return SCHEMA_FAIL;
+    }
 
-    sch_for_each(schema, chunk, field, chblix, schema_index(schema)){
+    sch_for_each(pager, schema, chunk, field, chblix, schema_index(schema)){
         if(strcmp(field.name, name) == 0){
-            if(lb_dealloc(schema_index(schema), &field.lb_header.chblix) == LB_FAIL){
+            if(lb_dealloc(pager, schema_index(schema), &chblix) == LB_FAIL){
                 logger(LL_ERROR, __func__, "Failed to deallocate field %s", name);
                 return SCHEMA_FAIL;
             }
@@ -24,53 +24,68 @@ typedef enum {SCHEMA_SUCCESS = 0, SCHEMA_FAIL = -1, SCHEMA_NOT_FOUND = -2} schem
 
 /**
  * @brief       Load a schema
+ * @param[in]   pager: handle of database
  * @param[in]   schidx: index of the schema
  * @return      pointer to the schema on success, NULL on failure
  */
 
-#define sch_load(schidx) ((schema_t*)lb_ppl_load(schidx))
+#define sch_load(pager, schidx) ((schema_t*)lb_ppl_load(pager, schidx))
+
+/**
+ * @brief       Load a schema for reading
+ * @details     Schema isn't marked dirty, it must not be modified through returned pointer.
+ * @param[in]   pager: handle of database
+ * @param[in]   schidx: index of the schema
+ * @return      pointer to the schema on success, NULL on failure
+ */
+
+#define sch_read(pager, schidx) ((schema_t*)lb_ppl_read(pager, schidx))
 
 /**
  * @brief       Delete a schema
+ * @param[in]   pager: handle of database
  * @param[in]   schidx: index of the schema
  * @return      SCHEMA_SUCCESS on success, SCHEMA_FAIL on failure
  */
 
-#define sch_delete(schidx) (lb_ppl_destroy((schidx)))
+#define sch_delete(pager, schidx) (lb_ppl_destroy(pager, (schidx)))
 
 /**
  * @brief      Load field
+ * @param[in]  pager: handle of database
  * @param[in]  schidx: index of the schema
  * @param[in]  fieldix: index of the field
  * @param[out] field: pointer to the field
  * @return     LB_SUCCESS on success, LB_FAIL on failure
  */
 
-#define sch_field_load(schidx, fieldix, field) (lb_load((schidx),(fieldix), (linked_block_t*)(field)))
+#define sch_field_load(pager, schidx, fieldix, field) (lb_load(pager, (schidx),(fieldix), (linked_block_t*)(field)))
 
 /**
  * @brief      Update field
+ * @param[in]  pager: handle of database
  * @param[in]  schidx: index of the schema
  * @param[in]  fieldix: index of the field
  * @param[out] field: pointer to the field
  * @return     LB_SUCCESS on success, LB_FAIL on failure
  */
 
-#define sch_field_update(schidx, fieldix, field) (lb_update((schidx), (fieldix), (linked_block_t*)(field)))
+#define sch_field_update(pager, schidx, fieldix, field) (lb_update(pager, (schidx), (fieldix), (linked_block_t*)(field)))
 
 
 
-#define sch_add_int_field(schema, name) sch_add_field((schema), name, DT_INT, sizeof(int64_t))
-#define sch_add_char_field(schema, name, size) sch_add_field((schema), name, DT_CHAR, size)
-#define sch_add_varchar_field(schema, name) sch_add_field((schema), name, DT_VARCHAR, sizeof(vch_ticket_t))
-#define sch_add_float_field(schema, name) sch_add_field((schema), name, DT_FLOAT, sizeof(float))
-#define sch_add_bool_field(schema, name) sch_add_field((schema), name, DT_BOOL, sizeof(bool))
+#define sch_add_int_field(pager, schema, name) sch_add_field(pager, (schema), name, DT_INT, sizeof(int64_t))
+#define sch_add_char_field(pager, schema, name, size) sch_add_field(pager, (schema), name, DT_CHAR, size)
+#define sch_add_varchar_field(pager, schema, name) sch_add_field(pager, (schema), name, DT_VARCHAR, sizeof(vch_ticket_t))
+#define sch_add_float_field(pager, schema, name) sch_add_field(pager, (schema), name, DT_FLOAT, sizeof(float))
+#define sch_add_bool_field(pager, schema, name) sch_add_field(pager, (schema), name, DT_BOOL, sizeof(bool))
 
 #define schema_index(schema) ((schema)->ppl_header.lp_header.page_index)
 
 
 /**
  * @brief       For each field in a schema
+ * @param[in]   pager: handle of database
  * @param[in]   sch: pointer to the schema
  * @param[in]   chunk: chunk
  * @param[in]   field: pointer to the field
@@ -78,17 +93,19 @@ typedef enum {SCHEMA_SUCCESS = 0, SCHEMA_FAIL = -1, SCHEMA_NOT_FOUND = -2} schem
  * @param[in]   schidx: index of the schema
  */
 
-#define sch_for_each(sch,chunk, field, chblix, schidx) \
+#define sch_for_each(pager, sch,chunk, field, chblix, schidx) \
     field_t field;                               \
-    chunk_t* chunk = ppl_load_chunk(sch->ppl_header.head);                  \
-    chblix_t chblix = lb_pool_start((page_pool_t*)sch, &chunk);\
-    sch_field_load(schidx, &chblix, &field);\
+    pg_scoped_t chunk##_pool_pin pg_pinned = {pager, pg_pin(pager, page_pool_index((&sch->ppl_header)))}; \
+    pg_scoped_t chunk##_pin pg_pinned = {pager, pg_pin(pager, sch->ppl_header.head)}; \
+    chunk_t* chunk = ppl_read_chunk(pager, sch->ppl_header.head);                  \
+    chblix_t chblix = lb_pool_start(pager, (page_pool_t*)sch, &chunk, &chunk##_pin.page_index);\
+    sch_field_load(pager, schidx, &chblix, &field);\
     for(;\
     chblix_cmp(&chblix, &CHBLIX_FAIL) != 0 &&\
-    sch_field_load(schidx, &chblix, &field) != LB_FAIL; \
-    ++chblix.block_idx,  chblix = lb_nearest_valid_chblix((page_pool_t*)sch, chblix, &chunk))
+    sch_field_load(pager, schidx, &chblix, &field) != LB_FAIL; \
+    ++chblix.block_idx,  chblix = lb_nearest_valid_chblix(pager, (page_pool_t*)sch, chblix, &chunk, &chunk##_pin.page_index))
 
-void* sch_init(void);
-int sch_add_field(schema_t* schema, const char* name, datatype_t type, int64_t size);
-int sch_get_field(schema_t* schema, const char* name, field_t* field);
-int sch_delete_field(schema_t* schema, const char* name);
+void* sch_init(pager_t* pager);
+int sch_add_field(pager_t* pager, schema_t* schema, const char* name, datatype_t type, int64_t size);
+int sch_get_field(pager_t* pager, schema_t* schema, const char* name, field_t* field);
+int sch_delete_field(pager_t* pager, schema_t* schema, const char* name);
@@ -4,62 +4,83 @@
 
 /**
  * @brief       Initialize table and add it to the metatable
+ * @param[in]   pager: handle of database
  * @param[in]   db: pointer to db
  * @param[in]   name: name of the table
  * @param[in]   schema: pointer to schema
  * @return      index of the table on success, TABLE_FAIL on failure
  */
 
-table_t* tab_init(db_t* db, const char* name, schema_t* schema){
+table_t* tab_init(pager_t* pager, db_t* db, const char* name, schema_t* schema){
     table_t* table = NULL;
-    if((table = tab_base_init(name, schema)) == NULL){
+    if((table = tab_base_init(pager, name, schema)) == NULL){
         logger(LL_ERROR, __func__, "Unable to init table");
         return NULL;
     }
-    mtab_add(db->meta_table_idx, name,table_index(table));
+    mtab_add(pager, db->meta_table_idx, name,table_index(table));
     return table;
 }
 
 /**
  * @brief       Get row by value in column
+ * @param[in]   pager: handle of database
  * @param[in]   db: pointer to db
  * @param[in]   table: pointer to the table
  * @param[in]   schema: pointer to the schema
  * @param[in]   field: pointer to the field
  * @param[in]   value: pointer to the value
  * @param[in]   type: type of the value
- * @return      chblix_t of row on success, CHBLIX_FAIL on failure
+ * @return      row id on success, ROWID_FAIL on failure
  */
 
-chblix_t tab_get_row(db_t* db, table_t* table, schema_t* schema, field_t* field, void* value, datatype_t type){
+rowid_t tab_get_row(pager_t* pager, db_t* db, table_t* table, schema_t* schema, field_t* field, void* value, datatype_t type){
     if(table == NULL){
         logger(LL_ERROR, __func__, "Invalid argument, table is NULL");
-        return CHBLIX_FAIL;
+        return ROWID_FAIL;
     }
 
     if(schema == NULL){
         logger(LL_ERROR, __func__, "Invalid argument, schema is NULL");
-        return CHBLIX_FAIL;
+        return ROWID_FAIL;
     }
+    pg_scoped_t latch pg_latched = {pager, pg_latch(pager, table_index(table), false)};
+    if(latch.page_index == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to latch table %"PRId64"", table_index(table));
+        return ROWID_FAIL;
+    }
+    tab_cursor_t cursor;
+    if(tab_cursor_open(pager, &cursor, table) == TABLE_FAIL){
+        logger(LL_ERROR, __func__, "Unable to scan table %"PRId64"", table_index(table));
+        return ROWID_FAIL;
+    }
+    rowid_t rowids[TAB_BATCH_ROWS];
+    void* rows = malloc(TAB_BATCH_ROWS * schema->slot_size);
     void* element = malloc(field->size);
-    tab_for_each_element(table, chunk, chblix, element, field){
-        if(comp_eq(db, type, element, value)){
-            free(element);
-            return chblix;
+    rowid_t found = ROWID_FAIL;
+    for(int64_t count; found == ROWID_FAIL && (count = tab_cursor_next_batch(pager, &cursor, rowids, rows, TAB_BATCH_ROWS)) > 0;){
+        for(int64_t i = 0; i < count; ++i){
+            memcpy(element, (char*)rows + i * schema->slot_size + field->offset, field->size);
+            if(comp_eq(pager, db, type, element, value)){
+                found = rowids[i];
+                break;
+            }
         }
     }
+    tab_cursor_close(pager, &cursor);
     free(element);
-    return CHBLIX_FAIL;
+    free(rows);
+    return found;
 }
 
 /**
  * @brief       Print table
+ * @param[in]   pager: handle of database
  * @param[in]   db: pointer to db
  * @param[in]   table: index of the table
  * @param[in]   schema: pointer to the schema
  */
 
-void tab_print(db_t* db, table_t* table, schema_t* schema){
+void tab_print(pager_t* pager, db_t* db, table_t* table, schema_t* schema){
     if(table == NULL){
         logger(LL_ERROR, __func__, "Invalid argument, table is NULL");
         return;
@@ -69,49 +90,64 @@ void tab_print(db_t* db, table_t* table, schema_t* schema){
         logger(LL_ERROR, __func__, "Invalid argument, schema is NULL");
         return;
     }
-    void* row = malloc(schema->slot_size);
-    tab_for_each_row(table, chunk, chblix,  row, schema){
-        sch_for_each(schema,chunk2, field, sch_chblix, table->schidx){
-            switch(field.type){
-                case DT_INT: {
-                    printf("%"PRId64"\t", *(int64_t*)((char*)row + field.offset));
-                    break;
-                }
-                case DT_FLOAT: {
-                    printf("%f\t", *(float *) ((char *) row + field.offset));
-                    break;
-                }
-                case DT_CHAR: {
-                    printf("%s\t", (char*)((char*)row + field.offset));
-                    break;
-                }
-                case DT_BOOL: {
-                    printf("%d\t", *(bool*)((char*)row + field.offset));
-                    break;
-                }
-                case DT_VARCHAR: {
-                    vch_ticket_t* vch = (vch_ticket_t*)((char*)row + field.offset);
-                    char* str = malloc(vch->size);
-                    vch_get(db->varchar_mgr_idx, vch, str);
-                    printf("%s\t", str);
-                    free(str);
-                    break;
+    pg_scoped_t latch pg_latched = {pager, pg_latch(pager, table_index(table), false)};
+    if(latch.page_index == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to latch table %"PRId64"", table_index(table));
+        return;
+    }
+    tab_cursor_t cursor;
+    if(tab_cursor_open(pager, &cursor, table) == TABLE_FAIL){
+        logger(LL_ERROR, __func__, "Unable to scan table %"PRId64"", table_index(table));
+        return;
+    }
+    void* rows = malloc(TAB_BATCH_ROWS * schema->slot_size);
+    for(int64_t count; (count = tab_cursor_next_batch(pager, &cursor, NULL, rows, TAB_BATCH_ROWS)) > 0;){
+        for(int64_t i = 0; i < count; ++i){
+            const char* row = (char*)rows + i * schema->slot_size;
+            sch_for_each(pager, schema,chunk2, field, sch_chblix, table->schidx){
+                switch(field.type){
+                    case DT_INT: {
+                        printf("%"PRId64"\t", *(const int64_t*)(row + field.offset));
+                        break;
+                    }
+                    case DT_FLOAT: {
+                        printf("%f\t", *(const float*)(row + field.offset));
+                        break;
+                    }
+                    case DT_CHAR: {
+                        printf("%s\t", row + field.offset);
+                        break;
+                    }
+                    case DT_BOOL: {
+                        printf("%d\t", *(const bool*)(row + field.offset));
+                        break;
+                    }
+                    case DT_VARCHAR: {
+                        vch_ticket_t* vch = (vch_ticket_t*)(row + field.offset);
+                        char* str = malloc(vch->size);
+                        vch_get(pager, db->varchar_mgr_idx, vch, str);
+                        printf("%s\t", str);
+                        free(str);
+                        break;
+                    }
+
+                    default:
+                        logger(LL_ERROR, __func__, "Unknown type %d", field.type);
+                        break;
                 }
-
-                default:
-                    logger(LL_ERROR, __func__, "Unknown type %d", field.type);
-                    break;
             }
+            printf("\n");
+            fflush(stdout);
         }
-        printf("\n");
-        fflush(stdout);
     }
-    free(row);
+    tab_cursor_close(pager, &cursor);
+    free(rows);
     fflush(stdout);
 }
 
 /**
  * @brief       Inner join two tables
+ * @param[in]   pager: handle of database
  * @param[in]   db: pointer to db
  * @param[in]   left: pointer to the left table
  * @param[in]   left_schema: pointer to the schema of the left table
@@ -123,7 +159,7 @@ void tab_print(db_t* db, table_t* table, schema_t* schema){
  * @return      pointer to the new table on success, NULL on failure
  */
 
-table_t* tab_join(
+table_t* tab_join(pager_t* pager, 
         db_t* db,
         table_t* left,
         schema_t* left_schema,
@@ -152,28 +188,38 @@ table_t* tab_join(
         logger(LL_ERROR, __func__, "Invalid argument, right schema is NULL");
         return NULL;
     }
+    pg_scoped_t left_latch pg_latched = {pager, pg_latch(pager, table_index(left), false)};
+    if(left_latch.page_index == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to latch table %"PRId64"", table_index(left));
+        return NULL;
+    }
+    pg_scoped_t right_latch pg_latched = {pager, pg_latch(pager, table_index(right), false)};
+    if(right_latch.page_index == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to latch table %"PRId64"", table_index(right));
+        return NULL;
+    }
 
     /* Create new schema */
-    schema_t* new_schema = sch_init();
+    schema_t* new_schema = sch_init(pager);
     if(new_schema == NULL){
         logger(LL_ERROR, __func__, "Failed to create new schema");
         return NULL;
     }
-    sch_for_each(left_schema, chunk, left_field_t, left_chblix, left->schidx){
-        if(sch_add_field(new_schema, left_field_t.name, left_field_t.type, (int64_t)left_field_t.size) == SCHEMA_FAIL){
+    sch_for_each(pager, left_schema, chunk, left_field_t, left_chblix, left->schidx){
+        if(sch_add_field(pager, new_schema, left_field_t.name, left_field_t.type, (int64_t)left_field_t.size) == SCHEMA_FAIL){
             logger(LL_ERROR, __func__, "Failed to add field %s", left_field_t.name);
             return NULL;
         }
     }
-    sch_for_each(right_schema,chunk2, right_field_t, right_chblix, right->schidx){
-        if(sch_add_field(new_schema, right_field_t.name, right_field_t.type, (int64_t)right_field_t.size) == SCHEMA_FAIL){
+    sch_for_each(pager, right_schema,chunk2, right_field_t, right_chblix, right->schidx){
+        if(sch_add_field(pager, new_schema, right_field_t.name, right_field_t.type, (int64_t)right_field_t.size) == SCHEMA_FAIL){
             logger(LL_ERROR, __func__, "Failed to add field %s", right_field_t.name);
             return NULL;
         }
     }
 
     /* Create new table */
-    table_t* table = tab_init(db, name, new_schema);
+    table_t* table = tab_init(pager, db, name, new_schema);
     if(table == NULL){
         logger(LL_ERROR, __func__, "Failed to create new table");
         return NULL;
@@ -182,39 +228,59 @@ table_t* tab_join(
     /* Create new row */
     void* row = malloc(new_schema->slot_size);
 
-    void* left_row = malloc(left_schema->slot_size);
-    void* right_row = malloc(right_schema->slot_size);
-
-
-
-    /* Join */
+    /* Join, right table is scanned for each row of left one */
+    tab_cursor_t left_cursor;
+    if(tab_cursor_open(pager, &left_cursor, left) == TABLE_FAIL){
+        logger(LL_ERROR, __func__, "Unable to scan table %"PRId64"", table_index(left));
+        free(row);
+        return NULL;
+    }
+    void* left_rows = malloc(TAB_BATCH_ROWS * left_schema->slot_size);
+    void* right_rows = malloc(TAB_BATCH_ROWS * right_schema->slot_size);
     void* elleft = malloc(join_field_left->size);
     void* elright = malloc(join_field_right->size);
-    tab_for_each_row(left, left_chunk, leftt_chblix, left_row, left_schema){
-        memcpy(elleft, (char*)left_row + join_field_left->offset, join_field_left->size);
-        tab_for_each_row(right, right_chunk,rightt_chblix, right_row, right_schema){
-            memcpy(elright, (char*)right_row + join_field_right->offset, join_field_right->size);
-            if(comp_eq(db, join_field_left->type, elleft, elright)){
-                memcpy(row, left_row, left_schema->slot_size);
-                memcpy((char*)row + left_schema->slot_size, right_row, right_schema->slot_size);
-                chblix_t rowix = tab_insert(table, new_schema, row);
-                if(chblix_cmp(&rowix, &CHBLIX_FAIL) == 0){
-                    logger(LL_ERROR, __func__, "Failed to insert row");
-                    return NULL;
+    bool failed = false;
+    for(int64_t left_count; !failed && (left_count = tab_cursor_next_batch(pager, &left_cursor, NULL, left_rows, TAB_BATCH_ROWS)) > 0;){
+        for(int64_t i = 0; !failed && i < left_count; ++i){
+            const char* left_row = (char*)left_rows + i * left_schema->slot_size;
+            memcpy(elleft, left_row + join_field_left->offset, join_field_left->size);
+            tab_cursor_t right_cursor;
+            if(tab_cursor_open(pager, &right_cursor, right) == TABLE_FAIL){
+                logger(LL_ERROR, __func__, "Unable to scan table %"PRId64"", table_index(right));
+                failed = true;
+                break;
+            }
+            for(int64_t right_count; !failed && (right_count = tab_cursor_next_batch(pager, &right_cursor, NULL, right_rows, TAB_BATCH_ROWS)) > 0;){
+                for(int64_t j = 0; j < right_count; ++j){
+                    const char* right_row = (char*)right_rows + j * right_schema->slot_size;
+                    memcpy(elright, right_row + join_field_right->offset, join_field_right->size);
+                    if(!comp_eq(pager, db, join_field_left->type, elleft, elright)){
+                        continue;
+                    }
+                    memcpy(row, left_row, left_schema->slot_size);
+                    memcpy((char*)row + left_schema->slot_size, right_row, right_schema->slot_size);
+                    if(tab_insert(pager, table, new_schema, row) == ROWID_FAIL){
+                        logger(LL_ERROR, __func__, "Failed to insert row");
+                        failed = true;
+                        break;
+                    }
                 }
             }
+            tab_cursor_close(pager, &right_cursor);
         }
     }
+    tab_cursor_close(pager, &left_cursor);
     free(elleft);
     free(elright);
     free(row);
-    free(left_row);
-    free(right_row);
-    return table;
+    free(left_rows);
+    free(right_rows);
+    return failed ? NULL : table;
 }
 
 /**
  * @brief       Select row form table on condition
+ * @param[in]   pager: handle of database
  * @param[in]   db: pointer to db
  * @param[in]   sel_table: pointer to table from which the selection is made
  * @param[in]   sel_schema: pointer to schema of the table from which the selection is made
@@ -226,7 +292,7 @@ table_t* tab_join(
  * @return      pointer to new table on success, NULL on failure
  */
 
-table_t* tab_select_op(db_t* db,
+table_t* tab_select_op(pager_t* pager, db_t* db,
                             table_t* sel_table,
                             schema_t* sel_schema,
                             field_t* select_field,
@@ -234,77 +300,93 @@ table_t* tab_select_op(db_t* db,
                             condition_t condition,
                             void* value,
                             datatype_t type) {
+    pg_scoped_t latch pg_latched = {pager, pg_latch(pager, table_index(sel_table), false)};
+    if(latch.page_index == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to latch table %"PRId64"", table_index(sel_table));
+        return NULL;
+    }
+
     /* Create new schema */
-    schema_t* schema = sch_init();
+    schema_t* schema = sch_init(pager);
     if(schema == NULL){
         logger(LL_ERROR, __func__, "Failed to create new schema");
         return NULL;
     }
-    sch_for_each(sel_schema, sch_chunk, field, chblix, sel_table->schidx){
-        if(sch_add_field(schema, field.name, field.type, (int64_t)field.size) == SCHEMA_FAIL){
+    sch_for_each(pager, sel_schema, sch_chunk, field, chblix, sel_table->schidx){
+        if(sch_add_field(pager, schema, field.name, field.type, (int64_t)field.size) == SCHEMA_FAIL){
             logger(LL_ERROR, __func__, "Failed to add field %s", field.name);
             return NULL;
         }
     }
 
     /* Create new table */
-    table_t* table = tab_init(db, name, schema);
+    table_t* table = tab_init(pager, db, name, schema);
     if(table == NULL){
         logger(LL_ERROR, __func__, "Failed to create new table");
         return NULL;
     }
 
-    /* Create new row */
-    void* row = malloc(schema->slot_size);
-
     /* Check if datatype of field equals datatype of value */
     if(type != select_field->type){
-        free(row);
         return NULL;
     }
 
-    void* el_row = malloc(sel_schema->slot_size);
+    tab_cursor_t cursor;
+    if(tab_cursor_open(pager, &cursor, sel_table) == TABLE_FAIL){
+        logger(LL_ERROR, __func__, "Unable to scan table %"PRId64"", table_index(sel_table));
+        return NULL;
+    }
+    void* rows = malloc(TAB_BATCH_ROWS * sel_schema->slot_size);
     void* el = malloc(select_field->size);
     void* comp_val = malloc(select_field->size);
     memcpy(comp_val, value, select_field->size);
 
-    /* Select */
-    tab_for_each_row(sel_table, tab_chunk, sel_chblix, el_row, sel_schema){
-        memcpy(el, (char*)el_row + select_field->offset, select_field->size);
-        if(comp_compare(db, type, el,comp_val, condition)){
-            memcpy(row, el_row, schema->slot_size);
-            chblix_t rowix = tab_insert(table, schema, row);
-            if(chblix_cmp(&rowix, &CHBLIX_FAIL) == 0){
+    /* Select, rows are fetched in batches and inserted from batch, compared element is
+     * copied because fields of packed row aren't aligned */
+    bool failed = false;
+    for(int64_t count; !failed && (count = tab_cursor_next_batch(pager, &cursor, NULL, rows, TAB_BATCH_ROWS)) > 0;){
+        for(int64_t i = 0; i < count; ++i){
+            char* el_row = (char*)rows + i * sel_schema->slot_size;
+            memcpy(el, el_row + select_field->offset, select_field->size);
+            if(comp_compare(pager, db, type, el, comp_val, condition) && tab_insert(pager, table, schema, el_row) == ROWID_FAIL){
                 logger(LL_ERROR, __func__, "Failed to insert row");
-                return NULL;
+                failed = true;
+                break;
             }
         }
     }
+    tab_cursor_close(pager, &cursor);
     free(comp_val);
-    free(row);
-    free(el_row);
+    free(rows);
     free(el);
-    return table;
+    return failed ? NULL : table;
 }
 
 /**
  * @brief       Drop a table
+ * @param[in]   pager: handle of database
  * @param[in]   db: pointer to db
  * @param[in]   table: pointer of the table
  * @return      PPL_SUCCESS on success, PPL_FAIL on failure
  */
 
-int tab_drop(db_t* db, table_t* table){
-    if (mtab_delete(db->meta_table_idx,table_index(table)) == TABLE_FAIL) {
+int tab_drop(pager_t* pager, db_t* db, table_t* table){
+    pg_scoped_t latch pg_latched = {pager, pg_latch(pager, table_index(table), true)};
+    if(latch.page_index == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to latch table %"PRId64"", table_index(table));
+        return PPL_FAIL;
+    }
+    if (mtab_delete(pager, db->meta_table_idx,table_index(table)) == TABLE_FAIL) {
         logger(LL_ERROR, __func__, "Failed to delete table %"PRId64, table_index(table));
         return PPL_FAIL;
     }
-    sch_delete(table->schidx);
-    return lb_ppl_destroy(table_index(table));
+    sch_delete(pager, table->schidx);
+    return lb_ppl_destroy(pager, table_index(table));
 }
 
 /**
  * @brief       Update row in table
+ * @param[in]   pager: handle of database
  * @param[in]   db: pointer to db
  * @param[in]   table: pointer to table
  * @param[in]   schema: pointer to schema
@@ -316,7 +398,7 @@ int tab_drop(db_t* db, table_t* table){
  * @return
  */
 
-int tab_update_row_op(db_t* db,
+int tab_update_row_op(pager_t* pager, db_t* db,
                     table_t* table,
                     schema_t* schema,
                     field_t* field,
@@ -324,38 +406,52 @@ int tab_update_row_op(db_t* db,
                     void* value,
                     datatype_t type,
                     void* row){
+    pg_scoped_t latch pg_latched = {pager, pg_latch(pager, table_index(table), true)};
+    if(latch.page_index == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to latch table %"PRId64"", table_index(table));
+        return TABLE_FAIL;
+    }
 
+    tab_cursor_t cursor;
+    if(tab_cursor_open_write(pager, &cursor, table) == TABLE_FAIL){
+        logger(LL_ERROR, __func__, "Unable to scan table %"PRId64"", table_index(table));
+        return TABLE_FAIL;
+    }
+    rowid_t rowids[TAB_BATCH_ROWS];
+    void* rows = malloc(TAB_BATCH_ROWS * schema->slot_size);
     void* el_row = malloc(schema->slot_size);
     void* el = malloc(field->size);
     void* comp_val = malloc(field->size);
     memcpy(comp_val, value, field->size);
-    int64_t counter = 0;
 
-    /* Update */
-    tab_for_each_row(table, upd_chunk,upd_chblix, el_row, schema){
-        counter++;
-        memcpy(el, (char*)el_row + field->offset, field->size);
-        if(comp_compare(db, type, el, comp_val, condition)){
+    /* Update, fetched rows are rewritten in place */
+    int res = TABLE_SUCCESS;
+    for(int64_t count; res == TABLE_SUCCESS && (count = tab_cursor_next_batch(pager, &cursor, rowids, rows, TAB_BATCH_ROWS)) > 0;){
+        for(int64_t i = 0; i < count; ++i){
+            memcpy(el, (char*)rows + i * schema->slot_size + field->offset, field->size);
+            if(!comp_compare(pager, db, type, el, comp_val, condition)){
+                continue;
+            }
             memcpy(el_row, row, schema->slot_size);
-            if(tab_update_row(table,schema, &upd_chblix, el_row) == TABLE_FAIL){
+            if(tab_update_row(pager, table, schema, rowids[i], el_row) == TABLE_FAIL){
                 logger(LL_ERROR, __func__, "Failed to update row");
-                return TABLE_FAIL;
+                res = TABLE_FAIL;
+                break;
             }
         }
-        if(counter == 488){
-            printf("stop");
-        }
     }
-    printf("counter %"PRId64"\n", counter);
+    tab_cursor_close(pager, &cursor);
     free(comp_val);
     free(el_row);
+    free(rows);
     free(el);
-    return TABLE_SUCCESS;
+    return res;
 }
 
 
 /**
  * @brief       Update element in table
+ * @param[in]   pager: handle of database
  * @param[in]   db: pointer to db
  * @param[in]   tablix: index of the table
  * @param[in]   element: element to write
@@ -367,7 +463,7 @@ int tab_update_row_op(db_t* db,
  * @return      TABLE_SUCCESS on success, TABLE_FAIL on failure
  */
 
-int tab_update_element_op(db_t* db,
+int tab_update_element_op(pager_t* pager, db_t* db,
                             int64_t tablix,
                             void* element,
                             const char* field_name,
@@ -375,15 +471,21 @@ int tab_update_element_op(db_t* db,
                             condition_t condition,
                             void* value,
                             datatype_t type) {
+    pg_scoped_t latch pg_latched = {pager, pg_latch(pager, tablix, true)};
+    if(latch.page_index == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to latch table %"PRId64"", tablix);
+        return TABLE_FAIL;
+    }
+
     /* Load table */
-    table_t* upd_tab = tab_load(tablix);
+    table_t* upd_tab = tab_load(pager, tablix);
     if(upd_tab == NULL){
         logger(LL_ERROR, __func__, "Failed to load table %"PRId64, tablix);
         return TABLE_FAIL;
     }
 
     /* Load schema */
-    schema_t* upd_schema = sch_load(upd_tab->schidx);
+    schema_t* upd_schema = sch_read(pager, upd_tab->schidx);
     if(upd_schema == NULL){
         logger(LL_ERROR, __func__, "Failed to load schema %"PRId64, upd_tab->schidx);
         return TABLE_FAIL;
@@ -391,14 +493,14 @@ int tab_update_element_op(db_t* db,
 
     /* Load compare field */
     field_t comp_field;
-    if(sch_get_field(upd_schema, field_comp, &comp_field) == SCHEMA_FAIL){
+    if(sch_get_field(pager, upd_schema, field_comp, &comp_field) == SCHEMA_FAIL){
         logger(LL_ERROR, __func__, "Failed to get field %s", field_comp);
         return TABLE_FAIL;
     }
 
     /* Load update field */
     field_t upd_field;
-    if(sch_get_field(upd_schema, field_name, &upd_field) == SCHEMA_FAIL){
+    if(sch_get_field(pager, upd_schema, field_name, &upd_field) == SCHEMA_FAIL){
         logger(LL_ERROR, __func__, "Failed to get field %s", field_comp);
         return TABLE_FAIL;
     }
@@ -408,32 +510,45 @@ int tab_update_element_op(db_t* db,
         return TABLE_FAIL;
     }
 
-    void* el_row = malloc(upd_schema->slot_size);
+    tab_cursor_t cursor;
+    if(tab_cursor_open_write(pager, &cursor, upd_tab) == TABLE_FAIL){
+        logger(LL_ERROR, __func__, "Unable to scan table %"PRId64"", tablix);
+        return TABLE_FAIL;
+    }
+    rowid_t rowids[TAB_BATCH_ROWS];
+    void* rows = malloc(TAB_BATCH_ROWS * upd_schema->slot_size);
     void* el = malloc(comp_field.size);
     void* upd_el = malloc(upd_field.size);
     void* comp_val = malloc(comp_field.size);
     memcpy(comp_val, value, comp_field.size);
 
-    /* Update */
-    tab_for_each_row(upd_tab, upd_chunk,upd_chblix, el_row, upd_schema){
-        memcpy(el, (char*)el_row + comp_field.offset, comp_field.size);
-        if(comp_compare(db, type, el, comp_val, condition)){
+    /* Update, elements of fetched rows are rewritten in place */
+    int res = TABLE_SUCCESS;
+    for(int64_t count; res == TABLE_SUCCESS && (count = tab_cursor_next_batch(pager, &cursor, rowids, rows, TAB_BATCH_ROWS)) > 0;){
+        for(int64_t i = 0; i < count; ++i){
+            memcpy(el, (char*)rows + i * upd_schema->slot_size + comp_field.offset, comp_field.size);
+            if(!comp_compare(pager, db, type, el, comp_val, condition)){
+                continue;
+            }
             memcpy(upd_el, element, upd_field.size);
-            if(tab_update_element(upd_tab, &upd_chblix, &upd_field, upd_el) == TABLE_FAIL){
+            if(tab_update_element(pager, upd_tab, rowids[i], &upd_field, upd_el) == TABLE_FAIL){
                 logger(LL_ERROR, __func__, "Failed to update row");
-                return TABLE_FAIL;
+                res = TABLE_FAIL;
+                break;
             }
         }
     }
+    tab_cursor_close(pager, &cursor);
     free(upd_el);
     free(comp_val);
-    free(el_row);
+    free(rows);
     free(el);
-    return TABLE_SUCCESS;
+    return res;
 }
 
 /**
  * @brief       Delete row from table
+ * @param[in]   pager: handle of database
  * @param[in]   db: pointer to db
  * @param[in]   table: pointer to table
  * @param[in]   schema: pointer to schema
@@ -443,57 +558,51 @@ int tab_update_element_op(db_t* db,
  * @return      TABLE_SUCCESS on success, TABLE_FAIL on failure
  */
 
-int tab_delete_op(db_t* db,
+int tab_delete_op(pager_t* pager, db_t* db,
                    table_t* table,
                    schema_t* schema,
                    field_t* field_comp,
                    condition_t condition,
                    void* value){
+    pg_scoped_t latch pg_latched = {pager, pg_latch(pager, table_index(table), true)};
+    if(latch.page_index == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to latch table %"PRId64"", table_index(table));
+        return TABLE_FAIL;
+    }
 
-    void* el_row = malloc(schema->slot_size);
+    tab_cursor_t cursor;
+    if(tab_cursor_open_write(pager, &cursor, table) == TABLE_FAIL){
+        logger(LL_ERROR, __func__, "Unable to scan table %"PRId64"", table_index(table));
+        return TABLE_FAIL;
+    }
+    rowid_t rowids[TAB_BATCH_ROWS];
+    void* rows = malloc(TAB_BATCH_ROWS * schema->slot_size);
     void* el = malloc(field_comp->size);
     void* comp_val = malloc(field_comp->size);
     memcpy(comp_val, value, field_comp->size);
-    int64_t counter = 0;
-
-    /* Delete */
-    tab_for_each_row(table, del_chunk, del_chblix, el_row, schema){
-        counter++;
-        memcpy(el, (char*)el_row + field_comp->offset, field_comp->size);
-//        int64_t* id = el;
-//        printf("c: %lld | b: %lld | id: %lld\n", del_chblix.chunk_idx, del_chblix.block_idx, *id);
-        if(comp_compare(db, field_comp->type, el, comp_val, condition)){
-            chblix_t temp = del_chblix;
-            bool flag = false;
-            if(del_chunk->num_of_free_blocks + 1 == del_chunk->capacity){
-                int64_t next_chunk = del_chunk->next_page;
-                temp = (chblix_t){.block_idx = -1, .chunk_idx=next_chunk};
-                flag = true;
-            }
-            if(tab_delete_nova(table, del_chunk, &del_chblix) == TABLE_FAIL){
+
+    /* Delete, cursor stands on the next row, so chunk emptied by deletion is already left */
+    int res = TABLE_SUCCESS;
+    for(int64_t count; res == TABLE_SUCCESS && (count = tab_cursor_next_batch(pager, &cursor, rowids, rows, TAB_BATCH_ROWS)) > 0;){
+        for(int64_t i = 0; i < count; ++i){
+            memcpy(el, (char*)rows + i * schema->slot_size + field_comp->offset, field_comp->size);
+            if(comp_compare(pager, db, field_comp->type, el, comp_val, condition) && tab_cursor_delete(pager, &cursor, rowids[i]) == TABLE_FAIL){
                 logger(LL_ERROR, __func__, "Failed to delete row");
-                return TABLE_FAIL;
-            }
-            if(flag){
-                del_chblix = temp;
-                del_chunk = ppl_load_chunk(del_chblix.chunk_idx);
+                res = TABLE_FAIL;
+                break;
             }
         }
     }
+    tab_cursor_close(pager, &cursor);
     free(comp_val);
-    free(el_row);
+    free(rows);
     free(el);
-//    int64_t* val = value;
-//    printf("value %llu, counter %llu\n", *val, counter);
-    fflush(stdout);
-
-
-    return TABLE_SUCCESS;
-
+    return res;
 }
 
 
 /** @brief       Create a table on a subset of fields
+ *  @param[in]   pager: handle of database
  *  @param[in]   db: pointer to db
  *  @param[in]   table: pointer to table
  *  @param[in]   schema: pointer to schema
@@ -503,49 +612,67 @@ int tab_delete_op(db_t* db,
  *  @return      pointer to new table on success, NULL on failure
  */
 
-table_t* tab_projection(db_t* db,
+table_t* tab_projection(pager_t* pager, db_t* db,
                    table_t* table,
                    schema_t* schema,
                    field_t* fields,
                    int64_t num_of_fields,
                    const char* name){
+    pg_scoped_t latch pg_latched = {pager, pg_latch(pager, table_index(table), false)};
+    if(latch.page_index == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to latch table %"PRId64"", table_index(table));
+        return NULL;
+    }
 
     /* Create new schema */
-    schema_t* new_schema = sch_init();
+    schema_t* new_schema = sch_init(pager);
     if(new_schema == NULL){
         logger(LL_ERROR, __func__, "Failed to create new schema");
         return NULL;
     }
     for(int64_t i = 0; i < num_of_fields; ++i){
-        if(sch_add_field(new_schema, fields[i].name, fields[i].type, (int64_t)fields[i].size) == SCHEMA_FAIL){
+        if(sch_add_field(pager, new_schema, fields[i].name, fields[i].type, (int64_t)fields[i].size) == SCHEMA_FAIL){
             logger(LL_ERROR, __func__, "Failed to add field %s", fields[i].name);
             return NULL;
         }
     }
 
     /* Create new table */
-    table_t* new_table = tab_init(db, name, new_schema);
+    table_t* new_table = tab_init(pager, db, name, new_schema);
     if(new_table == NULL){
         logger(LL_ERROR, __func__, "Failed to create new table");
         return NULL;
     }
 
+    tab_cursor_t cursor;
+    if(tab_cursor_open(pager, &cursor, table) == TABLE_FAIL){
+        logger(LL_ERROR, __func__, "Unable to scan table %"PRId64"", table_index(table));
+        return NULL;
+    }
+
     /* Create new row */
     void* row = malloc(new_schema->slot_size);
-
-    /* Projection */
-
-    tab_for_each_row(table, chunk, chblix, row, schema){
-        for(int64_t i = 0; i < num_of_fields; ++i){
-            memcpy((char*)row + fields[i].offset, (char*)row + fields[i].offset, fields[i].size);
-        }
-        chblix_t rowix = tab_insert(new_table, new_schema, row);
-        if(chblix_cmp(&rowix, &CHBLIX_FAIL) == 0){
-            logger(LL_ERROR, __func__, "Failed to insert row");
-            return NULL;
+    void* rows = malloc(TAB_BATCH_ROWS * schema->slot_size);
+
+    /* Projection, fields are copied from fetched rows, they lie one after another in new row */
+    bool failed = false;
+    for(int64_t count; !failed && (count = tab_cursor_next_batch(pager, &cursor, NULL, rows, TAB_BATCH_ROWS)) > 0;){
+        for(int64_t i = 0; i < count; ++i){
+            const char* src_row = (char*)rows + i * schema->slot_size;
+            int64_t offset = 0;
+            for(int64_t f = 0; f < num_of_fields; ++f){
+                memcpy((char*)row + offset, src_row + fields[f].offset, fields[f].size);
+                offset += (int64_t)fields[f].size;
+            }
+            if(tab_insert(pager, new_table, new_schema, row) == ROWID_FAIL){
+                logger(LL_ERROR, __func__, "Failed to insert row");
+                failed = true;
+                break;
+            }
         }
     }
+    tab_cursor_close(pager, &cursor);
+    free(rows);
     free(row);
-    return new_table;
+    return failed ? NULL : new_table;
 }
-
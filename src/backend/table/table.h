@@ -6,15 +6,15 @@
 #include <inttypes.h>
 
 
-table_t* tab_init(db_t* db, const char* name, schema_t* schema);
-chblix_t tab_get_row(db_t* db,
-                     table_t* table,
-                     schema_t* schema,
-                     field_t* field,
-                     void* value,
-                     datatype_t type);
-void tab_print(db_t* db, table_t* table, schema_t* schema);
-table_t* tab_join(
+table_t* tab_init(pager_t* pager, db_t* db, const char* name, schema_t* schema);
+rowid_t tab_get_row(pager_t* pager, db_t* db,
+                    table_t* table,
+                    schema_t* schema,
+                    field_t* field,
+                    void* value,
+                    datatype_t type);
+void tab_print(pager_t* pager, db_t* db, table_t* table, schema_t* schema);
+table_t* tab_join(pager_t* pager, 
         db_t* db,
         table_t* left,
         schema_t* left_schema,
@@ -23,7 +23,7 @@ table_t* tab_join(
         field_t* join_field_left,
         field_t* join_field_right,
         const char* name);
-table_t* tab_select_op(db_t* db,
+table_t* tab_select_op(pager_t* pager, db_t* db,
                             table_t* sel_table,
                             schema_t* sel_schema,
                             field_t* select_field,
@@ -32,8 +32,8 @@ table_t* tab_select_op(db_t* db,
                             void* value,
                             datatype_t type);
 
-int tab_drop(db_t* db, table_t* table);
-int tab_update_row_op(db_t* db,
+int tab_drop(pager_t* pager, db_t* db, table_t* table);
+int tab_update_row_op(pager_t* pager, db_t* db,
                            table_t* table,
                            schema_t* schema,
                            field_t* field,
@@ -41,7 +41,7 @@ int tab_update_row_op(db_t* db,
                            void* value,
                            datatype_t type,
                            void* row);
-int tab_update_element_op(db_t* db,
+int tab_update_element_op(pager_t* pager, db_t* db,
                           int64_t tablix,
                           void* element,
                           const char* field_name,
@@ -49,14 +49,14 @@ int tab_update_element_op(db_t* db,
                           condition_t condition,
                           void* value,
                           datatype_t type);
-int tab_delete_op(db_t* db,
+int tab_delete_op(pager_t* pager, db_t* db,
                    table_t* table,
                    schema_t* schema,
                    field_t* comp,
                    condition_t condition,
                    void* value);
 
-table_t* tab_projection(db_t* db,
+table_t* tab_projection(pager_t* pager, db_t* db,
                         table_t* table,
                         schema_t* schema,
                         field_t* fields,
@@ -4,23 +4,35 @@
 
 /**
  * @brief       Initialize a table
+ * @param[in]   pager: handle of database
  * @param[in]   name: name of the table
  * @param[in]   schema: pointer to schema
  * @param[out]  table: pointer to allocated table
  * @return      index of the table on success, TABLE_FAIL on failure
  */
 
-table_t* tab_base_init(const char* name, schema_t* schema){
+table_t* tab_base_init(pager_t* pager, const char* name, schema_t* schema){
     if(schema == NULL){
         logger(LL_ERROR, __func__, "Invalid argument, schema is NULL");
         return NULL;
     }
-    int64_t tablix = lb_ppl_init((int64_t)schema->slot_size);
+    pg_scoped_t schema_latch pg_latched = {pager, pg_latch(pager, schema_index(schema), false)};
+    if(schema_latch.page_index == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to latch schema %ld", schema_index(schema));
+        return NULL;
+    }
+    int64_t tablix = lb_ppl_init(pager, (int64_t)schema->slot_size);
     if(tablix == LB_FAIL){
         logger(LL_ERROR, __func__, "Failed to initialize table %s", name);
         return NULL;
     }
-    table_t* table = (table_t*)lb_ppl_load(tablix);
+    /* table is new, no other thread waits for its latch */
+    pg_scoped_t latch pg_latched = {pager, pg_latch(pager, tablix, true)};
+    if(latch.page_index == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to latch table %ld", tablix);
+        return NULL;
+    }
+    table_t* table = (table_t*)lb_ppl_load(pager, tablix);
     if(table == NULL){
         logger(LL_ERROR, __func__, "Failed to load table %s", name);
         return NULL;
@@ -32,97 +44,151 @@ table_t* tab_base_init(const char* name, schema_t* schema){
 
 /**
  * @brief       Insert a row
+ * @param[in]   pager: handle of database
  * @param[in]   table: pointer to table
  * @param[in]   schema: pointer to schema
  * @param[in]   src: source
- * @return      chblix_t of row on success, CHBLIX_FAIL on failure
+ * @return      row id on success, ROWID_FAIL on failure
  */
 
-chblix_t tab_insert(table_t* table, schema_t* schema, void* src){
+rowid_t tab_insert(pager_t* pager, table_t* table, schema_t* schema, void* src){
     if(table == NULL){
         logger(LL_ERROR, __func__, "Invalid argument: table is NULL");
-        return CHBLIX_FAIL;
+        return ROWID_FAIL;
+    }
+    pg_scoped_t latch pg_latched = {pager, pg_latch(pager, table_index(table), true)};
+    if(latch.page_index == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to latch table %ld", table_index(table));
+        return ROWID_FAIL;
     }
 
-    chblix_t rowix = lb_alloc(&table->ppl_header);
+    chblix_t rowix = lb_alloc(pager, &table->ppl_header);
 //    printf("c: %lld | b: %lld | ", rowix.chunk_idx, rowix.block_idx);
 
     if(chblix_cmp(&rowix, &CHBLIX_FAIL) == 0){
         logger(LL_ERROR, __func__, "Failed to allocate row");
-        return CHBLIX_FAIL;
+        return ROWID_FAIL;
     }
 
-    if(lb_write(&table->ppl_header, &rowix, src, schema->slot_size, 0) == LB_FAIL){
+    if(lb_write(pager, &table->ppl_header, &rowix, src, schema->slot_size, 0) == LB_FAIL){
         logger(LL_ERROR, __func__, "Failed to write row");
-        return CHBLIX_FAIL;
+        return ROWID_FAIL;
     }
 
-    return rowix;
+    return rowid_pack(rowix);
 
 }
 
 /**
  * @brief       Select a row
- * @param[in]   tablix: index of the table
- * @param[in]   rowix: chblix of the row
+ * @param[in]   pager: handle of database
+ * @param[in]   table: pointer to the table
+ * @param[in]   rowid: row id
  * @param[out]  dest: destination
  * @return      TABLE_SUCCESS on success, TABLE_FAIL on failure
  */
 
-int tab_select_row(int64_t tablix, chblix_t* rowix, void* dest){
-    table_t* table = tab_load(tablix);
+int tab_select_row(pager_t* pager, table_t* table, rowid_t rowid, void* dest){
     if(table == NULL){
-        logger(LL_ERROR, __func__, "Failed to load table %ld", tablix);
+        logger(LL_ERROR, __func__, "Invalid argument: table is NULL");
         return TABLE_FAIL;
     }
-
-    schema_t* schema = sch_load(table->schidx);
+    pg_scoped_t latch pg_latched = {pager, pg_latch(pager, table_index(table), false)};
+    if(latch.page_index == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to latch table %ld", table_index(table));
+        return TABLE_FAIL;
+    }
+    schema_t* schema = sch_read(pager, table->schidx);
     if(schema == NULL){
         logger(LL_ERROR, __func__, "Failed to load schema %ld", table->schidx);
         return TABLE_FAIL;
     }
 
-    if(lb_read(tablix, rowix, dest, schema->slot_size, 0) == LB_FAIL){
+    chblix_t rowix = rowid_unpack(rowid);
+    if(lb_read(pager, table_index(table), &rowix, dest, schema->slot_size, 0) == LB_FAIL){
         logger(LL_ERROR, __func__, "Failed to read row");
         return TABLE_FAIL;
     }
     return TABLE_SUCCESS;
 }
 
+/**
+ * @brief       View a row without copying it
+ * @details     Pointer is into page of row chunk, the page is pinned and stays valid till
+ *              pin is released, e.g. pg_scoped_t pin pg_pinned = {pager, -1};
+ *              tab_row_view(pager, table, rowid, &pin.page_index);
+ *              Row is changed by concurrent writers unless table is latched.
+ * @param[in]   pager: handle of database
+ * @param[in]   table: pointer to table
+ * @param[in]   rowid: row id
+ * @param[out]  pin: index of pinned page to unpin with pg_unpin, -1 if nothing is pinned
+ * @return      pointer to the row on success, NULL if row doesn't exist or can't be viewed
+ */
+
+const void* tab_row_view(pager_t* pager, table_t* table, rowid_t rowid, int64_t* pin){
+    *pin = -1;
+    if(table == NULL || rowid == ROWID_FAIL){
+        logger(LL_ERROR, __func__, "Invalid arguments");
+        return NULL;
+    }
+    pg_scoped_t chunk_pin pg_pinned = {pager, pg_pin(pager, rowid_chunk(rowid))};
+    if(chunk_pin.page_index == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to pin chunk %ld", rowid_chunk(rowid));
+        return NULL;
+    }
+    chunk_t* chunk = ppl_read_chunk(pager, rowid_chunk(rowid));
+    if(chunk == NULL){
+        logger(LL_ERROR, __func__, "Unable to load chunk %ld", rowid_chunk(rowid));
+        return NULL;
+    }
+    chblix_t rowix = rowid_unpack(rowid);
+    if(!lb_valid(pager, &table->ppl_header, chunk, rowix)){
+        logger(LL_ERROR, __func__, "Row %lu doesn't exist", rowid);
+        return NULL;
+    }
+    const void* row = lb_view(&table->ppl_header, chunk, &rowix);
+    if(row != NULL){
+        /* pin is handed over to caller */
+        *pin = chunk_pin.page_index;
+        chunk_pin.page_index = -1;
+    }
+    return row;
+}
+
 /**
  * @brief       Delete a row
+ * @param       pager: handle of database
  * @param       table: pointer to table
  * @param       chunk: pointer to chunk
- * @param       rowix: chblix of the row
+ * @param       rowid: row id
  * @return      TABLE_SUCCESS on success, TABLE_FAIL on failure
  */
 
-int tab_delete_nova(table_t* table, chunk_t* chunk, chblix_t* rowix){
-    /* Loading Linked Block */
-    linked_block_t* lb = malloc(table->ppl_header.block_size); /* Don't forget to free it */
-    if (lb_load_nova_pppp(&table->ppl_header,chunk, rowix, lb) == LB_FAIL) {
-        logger(LL_ERROR, __func__, "Unable to read block");
-        free(lb);
+int tab_delete_nova(pager_t* pager, table_t* table, chunk_t* chunk, rowid_t rowid){
+    pg_scoped_t latch pg_latched = {pager, pg_latch(pager, table_index(table), true)};
+    if(latch.page_index == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to latch table %ld", table_index(table));
         return TABLE_FAIL;
     }
-    if(lb_dealloc_nova(&table->ppl_header, lb) == LB_FAIL){
+    chblix_t rowix = rowid_unpack(rowid);
+    if(lb_dealloc_nova(pager, &table->ppl_header, chunk, &rowix) == LB_FAIL){
         logger(LL_ERROR, __func__, "Failed to deallocate row");
         return TABLE_FAIL;
     }
-    free(lb);
     return TABLE_SUCCESS;
 }
 
 /**
  * @brief       Update a row
+ * @param[in]   pager: handle of database
  * @param[in]   table: pointer to table
  * @param[in]   schema: pointer to schema
- * @param[in]   rowix: chblix of the row
+ * @param[in]   rowid: row id
  * @param[in]   row: row to be written
  * @return      TABLE_SUCCESS on success, TABLE_FAIL on failure
  */
 
-int tab_update_row(table_t* table, schema_t* schema, chblix_t* rowix, void* row){
+int tab_update_row(pager_t* pager, table_t* table, schema_t* schema, rowid_t rowid, void* row){
     if(table == NULL){
         logger(LL_ERROR, __func__, "Invalid argument: table is NULL");
         return TABLE_FAIL;
@@ -132,8 +198,14 @@ int tab_update_row(table_t* table, schema_t* schema, chblix_t* rowix, void* row)
         logger(LL_ERROR, __func__, "Invalid argument: schema is NULL");
         return TABLE_FAIL;
     }
+    pg_scoped_t latch pg_latched = {pager, pg_latch(pager, table_index(table), true)};
+    if(latch.page_index == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to latch table %ld", table_index(table));
+        return TABLE_FAIL;
+    }
 
-    if(lb_write(&table->ppl_header, rowix, row, schema->slot_size, 0) == LB_FAIL){
+    chblix_t rowix = rowid_unpack(rowid);
+    if(lb_write(pager, &table->ppl_header, &rowix, row, schema->slot_size, 0) == LB_FAIL){
         logger(LL_ERROR, __func__, "Failed to write row");
         return TABLE_FAIL;
     }
@@ -142,15 +214,22 @@ int tab_update_row(table_t* table, schema_t* schema, chblix_t* rowix, void* row)
 
 /**
  * @brief       Update an element
+ * @param[in]   pager: handle of database
  * @param[in]   table: pointer to table
- * @param[in]   rowix: chblix of the row
+ * @param[in]   rowid: row id
  * @param[in]   field: pointer to the field
  * @param[in]   element: pointer to the element to be written
  * @return      TABLE_SUCCESS on success, TABLE_FAIL on failure
  */
 
-int tab_update_element(table_t* table, chblix_t* rowix, field_t* field, void* element){
-    if(lb_write(&table->ppl_header, rowix, element, (int64_t) field->size, (int64_t) field->offset) == LB_FAIL){
+int tab_update_element(pager_t* pager, table_t* table, rowid_t rowid, field_t* field, void* element){
+    pg_scoped_t latch pg_latched = {pager, pg_latch(pager, table_index(table), true)};
+    if(latch.page_index == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to latch table %ld", table_index(table));
+        return TABLE_FAIL;
+    }
+    chblix_t rowix = rowid_unpack(rowid);
+    if(lb_write(pager, &table->ppl_header, &rowix, element, (int64_t) field->size, (int64_t) field->offset) == LB_FAIL){
         logger(LL_ERROR, __func__, "Failed to write row");
         return TABLE_FAIL;
     }
@@ -160,34 +239,251 @@ int tab_update_element(table_t* table, chblix_t* rowix, field_t* field, void* el
 
 /**
  * @brief       Get an element from row
- * @param[in]   tablix: index of the table
- * @param[in]   rowix: chblix of the row
+ * @param[in]   pager: handle of database
+ * @param[in]   table: pointer to the table
+ * @param[in]   rowid: row id
  * @param[in]   field: pointer to the field
  * @param[out]  element: pointer to the element to be written
  * @return      TABLE_SUCCESS on success, TABLE_FAIL on failure
  */
 
-int tab_get_element(int64_t tablix, chblix_t* rowix, field_t* field, void* element){
-    table_t* table = tab_load(tablix);
+int tab_get_element(pager_t* pager, table_t* table, rowid_t rowid, field_t* field, void* element){
     if(table == NULL){
-        logger(LL_ERROR, __func__, "Failed to load table %ld", tablix);
+        logger(LL_ERROR, __func__, "Invalid argument: table is NULL");
         return TABLE_FAIL;
     }
-
-    schema_t* schema = sch_load(table->schidx);
-    if(schema == NULL){
-        logger(LL_ERROR, __func__, "Failed to load schema %ld", table->schidx);
+    pg_scoped_t latch pg_latched = {pager, pg_latch(pager, table_index(table), false)};
+    if(latch.page_index == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to latch table %ld", table_index(table));
         return TABLE_FAIL;
     }
 
-    if(lb_read(tablix, rowix, element, (int64_t)field->size, (int64_t)field->offset) == LB_FAIL){
+    chblix_t rowix = rowid_unpack(rowid);
+    if(lb_read(pager, table_index(table), &rowix, element, (int64_t)field->size, (int64_t)field->offset) == LB_FAIL){
         logger(LL_ERROR, __func__, "Failed to read row");
         return TABLE_FAIL;
     }
     return TABLE_SUCCESS;
 }
 
+/**
+ * @brief       Open scan of table rows, table is latched
+ * @param[in]   pager: handle of database
+ * @param[out]  cursor: cursor to open
+ * @param[in]   table: pointer to the table
+ * @param[in]   writable: table is latched exclusively
+ * @return      TABLE_SUCCESS on success, TABLE_FAIL on failure
+ */
+
+static int tab_cursor_start(pager_t* pager, tab_cursor_t* cursor, table_t* table, bool writable){
+    if(cursor == NULL || table == NULL){
+        logger(LL_ERROR, __func__, "Invalid arguments");
+        return TABLE_FAIL;
+    }
+    *cursor = (tab_cursor_t){.table = table, .chunk = NULL, .block_idx = 0, .chunk_pin = PAGER_FAIL,
+                             .pool_pin = PAGER_FAIL, .latch = PAGER_FAIL, .writable = writable};
+    cursor->latch = pg_latch(pager, table_index(table), writable);
+    if(cursor->latch == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to latch table %ld", table_index(table));
+        return TABLE_FAIL;
+    }
+    cursor->pool_pin = pg_pin(pager, table_index(table));
+    if(table->ppl_header.head == -1){
+        return TABLE_SUCCESS;
+    }
+    cursor->chunk_pin = pg_pin(pager, table->ppl_header.head);
+    cursor->chunk = ppl_read_chunk(pager, table->ppl_header.head);
+    if(cursor->chunk == NULL){
+        logger(LL_ERROR, __func__, "Unable to load chunk %ld", table->ppl_header.head);
+        tab_cursor_close(pager, cursor);
+        return TABLE_FAIL;
+    }
+    return TABLE_SUCCESS;
+}
+
+/**
+ * @brief       Open scan of table rows for reading
+ * @details     Table is latched shared until cursor is closed, so rows aren't changed during scan.
+ *              Rows mustn't be changed through read only cursor.
+ * @param[in]   pager: handle of database
+ * @param[out]  cursor: cursor to open
+ * @param[in]   table: pointer to the table
+ * @return      TABLE_SUCCESS on success, TABLE_FAIL on failure
+ */
+
+int tab_cursor_open(pager_t* pager, tab_cursor_t* cursor, table_t* table){
+    return tab_cursor_start(pager, cursor, table, false);
+}
+
+/**
+ * @brief       Open scan of table rows for changing them
+ * @details     Table is latched exclusively until cursor is closed, latch held by calling thread
+ *              is taken again. Fetched rows may be updated in place or deleted by tab_cursor_delete,
+ *              rows mustn't be inserted into the table during scan.
+ * @param[in]   pager: handle of database
+ * @param[out]  cursor: cursor to open
+ * @param[in]   table: pointer to the table
+ * @return      TABLE_SUCCESS on success, TABLE_FAIL on failure
+ */
+
+int tab_cursor_open_write(pager_t* pager, tab_cursor_t* cursor, table_t* table){
+    return tab_cursor_start(pager, cursor, table, true);
+}
+
+/**
+ * @brief       Move cursor to the next chunk which has rows
+ * @param[in]   pager: handle of database
+ * @param[in]   cursor: open cursor
+ * @return      TABLE_SUCCESS on success, TABLE_FAIL if there are no more rows
+ */
+
+static int tab_cursor_next_chunk(pager_t* pager, tab_cursor_t* cursor){
+    page_pool_t* ppl = &cursor->table->ppl_header;
+    chblix_t next = lb_nearest_valid_chblix(pager, ppl,
+                                            (chblix_t){.block_idx = cursor->chunk->capacity,
+                                                       .chunk_idx = cursor->chunk->page_index},
+                                            &cursor->chunk, &cursor->chunk_pin);
+    if(chblix_cmp(&next, &CHBLIX_FAIL) == 0){
+        return TABLE_FAIL;
+    }
+    cursor->block_idx = next.block_idx;
+    return TABLE_SUCCESS;
+}
+
+/**
+ * @brief       Move cursor to the next row which isn't fetched
+ * @details     Cursor leaves chunk which has no more rows, so the chunk may be freed once
+ *              its rows are deleted. Cursor is finished after the last row.
+ * @param[in]   pager: handle of database
+ * @param[in]   cursor: open cursor
+ */
+
+static void tab_cursor_settle(pager_t* pager, tab_cursor_t* cursor){
+    if(cursor->chunk == NULL){
+        return;
+    }
+    const chunk_t* chunk = cursor->chunk;
+    const uint64_t* heads = ppl_head_bits(chunk);
+    int64_t words = ppl_bitmap_words(chunk->capacity);
+    for(int64_t word = cursor->block_idx / PPL_WORD_BITS; word < words; ++word){
+        uint64_t bits = heads[word];
+        if(word == cursor->block_idx / PPL_WORD_BITS){
+            bits &= ~0ull << (cursor->block_idx % PPL_WORD_BITS);
+        }
+        if(bits){
+            return;
+        }
+    }
+    if(tab_cursor_next_chunk(pager, cursor) == TABLE_FAIL){
+        if(cursor->chunk_pin != PAGER_FAIL){
+            pg_unpin(pager, cursor->chunk_pin);
+            cursor->chunk_pin = PAGER_FAIL;
+        }
+        cursor->chunk = NULL;
+    }
+}
+
+/**
+ * @brief       Fetch next rows of scan
+ * @details     Rows of current chunk are found by its chain head bitmap and copied from chunk page,
+ *              chunk is left for the next one only when all its rows are taken.
+ * @param[in]   pager: handle of database
+ * @param[in]   cursor: open cursor
+ * @param[out]  rowids: array of count row ids or NULL
+ * @param[out]  rows: buffer of count rows of table slot size or NULL
+ * @param[in]   count: maximum number of rows
+ * @return      number of fetched rows, 0 at the end of scan, TABLE_FAIL on failure
+ */
+
+int64_t tab_cursor_next_batch(pager_t* pager, tab_cursor_t* cursor, rowid_t* rowids, void* rows, int64_t count){
+    if(cursor == NULL || cursor->table == NULL || count < 0){
+        logger(LL_ERROR, __func__, "Invalid arguments");
+        return TABLE_FAIL;
+    }
+    page_pool_t* ppl = &cursor->table->ppl_header;
+    int64_t row_size = lb_block_data_size(ppl);
+    int64_t fetched = 0;
+    while(fetched < count && cursor->chunk != NULL){
+        chunk_t* chunk = cursor->chunk;
+        const uint64_t* heads = ppl_head_bits(chunk);
+        int64_t words = ppl_bitmap_words(chunk->capacity);
+        int64_t word = cursor->block_idx / PPL_WORD_BITS;
+        uint64_t bits = word < words ? heads[word] & (~0ull << (cursor->block_idx % PPL_WORD_BITS)) : 0;
+        while(fetched < count && word < words){
+            if(!bits){
+                if(++word < words){
+                    bits = heads[word];
+                }
+                continue;
+            }
+            chblix_t rowix = {.block_idx = word * PPL_WORD_BITS + __builtin_ctzll(bits),
+                              .chunk_idx = chunk->page_index};
+            bits &= bits - 1;
+            if(rows != NULL){
+                void* dest = (char*)rows + fetched * row_size;
+                const void* view = lb_view(ppl, chunk, &rowix);
+                if(view != NULL){
+                    memcpy(dest, view, row_size);
+                }
+                else if(lb_read_nova(pager, ppl, chunk, &rowix, dest, row_size, 0) == LB_FAIL){
+                    logger(LL_ERROR, __func__, "Failed to read row");
+                    return TABLE_FAIL;
+                }
+            }
+            if(rowids != NULL){
+                rowids[fetched] = rowid_pack(rowix);
+            }
+            fetched++;
+            cursor->block_idx = rowix.block_idx + 1;
+        }
+        if(word >= words){
+            cursor->block_idx = chunk->capacity;
+        }
+        tab_cursor_settle(pager, cursor);
+    }
+    return fetched;
+}
 
+/**
+ * @brief       Delete row fetched by cursor
+ * @param[in]   pager: handle of database
+ * @param[in]   cursor: cursor opened by tab_cursor_open_write
+ * @param[in]   rowid: id of fetched row
+ * @return      TABLE_SUCCESS on success, TABLE_FAIL on failure
+ */
 
+int tab_cursor_delete(pager_t* pager, tab_cursor_t* cursor, rowid_t rowid){
+    if(cursor == NULL || cursor->table == NULL || !cursor->writable){
+        logger(LL_ERROR, __func__, "Rows are deleted by writable cursor");
+        return TABLE_FAIL;
+    }
+    chunk_t* chunk = cursor->chunk;
+    if(chunk != NULL && chunk->page_index == rowid_chunk(rowid) && rowid_block(rowid) >= cursor->block_idx){
+        logger(LL_ERROR, __func__, "Row %ld:%ld isn't fetched", rowid_chunk(rowid), rowid_block(rowid));
+        return TABLE_FAIL;
+    }
+    return tab_delete_nova(pager, cursor->table, chunk != NULL && chunk->page_index == rowid_chunk(rowid) ? chunk : NULL, rowid);
+}
 
+/**
+ * @brief       Close scan, pins and latch of cursor are released
+ * @param[in]   pager: handle of database
+ * @param[in]   cursor: cursor to close
+ */
 
+void tab_cursor_close(pager_t* pager, tab_cursor_t* cursor){
+    if(cursor == NULL){
+        return;
+    }
+    if(cursor->chunk_pin != PAGER_FAIL){
+        pg_unpin(pager, cursor->chunk_pin);
+    }
+    if(cursor->pool_pin != PAGER_FAIL){
+        pg_unpin(pager, cursor->pool_pin);
+    }
+    if(cursor->latch != PAGER_FAIL){
+        pg_unlatch(pager, cursor->latch);
+    }
+    *cursor = (tab_cursor_t){.table = NULL, .chunk = NULL, .chunk_pin = PAGER_FAIL,
+                             .pool_pin = PAGER_FAIL, .latch = PAGER_FAIL, .writable = false};
+}
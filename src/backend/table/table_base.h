@@ -11,15 +11,49 @@ typedef struct table {
 
 typedef enum {TABLE_SUCCESS = 0, TABLE_FAIL = -1} table_status_t;
 
+/**
+ * Scan of table rows in batches. Table is latched and pool page and current chunk are pinned
+ * while cursor is open, rows are taken from chain head bitmap of chunk word by word.
+ * Cursor of tab_cursor_open latches table shared and is read only. Cursor of tab_cursor_open_write
+ * latches table exclusively, it can be opened inside exclusive latch of table, and fetched rows
+ * may be updated in place or deleted by tab_cursor_delete between batches. Cursor always stands
+ * on a row which isn't fetched yet, so its chunk isn't emptied and freed by such deletions.
+ */
+typedef struct tab_cursor{
+    table_t* table;
+    chunk_t* chunk;         /* current chunk, NULL when scan is finished */
+    int64_t block_idx;      /* next block to visit in current chunk */
+    int64_t chunk_pin;      /* pinned chunk page */
+    int64_t pool_pin;       /* pinned pool page */
+    int64_t latch;          /* latched table */
+    bool writable;          /* table is latched exclusively */
+} tab_cursor_t;
+
+/* Rows fetched by one step of scans of table operators */
+#ifndef TAB_BATCH_ROWS
+#define TAB_BATCH_ROWS 64
+#endif
+
 
 
 /**
  * @brief       Load a table
+ * @param[in]   pager: handle of database
  * @param[in]   tablix: index of the table
  * @return      pointer to the table on success, NULL on failure
  */
 
-#define tab_load(tablix) (table_t*)lb_ppl_load(tablix)
+#define tab_load(pager, tablix) (table_t*)lb_ppl_load(pager, tablix)
+
+/**
+ * @brief       Load a table for reading
+ * @details     Table isn't marked dirty, it must not be modified through returned pointer.
+ * @param[in]   pager: handle of database
+ * @param[in]   tablix: index of the table
+ * @return      pointer to the table on success, NULL on failure
+ */
+
+#define tab_read(pager, tablix) (table_t*)lb_ppl_read(pager, tablix)
 
 /**
  * @brief       Get table index
@@ -30,6 +64,7 @@ typedef enum {TABLE_SUCCESS = 0, TABLE_FAIL = -1} table_status_t;
 
 /**
  * @brief       For each element specific column in a table
+ * @param[in]   pager: handle of database
  * @param[in]   table: pointer to the table
  * @param[in]   chunk: chunk
  * @param[in]   chblix: chblix of the row
@@ -37,17 +72,20 @@ typedef enum {TABLE_SUCCESS = 0, TABLE_FAIL = -1} table_status_t;
  * @param[in]   field: pointer to field of the element
  */
 
-#define tab_for_each_element(table, chunk, chblix, element, field) \
-chunk_t* chunk = ppl_load_chunk(table->ppl_header.head);                     \
-chblix_t chblix = lb_pool_start(&table->ppl_header, &chunk);\
-lb_read_nova(&table->ppl_header,chunk, &chblix, element, (int64_t)(field)->size, (int64_t)(field)->offset);\
+#define tab_for_each_element(pager, table, chunk, chblix, element, field) \
+pg_scoped_t chunk##_pool_pin pg_pinned = {pager, pg_pin(pager, page_pool_index((&table->ppl_header)))}; \
+pg_scoped_t chunk##_pin pg_pinned = {pager, pg_pin(pager, table->ppl_header.head)}; \
+chunk_t* chunk = ppl_read_chunk(pager, table->ppl_header.head);                     \
+chblix_t chblix = lb_pool_start(pager, &table->ppl_header, &chunk, &chunk##_pin.page_index);\
+lb_read_nova(pager, &table->ppl_header,chunk, &chblix, element, (int64_t)(field)->size, (int64_t)(field)->offset);\
 for (;\
 chblix_cmp(&chblix, &CHBLIX_FAIL) != 0 &&\
-lb_read_nova(&table->ppl_header, chunk, &chblix, element, (int64_t)(field)->size, (int64_t)(field)->offset) != LB_FAIL;\
-++chblix.block_idx, chblix = lb_nearest_valid_chblix(&table->ppl_header, chblix, &chunk))
+lb_read_nova(pager, &table->ppl_header, chunk, &chblix, element, (int64_t)(field)->size, (int64_t)(field)->offset) != LB_FAIL;\
+++chblix.block_idx, chblix = lb_nearest_valid_chblix(pager, &table->ppl_header, chblix, &chunk, &chunk##_pin.page_index))
 
 /**
  * @brief       For each element specific column in a table
+ * @param[in]   pager: handle of database
  * @param[in]   table: pointer to the table
  * @param[in]   chunk: chunk
  * @param[in]   chblix: chblix of the row
@@ -55,15 +93,42 @@ lb_read_nova(&table->ppl_header, chunk, &chblix, element, (int64_t)(field)->size
  * @param[in]   schema: pointer to the schema
  */
 
-#define tab_for_each_row(table, chunk, chblix, row, schema) \
-chunk_t* chunk = ppl_load_chunk(table->ppl_header.head);   \
-chblix_t chblix = lb_pool_start(&table->ppl_header, &chunk);\
-lb_read_nova(&table->ppl_header, chunk, &chblix, row, schema->slot_size, 0);\
+#define tab_for_each_row(pager, table, chunk, chblix, row, schema) \
+pg_scoped_t chunk##_pool_pin pg_pinned = {pager, pg_pin(pager, page_pool_index((&table->ppl_header)))}; \
+pg_scoped_t chunk##_pin pg_pinned = {pager, pg_pin(pager, table->ppl_header.head)}; \
+chunk_t* chunk = ppl_read_chunk(pager, table->ppl_header.head);   \
+chblix_t chblix = lb_pool_start(pager, &table->ppl_header, &chunk, &chunk##_pin.page_index);\
+lb_read_nova(pager, &table->ppl_header, chunk, &chblix, row, schema->slot_size, 0);\
 for (;                                         \
 chblix_cmp(&chblix, &CHBLIX_FAIL) != 0 &&\
-lb_read_nova(&table->ppl_header,chunk,  &chblix, row, schema->slot_size, 0) != LB_FAIL; \
-++chblix.block_idx, chblix = lb_nearest_valid_chblix(&table->ppl_header,\
-                                                                      chblix, &chunk))
+lb_read_nova(pager, &table->ppl_header,chunk,  &chblix, row, schema->slot_size, 0) != LB_FAIL; \
+++chblix.block_idx, chblix = lb_nearest_valid_chblix(pager, &table->ppl_header,\
+                                                                      chblix, &chunk, &chunk##_pin.page_index))
+
+/**
+ * @brief       For each row in a table, rows are read in place
+ * @details     Row which can't be viewed in its chunk page is copied to buffer.
+ *              Row is valid until the next step of loop.
+ * @param[in]   pager: handle of database
+ * @param[in]   table: pointer to the table
+ * @param[in]   chunk: chunk
+ * @param[in]   chblix: chblix of the row
+ * @param[in]   row: name of const pointer to the row, it is declared by this macro
+ * @param[in]   buffer: row sized buffer, must be allocated before calling this macro
+ */
+
+#define tab_for_each_row_view(pager, table, chunk, chblix, row, buffer) \
+pg_scoped_t chunk##_pool_pin pg_pinned = {pager, pg_pin(pager, page_pool_index((&table->ppl_header)))}; \
+pg_scoped_t chunk##_pin pg_pinned = {pager, pg_pin(pager, table->ppl_header.head)}; \
+chunk_t* chunk = ppl_read_chunk(pager, table->ppl_header.head);   \
+const void* row = NULL; \
+for (chblix_t chblix = lb_pool_start(pager, &table->ppl_header, &chunk, &chunk##_pin.page_index); \
+chblix_cmp(&chblix, &CHBLIX_FAIL) != 0 && \
+((row = lb_view(&table->ppl_header, chunk, &chblix)) != NULL || \
+ (lb_read_nova(pager, &table->ppl_header, chunk, &chblix, (buffer), lb_block_data_size(&table->ppl_header), 0) != LB_FAIL \
+  && (row = (buffer)) != NULL)); \
+++chblix.block_idx, chblix = lb_nearest_valid_chblix(pager, &table->ppl_header,\
+                                                                      chblix, &chunk, &chunk##_pin.page_index))
 
 #define tab_row(...) \
     typedef struct __attribute__((packed)){ \
@@ -71,12 +136,18 @@ lb_read_nova(&table->ppl_header,chunk,  &chblix, row, schema->slot_size, 0) != L
     } row_t;         \
 row_t row
 
-table_t* tab_base_init(const char* name, schema_t* schema);
-chblix_t tab_insert(table_t* table, schema_t* schema, void* src);
-int tab_select_row(int64_t tablix, chblix_t* rowix, void* dest);
-int tab_delete_nova(table_t* table, chunk_t* chunk, chblix_t* rowix);
-int tab_delete(int64_t tablix, chblix_t* rowix);
-int tab_update_row(table_t* table, schema_t* schema, chblix_t* rowix, void* row);
+table_t* tab_base_init(pager_t* pager, const char* name, schema_t* schema);
+rowid_t tab_insert(pager_t* pager, table_t* table, schema_t* schema, void* src);
+int tab_select_row(pager_t* pager, table_t* table, rowid_t rowid, void* dest);
+const void* tab_row_view(pager_t* pager, table_t* table, rowid_t rowid, int64_t* pin);
+int tab_delete_nova(pager_t* pager, table_t* table, chunk_t* chunk, rowid_t rowid);
+int tab_delete(int64_t tablix, rowid_t rowid);
+int tab_update_row(pager_t* pager, table_t* table, schema_t* schema, rowid_t rowid, void* row);
 
-int tab_update_element(table_t* table, chblix_t* rowix, field_t* field, void* element);
-int tab_get_element(int64_t tablix, chblix_t* rowix, field_t* field, void* element);
+int tab_update_element(pager_t* pager, table_t* table, rowid_t rowid, field_t* field, void* element);
+int tab_cursor_open(pager_t* pager, tab_cursor_t* cursor, table_t* table);
+int tab_cursor_open_write(pager_t* pager, tab_cursor_t* cursor, table_t* table);
+int64_t tab_cursor_next_batch(pager_t* pager, tab_cursor_t* cursor, rowid_t* rowids, void* rows, int64_t count);
+int tab_cursor_delete(pager_t* pager, tab_cursor_t* cursor, rowid_t rowid);
+void tab_cursor_close(pager_t* pager, tab_cursor_t* cursor);
+int tab_get_element(pager_t* pager, table_t* table, rowid_t rowid, field_t* field, void* element);
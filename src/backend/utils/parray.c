@@ -5,18 +5,19 @@
 #include <sys/types.h>
 /**
  * @brief       Initializes PArray
+ * @param[in]   pager: handle of database
  * @param[in]   block_size: size of block
  * @param[in]   inval: invalid value used when deleting blocks
  * @return      page_index or PA_FAIL
  */
 
-int64_t pa_init(int64_t block_size){
-    int64_t page_index = lp_init_m(sizeof(parray_t));
+int64_t pa_init(pager_t* pager, int64_t block_size){
+    int64_t page_index = lp_init_m(pager, sizeof(parray_t));
     if(page_index == LP_FAIL){
         logger(LL_ERROR, __func__, "Unable to allocate page");
         return PA_FAIL;
     }
-    parray_t *pa = (parray_t *) lp_load(page_index);
+    parray_t *pa = (parray_t *) lp_load(pager, page_index);
     if(!pa){
         logger(LL_ERROR, __func__, "Unable to allocate page");
         return PA_FAIL;
@@ -29,12 +30,13 @@ int64_t pa_init(int64_t block_size){
 
 /**
  * @brief       Loads PArray
+ * @param[in]   pager: handle of database
  * @param[in]   page_index: page index of parray
  * @return      pointer to parray_t on success, `NULL` otherwise
  */
 
-parray_t* pa_load(int64_t page_index){
-    parray_t *pa = (parray_t *) lp_load(page_index);
+parray_t* pa_load(pager_t* pager, int64_t page_index){
+    parray_t *pa = (parray_t *) lp_load(pager, page_index);
     if(!pa){
         logger(LL_ERROR, __func__, "Unable to load page");
         return NULL;
@@ -44,13 +46,14 @@ parray_t* pa_load(int64_t page_index){
 
 /**
  * @brif        Destroys PArray
+ * @param[in]   pager: handle of database
  * @param[in]   page_index: page index of PArray
  * @return      PA_SUCCESS on success, PA_FAIL otherwise
  */
 
-int pa_destroy(int64_t page_index) {
+int pa_destroy(pager_t* pager, int64_t page_index) {
     logger(LL_INFO, __func__, "Destroying PArray");
-    if (lp_delete(page_index) == LP_FAIL) {
+    if (lp_delete(pager, page_index) == LP_FAIL) {
         logger(LL_ERROR, __func__, "Unable to deallocate page");
         return PA_FAIL;
     }
@@ -60,6 +63,7 @@ int pa_destroy(int64_t page_index) {
 
 /**
  * @brief       Write to parray
+ * @param[in]   pager: handle of database
  * @param[in]   pa: pointer to parray
  * @param[in]   block_idx: block index to write to
  * @param[in]   src: source
@@ -68,7 +72,7 @@ int pa_destroy(int64_t page_index) {
  * @return      PA_SUCCESS on success, PA_FAIL otherwise
  */
 
-int pa_write(parray_t *pa, int64_t block_idx, void *src, int64_t size, int64_t src_offset){
+int pa_write(pager_t* pager, parray_t *pa, int64_t block_idx, void *src, int64_t size, int64_t src_offset){
     if(!pa){
         logger(LL_ERROR, __func__, "Unable to load page");
         return PA_FAIL;
@@ -78,7 +82,7 @@ int pa_write(parray_t *pa, int64_t block_idx, void *src, int64_t size, int64_t s
         return PA_FAIL;
     }
     off_t offset = (off_t)(block_idx * pa->block_size + src_offset);
-    if(lp_write(pa->page_idx, src, size, offset) == LP_FAIL){
+    if(lp_write(pager, pa->page_idx, src, size, offset) == LP_FAIL){
         logger(LL_ERROR, __func__, "Unable to write to PArray");
         return PA_FAIL;
     }
@@ -88,6 +92,7 @@ int pa_write(parray_t *pa, int64_t block_idx, void *src, int64_t size, int64_t s
 
 /**
  * @brief       Read from PArray
+ * @param[in]   pager: handle of database
  * @param[in]   parray: parray to read from
  * @param[in]   block_idx: block index to read from
  * @param[out]  dest: destination
@@ -97,7 +102,7 @@ int pa_write(parray_t *pa, int64_t block_idx, void *src, int64_t size, int64_t s
  */
 
 
-int pa_read(parray_t *parray, int64_t block_idx, void *dest, int64_t size, int64_t src_offset) {
+int pa_read(pager_t* pager, parray_t *parray, int64_t block_idx, void *dest, int64_t size, int64_t src_offset) {
 
     if (!parray) {
         logger(LL_ERROR, __func__, "Parray is NULL");
@@ -116,7 +121,7 @@ int pa_read(parray_t *parray, int64_t block_idx, void *dest, int64_t size, int64
         return PA_FAIL;
     }
     off_t offset = (off_t)(block_idx * parray->block_size + src_offset);
-    if (lp_read_copy(parray->page_idx, dest, size, offset) == LP_FAIL) {
+    if (lp_read_copy(pager, parray->page_idx, dest, size, offset) == LP_FAIL) {
         logger(LL_ERROR, __func__, "Unable to read from PArray");
         return PA_FAIL;
     }
@@ -125,6 +130,7 @@ int pa_read(parray_t *parray, int64_t block_idx, void *dest, int64_t size, int64
 
 /**
  * @brief           Read several blocks at once
+ * @param[in]       pager: handle of database
  * @param[in]       paidx: page index of PArray
  * @param[in]       stblidx: start block index
  * @param[out]      dest: destination
@@ -133,15 +139,15 @@ int pa_read(parray_t *parray, int64_t block_idx, void *dest, int64_t size, int64
  * @return          PA_SUCCESS or PA_FAIL
  */
 
-int pa_read_blocks(int64_t paidx, int64_t stblidx, void *dest, int64_t size, int64_t src_offset){
+int pa_read_blocks(pager_t* pager, int64_t paidx, int64_t stblidx, void *dest, int64_t size, int64_t src_offset){
     logger(LL_INFO, __func__, "Reading blocks %ld bytes from PArray", size);
-    parray_t *pa = (parray_t *) lp_load(paidx);
+    parray_t *pa = (parray_t *) lp_read(pager, paidx);
     if (!pa) {
         logger(LL_ERROR, __func__, "Unable to load page");
         return PA_FAIL;
     }
     off_t offset = (off_t)(stblidx * pa->block_size + src_offset);
-    if (lp_read_copy(pa->page_idx, dest, size, offset) == LP_FAIL) {
+    if (lp_read_copy(pager, pa->page_idx, dest, size, offset) == LP_FAIL) {
         logger(LL_ERROR, __func__, "Unable to read from PArray");
         return PA_FAIL;
     }
@@ -150,20 +156,21 @@ int pa_read_blocks(int64_t paidx, int64_t stblidx, void *dest, int64_t size, int
 
 /**
  * @brif        Append data to PArray
+ * @param[in]   pager: handle of database
  * @param[in]   paidx: page index of PArray
  * @param[in]   src: source
  * @param[in]   size: size to append
  * @return      PA_SUCCESS on success, PA_FAIL otherwise
  */
 
-int pa_append(int64_t paidx, void *src, int64_t size) {
-    parray_t *pa = (parray_t *) lp_load(paidx);
+int pa_append(pager_t* pager, int64_t paidx, void *src, int64_t size) {
+    parray_t *pa = (parray_t *) lp_load(pager, paidx);
 
     if (!pa) {
         logger(LL_ERROR, __func__, "Unable to load page");
         return PA_FAIL;
     }
-    if(pa_write(pa, pa->size, src, size, 0) == PA_FAIL){
+    if(pa_write(pager, pa, pa->size, src, size, 0) == PA_FAIL){
         logger(LL_ERROR, __func__, "Unable to append to parray %ld, pa.size = %ld", paidx
                , pa->size);
         return PA_FAIL;
@@ -175,15 +182,16 @@ int pa_append(int64_t paidx, void *src, int64_t size) {
 
 /**
  * @brief       Pop data from PArray
+ * @param[in]   pager: handle of database
  * @param[in]   pa_index: page index of PArray
  * @param[out]  dest: destination
  * @param[in]   size: size to pop
  * @return      PA_SUCCESS on success, PA_EMPTY if PArray is empty, PA_FAIL otherwise
  */
 
-int pa_pop(int64_t pa_index, void *dest, int64_t size) {
-    parray_t *pa = (parray_t *) lp_load(pa_index);
-    int res = pa_read(pa, pa->size - 1, dest, size, 0);
+int pa_pop(pager_t* pager, int64_t pa_index, void *dest, int64_t size) {
+    parray_t *pa = (parray_t *) lp_load(pager, pa_index);
+    int res = pa_read(pager, pa, pa->size - 1, dest, size, 0);
     if(res == PA_SUCCESS){
         pa->size--;
     }
@@ -193,12 +201,13 @@ int pa_pop(int64_t pa_index, void *dest, int64_t size) {
 
 /**
  * @brief       Get size of PArray
+ * @param[in]   pager: handle of database
  * @param[in]   page_index
  * @return      size of PArray
  */
 
-int64_t pa_size(int64_t page_index) {
-    parray_t *pa = (parray_t *) lp_load(page_index);
+int64_t pa_size(pager_t* pager, int64_t page_index) {
+    parray_t *pa = (parray_t *) lp_read(pager, page_index);
     if (!pa) {
         logger(LL_ERROR, __func__, "Unable to load page");
         return PA_FAIL;
@@ -208,12 +217,13 @@ int64_t pa_size(int64_t page_index) {
 
 /**
  * Get block size of PArray
+ * @param pager: handle of database
  * @param page_index
  * @return  block size of PArray
  */
 
-int64_t pa_block_size(int64_t page_index) {
-    parray_t *pa = (parray_t *) lp_load(page_index);
+int64_t pa_block_size(pager_t* pager, int64_t page_index) {
+    parray_t *pa = (parray_t *) lp_read(pager, page_index);
     if (!pa) {
         logger(LL_ERROR, __func__, "Unable to load page");
         return PA_FAIL;
@@ -223,14 +233,15 @@ int64_t pa_block_size(int64_t page_index) {
 
 /**
  * Get data from PArray
+ * @param pager: handle of database
  * @param page_index
  * @param block_idx
  * @param dest
  * @return  PA_SUCCESS or PA_FAIL
  */
 
-int pa_at(int64_t page_index, int64_t block_idx, void *dest){
-    parray_t *pa = (parray_t *) lp_load(page_index);
+int pa_at(pager_t* pager, int64_t page_index, int64_t block_idx, void *dest){
+    parray_t *pa = (parray_t *) lp_read(pager, page_index);
     if (!pa) {
         logger(LL_ERROR, __func__, "Unable to load page");
         return PA_FAIL;
@@ -240,7 +251,7 @@ int pa_at(int64_t page_index, int64_t block_idx, void *dest){
         return PA_FAIL;
     }
     off_t offset = (off_t)(block_idx * pa->block_size);
-    if (lp_read_copy(pa->page_idx, dest, pa->block_size, offset) == LP_FAIL) {
+    if (lp_read_copy(pager, pa->page_idx, dest, pa->block_size, offset) == LP_FAIL) {
         logger(LL_ERROR, __func__, "Unable to read from PArray");
         return PA_FAIL;
     }
@@ -5,17 +5,18 @@
 
 /**
  * @brief       Initializes parray64
+ * @param[in]   pager: handle of database
  * @param[in]   block_size: size of block
  * @param[in]   inval: invalid value used when deleting blocks
  * @return      page_index or PA_FAIL
  */
 
-int64_t pa_init64(int64_t block_size, int64_t inval){
-    int64_t pa = pa_init(block_size);
+int64_t pa_init64(pager_t* pager, int64_t block_size, int64_t inval){
+    int64_t pa = pa_init(pager, block_size);
     if(pa == PA_FAIL){
         return PA_FAIL;
     }
-    parray64_t* parray64 = (parray64_t*)pa_load(pa);
+    parray64_t* parray64 = (parray64_t*)pa_load(pager, pa);
     parray64->inval = inval;
     parray64->parray.lp.mem_start = sizeof(parray64_t);
     return pa;
@@ -24,37 +25,40 @@ int64_t pa_init64(int64_t block_size, int64_t inval){
 
 /**
  * @brief       Write to parray64
+ * @param[in]   pager: handle of database
  * @param[in]   parray: parray64 to write to
  * @param[in]   block_idx: block index to write to
  * @param[in]   value: value to write
  * @return      PA_SUCCESS on success, PA_FAIL otherwise
  */
 
-int pa_write64(parray64_t* parray, int64_t block_idx, int64_t value){
-    return pa_write((parray_t*)parray, block_idx, &value, sizeof(int64_t), 0);
+int pa_write64(pager_t* pager, parray64_t* parray, int64_t block_idx, int64_t value){
+    return pa_write(pager, (parray_t*)parray, block_idx, &value, sizeof(int64_t), 0);
 }
 
 /**
  * @brief       Read from parray64
+ * @param[in]   pager: handle of database
  * @param[in]   parray64: parray64 to read from
  * @param[in]   block_idx: block index to read from
  * @param[in]   dest: destination
  * @return      PA_SUCCESS on success, PA_FAIL otherwise
  */
 
-int pa_read64(parray64_t* parray64, int64_t block_idx, int64_t* dest){
-    return pa_read((parray_t*)parray64, block_idx, dest, sizeof(int64_t), 0);
+int pa_read64(pager_t* pager, parray64_t* parray64, int64_t block_idx, int64_t* dest){
+    return pa_read(pager, (parray_t*)parray64, block_idx, dest, sizeof(int64_t), 0);
 }
 
 /**
  * @brief       Delete data from parray64
+ * @param[in]   pager: handle of database
  * @param[in]   page_index: page index of PArray
  * @param[in]   block_idx: block index to delete
  * @return      PA_SUCCESS on success, PA_FAIL otherwise
  */
 
-int pa_delete64(int64_t page_index, int64_t block_idx){
-    parray64_t *pa = (parray64_t *) lp_load(page_index);
+int pa_delete64(pager_t* pager, int64_t page_index, int64_t block_idx){
+    parray64_t *pa = (parray64_t *) lp_load(pager, page_index);
 
     if (!pa) {
         logger(LL_ERROR, __func__, "Unable to load page");
@@ -66,7 +70,7 @@ int pa_delete64(int64_t page_index, int64_t block_idx){
         return PA_FAIL;
     }
 
-    if (pa_write64(pa, block_idx, pa->inval) == PA_FAIL){
+    if (pa_write64(pager, pa, block_idx, pa->inval) == PA_FAIL){
         logger(LL_ERROR, __func__, "Unable to delete from PArray");
         return PA_FAIL;
     }
@@ -76,25 +80,27 @@ int pa_delete64(int64_t page_index, int64_t block_idx){
 
 /**
  * @brief       Append value to parray64
+ * @param[in]   pager: handle of database
  * @param[in]   paidx: page index of PArray
  * @return      page_index or PA_FAIL
  */
 
-int pa_append64(int64_t paidx, int64_t value){
-    return pa_append(paidx, &value, sizeof(int64_t));
+int pa_append64(pager_t* pager, int64_t paidx, int64_t value){
+    return pa_append(pager, paidx, &value, sizeof(int64_t));
 }
 
 /**
  * @brief       Pop value from parray64
+ * @param[in]   pager: handle of database
  * @param[in]   paidx: page index of PArray
  * @param[out]  dest: destination
  * @return      PA_SUCCESS on success, PA_EMPY if parray64 empty, PA_FAIL otherwise
  */
 
-int pa_pop64(int64_t paidx, int64_t* dest){
-    parray64_t pa = *(parray64_t *) lp_load(paidx);
+int pa_pop64(pager_t* pager, int64_t paidx, int64_t* dest){
+    parray64_t pa = *(parray64_t *) lp_read(pager, paidx);
     do {
-        int res = pa_pop(paidx, dest, sizeof(int64_t));
+        int res = pa_pop(pager, paidx, dest, sizeof(int64_t));
         if (res == PA_FAIL) {
             logger(LL_ERROR, __func__, "Unable to pop from PArray");
             return PA_FAIL;
@@ -103,7 +109,7 @@ int pa_pop64(int64_t paidx, int64_t* dest){
             return PA_EMPTY;
         }
         if (*dest == pa.inval) {
-            pa_delete64(paidx, pa.parray.size - 1);
+            pa_delete64(pager, paidx, pa.parray.size - 1);
         }
     } while (*dest == pa.inval);
     return PA_SUCCESS;
@@ -111,13 +117,14 @@ int pa_pop64(int64_t paidx, int64_t* dest){
 
 /**
  * @brief           Returns block index of first occurence of value in PArray
+ * @param[in]       pager: handle of database
  * @param[in]       paidx: page index of parray64
  * @param[in]       value: value to find
  * @return          block index of first occurence of value in PArray or PA_FAIL
  */
 
-int64_t pa_find_first_int64(int64_t paidx, int64_t value){
-    int64_t size = pa_size(paidx);
+int64_t pa_find_first_int64(pager_t* pager, int64_t paidx, int64_t value){
+    int64_t size = pa_size(pager, paidx);
 
     /* If PArray is empty */
     if(size == 0){
@@ -130,11 +137,11 @@ int64_t pa_find_first_int64(int64_t paidx, int64_t value){
     }
 
     /* Load PArray */
-    parray64_t *pa = (parray64_t *) lp_load(paidx);
+    parray64_t *pa = (parray64_t *) lp_read(pager, paidx);
 
     /* Reading all blocks */
     int64_t blocks[(size_t) size];
-    if(pa_read_blocks(paidx, 0, &blocks, size * pa->parray.block_size, 0) == PA_FAIL){
+    if(pa_read_blocks(pager, paidx, 0, &blocks, size * pa->parray.block_size, 0) == PA_FAIL){
         logger(LL_ERROR, __func__, "Unable to read PArray");
         return PA_FAIL;
     }
@@ -150,13 +157,14 @@ int64_t pa_find_first_int64(int64_t paidx, int64_t value){
 
 /**
  * @brief           Check if value exists in parray64
+ * @param[in]       pager: handle of database
  * @param[in]       paidx: page index of parray64
  * @param[in]       value: value to find
  * @return          true if value exists, false if not, PA_FAIL on error
  */
 
-int pa_exists64(int64_t paidx, int64_t value){
-    int64_t size = pa_size(paidx);
+int pa_exists64(pager_t* pager, int64_t paidx, int64_t value){
+    int64_t size = pa_size(pager, paidx);
 
     /* If PArray is empty */
     if(size == 0){
@@ -169,11 +177,11 @@ int pa_exists64(int64_t paidx, int64_t value){
     }
 
     /* Load PArray */
-    parray64_t *pa = (parray64_t *) lp_load(paidx);
+    parray64_t *pa = (parray64_t *) lp_read(pager, paidx);
 
     /* Reading all blocks */
     int64_t blocks[(size_t) size];
-    if(pa_read_blocks(paidx, 0, &blocks, size * pa->parray.block_size, 0) == PA_FAIL){
+    if(pa_read_blocks(pager, paidx, 0, &blocks, size * pa->parray.block_size, 0) == PA_FAIL){
         logger(LL_ERROR, __func__, "Unable to read PArray");
         return PA_FAIL;
     }
@@ -189,19 +197,20 @@ int pa_exists64(int64_t paidx, int64_t value){
 
 /**
  * @brief       Push unique int64_t to parray64
+ * @param[in]   pager: handle of database
  * @param[in]   paidx: page index of PArray
  * @param[in]   value: value to push
  * @return      PA_SUCCESS or PA_FAIL
  */
 
-int pa_push_unique64(int64_t paidx, int64_t value){
-    int res = pa_exists64(paidx, value);
+int pa_push_unique64(pager_t* pager, int64_t paidx, int64_t value){
+    int res = pa_exists64(pager, paidx, value);
     if(res == PA_FAIL){
         logger(LL_ERROR, __func__, "Unable to check if value exists");
         return PA_FAIL;
     }
     else if(res == false) {
-        if(pa_append64(paidx, value) != PA_SUCCESS){
+        if(pa_append64(pager, paidx, value) != PA_SUCCESS){
             logger(LL_ERROR, __func__, "Unable to append value");
             return PA_FAIL;
         }
@@ -211,18 +220,19 @@ int pa_push_unique64(int64_t paidx, int64_t value){
 
 /**
  * @brief           Deletes first occurences of value in PArray
+ * @param[in]       pager: handle of database
  * @param[in]       paidx: page index of PArray
  * @param[in]       value: value to delete
  * @return          PA_SUCCESS on success or not found, PA_FAIL otherwise
  */
 
-int pa_delete_unique64(int64_t paidx, int64_t value){
-    int64_t block_index = pa_find_first_int64(paidx, value);
+int pa_delete_unique64(pager_t* pager, int64_t paidx, int64_t value){
+    int64_t block_index = pa_find_first_int64(pager, paidx, value);
     if(block_index == PA_FAIL){
         logger(LL_INFO, __func__, "Value %ld not found in PArray %ld", value, paidx);
         return PA_SUCCESS;
     }
-    if(pa_delete64(paidx, block_index) != PA_SUCCESS){
+    if(pa_delete64(pager, paidx, block_index) != PA_SUCCESS){
         logger(LL_ERROR, __func__, "Unable to delete value");
         return PA_FAIL;
     }
@@ -1,13 +1,21 @@
 #include "caching.h"
+#include "flusher.h"
 #include "utils/logger.h"
 #include "utils/roundup.h"
 #include <inttypes.h>
-#include <math.h>
-#include <time.h>
 
 #define CH_SIZE_UPPER_LIMIT SIZE_MAX
 
-// flag = 1 - occupied flag = 2 - removed_from_cache flag = 3 - deleted flag = 0 - unknown
+/* Entry id used by ch_for_each_cached: shard in high bits, entry of shard in low bits */
+#define CH_ENTRY_BITS 40
+#define CH_ENTRY_MASK ((UINT64_C(1) << CH_ENTRY_BITS) - 1)
+
+static int ch_load(caching_t* ch, ch_shard_t* sh, int64_t page_index, int64_t* entry, bool write, bool locked);
+static int ch_wal_commit(caching_t* ch, bool checkpoint);
+
+// flag = 1 - occupied flag = 2 - removed_from_cache flag = 3 - deleted flag = 4 - spilled flag = 0 - unknown
+// Pages with flag 0 have no entry in page table, flag 2 is kept only for pages remembered by 2Q ghost queue.
+// Page with flag 4 was evicted before commit, its only image is in write-ahead log.
 
 /**
  * @brief   Get current file size
@@ -51,321 +59,1892 @@ off_t ch_page_offset(uint64_t page_index){
 }
 
 
+static void ch_list_reset(ch_list_t* list){
+    list->head = list->tail = -1;
+    list->size = 0;
+}
+
+static void ch_shard_reset(ch_shard_t* sh){
+    sh->size = sh->used = sh->max_used = sh->capacity = 0;
+    sh->top = 0;
+    sh->free_entry = -1;
+    sh->entries = NULL;
+    sh->table = NULL;
+    sh->table_mask = 0;
+    sh->clock = 0;
+    ch_list_reset(&sh->a1in);
+    ch_list_reset(&sh->a1out);
+    ch_list_reset(&sh->am);
+    sh->wb_pages = NULL;
+    sh->wb_count = sh->wb_capacity = 0;
+}
+
+static void ch_table_reset(caching_t* ch){
+    for(size_t i = 0; i < CH_SHARDS; ++i){
+        ch_shard_reset(&ch->shards[i]);
+    }
+    for(size_t i = 0; i < CH_RA_STREAMS; ++i){
+        ch->ra[i] = (ch_ra_stream_t){.last = -1, .ahead = -1, .window = CH_RA_MIN, .used = 0};
+    }
+    ch->ra_clock = 0;
+    atomic_store(&ch->dirty, 0);
+    atomic_store(&ch->dirty_clock, 0);
+    atomic_store(&ch->flush_clock, 0);
+    atomic_store(&ch->flush_pending, false);
+    ch->flusher = NULL;
+    ch->flush_pages = NULL;
+    ch->flush_count = 0;
+    ch->punch_pages = NULL;
+    ch->punch_count = ch->punch_capacity = 0;
+}
+
 /**
- * @brief       Cacher initialization
+ * @brief       Parse size with optional K, M or G suffix
+ * @param[in]   str: string to parse
+ * @return      size in bytes or 0 if string is invalid
+ */
+
+static size_t ch_parse_size(const char* str){
+    char* end = NULL;
+    unsigned long long value = strtoull(str, &end, 10);
+    if(end == str){
+        return 0;
+    }
+    switch (*end) {
+        case 'k': case 'K': value *= KB; break;
+        case 'm': case 'M': value *= MB; break;
+        case 'g': case 'G': value *= GB; break;
+        case '\0': break;
+        default: return 0;
+    }
+    return (size_t)value;
+}
+
+/**
+ * @brief       Cacher initialization with default options
  * @param[in]   file_name: file name
  * @param[out]  ch: pointer to caching_t
  * @return      CH_SUCCESS on success, CH_FAIL on failure
  */
- 
+
 int ch_init(const char* file_name, caching_t* ch){
+    return ch_init_opt(file_name, ch, NULL);
+}
+
+/**
+ * @brief       Cacher initialization
+ * @details     Budget is taken from opt, then from CH_BUDGET_ENV environment variable,
+ *              then CH_MAX_MEMORY_USAGE is used. Number of shards is chosen by initial budget.
+ * @param[in]   file_name: file name
+ * @param[out]  ch: pointer to caching_t
+ * @param[in]   opt: cacher options or NULL for defaults
+ * @return      CH_SUCCESS on success, CH_FAIL on failure
+ */
+
+int ch_init_opt(const char* file_name, caching_t* ch, const ch_options_t* opt){
     logger(LL_DEBUG, __func__ , "Caching initialization.");
-    if(init_file(file_name, &ch->file) == FILE_FAIL){
+    /* log left by crash is replayed even if it isn't used anymore */
+    if(wal_recover(file_name) == WAL_FAIL){
+        logger(LL_ERROR, __func__ , "Unable to recover file.");
+        return CH_FAIL;
+    }
+    fl_options_t file_opt = opt ? opt->file : (fl_options_t){0};
+    if(opt && opt->wal){
+        /* kernel may write mapped page any time, frame is written only by cacher */
+        file_opt.backend = FL_BACKEND_PREAD;
+    }
+    if(init_file_opt(file_name, &ch->file, &file_opt) == FILE_FAIL){
         logger(LL_ERROR, __func__ , "Unable to init file.");
         return CH_FAIL;
     }
-    ch->size = ch->used = ch->max_used = ch->capacity = 0;
-    ch->usage_count = NULL;
-    ch->last_used = NULL;
-    ch->cached_page_ptr = NULL;
-    ch->flags = NULL;
-    return CH_SUCCESS;
+    ch_table_reset(ch);
+    ch->policy = opt && opt->policy != CH_POLICY_DEFAULT ? opt->policy : CH_DEFAULT_POLICY;
+    ch->low_watermark_pct = opt && opt->low_watermark && opt->low_watermark < 100 ? opt->low_watermark : CH_LOW_WATERMARK;
+    size_t budget = opt ? opt->budget : 0;
+    const char* env = getenv(CH_BUDGET_ENV);
+    if(!budget && env){
+        budget = ch_parse_size(env);
+        if(!budget){
+            logger(LL_WARN, __func__, "Invalid %s value: %s", CH_BUDGET_ENV, env);
+        }
+    }
+    budget = budget ? budget : CH_MAX_MEMORY_USAGE;
+    ch->shard_count = 1;
+    while(ch->shard_count < CH_SHARDS && budget / PAGE_SIZE / (ch->shard_count * 2) >= CH_SHARD_MIN_PAGES){
+        ch->shard_count *= 2;
+    }
+    lk_mutex_init(&ch->lock);
+    lk_mutex_init(&ch->io_lock);
+    for(size_t i = 0; i < ch->shard_count; ++i){
+        lk_mutex_init(&ch->shards[i].lock);
+    }
+    ch_set_budget(ch, budget);
+    ch->syncer = syn_init(&ch->file, opt ? &opt->sync : NULL);
+    if(!ch->syncer){
+        logger(LL_ERROR, __func__, "Unable to init syncer.");
+        close_file(&ch->file);
+        return CH_FAIL;
+    }
+    ch->punch_holes = opt && opt->punch_holes;
+    ch->wal = NULL;
+    if(opt && opt->wal && !(ch->wal = wal_open(file_name, &opt->sync, ch_number_pages(ch)))){
+        logger(LL_ERROR, __func__, "Unable to open log.");
+        syn_destroy(ch->syncer);
+        close_file(&ch->file);
+        return CH_FAIL;
+    }
+    return CH_SUCCESS;
+}
+
+/**
+ * @brief       Shard of page
+ * @details     Shard is taken from high bits of hash, page table slot is taken from low bits.
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   page_index: index of page
+ * @return      pointer to shard
+ */
+
+static inline ch_shard_t* ch_shard(caching_t* ch, int64_t page_index){
+    uint64_t h = (uint64_t)page_index * 0x9E3779B97F4A7C15ull;
+    return &ch->shards[(h >> 58) & (ch->shard_count - 1)];
+}
+
+/**
+ * @brief       Hash of page index
+ * @param[in]   sh: pointer to shard
+ * @param[in]   page_index: index of page
+ * @return      slot in page table
+ */
+
+static inline size_t ch_hash(ch_shard_t* sh, int64_t page_index){
+    uint64_t h = (uint64_t)page_index * 0x9E3779B97F4A7C15ull;
+    return (size_t)(h ^ (h >> 32)) & sh->table_mask;
+}
+
+/**
+ * @brief       Find entry of page
+ * @param[in]   sh: pointer to shard
+ * @param[in]   page_index: index of page
+ * @return      entry index or -1 if page is not tracked
+ */
+
+static int64_t ch_lookup(ch_shard_t* sh, int64_t page_index){
+    if(!sh->table){
+        return -1;
+    }
+    for(size_t slot = ch_hash(sh, page_index); sh->table[slot] != -1; slot = (slot + 1) & sh->table_mask){
+        if(sh->entries[sh->table[slot]].page_index == page_index){
+            return sh->table[slot];
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief       Find entry of page
+ * @details     Shard isn't locked, it is meant for callers which have exclusive access to cache.
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   page_index: index of page
+ * @return      pointer to entry or NULL if page is not tracked
+ * @warning     pointer is valid until next entry is created
+ */
+
+ch_entry_t* ch_find_entry(caching_t* ch, int64_t page_index){
+    ch_shard_t* sh = ch_shard(ch, page_index);
+    int64_t entry = ch_lookup(sh, page_index);
+    return entry == -1 ? NULL : &sh->entries[entry];
+}
+
+static void ch_table_insert(ch_shard_t* sh, int64_t entry){
+    size_t slot = ch_hash(sh, sh->entries[entry].page_index);
+    while(sh->table[slot] != -1){
+        slot = (slot + 1) & sh->table_mask;
+    }
+    sh->table[slot] = entry;
+}
+
+/**
+ * @brief       Reserve new capacity for shard.
+ * @details     Capacity is number of tracked pages (cached, remembered or deleted),
+ *              page table is rebuilt when it becomes 3/4 full.
+ * @param[in]   sh: pointer to shard
+ * @param[in]   new_capacity: new capacity
+ * @return      CH_SUCCESS on success, CH_FAIL otherwise
+ */
+
+static int ch_shard_reserve(ch_shard_t* sh, size_t new_capacity){
+    if(new_capacity > sh->capacity){
+        size_t ch_new_capacity = new_capacity;
+        roundupsize(ch_new_capacity);
+        if(ch_new_capacity < new_capacity){
+            logger(LL_ERROR, __func__, "Integer overflow while reserving new cacher capacity: %ld.", new_capacity);
+            return CH_FAIL;
+        }
+        logger(LL_DEBUG, __func__, "Reserving new cacher capacity: %ld -> %ld.", sh->capacity, ch_new_capacity);
+        ch_entry_t* ch_new_entries = realloc(sh->entries, ch_new_capacity * sizeof(ch_entry_t));
+        if(!ch_new_entries){
+            logger(LL_ERROR, __func__, "Unable allocate new entries for cacher.");
+            return CH_FAIL;
+        }
+        sh->entries = ch_new_entries;
+        sh->capacity = ch_new_capacity;
+    }
+    if(new_capacity <= sh->max_used){
+        return CH_SUCCESS;
+    }
+    size_t ch_new_table_capacity = sh->table_mask ? (sh->table_mask + 1) << 1 : 4;
+    while(ch_new_table_capacity - (ch_new_table_capacity >> 2) < new_capacity){
+        ch_new_table_capacity <<= 1;
+    }
+    int64_t* ch_new_table = malloc(ch_new_table_capacity * sizeof(int64_t));
+    if(!ch_new_table){
+        logger(LL_ERROR, __func__, "Unable allocate new page table for cacher.");
+        return CH_FAIL;
+    }
+    memset(ch_new_table, -1, ch_new_table_capacity * sizeof(int64_t));
+    free(sh->table);
+    sh->table = ch_new_table;
+    sh->table_mask = ch_new_table_capacity - 1;
+    sh->max_used = (ch_new_table_capacity >> 1) + (ch_new_table_capacity >> 2); /*3/4 of the table*/
+    for(size_t entry = 0; entry < sh->top; entry++){
+        if(sh->entries[entry].flag){
+            ch_table_insert(sh, (int64_t)entry);
+        }
+    }
+    logger(LL_DEBUG, __func__, "Reserved new cacher capacity: %ld.", sh->capacity);
+    return CH_SUCCESS;
+}
+
+/**
+ * @brief       Reserve new capacity for cacher, it is split between shards
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   new_capacity: new capacity
+ * @return      CH_SUCCESS on success, CH_FAIL otherwise
+ */
+
+int ch_reserve(caching_t* ch, size_t new_capacity){
+    size_t per_shard = (new_capacity + ch->shard_count - 1) / ch->shard_count;
+    int res = CH_SUCCESS;
+    for(size_t i = 0; i < ch->shard_count && res == CH_SUCCESS; ++i){
+        lk_lock(&ch->shards[i].lock);
+        res = ch_shard_reserve(&ch->shards[i], per_shard);
+        lk_unlock(&ch->shards[i].lock);
+    }
+    return res;
+}
+
+/**
+ * @brief       Create entry for page
+ * @param[in]   sh: pointer to shard
+ * @param[in]   page_index: index of page
+ * @param[in]   flag: initial flag
+ * @return      entry index or CH_FAIL
+ */
+
+static int64_t ch_entry_create(ch_shard_t* sh, int64_t page_index, char flag){
+    if(ch_shard_reserve(sh, sh->used + 1) == CH_FAIL){
+        return CH_FAIL;
+    }
+    int64_t entry;
+    if(sh->free_entry != -1){
+        entry = sh->free_entry;
+        sh->free_entry = sh->entries[entry].next;
+    }
+    else{
+        entry = (int64_t)sh->top++;
+    }
+    ch_entry_t* e = &sh->entries[entry];
+    e->page_index = page_index;
+    e->page = NULL;
+    e->prev = e->next = -1;
+    e->last_used = 0;
+    e->flag = flag;
+    e->queue = CH_Q_NONE;
+    e->referenced = 0;
+    e->pins = 0;
+    e->kept = 0;
+    e->dirty = e->flushing = 0;
+    e->dirtied = e->logged = 0;
+    e->spilled = 0;
+    sh->used++;
+    ch_table_insert(sh, entry);
+    return entry;
+}
+
+/**
+ * @brief       Forget page, entry goes to free list
+ * @details     Linear probing chain is repaired by backward shift, no tombstones are left.
+ * @param[in]   sh: pointer to shard
+ * @param[in]   entry: entry index
+ */
+
+static void ch_entry_release(ch_shard_t* sh, int64_t entry){
+    size_t slot = ch_hash(sh, sh->entries[entry].page_index);
+    while(sh->table[slot] != entry){
+        slot = (slot + 1) & sh->table_mask;
+    }
+    size_t hole = slot;
+    for(size_t next = (hole + 1) & sh->table_mask; sh->table[next] != -1; next = (next + 1) & sh->table_mask){
+        size_t home = ch_hash(sh, sh->entries[sh->table[next]].page_index);
+        if(((next - home) & sh->table_mask) >= ((next - hole) & sh->table_mask)){
+            sh->table[hole] = sh->table[next];
+            hole = next;
+        }
+    }
+    sh->table[hole] = -1;
+    sh->entries[entry].flag = 0;
+    sh->entries[entry].page_index = -1;
+    sh->entries[entry].next = sh->free_entry;
+    sh->free_entry = entry;
+    sh->used--;
+}
+
+size_t ch_size(caching_t* ch){
+    size_t size = 0;
+    for(size_t i = 0; i < ch->shard_count; ++i){
+        size += ch->shards[i].size;
+    }
+    return size;
+}
+size_t ch_used(caching_t* ch){
+    size_t used = 0;
+    for(size_t i = 0; i < ch->shard_count; ++i){
+        used += ch->shards[i].used;
+    }
+    return used;
+}
+size_t ch_capacity(caching_t* ch){
+    size_t capacity = 0;
+    for(size_t i = 0; i < ch->shard_count; ++i){
+        capacity += ch->shards[i].capacity;
+    }
+    return capacity;
+}
+void* ch_cached_page(caching_t* ch, size_t index) {
+    ch_shard_t* sh = ch_shard(ch, (int64_t)index);
+    lk_lock(&sh->lock);
+    int64_t entry = ch_lookup(sh, (int64_t)index);
+    void* page = entry == -1 ? NULL : sh->entries[entry].page;
+    lk_unlock(&sh->lock);
+    return page;
+}
+size_t ch_usage_memory_space(caching_t* ch){
+    return PAGE_SIZE * ch_size(ch);
+}
+int ch_page_status(caching_t* ch, size_t index) {
+    ch_shard_t* sh = ch_shard(ch, (int64_t)index);
+    lk_lock(&sh->lock);
+    int64_t entry = ch_lookup(sh, (int64_t)index);
+    int flag = entry == -1 ? 0 : sh->entries[entry].flag;
+    lk_unlock(&sh->lock);
+    return flag;
+}
+
+/* 2Q queue thresholds (Kin = 1/4, Kout = 1/2 of shard) */
+#define CH_2Q_KIN(sh)  ((sh)->high_watermark >> 2 ? (sh)->high_watermark >> 2 : 1)
+#define CH_2Q_KOUT(sh) ((sh)->high_watermark >> 1 ? (sh)->high_watermark >> 1 : 1)
+
+static ch_list_t* ch_list(ch_shard_t* sh, char queue){
+    switch (queue) {
+        case CH_Q_A1IN: return &sh->a1in;
+        case CH_Q_A1OUT: return &sh->a1out;
+        case CH_Q_AM: return &sh->am;
+        default: return NULL;
+    }
+}
+
+/**
+ * @brief       Insert entry at the head of queue
+ * @param[in]   sh: pointer to shard
+ * @param[in]   queue: target queue
+ * @param[in]   entry: entry index
+ */
+
+static void ch_list_push(ch_shard_t* sh, char queue, int64_t entry){
+    ch_list_t* list = ch_list(sh, queue);
+    sh->entries[entry].prev = -1;
+    sh->entries[entry].next = list->head;
+    if(list->head != -1){
+        sh->entries[list->head].prev = entry;
+    }
+    else{
+        list->tail = entry;
+    }
+    list->head = entry;
+    list->size++;
+    sh->entries[entry].queue = queue;
+}
+
+/**
+ * @brief       Unlink entry from the queue it belongs to
+ * @param[in]   sh: pointer to shard
+ * @param[in]   entry: entry index
+ */
+
+static void ch_list_unlink(ch_shard_t* sh, int64_t entry){
+    ch_entry_t* e = &sh->entries[entry];
+    ch_list_t* list = ch_list(sh, e->queue);
+    if(list == NULL){
+        return;
+    }
+    if(e->prev != -1) sh->entries[e->prev].next = e->next; else list->head = e->next;
+    if(e->next != -1) sh->entries[e->next].prev = e->prev; else list->tail = e->prev;
+    list->size--;
+    e->prev = e->next = -1;
+    e->queue = CH_Q_NONE;
+}
+
+/**
+ * @brief       Register page that just became resident
+ * @details     Page remembered in A1out goes straight to Am, any other page starts in A1in.
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   sh: pointer to shard
+ * @param[in]   entry: entry index
+ */
+
+static void ch_admit(caching_t* ch, ch_shard_t* sh, int64_t entry){
+    if(ch->policy != CH_POLICY_2Q){
+        return;
+    }
+    char queue = sh->entries[entry].queue == CH_Q_A1OUT ? CH_Q_AM : CH_Q_A1IN;
+    sh->entries[entry].referenced = 0;
+    ch_list_unlink(sh, entry);
+    ch_list_push(sh, queue, entry);
+}
+
+/**
+ * @brief       Account page reference
+ * @details     2Q only sets reference bit, Am order is fixed up lazily on eviction (second chance).
+ *              Legacy policy stamps page with logical access clock of shard.
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   sh: pointer to shard
+ * @param[in]   entry: entry index
+ */
+
+static inline void ch_touch(caching_t* ch, ch_shard_t* sh, int64_t entry){
+    if(ch->policy == CH_POLICY_2Q){
+        sh->entries[entry].referenced = 1;
+    }
+    else{
+        sh->entries[entry].last_used = ++sh->clock;
+    }
+}
+
+/**
+ * @brief       Check if page was modified after it was logged
+ * @details     With write-ahead log such page mustn't be written to file until it is committed.
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   e: pointer to entry
+ * @return      true if page isn't logged
+ */
+
+static inline bool ch_unlogged(caching_t* ch, const ch_entry_t* e){
+    return ch->wal && e->dirty && e->dirtied != e->logged;
+}
+
+/* Page can't be evicted */
+static inline bool ch_held(caching_t* ch, const ch_entry_t* e){
+    return e->pins || ch_unlogged(ch, e);
+}
+
+/**
+ * @brief       Pick A1in victim, the oldest page which isn't pinned or unlogged
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   sh: pointer to shard
+ * @return      entry index or -1 if there is no such page
+ */
+
+static int64_t ch_a1in_victim(caching_t* ch, ch_shard_t* sh){
+    int64_t victim = sh->a1in.tail;
+    while(victim != -1 && ch_held(ch, &sh->entries[victim])){
+        victim = sh->entries[victim].prev;
+    }
+    return victim;
+}
+
+/**
+ * @brief       Pick Am victim, referenced pages get a second chance at the head of Am
+ * @details     Pinned and unlogged pages are skipped, two passes over Am are enough to clear all reference bits.
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   sh: pointer to shard
+ * @return      entry index or -1 if there is no page to evict
+ */
+
+static int64_t ch_am_victim(caching_t* ch, ch_shard_t* sh){
+    int64_t victim = sh->am.tail;
+    for(size_t steps = 2 * sh->am.size; victim != -1 && steps; --steps){
+        ch_entry_t* e = &sh->entries[victim];
+        int64_t prev = e->prev;
+        bool held = ch_held(ch, e);
+        if(!held && !e->referenced){
+            return victim;
+        }
+        if(!held){
+            e->referenced = 0;
+            ch_list_unlink(sh, victim);
+            ch_list_push(sh, CH_Q_AM, victim);
+        }
+        victim = prev != -1 ? prev : sh->am.tail;
+    }
+    return -1;
+}
+
+static void ch_set_clean(caching_t* ch, ch_shard_t* sh, int64_t entry){
+    if(sh->entries[entry].dirty){
+        sh->entries[entry].dirty = 0;
+        atomic_fetch_sub_explicit(&ch->dirty, 1, memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief       Wait for batch in flight and clean its pages
+ * @details     Page stays dirty if it was modified after it was staged, if it is pinned
+ *              or if batch failed. Caller holds ch->lock.
+ * @param[in]   ch: pointer to caching_t
+ * @return      CH_SUCCESS on success, CH_FAIL if batch failed
+ */
+
+static int ch_flush_complete(caching_t* ch){
+    if(!ch->flush_pages){
+        return CH_SUCCESS;
+    }
+    bool ok = fls_wait(ch->flusher) == FLS_SUCCESS;
+    for(size_t i = 0; i < ch->flush_count; ++i){
+        ch_shard_t* sh = ch_shard(ch, ch->flush_pages[i].page_index);
+        lk_lock(&sh->lock);
+        int64_t entry = ch_lookup(sh, ch->flush_pages[i].page_index);
+        if(entry != -1){
+            ch_entry_t* e = &sh->entries[entry];
+            e->flushing = 0;
+            if(ok && e->flag == 1 && !e->pins && e->dirtied == ch->flush_pages[i].dirtied){
+                ch_set_clean(ch, sh, entry);
+            }
+        }
+        lk_unlock(&sh->lock);
+    }
+    free(ch->flush_pages);
+    ch->flush_pages = NULL;
+    ch->flush_count = 0;
+    atomic_store(&ch->flush_pending, false);
+    if(!ok){
+        logger(LL_ERROR, __func__, "Write-back batch failed, pages are left dirty");
+    }
+    return ok ? CH_SUCCESS : CH_FAIL;
+}
+
+static int64_t ch_write_back(caching_t* ch, bool wait);
+
+/**
+ * @brief       Mark entry as modified
+ * @details     Only counters are updated, write-back is started by ch_flush_check
+ *              after shard is unlocked.
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   sh: pointer to shard
+ * @param[in]   entry: entry index
+ */
+
+static void ch_set_dirty(caching_t* ch, ch_shard_t* sh, int64_t entry){
+    ch_entry_t* e = &sh->entries[entry];
+    if(!e->dirty){
+        e->dirty = 1;
+        atomic_fetch_add_explicit(&ch->dirty, 1, memory_order_relaxed);
+    }
+    e->dirtied = atomic_fetch_add_explicit(&ch->dirty_clock, 1, memory_order_relaxed) + 1;
+}
+
+/**
+ * @brief       Complete finished batch and start new one
+ * @details     Write-back batch is started when enough pages are dirty and enough
+ *              modifications were made since the last batch. Nothing is done if another
+ *              thread holds cacher lock, it will check again with the next modification.
+ * @param[in]   ch: pointer to caching_t
+ */
+
+static void ch_flush_check(caching_t* ch){
+    uint64_t clock = atomic_load_explicit(&ch->dirty_clock, memory_order_relaxed);
+    bool start = atomic_load_explicit(&ch->dirty, memory_order_relaxed) >= CH_FLUSH_BATCH &&
+                 clock - atomic_load_explicit(&ch->flush_clock, memory_order_relaxed) >= CH_FLUSH_BATCH;
+    if(!start && !atomic_load_explicit(&ch->flush_pending, memory_order_relaxed)){
+        return;
+    }
+    if(!lk_trylock(&ch->lock)){
+        return;
+    }
+    if(ch->flush_pages && !fls_busy(ch->flusher)){
+        ch_flush_complete(ch);
+    }
+    if(start){
+        ch_write_back(ch, false);
+    }
+    lk_unlock(&ch->lock);
+}
+
+/**
+ * @brief       Unmap cached page, entry is kept
+ * @details     Staged copy of page in flight is written before the page itself.
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   sh: pointer to shard
+ * @param[in]   entry: entry index
+ * @return      CH_SUCCESS on success, CH_FAIL otherwise
+ */
+
+static int ch_unmap_entry(caching_t* ch, ch_shard_t* sh, int64_t entry){
+    ch_entry_t* e = &sh->entries[entry];
+    if(e->flushing){
+        fls_wait(ch->flusher);
+        e->flushing = 0;
+    }
+    int res = FILE_SUCCESS;
+    bool release = !e->dirty || ch_unlogged(ch, e);
+    if(!release && ch->wal && wal_sync(ch->wal) == WAL_FAIL){
+        res = FILE_FAIL;
+    }
+    else if(!release && sh->wb_count < sh->wb_capacity){
+        sh->wb_pages[sh->wb_count++] = e->page;
+    }
+    else{
+        lk_lock(&ch->io_lock);
+        /* change which isn't logged is dropped, file keeps committed page */
+        res = release ? release_page(&e->page, &ch->file) : unmap_page(&e->page, &ch->file);
+        lk_unlock(&ch->io_lock);
+    }
+    if(res == FILE_FAIL){
+        logger(LL_ERROR, __func__, "Unable to unmap page %ld", e->page_index);
+        return CH_FAIL;
+    }
+    ch_set_clean(ch, sh, entry);
+    if (sh->size <= 0){
+        logger(LL_ERROR, __func__, "Integer overflow while updating size: %ld.", sh->size);
+        return CH_FAIL;
+    }
+    sh->size--;
+    e->flag = 2;
+    e->page = NULL;
+    ch_list_unlink(sh, entry);
+    return CH_SUCCESS;
+}
+
+/**
+ * @brief       Start collecting evicted pages for batched write-back
+ * @details     Only frames of pool backend are collected, mapped pages are unmapped one by one.
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   sh: pointer to shard
+ * @param[in]   count: maximal number of pages to collect
+ */
+
+static void ch_wb_begin(caching_t* ch, ch_shard_t* sh, size_t count){
+    if(!fl_pool_frames(&ch->file) || count < 2){
+        return;
+    }
+    sh->wb_pages = malloc(count * sizeof(void*));
+    sh->wb_capacity = sh->wb_pages ? count : 0;
+    sh->wb_count = 0;
+}
+
+/**
+ * @brief       Write back and unmap collected pages
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   sh: pointer to shard
+ */
+
+static void ch_wb_end(caching_t* ch, ch_shard_t* sh){
+    if(!sh->wb_pages){
+        return;
+    }
+    lk_lock(&ch->io_lock);
+    if(fl_unmap_pages(&ch->file, sh->wb_pages, sh->wb_count) == FILE_FAIL){
+        logger(LL_ERROR, __func__, "Unable to write back %zu pages", sh->wb_count);
+    }
+    lk_unlock(&ch->io_lock);
+    free(sh->wb_pages);
+    sh->wb_pages = NULL;
+    sh->wb_count = sh->wb_capacity = 0;
+}
+
+/**
+ * @brief       Evict one page according to 2Q
+ * @details     Pages evicted from A1in are remembered in A1out.
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   sh: pointer to shard
+ * @return      number of unmapped pages
+ */
+
+static uint64_t ch_evict_2q(caching_t* ch, ch_shard_t* sh){
+    bool from_a1in = sh->a1in.size > CH_2Q_KIN(sh) || sh->am.size == 0;
+    int64_t victim = from_a1in ? ch_a1in_victim(ch, sh) : ch_am_victim(ch, sh);
+    if(victim == -1){
+        /* everything in chosen queue is pinned */
+        from_a1in = !from_a1in;
+        victim = from_a1in ? ch_a1in_victim(ch, sh) : ch_am_victim(ch, sh);
+    }
+    if(victim == -1){
+        return 0;
+    }
+    logger(LL_DEBUG, __func__, "Evicting page %ld", sh->entries[victim].page_index);
+    if(ch_unmap_entry(ch, sh, victim) == CH_FAIL){
+        return 0;
+    }
+    if(!from_a1in){
+        ch_entry_release(sh, victim);
+        return 1;
+    }
+    ch_list_push(sh, CH_Q_A1OUT, victim);
+    while(sh->a1out.size > CH_2Q_KOUT(sh)){
+        int64_t ghost = sh->a1out.tail;
+        ch_list_unlink(sh, ghost);
+        ch_entry_release(sh, ghost);
+    }
+    return 1;
+}
+
+static uint64_t ch_unmap_shard(caching_t* ch, ch_shard_t* sh);
+
+/**
+ * @brief       Evict pages of shard by replacement policy until its low watermark is reached
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   sh: pointer to locked shard
+ * @return      number of unmapped pages
+ */
+
+static uint64_t ch_evict(caching_t* ch, ch_shard_t* sh){
+    uint64_t count = 0;
+    ch_wb_begin(ch, sh, sh->size);
+    if(ch->policy != CH_POLICY_2Q){
+        count = ch_unmap_shard(ch, sh);
+    }
+    while(ch->policy == CH_POLICY_2Q && sh->size > sh->low_watermark){
+        uint64_t unmapped = ch_evict_2q(ch, sh);
+        if(!unmapped){
+            break;
+        }
+        count += unmapped;
+    }
+    ch_wb_end(ch, sh);
+    return count;
+}
+
+/**
+ * @brief       Pick the least recently used unlogged page which isn't pinned
+ * @details     2Q takes A1in from the oldest end before Am, legacy policy takes
+ *              the oldest access stamp.
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   sh: pointer to locked shard
+ * @return      entry index or -1 if there is no such page
+ */
+
+static int64_t ch_spill_victim(caching_t* ch, ch_shard_t* sh){
+    if(ch->policy == CH_POLICY_2Q){
+        for(int64_t entry = sh->a1in.tail; entry != -1; entry = sh->entries[entry].prev){
+            if(!sh->entries[entry].pins && ch_unlogged(ch, &sh->entries[entry])){
+                return entry;
+            }
+        }
+        /* second chance as in ch_am_victim */
+        int64_t victim = sh->am.tail;
+        for(size_t steps = 2 * sh->am.size; victim != -1 && steps; --steps){
+            ch_entry_t* e = &sh->entries[victim];
+            int64_t prev = e->prev;
+            bool spillable = !e->pins && ch_unlogged(ch, e);
+            if(spillable && !e->referenced){
+                return victim;
+            }
+            if(spillable){
+                e->referenced = 0;
+                ch_list_unlink(sh, victim);
+                ch_list_push(sh, CH_Q_AM, victim);
+            }
+            victim = prev != -1 ? prev : sh->am.tail;
+        }
+        return -1;
+    }
+    int64_t victim = -1;
+    for(size_t entry = 0; entry < sh->top; ++entry){
+        const ch_entry_t* e = &sh->entries[entry];
+        if(e->flag == 1 && !e->pins && ch_unlogged(ch, e) && (victim == -1 || e->last_used < sh->entries[victim].last_used)){
+            victim = (int64_t)entry;
+        }
+    }
+    return victim;
+}
+
+/**
+ * @brief       Write unlogged pages of shard to log without commit and evict them
+ * @details     Pages are spilled only until shard has room for one page, as pages loaded
+ *              recently are still used by callers. Caller holds ch->lock, so log isn't restarted
+ *              by checkpoint meanwhile. Pinned pages are kept.
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   sh: pointer to locked shard
+ * @return      number of unmapped pages
+ */
+
+static uint64_t ch_spill(caching_t* ch, ch_shard_t* sh){
+    uint64_t count = 0;
+    while(sh->size >= sh->high_watermark){
+        int64_t entry = ch_spill_victim(ch, sh);
+        if(entry == -1){
+            break;
+        }
+        ch_entry_t* e = &sh->entries[entry];
+        off_t offset = wal_spill(ch->wal, e->page_index, e->page);
+        if(offset == -1){
+            logger(LL_ERROR, __func__, "Unable to spill page %ld to log", e->page_index);
+            break;
+        }
+        /* change is dropped from cache, it is read back from log */
+        if(ch_unmap_entry(ch, sh, entry) == CH_FAIL){
+            break;
+        }
+        e->flag = 4;
+        e->spilled = offset;
+        count++;
+    }
+    return count;
+}
+
+/**
+ * @brief       Write spilled pages to file and forget them, caller holds ch->lock
+ * @details     It is done on checkpoint, after commit of spilled pages and before log is restarted.
+ * @param[in]   ch: pointer to caching_t
+ * @return      CH_SUCCESS on success, CH_FAIL otherwise
+ */
+
+static int ch_unspill(caching_t* ch){
+    void* page = NULL;
+    int res = CH_SUCCESS;
+    for(size_t i = 0; i < ch->shard_count && res == CH_SUCCESS; ++i){
+        ch_shard_t* sh = &ch->shards[i];
+        lk_lock(&sh->lock);
+        for(size_t entry = 0; entry < sh->top && res == CH_SUCCESS; ++entry){
+            ch_entry_t* e = &sh->entries[entry];
+            if(e->flag != 4){
+                continue;
+            }
+            if(!page && (!(page = malloc(PAGE_SIZE)) || wal_sync(ch->wal) == WAL_FAIL)){
+                res = CH_FAIL;
+                break;
+            }
+            if(wal_read_page(ch->wal, e->spilled, page) == WAL_FAIL){
+                res = CH_FAIL;
+                break;
+            }
+            lk_lock(&ch->io_lock);
+            res = fl_write_back(&ch->file, page, PAGE_SIZE, ch_page_offset(e->page_index)) == FILE_FAIL ? CH_FAIL : CH_SUCCESS;
+            lk_unlock(&ch->io_lock);
+            if(res == CH_SUCCESS){
+                ch_entry_release(sh, (int64_t)entry);
+            }
+        }
+        lk_unlock(&sh->lock);
+    }
+    free(page);
+    if(res == CH_FAIL){
+        logger(LL_ERROR, __func__, "Unable to write spilled pages to file");
+    }
+    return res;
+}
+
+/**
+ * @brief       Evict pages of shard until its low watermark is reached
+ * @details     When shard is full of unlogged pages they are spilled to log without commit, so
+ *              they can be evicted and nothing which isn't complete is committed. Shard is
+ *              unlocked while cacher lock is taken.
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   sh: pointer to locked shard
+ * @param[in]   locked: caller holds ch->lock
+ * @return      number of unmapped pages
+ */
+
+static uint64_t ch_shrink(caching_t* ch, ch_shard_t* sh, bool locked){
+    uint64_t count = ch_evict(ch, sh);
+    if(ch->wal && sh->size >= sh->high_watermark){
+        logger(LL_DEBUG, __func__, "Cache is full of unlogged pages, spilling them to log");
+        if(!locked){
+            lk_unlock(&sh->lock);
+            lk_lock(&ch->lock);
+            lk_lock(&sh->lock);
+        }
+        count += ch_spill(ch, sh);
+        if(!locked){
+            lk_unlock(&ch->lock);
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief       Set cache budget
+ * @details     Budget is split evenly between shards, shards bigger than their part are shrunk
+ *              immediately. With frame pool backend budget is bounded by pool size, a few frames
+ *              are left for pages mapped while cache is full.
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   budget: budget in bytes
+ * @return      CH_SUCCESS on success, CH_FAIL otherwise
+ */
+
+int ch_set_budget(caching_t* ch, size_t budget){
+    size_t pages = budget / PAGE_SIZE;
+    if(pages < CH_MIN_BUDGET_PAGES){
+        logger(LL_WARN, __func__, "Cache budget %zu is too small, using %d pages", budget, CH_MIN_BUDGET_PAGES);
+        pages = CH_MIN_BUDGET_PAGES;
+    }
+    size_t frames = fl_pool_frames(&ch->file);
+    if(frames && pages + CH_MIN_BUDGET_PAGES > frames){
+        logger(LL_WARN, __func__, "Cache budget %zu exceeds frame pool, using %zu pages", budget, frames - CH_MIN_BUDGET_PAGES);
+        pages = frames - CH_MIN_BUDGET_PAGES;
+    }
+    logger(LL_DEBUG, __func__, "Setting cache budget to %zu pages", pages);
+    ch->budget = pages * PAGE_SIZE;
+    ch->high_watermark = pages;
+    ch->low_watermark = pages * ch->low_watermark_pct / 100;
+    if(ch->low_watermark >= ch->high_watermark){
+        ch->low_watermark = ch->high_watermark - 1;
+    }
+    for(size_t i = 0; i < ch->shard_count; ++i){
+        ch_shard_t* sh = &ch->shards[i];
+        lk_lock(&sh->lock);
+        sh->high_watermark = pages / ch->shard_count ? pages / ch->shard_count : 1;
+        sh->low_watermark = sh->high_watermark * ch->low_watermark_pct / 100;
+        if(sh->low_watermark >= sh->high_watermark){
+            sh->low_watermark = sh->high_watermark - 1;
+        }
+        if(sh->size > sh->high_watermark){
+            uint64_t count = ch_shrink(ch, sh, false);
+            logger(LL_DEBUG, __func__, "Unmaped %ld pages", count);
+        }
+        lk_unlock(&sh->lock);
+    }
+    return CH_SUCCESS;
+}
+
+size_t ch_budget(caching_t* ch) {return ch->budget;}
+
+/**
+ * @brief       Put mapped page to shard, shard must have room for it
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   sh: pointer to locked shard
+ * @param[in]   page_index: index of page
+ * @param[in]   mapped_page_ptr: pointer to mmaped page
+ * @return      entry index or CH_FAIL
+ */
+
+static int64_t ch_insert(caching_t* ch, ch_shard_t* sh, int64_t page_index, void* mapped_page_ptr){
+    int64_t entry = ch_lookup(sh, page_index);
+    if(entry == -1 && (entry = ch_entry_create(sh, page_index, 2)) == CH_FAIL){
+        logger(LL_ERROR, __func__ , "Unable to reserve cacher capacity.");
+        return CH_FAIL;
+    }
+
+    if(sh->entries[entry].flag == 1){
+        return entry;
+    }
+
+    if (sh->size >= CH_SIZE_UPPER_LIMIT){
+        logger(LL_ERROR, __func__, "Integer overflow while updating size: %ld.", sh->size);
+        return CH_FAIL;
+    }
+
+    sh->entries[entry].flag = 1;
+    sh->entries[entry].page = mapped_page_ptr;
+    ch_admit(ch, sh, entry);
+    sh->size++;
+    return entry;
+}
+
+/**
+ * @brief       Put page to cacher
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   page_index: index of page
+ * @param[in]   mapped_page_ptr: pointer to mmaped page
+ * @return      CH_SUCCESS on success, CH_FAIL otherwise
+ */
+
+int ch_put(caching_t* ch, int64_t page_index, void* mapped_page_ptr){
+    if(ch == NULL) { // Null pointer check.
+        logger(LL_ERROR, __func__ , "Input caching structure is NULL.");
+        return CH_FAIL;
+    }
+
+    logger(LL_DEBUG, __func__, "Putting page %ld to cache", page_index);
+
+    ch_shard_t* sh = ch_shard(ch, page_index);
+    lk_lock(&sh->lock);
+    if(sh->size >= sh->high_watermark){
+        uint64_t count = ch_shrink(ch, sh, false);
+        logger(LL_DEBUG, __func__, "Unmaped %ld pages", count);
+    }
+    int64_t entry = ch_insert(ch, sh, page_index, mapped_page_ptr);
+    lk_unlock(&sh->lock);
+    return entry == CH_FAIL ? CH_FAIL : CH_SUCCESS;
+}
+
+/**
+ * @brief       Get entry of cached page
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   sh: pointer to locked shard
+ * @param[in]   page_index: index of page
+ * @return      entry index or -1 if page isn't cached
+ */
+
+static int64_t ch_get_entry(caching_t* ch, ch_shard_t* sh, int64_t page_index){
+    if(!sh->size){
+        logger(LL_DEBUG, __func__ , "Cacher size is 0.");
+        return -1;
+    }
+    if(page_index > ch_max_page_index(ch)){
+        logger(LL_DEBUG, __func__, "Requesting not existing key in file, page_index: %ld", page_index);
+        return -1;
+    }
+    int64_t entry = ch_lookup(sh, page_index);
+    if(entry == -1 || sh->entries[entry].flag != 1){
+        logger(LL_DEBUG, __func__, "Requesting key that is not in cache");
+        return -1;
+    }
+    ch_touch(ch, sh, entry);
+    return entry;
+}
+
+/**
+ * @brief       Get page from cacher
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   page_index: index of page
+ * @return      pointer to page or NULL
+ */
+
+void* ch_get(caching_t* ch, int64_t page_index){
+    ch_shard_t* sh = ch_shard(ch, page_index);
+    lk_lock(&sh->lock);
+    int64_t entry = ch_get_entry(ch, sh, page_index);
+    void* page = entry == -1 ? NULL : sh->entries[entry].page;
+    lk_unlock(&sh->lock);
+    return page;
+}
+
+/**
+ * @brief       Remove page from cache
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   sh: pointer to locked shard
+ * @param[in]   index: index of page
+ * @param[in]   force: remove page even if it is pinned
+ * @return      CH_SUCCESS on success, CH_PINNED if page is pinned, CH_FAIL otherwise
+ */
+
+static int ch_remove_page(caching_t* ch, ch_shard_t* sh, int64_t index, bool force){
+    logger(LL_DEBUG, __func__, "Removing page %ld from cache", index);
+    if(index > ch_max_page_index(ch)){
+        logger(LL_ERROR, __func__, "Unable to remove page %ld, out of file range", index);
+        return CH_FAIL;
+    }
+    int64_t entry = ch_lookup(sh, index);
+    if(entry == -1){
+        return CH_SUCCESS;
+    }
+    if(sh->entries[entry].flag == 3){
+        logger(LL_ERROR, __func__, "Unable to remove deleted page %ld", index);
+        return CH_FAIL;
+    }
+    if(sh->entries[entry].pins && !force){
+        logger(LL_DEBUG, __func__, "Page %ld is pinned", index);
+        return CH_PINNED;
+    }
+    /* page kept by ch_keep is released with it */
+    if(sh->entries[entry].pins > sh->entries[entry].kept){
+        logger(LL_WARN, __func__, "Removing page %ld pinned %u times", index, sh->entries[entry].pins);
+    }
+    if(!force && (sh->entries[entry].flag == 4 || ch_unlogged(ch, &sh->entries[entry]))){
+        logger(LL_DEBUG, __func__, "Page %ld isn't logged", index);
+        return CH_PINNED;
+    }
+    if(sh->entries[entry].flag == 1 && ch_unmap_entry(ch, sh, entry) == CH_FAIL){
+        return CH_FAIL;
+    }
+    ch_list_unlink(sh, entry);
+    ch_entry_release(sh, entry);
+    return CH_SUCCESS;
+}
+
+/**
+ * @brief       Remove page from cache, pinned page is kept
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   index: index of page
+ * @return      CH_SUCCESS on success, CH_PINNED if page is pinned, CH_FAIL otherwise
+ */
+
+int ch_remove(caching_t* ch, int64_t index){
+    ch_shard_t* sh = ch_shard(ch, index);
+    lk_lock(&sh->lock);
+    int res = ch_remove_page(ch, sh, index, false);
+    lk_unlock(&sh->lock);
+    return res;
+}
+
+/**
+ * @brief       Pin page, pinned page is never evicted, so pointer to it stays valid
+ * @details     Page is loaded if it isn't cached. Pins are counted, each pin needs its unpin.
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   page_index: index of page
+ * @return      CH_SUCCESS on success, CH_DELETED if page was deleted, CH_FAIL otherwise
+ */
+
+int ch_pin(caching_t* ch, int64_t page_index){
+    ch_shard_t* sh = ch_shard(ch, page_index);
+    lk_lock(&sh->lock);
+    int64_t entry = -1;
+    int res = ch_load(ch, sh, page_index, &entry, false, false);
+    if(res == CH_SUCCESS){
+        sh->entries[entry].pins++;
+    }
+    lk_unlock(&sh->lock);
+    return res;
+}
+
+/**
+ * @brief       Keep page pinned till it is deleted
+ * @details     Page is pinned once however many times it is kept, the pin is dropped when page
+ *              is deleted or cache is destroyed. It is meant for pages pointed to by long living
+ *              handles.
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   page_index: index of page
+ * @return      CH_SUCCESS on success, CH_DELETED if page was deleted, CH_FAIL otherwise
+ */
+
+int ch_keep(caching_t* ch, int64_t page_index){
+    ch_shard_t* sh = ch_shard(ch, page_index);
+    lk_lock(&sh->lock);
+    int64_t entry = -1;
+    int res = ch_load(ch, sh, page_index, &entry, false, false);
+    if(res == CH_SUCCESS && !sh->entries[entry].kept){
+        sh->entries[entry].kept = 1;
+        sh->entries[entry].pins++;
+    }
+    lk_unlock(&sh->lock);
+    return res;
+}
+
+/**
+ * @brief       Check if page is pinned
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   page_index: index of page
+ * @return      true if page is cached and pinned
+ */
+
+bool ch_pinned(caching_t* ch, int64_t page_index){
+    ch_shard_t* sh = ch_shard(ch, page_index);
+    lk_lock(&sh->lock);
+    int64_t entry = ch_lookup(sh, page_index);
+    bool pinned = entry != -1 && sh->entries[entry].flag == 1 && sh->entries[entry].pins;
+    lk_unlock(&sh->lock);
+    return pinned;
+}
+
+/**
+ * @brief       Unpin page
+ * @details     Page deleted while it was pinned is silently accepted.
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   page_index: index of page
+ * @return      CH_SUCCESS on success, CH_FAIL if page isn't pinned
+ */
+
+int ch_unpin(caching_t* ch, int64_t page_index){
+    ch_shard_t* sh = ch_shard(ch, page_index);
+    lk_lock(&sh->lock);
+    int64_t entry = ch_lookup(sh, page_index);
+    int res = CH_SUCCESS;
+    if(entry == -1 || (sh->entries[entry].flag != 3 && (sh->entries[entry].flag != 1 || sh->entries[entry].pins <= sh->entries[entry].kept))){
+        logger(LL_WARN, __func__, "Page %ld isn't pinned", page_index);
+        res = CH_FAIL;
+    }
+    else if(sh->entries[entry].flag == 1){
+        sh->entries[entry].pins--;
+    }
+    lk_unlock(&sh->lock);
+    return res;
+}
+
+
+
+/**
+ * @brief       Mapping new page and caching it.
+ * @param[in]   ch: pointer to caching_t
+ * @return      new page index or CH_FAIL
+ */
+
+int64_t ch_new_page(caching_t* ch){
+    logger(LL_DEBUG, __func__, "Requesting new page");
+    lk_lock(&ch->io_lock);
+    if (init_page(&ch->file) == FILE_FAIL) {
+        lk_unlock(&ch->io_lock);
+        logger(LL_ERROR, __func__, "Unable to init page");
+        return CH_FAIL;
+    }
+    int64_t page_index = fl_current_page_index(&ch->file);
+    void* mmaped_page_ptr = ch->file.cur_mmaped_data;
+    lk_unlock(&ch->io_lock);
+    ch_put(ch, page_index, mmaped_page_ptr);
+    return page_index;
+}
+
+/**
+ * @brief       Load page from Cache or from File
+ * @details     Page is mapped under shard lock, so it is never mapped twice.
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   sh: pointer to locked shard of page
+ * @param[in]   page_index: index of page
+ * @param[out]  entry: entry of loaded page
+ * @param[in]   write: page is going to be modified, it is marked dirty
+ * @param[in]   locked: caller holds ch->lock
+ * @return      CH_SUCCESS on success, CH_DELETED if page was deleted, CH_FAIL otherwise
+ */
+
+static int ch_load(caching_t* ch, ch_shard_t* sh, int64_t page_index, int64_t* entry, bool write, bool locked){
+    logger(LL_DEBUG, __func__, "Loading page %ld", page_index);
+
+    *entry = ch_get_entry(ch, sh, page_index);
+    if(*entry != -1){
+        if(write){
+            ch_set_dirty(ch, sh, *entry);
+        }
+        return CH_SUCCESS;
+    }
+
+    if((int64_t)page_index > ch_max_page_index(ch)){
+        logger(LL_ERROR, __func__, "chunk_t index is out of file range");
+        return CH_FAIL;
+    }
+    if(sh->size >= sh->high_watermark){
+        uint64_t count = ch_shrink(ch, sh, locked);
+        logger(LL_DEBUG, __func__, "Unmaped %ld pages", count);
+        /* shard is unlocked while cache is committed */
+        if((*entry = ch_get_entry(ch, sh, page_index)) != -1){
+            if(write){
+                ch_set_dirty(ch, sh, *entry);
+            }
+            return CH_SUCCESS;
+        }
+    }
+    int64_t found = ch_lookup(sh, page_index);
+    if(found != -1 && sh->entries[found].flag == 3){
+        return CH_DELETED;
+    }
+    bool spilled = found != -1 && sh->entries[found].flag == 4;
+    lk_lock(&ch->io_lock);
+    int res = mmap_page(ch_page_offset(page_index), &ch->file);
+    void* mmaped_page_ptr = fl_cur_mmaped_data(&ch->file);
+    lk_unlock(&ch->io_lock);
+    if(res == FILE_FAIL) {
+        logger(LL_ERROR, __func__, "Unable to mmap page_index: %ld", page_index);
+        return CH_FAIL;
+    }
+    if((spilled && wal_read_page(ch->wal, sh->entries[found].spilled, mmaped_page_ptr) == WAL_FAIL)
+       || (*entry = ch_insert(ch, sh, page_index, mmaped_page_ptr)) == CH_FAIL){
+        lk_lock(&ch->io_lock);
+        release_page(&mmaped_page_ptr, &ch->file);
+        lk_unlock(&ch->io_lock);
+        return CH_FAIL;
+    }
+
+    //Increase usage
+    ch_touch(ch, sh, *entry);
+    /* spilled page isn't committed yet, so it must be logged again before it reaches file */
+    if(write || spilled){
+        ch_set_dirty(ch, sh, *entry);
+    }
+
+    return CH_SUCCESS;
+}
+
+/**
+ * @brief       Load page for modification, page is marked dirty
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   page_index: index of page
+ * @param[out]  page: pointer on pointer loaded page or NULL
+ * @return      CH_SUCCESS on success, CH_DELETED if page was deleted, CH_FAIL otherwise
+ */
+
+int ch_load_page(caching_t* ch, int64_t page_index, void** page){
+    ch_shard_t* sh = ch_shard(ch, page_index);
+    lk_lock(&sh->lock);
+    int64_t entry = -1;
+    int res = ch_load(ch, sh, page_index, &entry, true, false);
+    if(res == CH_SUCCESS){
+        *page = sh->entries[entry].page;
+    }
+    lk_unlock(&sh->lock);
+    if(res == CH_SUCCESS){
+        ch_flush_check(ch);
+    }
+    return res;
+}
+
+/**
+ * @brief       Mark cached page as modified
+ * @details     Needed when page loaded for reading is modified.
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   page_index: index of page
+ * @return      CH_SUCCESS on success, CH_FAIL if page isn't cached
+ */
+
+int ch_mark_dirty(caching_t* ch, int64_t page_index){
+    ch_shard_t* sh = ch_shard(ch, page_index);
+    lk_lock(&sh->lock);
+    int64_t entry = ch_lookup(sh, page_index);
+    bool cached = entry != -1 && sh->entries[entry].flag == 1;
+    if(cached){
+        ch_set_dirty(ch, sh, entry);
+    }
+    lk_unlock(&sh->lock);
+    if(!cached){
+        logger(LL_ERROR, __func__, "Page %ld isn't cached", page_index);
+        return CH_FAIL;
+    }
+    ch_flush_check(ch);
+    return CH_SUCCESS;
+}
+
+/**
+ * @brief       Load batch of pages to cache ahead of use
+ * @details     Cached, deleted and out of range pages are skipped. Pages are read by one
+ *              batch of I/O engine, no more than high - low watermark pages are loaded,
+ *              so prefetched pages don't evict each other. Prefetched pages aren't counted as used.
+ *              Page loaded by another thread meanwhile is kept, its prefetched copy is dropped.
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   pages: indexes of pages
+ * @param[in]   count: number of pages
+ * @return      number of loaded pages or CH_FAIL
+ */
+
+int64_t ch_prefetch(caching_t* ch, const int64_t* pages, size_t count){
+    size_t room = ch->high_watermark - ch->low_watermark;
+    if(count > room){
+        count = room;
+    }
+    if(count == 0){
+        return 0;
+    }
+    int64_t* indexes = malloc(count * sizeof(int64_t));
+    off_t* offsets = malloc(count * sizeof(off_t));
+    void** mapped = malloc(count * sizeof(void*));
+    if(!indexes || !offsets || !mapped){
+        free(indexes);
+        free(offsets);
+        free(mapped);
+        return CH_FAIL;
+    }
+    size_t n = 0;
+    size_t wanted[CH_SHARDS] = {0};
+    for(size_t i = 0; i < count; ++i){
+        if(pages[i] < 0 || pages[i] > ch_max_page_index(ch)){
+            continue;
+        }
+        ch_shard_t* sh = ch_shard(ch, pages[i]);
+        lk_lock(&sh->lock);
+        int64_t entry = ch_lookup(sh, pages[i]);
+        /* spilled page is read from log by ch_load */
+        bool skip = entry != -1 && sh->entries[entry].flag != 2;
+        lk_unlock(&sh->lock);
+        if(skip){
+            continue;
+        }
+        wanted[sh - ch->shards]++;
+        indexes[n] = pages[i];
+        offsets[n++] = ch_page_offset(pages[i]);
+    }
+    for(size_t i = 0; i < ch->shard_count && n; ++i){
+        ch_shard_t* sh = &ch->shards[i];
+        lk_lock(&sh->lock);
+        if(wanted[i] && sh->size + wanted[i] > sh->high_watermark){
+            uint64_t unmapped = ch_evict(ch, sh);
+            logger(LL_DEBUG, __func__, "Unmaped %ld pages", unmapped);
+        }
+        lk_unlock(&sh->lock);
+    }
+    lk_lock(&ch->io_lock);
+    n = fl_map_pages(&ch->file, offsets, mapped, n);
+    lk_unlock(&ch->io_lock);
+    int64_t loaded = 0;
+    for(size_t i = 0; i < n; ++i){
+        if(!mapped[i]){
+            continue;
+        }
+        ch_shard_t* sh = ch_shard(ch, indexes[i]);
+        lk_lock(&sh->lock);
+        int64_t entry = ch_lookup(sh, indexes[i]);
+        /* duplicate index in request or page loaded meanwhile */
+        bool drop = entry != -1 && sh->entries[entry].flag != 2;
+        if(!drop && sh->size >= sh->high_watermark){
+            ch_evict(ch, sh);
+        }
+        if(drop || ch_insert(ch, sh, indexes[i], mapped[i]) == CH_FAIL){
+            lk_lock(&ch->io_lock);
+            release_page(&mapped[i], &ch->file);
+            lk_unlock(&ch->io_lock);
+        }
+        else{
+            ++loaded;
+        }
+        lk_unlock(&sh->lock);
+    }
+    logger(LL_DEBUG, __func__, "Prefetched %ld pages", loaded);
+    free(indexes);
+    free(offsets);
+    free(mapped);
+    return loaded;
+}
+
+/**
+ * @brief       Read range of pages ahead
+ * @details     Frames of pool backend are filled by batched prefetch, for mapped pages
+ *              kernel readahead is requested.
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   start: first page
+ * @param[in]   count: number of pages
+ * @param[in]   sequential: pages are read by sequential scan
+ */
+
+static void ch_read_range(caching_t* ch, int64_t start, size_t count, bool sequential){
+    if(start > ch_max_page_index(ch)){
+        return;
+    }
+    if((int64_t)count > ch_max_page_index(ch) - start + 1){
+        count = (size_t)(ch_max_page_index(ch) - start + 1);
+    }
+    logger(LL_DEBUG, __func__, "Reading ahead %zu pages from %ld", count, start);
+    if(!fl_pool_frames(&ch->file)){
+        lk_lock(&ch->io_lock);
+        fl_readahead(&ch->file, ch_page_offset(start), (off_t)(count * PAGE_SIZE), sequential);
+        lk_unlock(&ch->io_lock);
+        return;
+    }
+    int64_t* pages = malloc(count * sizeof(int64_t));
+    if(!pages){
+        return;
+    }
+    for(size_t i = 0; i < count; ++i){
+        pages[i] = start + (int64_t)i;
+    }
+    ch_prefetch(ch, pages, count);
+    free(pages);
+}
+
+/**
+ * @brief       Read ahead for scan stepping from prev_page to page_index
+ * @details     Scan is recognized by the page it has left. When scan keeps inside pages read
+ *              ahead, it is sequential and readahead window doubles up to CH_RA_MAX with each new
+ *              batch. When scan jumps outside, window is halved down to CH_RA_MIN. Next batch is
+ *              issued when less than half of window is left ahead of the scan. Window is bounded by
+ *              high - low watermark, so pages read ahead don't evict each other.
+ *              Readahead is skipped while another thread holds cacher lock.
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   prev_page: page left by scan or -1 for new scan
+ * @param[in]   page_index: page scan steps to
+ */
+
+void ch_readahead(caching_t* ch, int64_t prev_page, int64_t page_index){
+    if(!lk_trylock(&ch->lock)){
+        return;
+    }
+    ch_ra_stream_t* stream = NULL;
+    ch_ra_stream_t* victim = &ch->ra[0];
+    for(size_t i = 0; i < CH_RA_STREAMS; ++i){
+        if(prev_page != -1 && ch->ra[i].last == prev_page){
+            stream = &ch->ra[i];
+            break;
+        }
+        if(ch->ra[i].used < victim->used){
+            victim = &ch->ra[i];
+        }
+    }
+    bool sequential = false;
+    if(!stream){
+        stream = victim;
+        stream->window = CH_RA_MIN;
+        stream->ahead = page_index;
+    }
+    else if(page_index > stream->last && page_index <= stream->ahead){
+        sequential = true;
+    }
+    else{
+        stream->window = stream->window / 2 < CH_RA_MIN ? CH_RA_MIN : stream->window / 2;
+        stream->ahead = page_index;
+    }
+    stream->last = page_index;
+    stream->used = ++ch->ra_clock;
+    if(stream->ahead - page_index > (int64_t)stream->window / 2){
+        lk_unlock(&ch->lock);
+        return;
+    }
+    if(sequential){
+        size_t max_window = ch->high_watermark - ch->low_watermark;
+        max_window = max_window < CH_RA_MAX ? max_window : CH_RA_MAX;
+        stream->window = stream->window * 2 > max_window ? max_window : stream->window * 2;
+    }
+    int64_t start = stream->ahead;
+    size_t window = stream->window;
+    stream->ahead += (int64_t)stream->window;
+    lk_unlock(&ch->lock);
+    ch_read_range(ch, start, window, sequential);
 }
 
-size_t ch_size(caching_t* ch) {return ch->size;}
-size_t ch_used(caching_t* ch) {return ch->used;}
-void* ch_cached_page(caching_t* ch, size_t index) {return ch->cached_page_ptr[index];}
-size_t ch_usage_memory_space(caching_t* ch){
-    return PAGE_SIZE * ch->size;
+static int ch_dirty_page_cmp(const void* a, const void* b){
+    int64_t l = ((const ch_dirty_page_t*)a)->page_index;
+    int64_t r = ((const ch_dirty_page_t*)b)->page_index;
+    return (l > r) - (l < r);
 }
-int ch_page_status(caching_t* ch, size_t index) {return index <= ch->capacity ? ch->flags[index]: -1;}
 
 /**
- * @brief       Reserve new capacity for cacher.
+ * @brief       Write dirty pages back, caller holds ch->lock
+ * @details     Dirty pages are gathered shard by shard, sorted and adjacent pages are joined
+ *              into runs, each run is one write of flusher thread. Frames of pool backend are
+ *              staged under their shard lock, so they may be evicted or modified while batch is
+ *              written; for mapped pages writeback of file cache is started. Page evicted or
+ *              cleaned between gathering and staging is left out.
+ *              Background batch leaves pinned pages and pages modified less than CH_FLUSH_AGE page
+ *              modifications ago, it is limited to CH_FLUSH_MAX pages and is skipped while previous
+ *              batch is in flight. Waiting batch takes every dirty page and returns when it is written.
+ *              Unlogged pages are never written, log is made durable before the batch.
  * @param[in]   ch: pointer to caching_t
- * @param[in]   new_capacity: new capacity
- * @return      CH_SUCCESS on success, CH_FAIL otherwise
+ * @param[in]   wait: write all dirty pages and wait for them
+ * @return      number of pages in batch or CH_FAIL
  */
 
-int ch_reserve(caching_t* ch, size_t new_capacity){
-    if((new_capacity) <= ch->max_used) {
-       return CH_SUCCESS;
+static int64_t ch_write_back(caching_t* ch, bool wait){
+    if(!wait && ch->flusher && fls_busy(ch->flusher)){
+        return 0;
+    }
+    int res = ch_flush_complete(ch);
+    uint64_t dirty_clock = atomic_load(&ch->dirty_clock);
+    atomic_store(&ch->flush_clock, dirty_clock);
+    size_t dirty = atomic_load(&ch->dirty);
+    size_t limit = wait ? dirty : CH_FLUSH_MAX;
+    if(!dirty || !limit){
+        return res == CH_SUCCESS ? 0 : CH_FAIL;
     }
-    logger(LL_DEBUG, __func__, "Reserving new cacher capacity: %ld -> %ld.", ch->capacity, new_capacity);
-    size_t ch_new_capacity = new_capacity;
-    roundupsize(ch_new_capacity);
-    if(ch_new_capacity < new_capacity){
-        logger(LL_ERROR, __func__, "Integer overflow while reserving new cacher capacity: %ld.", new_capacity);
+    ch_dirty_page_t* pages = malloc(limit * sizeof(ch_dirty_page_t));
+    if(!pages){
         return CH_FAIL;
     }
-    size_t ch_new_max_used = (ch_new_capacity >> 1) + (ch_new_capacity >> 2); /*3/4 of the new capacity*/
-    if (ch_new_max_used < (new_capacity)){
-        ch_new_capacity <<= 1;
-        if (ch_new_capacity < (new_capacity))  {
-            logger(LL_ERROR, __func__, "Integer overflow while reserving new cacher capacity: %ld.", new_capacity);
-            return CH_FAIL;
+    size_t n = 0;
+    for(size_t i = 0; i < ch->shard_count && n < limit; ++i){
+        ch_shard_t* sh = &ch->shards[i];
+        lk_lock(&sh->lock);
+        for(size_t entry = 0; entry < sh->top && n < limit; ++entry){
+            ch_entry_t* e = &sh->entries[entry];
+            if(e->flag != 1 || !e->dirty || ch_unlogged(ch, e) || ch_page_offset(e->page_index) >= ch_file_size(ch)){
+                continue;
+            }
+            if(!wait && (e->pins || dirty_clock - e->dirtied < CH_FLUSH_AGE)){
+                continue;
+            }
+            pages[n++] = (ch_dirty_page_t){.page_index = e->page_index, .dirtied = e->dirtied};
         }
-        ch_new_max_used = (ch_new_capacity >> 1) + (ch_new_capacity >> 2);
-    }
-    char *ch_new_flags = malloc(ch_new_capacity*sizeof(char));
-    if(!ch_new_flags){
-        logger(LL_ERROR, __func__, "Unable allocate new flags for cacher.");
-        return CH_FAIL;
-    }
-    void** ch_new_cached_page_ptr = malloc(ch_new_capacity*sizeof(void*));
-    if(!ch_new_cached_page_ptr){
-        free(ch_new_flags);
-        logger(LL_ERROR, __func__, "Unable allocate new cached_page_ptr for cacher.");
-        return CH_FAIL;
-    }
-    uint32_t* ch_new_usage_count = malloc(ch_new_capacity*sizeof(uint32_t));
-    if(!ch_new_usage_count){
-        free(ch_new_flags);
-        free(ch_new_cached_page_ptr);
-        logger(LL_ERROR, __func__, "Unable allocate new usage_count for cacher.");
-        return CH_FAIL;
-    }
-    time_t* ch_new_last_used = malloc(ch_new_capacity * sizeof(time_t));
-    if(!ch_new_last_used){
-        free(ch_new_flags);
-        free(ch_new_cached_page_ptr);
-        free(ch_new_usage_count);
-        logger(LL_ERROR, __func__, "Unable allocate new last_used for cacher.");
-        return CH_FAIL;
-    }
-    memset(ch_new_last_used, 0, ch_new_capacity);
-    memset(ch_new_flags, 0, ch_new_capacity);
-    memset(ch_new_usage_count, 0, ch_new_capacity);
-    for(size_t ch_i = 0; ch_i < ch->capacity; ch_i++){
-        if(ch->flags[ch_i] == 1) {
-            ch_new_flags[ch_i] = 1;
-            ch_new_cached_page_ptr[ch_i] = ch->cached_page_ptr[ch_i];
-            ch_new_usage_count[ch_i] = ch->usage_count[ch_i];
-            ch_new_last_used[ch_i] = ch->last_used[ch_i];
-        }
-        if(ch->flags[ch_i] == 3){
-            ch_new_flags[ch_i] = 3;
-            ch_new_cached_page_ptr[ch_i] = ch->cached_page_ptr[ch_i];
-            ch_new_usage_count[ch_i] = ch->usage_count[ch_i];
-            ch_new_last_used[ch_i] = ch->last_used[ch_i];
-        }
-    }
-    free(ch->last_used);
-    free(ch->flags);
-    free(ch->usage_count);
-    free(ch->cached_page_ptr);
-    ch->flags = ch_new_flags;
-    ch->cached_page_ptr = ch_new_cached_page_ptr;
-    ch->capacity = ch_new_capacity;
-    ch->max_used = ch_new_max_used;
-    ch->usage_count = ch_new_usage_count;
-    ch->last_used = ch_new_last_used;
-    ch->used = ch->size;
-    logger(LL_DEBUG, __func__, "Reserved new cacher capacity: %ld.", ch->capacity);
-    return CH_SUCCESS;
-}
-
-/**
- * @brief       Put page to cacher
- * @param[in]   ch: pointer to caching_t
- * @param[in]   page_index: index of page
- * @param[in]   mapped_page_ptr: pointer to mmaped page
- * @return      CH_SUCCESS on success, CH_FAIL otherwise
- */
-
-int ch_put(caching_t* ch, int64_t page_index, void* mapped_page_ptr){
-    if(ch == NULL) { // Null pointer check.
-        logger(LL_ERROR, __func__ , "Input caching structure is NULL.");
-        return CH_FAIL;
+        lk_unlock(&sh->lock);
     }
-
-    logger(LL_DEBUG, __func__, "Putting page %ld to cache", page_index);
-
-    if(ch_usage_memory_space(ch) >= CH_MAX_MEMORY_USAGE){
-        uint64_t count = ch_unmap_some_pages(ch);
-        logger(LL_DEBUG, __func__, "Unmaped %ld pages", count);
+    if(!n){
+        free(pages);
+        return res == CH_SUCCESS ? 0 : CH_FAIL;
     }
-    size_t ch_new_capacity = ch->capacity ? ch->capacity : 2;
-    ch_new_capacity = ((size_t)page_index < ch_new_capacity) ? ch_new_capacity : (size_t)page_index + 1;
-    if(ch_new_capacity > ch->capacity && ch_reserve(ch, ch_new_capacity) == CH_FAIL){
-        logger(LL_ERROR, __func__ , "Unable to reserve cacher capacity.");
+    if(ch->wal && wal_sync(ch->wal) == WAL_FAIL){
+        free(pages);
         return CH_FAIL;
     }
-
-    if((size_t)page_index >= ch->capacity){
-        logger(LL_ERROR, __func__ , "Page index is outside the range of the cacher size.");
+    qsort(pages, n, sizeof(ch_dirty_page_t), ch_dirty_page_cmp);
+    bool staged = fl_pool_frames(&ch->file) != 0;
+    uint8_t* buffer = staged ? aligned_alloc(PAGE_SIZE, n * PAGE_SIZE) : NULL;
+    fls_run_t* runs = malloc(n * sizeof(fls_run_t));
+    if(!ch->flusher){
+        ch->flusher = fls_init(&ch->file);
+    }
+    if(!runs || (staged && !buffer) || !ch->flusher){
+        logger(LL_ERROR, __func__, "Unable to start write-back of %zu pages", n);
+        free(pages);
+        free(runs);
+        free(buffer);
         return CH_FAIL;
     }
-
-    if(ch->flags[page_index] == 1){
-        return CH_SUCCESS;
+    size_t count = 0, kept = 0;
+    for(size_t i = 0; i < n; ++i){
+        ch_shard_t* sh = ch_shard(ch, pages[i].page_index);
+        lk_lock(&sh->lock);
+        int64_t entry = ch_lookup(sh, pages[i].page_index);
+        ch_entry_t* e = entry == -1 ? NULL : &sh->entries[entry];
+        bool keep = e && e->flag == 1 && e->dirty && !ch_unlogged(ch, e);
+        if(keep){
+            e->flushing = 1;
+            pages[kept] = (ch_dirty_page_t){.page_index = e->page_index, .dirtied = e->dirtied};
+            if(staged){
+                memcpy(buffer + kept * PAGE_SIZE, e->page, PAGE_SIZE);
+            }
+        }
+        lk_unlock(&sh->lock);
+        if(!keep){
+            continue;
+        }
+        if(count && pages[kept].page_index == pages[kept - 1].page_index + 1){
+            runs[count - 1].size += PAGE_SIZE;
+        }
+        else{
+            runs[count++] = (fls_run_t){.offset = ch_page_offset(pages[kept].page_index), .size = PAGE_SIZE,
+                                        .buf = staged ? buffer + kept * PAGE_SIZE : NULL};
+        }
+        kept++;
     }
-
-    ch->flags[page_index] = 1;
-    ch->cached_page_ptr[page_index] = mapped_page_ptr;
-
-    if (ch->size >= CH_SIZE_UPPER_LIMIT){
-        logger(LL_ERROR, __func__, "Integer overflow while updating size: %ld.", ch->size);
-        return CH_FAIL;
+    logger(LL_DEBUG, __func__, "Writing back %zu pages in %zu runs", kept, count);
+    ch->flush_pages = pages;
+    ch->flush_count = kept;
+    atomic_store(&ch->flush_pending, true);
+    if(fls_submit(ch->flusher, runs, count, buffer) == FLS_FAIL){
+        res = CH_FAIL;
     }
+    if(wait && ch_flush_complete(ch) == CH_FAIL){
+        res = CH_FAIL;
+    }
+    return res == CH_SUCCESS ? (int64_t)kept : CH_FAIL;
+}
+
+/**
+ * @brief       Write dirty pages back
+ * @details     See ch_write_back.
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   wait: write all dirty pages and wait for them
+ * @return      number of pages in batch or CH_FAIL
+ */
 
-    ch->size++;
-//    printf("Cacher size: %ld\n", ch->size);
-//
-//    int counter = ch_print_cached_pages(ch);
-//    if(counter != ch->size){
-//        logger(LL_ERROR, __func__, "Cacher size is not equal to number of cached pages");
-//        return CH_FAIL;
-//    }
+int64_t ch_flush(caching_t* ch, bool wait){
+    lk_lock(&ch->lock);
+    int64_t res = ch_write_back(ch, wait);
+    lk_unlock(&ch->lock);
+    return res;
+}
 
-    return CH_SUCCESS;
+static int ch_cmp_page_index(const void* a, const void* b){
+    int64_t x = *(const int64_t*)a, y = *(const int64_t*)b;
+    return (x > y) - (x < y);
 }
 
 /**
- * @brief       Get page from cacher
+ * @brief       Punch holes of gathered deleted pages, caller holds ch->lock
+ * @details     Pages are sorted and contiguous runs are punched by one request. Page which was
+ *              used again or cut off since it was gathered is skipped. All shards are locked,
+ *              so no page is used again while it is punched. Hole punching is turned
+ *              off if file system doesn't support it.
  * @param[in]   ch: pointer to caching_t
- * @param[in]   page_index: index of page
- * @return      pointer to page or NULL
  */
 
-void* ch_get(caching_t* ch, int64_t page_index){
-    if(!ch->size){
-        logger(LL_DEBUG, __func__ , "Cacher size is 0.");
-        return NULL;
+static void ch_punch(caching_t* ch){
+    if(!ch->punch_count){
+        return;
     }
-    if(page_index > ch_max_page_index(ch)){
-        logger(LL_DEBUG, __func__, "Requesting not existing key in file, page_index: %ld", page_index);
-        return NULL;
+    qsort(ch->punch_pages, ch->punch_count, sizeof(int64_t), ch_cmp_page_index);
+    for(size_t i = 0; i < ch->shard_count; ++i){
+        lk_lock(&ch->shards[i].lock);
     }
-    if((size_t)page_index >= ch->capacity){
-        logger(LL_DEBUG, __func__, "Requesting not existing key");
-        return NULL;
+    int64_t start = -1, end = -1;
+    for(size_t i = 0; i <= ch->punch_count && ch->punch_holes; ++i){
+        int64_t page_index = -1;
+        if(i < ch->punch_count){
+            page_index = ch->punch_pages[i];
+            ch_shard_t* sh = ch_shard(ch, page_index);
+            int64_t entry = ch_lookup(sh, page_index);
+            if(page_index == end - 1 || entry == -1 || sh->entries[entry].flag != 3 || page_index > ch_max_page_index(ch)){
+                continue;
+            }
+            if(page_index == end){
+                end++;
+                continue;
+            }
+        }
+        lk_lock(&ch->io_lock);
+        if(start != -1 && fl_punch_hole(&ch->file, ch_page_offset(start), (off_t)(end - start) * PAGE_SIZE) == FILE_FAIL){
+            logger(LL_WARN, __func__, "Hole punching is turned off");
+            ch->punch_holes = false;
+        }
+        lk_unlock(&ch->io_lock);
+        start = page_index;
+        end = page_index + 1;
     }
-    if(ch->flags[page_index] != 1){
-        logger(LL_DEBUG, __func__, "Requesting key that is not in cache");
-        return NULL;
+    for(size_t i = ch->shard_count; i-- > 0;){
+        lk_unlock(&ch->shards[i].lock);
     }
-    ch->usage_count[page_index]++;
-    time_t now;
-    ch->last_used[page_index] = time(&now);
-    void* page = ch->cached_page_ptr[page_index];
-    return page;
+    ch->punch_count = 0;
 }
 
 /**
- * @brief       Remove page from cache
+ * @brief       Gather deleted page for hole punching, caller holds ch->lock
+ * @details     With write-ahead log holes are punched after deletion is committed.
  * @param[in]   ch: pointer to caching_t
- * @param[in]   index: index of page
+ * @param[in]   page_index: index of deleted page
+ */
+
+static void ch_punch_later(caching_t* ch, int64_t page_index){
+    if(ch->punch_count == ch->punch_capacity){
+        size_t capacity = ch->punch_capacity ? ch->punch_capacity * 2 : CH_PUNCH_BATCH;
+        int64_t* pages = realloc(ch->punch_pages, capacity * sizeof(int64_t));
+        if(!pages){
+            logger(LL_WARN, __func__, "Unable to gather page %ld for hole punching", page_index);
+            return;
+        }
+        ch->punch_pages = pages;
+        ch->punch_capacity = capacity;
+    }
+    ch->punch_pages[ch->punch_count++] = page_index;
+    if(!ch->wal && ch->punch_count >= CH_PUNCH_BATCH){
+        ch_punch(ch);
+    }
+}
+
+/**
+ * @brief       Log pages changed since last commit and commit them, caller holds ch->lock
+ * @details     Only the log is written, logged pages reach file by write-back or eviction.
+ *              Page changed again while it was logged stays unlogged till the next commit.
+ *              Pages spilled to log since previous commit are committed too.
+ *              On checkpoint, or when log outgrows WAL_CHECKPOINT_SIZE, every dirty and spilled
+ *              page is written, file is synced and log is restarted. Checkpoint follows logging
+ *              immediately, so no page is newer than its image in file.
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   checkpoint: checkpoint after commit
  * @return      CH_SUCCESS on success, CH_FAIL otherwise
  */
 
-int ch_remove(caching_t* ch, int64_t index){
-    logger(LL_DEBUG, __func__, "Removing page %ld from cache", index);
-    void* page = NULL;
-    if(ch_load_page(ch, index, &page) != CH_SUCCESS){
-        logger(LL_ERROR, __func__, "Unable to load a page %ld", index);
+static int ch_wal_commit(caching_t* ch, bool checkpoint){
+    ch_dirty_page_t* logged = NULL;
+    size_t count = 0, capacity = 0;
+    int res = CH_SUCCESS;
+    for(size_t i = 0; i < ch->shard_count && res == CH_SUCCESS; ++i){
+        ch_shard_t* sh = &ch->shards[i];
+        lk_lock(&sh->lock);
+        for(size_t entry = 0; entry < sh->top && res == CH_SUCCESS; ++entry){
+            ch_entry_t* e = &sh->entries[entry];
+            if(e->flag != 1 || !ch_unlogged(ch, e)){
+                continue;
+            }
+            if(count == capacity){
+                capacity = capacity ? capacity * 2 : CH_FLUSH_BATCH;
+                ch_dirty_page_t* grown = realloc(logged, capacity * sizeof(ch_dirty_page_t));
+                if(!grown){
+                    res = CH_FAIL;
+                    break;
+                }
+                logged = grown;
+            }
+            if(wal_log(ch->wal, e->page_index, e->page) == WAL_FAIL){
+                res = CH_FAIL;
+                break;
+            }
+            logged[count++] = (ch_dirty_page_t){.page_index = e->page_index, .dirtied = e->dirtied};
+        }
+        lk_unlock(&sh->lock);
+    }
+    if(res == CH_SUCCESS && wal_commit(ch->wal, ch_number_pages(ch)) == WAL_FAIL){
+        logger(LL_ERROR, __func__, "Unable to commit log");
+        res = CH_FAIL;
+    }
+    if(res == CH_FAIL){
+        free(logged);
         return CH_FAIL;
     }
-    if(unmap_page(&page, &ch->file) == -1){
-        logger(LL_ERROR, __func__, "Unable to unmap page %ld", index);
+    ch_punch(ch);
+    for(size_t i = 0; i < count; ++i){
+        ch_shard_t* sh = ch_shard(ch, logged[i].page_index);
+        lk_lock(&sh->lock);
+        int64_t entry = ch_lookup(sh, logged[i].page_index);
+        if(entry != -1 && sh->entries[entry].flag == 1 && sh->entries[entry].dirtied == logged[i].dirtied){
+            sh->entries[entry].logged = logged[i].dirtied;
+        }
+        lk_unlock(&sh->lock);
+    }
+    free(logged);
+    if(!checkpoint && wal_size(ch->wal) <= WAL_CHECKPOINT_SIZE){
+        return CH_SUCCESS;
+    }
+    if(ch_unspill(ch) == CH_FAIL || ch_write_back(ch, true) == CH_FAIL){
         return CH_FAIL;
     }
-    if (ch->size <= 0){
-        logger(LL_ERROR, __func__, "Integer overflow while updating size: %ld.", ch->size);
+    if(syn_mode(ch->syncer) != SYN_MODE_NONE && fl_sync(&ch->file) == FILE_FAIL){
         return CH_FAIL;
     }
-    ch->size--;
-    ch->flags[index] = 2;
-    ch->cached_page_ptr[index] = NULL;
-//    printf("Cacher size after remove: %ld\n", ch->size);
-//    int counter = ch_print_cached_pages(ch);
-//    if(counter != ch->size){
-//        logger(LL_ERROR, __func__, "Cacher size is not equal to number of cached pages");
-//        return CH_FAIL;
-//    }
-
-    return CH_SUCCESS;
+    return wal_checkpoint(ch->wal) == WAL_SUCCESS ? CH_SUCCESS : CH_FAIL;
 }
 
-
-
 /**
- * @brief       Mapping new page and caching it.
+ * @brief       Commit written pages according to durability mode
+ * @details     With write-ahead log changed pages are logged, in commit mode log is synced before
+ *              return. Otherwise nothing is done without durability, dirty pages are written to file,
+ *              in commit mode file is synced before return, in periodic mode it is synced by
+ *              background thread within interval. Sync isn't done under cacher lock, so commits
+ *              of several threads are grouped. Pages modified by other threads during commit
+ *              may be committed in any state, threads commit their own completed changes.
  * @param[in]   ch: pointer to caching_t
- * @return      new page index or CH_FAIL
+ * @return      CH_SUCCESS on success, CH_FAIL otherwise
  */
 
-int64_t ch_new_page(caching_t* ch){
-    logger(LL_DEBUG, __func__, "Requesting new page");
-    if (init_page(&ch->file) == FILE_FAIL) {
-        logger(LL_ERROR, __func__, "Unable to init page");
+int ch_commit(caching_t* ch){
+    lk_lock(&ch->lock);
+    if(ch->wal){
+        int res = ch_wal_commit(ch, false);
+        lk_unlock(&ch->lock);
+        return res;
+    }
+    ch_punch(ch);
+    if(syn_mode(ch->syncer) == SYN_MODE_NONE){
+        lk_unlock(&ch->lock);
+        return CH_SUCCESS;
+    }
+    int64_t flushed = ch_write_back(ch, true);
+    lk_unlock(&ch->lock);
+    if(flushed == CH_FAIL){
         return CH_FAIL;
     }
-    int64_t page_index = fl_current_page_index(&ch->file);
-    void* mmaped_page_ptr = ch->file.cur_mmaped_data;
-    ch_put(ch, page_index, mmaped_page_ptr);
-    return page_index;
+    return syn_commit(ch->syncer) == SYN_SUCCESS ? CH_SUCCESS : CH_FAIL;
 }
 
 /**
- * @brief       Load page from Cache or from File
+ * @brief       Commit and write every page to file
+ * @details     With write-ahead log the log is restarted afterwards.
  * @param[in]   ch: pointer to caching_t
- * @param[in]   page_index: index of page
- * @param[out]  page: pointer on pointer loaded page or NULL
- * @return      CH_SUCCESS on success, CH_DELETED if page was deleted, CH_FAIL otherwise
+ * @return      CH_SUCCESS on success, CH_FAIL otherwise
  */
 
-int ch_load_page(caching_t* ch, int64_t page_index, void** page){
-    logger(LL_DEBUG, __func__, "Loading page %ld", page_index);
-
-    *page = ch_get(ch, page_index);
-    if(*page != NULL){
-        return CH_SUCCESS;
-    }
-
-    if((int64_t)page_index > ch_max_page_index(ch)){
-        logger(LL_ERROR, __func__, "chunk_t index is out of file range");
-        return CH_FAIL;
-    }
-    if(ch->flags != NULL && page_index < ch->capacity && ch->flags[page_index] == 3){
-        return CH_DELETED;
+int ch_checkpoint(caching_t* ch){
+    lk_lock(&ch->lock);
+    int res = CH_SUCCESS;
+    if(ch->wal){
+        res = ch_wal_commit(ch, true);
     }
-    if(mmap_page(ch_page_offset(page_index), &ch->file) == FILE_FAIL) {
-        logger(LL_ERROR, __func__, "Unable to mmap page_index: %ld", page_index);
-        return CH_FAIL;
+    else{
+        ch_punch(ch);
+        if(ch_write_back(ch, true) == CH_FAIL){
+            res = CH_FAIL;
+        }
+        else if(syn_mode(ch->syncer) != SYN_MODE_NONE && fl_sync(&ch->file) == FILE_FAIL){
+            res = CH_FAIL;
+        }
     }
-    void* mmaped_page_ptr = fl_cur_mmaped_data(&ch->file);
-    ch_put(ch, page_index, mmaped_page_ptr);
-
-    *page = mmaped_page_ptr;
-
-    //Increase usage
-    ch->usage_count[page_index]++;
-    time_t now;
-    ch->last_used[page_index] = time(&now);
-
-    return CH_SUCCESS;
+    lk_unlock(&ch->lock);
+    return res;
 }
 
 /**
  * @brief   Use deleted page again
+ * @details Page becomes valid but not cached, it will be mapped on next load.
+ *          With write-ahead log deleted page isn't cleared in file, so it is cleared in cache.
  * @param   ch: pointer to caching_t
  * @param   page_index: index of page
  */
 
 void ch_use_again(caching_t* ch, int64_t page_index){
-    ch->flags[page_index] = 1;
-    ch->usage_count[page_index]++;
-    time_t now;
-    ch->last_used[page_index] = time(&now);
-    ch->size++;
-
-//    printf("Cacher size: %ld\n", ch->size);
-//
-//    int counter = ch_print_cached_pages(ch);
-//    if(counter != ch->size){
-//        logger(LL_ERROR, __func__, "Cacher size is not equal to number of cached pages");
-//    }
+    ch_shard_t* sh = ch_shard(ch, page_index);
+    lk_lock(&sh->lock);
+    int64_t entry = ch_lookup(sh, page_index);
+    if(entry != -1 && sh->entries[entry].flag == 3){
+        ch_entry_release(sh, entry);
+    }
+    bool cleared = ch->wal && ch_load(ch, sh, page_index, &entry, true, false) == CH_SUCCESS;
+    if(cleared){
+        memset(sh->entries[entry].page, 0, PAGE_SIZE);
+    }
+    lk_unlock(&sh->lock);
+    if(cleared){
+        ch_flush_check(ch);
+    }
 }
 /**
  * @brief       Write on page
@@ -381,22 +1960,55 @@ int ch_write(caching_t* ch, int64_t page_index, void* src, size_t size, off_t of
     logger(LL_DEBUG, __func__,
            "Writing to page %ld on offset %ld, size %ld bytes.", page_index, offset, size);
 
-    void* page = NULL;
     if(page_index > ch_max_page_index(ch)){
         logger(LL_ERROR, __func__, "chunk_t index is out of range");
         return CH_FAIL;
     }
-    if(ch_load_page(ch, page_index, &page) != CH_SUCCESS){
+    ch_shard_t* sh = ch_shard(ch, page_index);
+    lk_lock(&sh->lock);
+    int64_t entry = -1;
+    int res = ch_load(ch, sh, page_index, &entry, true, false);
+    if(res == CH_SUCCESS){
+        memcpy((uint8_t*)sh->entries[entry].page + offset, src, size);
+    }
+    lk_unlock(&sh->lock);
+    if(res != CH_SUCCESS){
         return CH_FAIL;
     }
+    ch_flush_check(ch);
+    return CH_SUCCESS;
+}
 
-    memcpy((uint8_t*)page + offset, src, size);
-
-    //Increase usage
-    ch->usage_count[page_index]++;
-    time_t now;
-    ch->last_used[page_index] = time(&now);
+/**
+ * @brief       Clear page
+ * @details     Staged copy of page in flight is written before page is cleared.
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   sh: pointer to locked shard of page
+ * @param[in]   page_index: index of page
+ * @param[in]   locked: caller holds ch->lock
+ * @return      CH_SUCCESS on success, CH_FAIL otherwise
+ */
 
+static int ch_clear(caching_t* ch, ch_shard_t* sh, int64_t page_index, bool locked){
+    int64_t entry = -1;
+    if(ch_load(ch, sh, page_index, &entry, false, locked) != CH_SUCCESS){
+        logger(LL_ERROR, __func__, "Unable to load page %ld", page_index);
+        return CH_FAIL;
+    }
+    if(sh->entries[entry].flushing){
+        fls_wait(ch->flusher);
+        sh->entries[entry].flushing = 0;
+    }
+    memset(sh->entries[entry].page, 0, PAGE_SIZE);
+    if(ch->wal){
+        /* file is changed only through log */
+        ch_set_dirty(ch, sh, entry);
+        return CH_SUCCESS;
+    }
+    lk_lock(&ch->io_lock);
+    flush_page(&ch->file, sh->entries[entry].page);
+    lk_unlock(&ch->io_lock);
+    ch_set_clean(ch, sh, entry);
     return CH_SUCCESS;
 }
 
@@ -409,18 +2021,18 @@ int ch_write(caching_t* ch, int64_t page_index, void* src, size_t size, off_t of
 
 int ch_clear_page(caching_t* ch, int64_t page_index){
     logger(LL_DEBUG, __func__, "Clearing page %ld", page_index);
-    void* page = NULL;
     if(page_index > ch_max_page_index(ch)){
         logger(LL_ERROR, __func__, "chunk_t index is out of range");
         return CH_FAIL;
     }
-    if(ch_load_page(ch, page_index, &page) != CH_SUCCESS){
-        logger(LL_ERROR, __func__, "Unable to load page %ld", page_index);
-        return CH_FAIL;
+    ch_shard_t* sh = ch_shard(ch, page_index);
+    lk_lock(&sh->lock);
+    int res = ch_clear(ch, sh, page_index, false);
+    lk_unlock(&sh->lock);
+    if(res == CH_SUCCESS && ch->wal){
+        ch_flush_check(ch);
     }
-    memset(page, 0, PAGE_SIZE);
-    sync_page(page);
-    return CH_SUCCESS;
+    return res;
 }
 
 
@@ -435,83 +2047,83 @@ int ch_clear_page(caching_t* ch, int64_t page_index){
  */
 
 int ch_copy_read(caching_t* ch, int64_t page_index, void* dest, size_t size, off_t offset){
-    void* page = NULL;
-    if(ch_load_page(ch, page_index, &page) != CH_SUCCESS){
-        return CH_FAIL;
+    ch_shard_t* sh = ch_shard(ch, page_index);
+    lk_lock(&sh->lock);
+    int64_t entry = -1;
+    int res = ch_load(ch, sh, page_index, &entry, false, false);
+    if(res == CH_SUCCESS){
+        memcpy(dest, (uint8_t*)sh->entries[entry].page + offset, size);
     }
-    memcpy(dest, (uint8_t*)page + offset, size);
-
-    //Increase usage
-    ch->usage_count[page_index]++;
-    time_t now;
-    ch->last_used[page_index] = time(&now);
-
-    return CH_SUCCESS;
+    lk_unlock(&sh->lock);
+    return res == CH_SUCCESS ? CH_SUCCESS : CH_FAIL;
 }
 
 /**
  * @brief       Unsafe read from page
+ * @details     Page isn't marked dirty, it must not be modified through returned pointer.
  * @param[in]   ch: pointer to caching_t
  * @param[in]   page_index: index of page
- * @param[in]   dest: destination
  * @param[in]   offset: offset in page to read from
- * @return      CH_SUCCESS on success, CH_FAIL otherwise
+ * @return      pointer to data or NULL
  */
 
 void* ch_read(caching_t* ch, int64_t page_index, off_t offset){
-    void* page = NULL;
-    if(ch_load_page(ch, page_index, &page) != CH_SUCCESS){
-        return NULL;
-    }
-
-    //Increase usage
-    ch->usage_count[page_index]++;
-    time_t now;
-    ch->last_used[page_index] = time(&now);
-
-    return (uint8_t*)page + offset;
+    ch_shard_t* sh = ch_shard(ch, page_index);
+    lk_lock(&sh->lock);
+    int64_t entry = -1;
+    int res = ch_load(ch, sh, page_index, &entry, false, false);
+    void* page = res == CH_SUCCESS ? sh->entries[entry].page : NULL;
+    lk_unlock(&sh->lock);
+    return page ? (uint8_t*)page + offset : NULL;
 }
 
 
 uint64_t ch_begin(void){return 0;}
-uint64_t ch_end(caching_t* ch){return ch->capacity;}
+uint64_t ch_end(caching_t* ch){return (uint64_t)ch->shard_count << CH_ENTRY_BITS;}
 
-int64_t ch_nearest_cached_index(const char *flags, size_t capacity, int64_t index){
-    while (index < capacity && flags[index] != 1) {
-        index++;
-    }
-    return index;
-}
+/**
+ * @brief       Find next entry with cached page
+ * @details     Shards aren't locked, it is meant for callers which have exclusive access to cache.
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   entry: entry id to start from
+ * @return      entry id or ch_end(ch)
+ */
 
-bool ch_cached(caching_t *ch, int64_t index) {
-    return ch->flags[index] == 1;
+int64_t ch_nearest_cached_entry(caching_t* ch, int64_t entry){
+    for(uint64_t s = (uint64_t)entry >> CH_ENTRY_BITS; s < ch->shard_count; entry = (int64_t)(++s << CH_ENTRY_BITS)){
+        ch_shard_t* sh = &ch->shards[s];
+        for(size_t local = (uint64_t)entry & CH_ENTRY_MASK; local < sh->top; ++local){
+            if(sh->entries[local].flag == 1){
+                return (int64_t)(s << CH_ENTRY_BITS | local);
+            }
+        }
+    }
+    return (int64_t)ch_end(ch);
 }
 
-
-static bool ch_valid(caching_t* ch, int64_t index){
-    return  ch->flags[index] == 1 || ch->flags[index] == 2;
+int64_t ch_entry_page_index(caching_t* ch, int64_t entry){
+    uint64_t s = (uint64_t)entry >> CH_ENTRY_BITS;
+    size_t local = (uint64_t)entry & CH_ENTRY_MASK;
+    return s < ch->shard_count && local < ch->shards[s].top ? ch->shards[s].entries[local].page_index : -1;
 }
 
-static int64_t ch_nearest_valid_index(caching_t* ch, size_t capacity, int64_t index){
-    while (index < capacity && !ch_valid(ch, index)){
-        index++;
-    }
-    return index;
+bool ch_cached(caching_t *ch, int64_t index) {
+    return ch_page_status(ch, (size_t)index) == 1;
 }
 
-#define ch_for_each_valid(index, ch) for ( \
-uint64_t index = ch_nearest_valid_index(ch, ch->capacity, ch_begin());\
-(index) != ch_end(ch) && ch_valid(ch, index);                                  \
-(index)++, (index) = ch_nearest_valid_index(ch, ch->capacity, (index)) \
-)                                          \
-
 int ch_print_valid_pages(caching_t* ch){
     int counter = 0;
-    ch_for_each_valid(index, ch){
-        counter++;
-        printf("%"PRIu64"\t", index);
-        if(counter % 10 == 0){
-            printf("\n");
+    for(size_t s = 0; s < ch->shard_count; s++){
+        ch_shard_t* sh = &ch->shards[s];
+        for(size_t entry = 0; entry < sh->top; entry++){
+            if(sh->entries[entry].flag != 1 && sh->entries[entry].flag != 2){
+                continue;
+            }
+            counter++;
+            printf("%"PRId64"\t", sh->entries[entry].page_index);
+            if(counter % 10 == 0){
+                printf("\n");
+            }
         }
     }
     if(counter % 10 != 0){
@@ -524,7 +2136,7 @@ int ch_print_cached_pages(caching_t* ch){
     int counter = 0;
     ch_for_each_cached(index, ch){
         counter++;
-        printf("%"PRIu64"\t", index);
+        printf("%"PRId64"\t", index);
         if(counter % 10 == 0){
             printf("\n");
         }
@@ -537,26 +2149,47 @@ int ch_print_cached_pages(caching_t* ch){
 
 /**
  * @brief       caching destroy
+ * @details     No other thread may use cacher.
  * @param[in]   ch: pointer to caching_t
  * @return      CH_SUCCESS
  */
 
 int ch_destroy(caching_t* ch){
     logger(LL_DEBUG, __func__ , "Caching destroy");
-    ch_for_each_cached(index, ch){
-        ch_remove(ch, index);
+    bool checkpointed = !ch->wal || ch_checkpoint(ch) == CH_SUCCESS;
+    if(!checkpointed){
+        logger(LL_ERROR, __func__, "Unable to checkpoint, log is kept for recovery");
     }
-    free(ch->last_used);
-    free(ch->flags);
-    free(ch->usage_count);
-    free(ch->cached_page_ptr);
-
-    ch->size = ch->used = ch->max_used = ch->capacity = 0;
+    lk_lock(&ch->lock);
+    if(!ch->wal){
+        ch_punch(ch);
+    }
+    ch_flush_complete(ch);
+    lk_unlock(&ch->lock);
+    fls_destroy(ch->flusher);
+    ch->flusher = NULL;
+    for(size_t s = 0; s < ch->shard_count; s++){
+        ch_shard_t* sh = &ch->shards[s];
+        ch_wb_begin(ch, sh, sh->size);
+        for(size_t entry = 0; entry < sh->top; entry++){
+            if(sh->entries[entry].flag == 1){
+                ch_remove_page(ch, sh, sh->entries[entry].page_index, true);
+            }
+        }
+        ch_wb_end(ch, sh);
+        free(sh->entries);
+        free(sh->table);
+        lk_mutex_destroy(&sh->lock);
+    }
+    syn_destroy(ch->syncer);
+    ch->syncer = NULL;
+    wal_close(ch->wal, checkpointed);
+    ch->wal = NULL;
+    free(ch->punch_pages);
+    lk_mutex_destroy(&ch->lock);
+    lk_mutex_destroy(&ch->io_lock);
 
-    ch->last_used = NULL;
-    ch->flags = NULL;
-    ch->usage_count = NULL;
-    ch->cached_page_ptr = NULL;
+    ch_table_reset(ch);
 
     ch->file.cur_mmaped_data = NULL;
 
@@ -589,100 +2222,185 @@ int ch_close(caching_t* ch){
 
 
 /**
- * @brief       Find least used count
- * @param[in]   ch: pointer to caching_t
- * @return      least used count
+ * @brief       Find least recent access stamp of shard
+ * @param[in]   sh: pointer to locked shard
+ * @return      least recent value of access clock
  */
 
-uint32_t ch_find_least_used_count(caching_t* ch){
-    uint32_t min_usage = UINT32_MAX;
-    ch_for_each_cached(index, ch){
-        if(ch->usage_count[index] < min_usage){
-            min_usage = ch->usage_count[index];
+static uint64_t ch_least_used_time(ch_shard_t* sh){
+    uint64_t min_time = sh->clock;
+    for(size_t entry = 0; entry < sh->top; entry++){
+        if(sh->entries[entry].flag == 1 && sh->entries[entry].last_used < min_time){
+            min_time = sh->entries[entry].last_used;
         }
     }
-    return min_usage;
+    return min_time;
 }
 
 /**
- * @brief       Find least used time
+ * @brief       Find least recent access stamp
+ * @details     Access clocks are counted per shard, stamps of different shards aren't comparable.
  * @param[in]   ch: pointer to caching_t
- * @return      least used time
+ * @return      least recent value of access clock
  */
 
-time_t ch_find_least_used_time(caching_t* ch){
-    time_t min_time = time(NULL);
-    ch_for_each_cached(index, ch){
-        if(ch->last_used[index] < min_time){
-            min_time = ch->last_used[index];
-        }
+uint64_t ch_find_least_used_time(caching_t* ch){
+    uint64_t min_time = UINT64_MAX;
+    for(size_t s = 0; s < ch->shard_count; s++){
+        lk_lock(&ch->shards[s].lock);
+        uint64_t time = ch_least_used_time(&ch->shards[s]);
+        lk_unlock(&ch->shards[s].lock);
+        min_time = time < min_time ? time : min_time;
     }
     return min_time;
 }
 
 
-#define CH_MIN_CACHED_SIZE ((CH_MAX_MEMORY_USAGE >> 1) + (CH_MAX_MEMORY_USAGE >> 2))
-
 /**
- * @brief       Unmapping pages with smallest usage count
+ * @brief       Unmapping least recently used pages of shard
+ * @details     Pages older than a growing window of access clock ticks are unmapped
+ *              until low watermark is reached.
  * @param[in]   ch: pointer to caching_t
+ * @param[in]   sh: pointer to locked shard
  * @return      number of unmapped pages
  */
 
-uint64_t ch_unmap_some_pages(caching_t* ch){
-    logger(LL_ERROR, __func__, "chunk_t unmapping start");
+static uint64_t ch_unmap_shard(caching_t* ch, ch_shard_t* sh){
+    logger(LL_DEBUG, __func__, "chunk_t unmapping start");
     uint64_t unmap_count = 0;
-    uint64_t usage_c = 0;
-    uint64_t min_time = ch_find_least_used_time(ch);
-    double time_threshold = 2; // 2 sec
-    double execute_count = 0;
-    while (unmap_count == 0) {
-        execute_count++;
-        ch_for_each_cached(index, ch) {
-            if ((double)ch->last_used[index] < ((double)min_time + time_threshold)) {
-                if (ch_remove(ch, index) != CH_FAIL) {
+    uint64_t min_time = ch_least_used_time(sh);
+    uint64_t time_threshold = sh->size > sh->low_watermark ? sh->size - sh->low_watermark : 1;
+    while (sh->size > sh->low_watermark) {
+        for(size_t entry = 0; entry < sh->top && sh->size > sh->low_watermark; entry++){
+            ch_entry_t* e = &sh->entries[entry];
+            if (e->flag == 1 && e->last_used < min_time + time_threshold) {
+                int64_t index = e->page_index;
+                if (ch_remove_page(ch, sh, index, false) == CH_SUCCESS) {
                     logger(LL_DEBUG, __func__, "Unmapped page %ld", index);
                     unmap_count++;
                 }
             }
-            if(ch->size < CH_MIN_CACHED_SIZE){
-                break;
-            }
         }
-        time_threshold = time_threshold + pow(2, execute_count);
+        /* threshold has covered whole clock, only pinned pages are left */
+        if(min_time + time_threshold > sh->clock){
+            break;
+        }
+        time_threshold <<= 1;
+    }
+    logger(LL_DEBUG, __func__, "Unmapped %ld pages", unmap_count);
+    return unmap_count;
+}
+
+/**
+ * @brief       Unmapping least recently used pages
+ * @details     Every shard is shrunk to its low watermark.
+ * @param[in]   ch: pointer to caching_t
+ * @return      number of unmapped pages
+ */
+
+uint64_t ch_unmap_some_pages(caching_t* ch){
+    uint64_t unmap_count = 0;
+    for(size_t s = 0; s < ch->shard_count; s++){
+        lk_lock(&ch->shards[s].lock);
+        unmap_count += ch_unmap_shard(ch, &ch->shards[s]);
+        lk_unlock(&ch->shards[s].lock);
     }
-    ch_print_cached_pages(ch);
-    logger(LL_ERROR, __func__, "Unmapped %ld pages with usage %ld", unmap_count, usage_c);
     return unmap_count;
 }
 
 
 /**
- * @brief       Delete last page from file
+ * @brief       Cut deleted last page off file, caller holds ch->lock
  * @param[in]   ch: pointer to caching_t
  * @return      CH_SUCCESS on success, CH_FAIL otherwise
  */
 
-int ch_delete_last_page(caching_t* ch){
-    if(ch_file_size(ch) == 0){
-        return CH_SUCCESS;
-    }
+static int ch_cut_last_page(caching_t* ch){
     int64_t page_index = ch_max_page_index(ch);
-    if(ch->flags[page_index] != 3){
+    ch_shard_t* sh = ch_shard(ch, page_index);
+    lk_lock(&sh->lock);
+    int64_t entry = ch_lookup(sh, page_index);
+    bool deleted = entry != -1 && sh->entries[entry].flag == 3;
+    if(deleted){
+        ch_entry_release(sh, entry);
+    }
+    lk_unlock(&sh->lock);
+    if(!deleted){
         logger(LL_ERROR, __func__, "Last page is not marked as deleted");
         return CH_FAIL;
     }
     logger(LL_DEBUG, __func__, "Deleting page %ld", page_index);
-    ch->flags[page_index] = 0;
-    if(delete_last_page(&ch->file) == FILE_FAIL){
+    /* file mustn't be truncated under writes of flusher */
+    ch_flush_complete(ch);
+    lk_lock(&ch->io_lock);
+    int res = delete_last_page(&ch->file);
+    lk_unlock(&ch->io_lock);
+    if(res == FILE_FAIL){
         logger(LL_ERROR, __func__, "Unable to delete last page");
         return CH_FAIL;
     }
     return CH_SUCCESS;
 }
 
+/**
+ * @brief       Delete last page from file
+ * @details     With write-ahead log file isn't cut, page stays deleted.
+ * @param[in]   ch: pointer to caching_t
+ * @return      CH_SUCCESS on success, CH_FAIL otherwise
+ */
+
+int ch_delete_last_page(caching_t* ch){
+    if(ch_file_size(ch) == 0 || ch->wal){
+        return CH_SUCCESS;
+    }
+    lk_lock(&ch->lock);
+    int res = ch_cut_last_page(ch);
+    lk_unlock(&ch->lock);
+    return res;
+}
+
+/**
+ * @brief       Cut file to number of pages
+ * @details     Cached pages beyond new end of file are dropped, they mustn't be pinned or dirty.
+ * @param[in]   ch: pointer to caching_t
+ * @param[in]   pages: number of pages left in file
+ * @return      CH_SUCCESS on success, CH_FAIL otherwise
+ */
+
+int ch_truncate(caching_t* ch, int64_t pages){
+    if(pages > ch_max_page_index(ch)){
+        return CH_SUCCESS;
+    }
+    logger(LL_INFO, __func__, "Cutting file from %ld to %ld pages", ch_max_page_index(ch) + 1, pages);
+    lk_lock(&ch->lock);
+    int res = CH_SUCCESS;
+    for(int64_t page_index = pages; page_index <= ch_max_page_index(ch) && res == CH_SUCCESS; ++page_index){
+        ch_shard_t* sh = ch_shard(ch, page_index);
+        lk_lock(&sh->lock);
+        int64_t entry = ch_lookup(sh, page_index);
+        if(entry != -1 && sh->entries[entry].flag == 3){
+            ch_entry_release(sh, entry);
+        }
+        else if(entry != -1 && (sh->entries[entry].dirty || ch_remove_page(ch, sh, page_index, false) != CH_SUCCESS)){
+            logger(LL_ERROR, __func__, "Page %ld beyond new end of file is in use", page_index);
+            res = CH_FAIL;
+        }
+        lk_unlock(&sh->lock);
+    }
+    if(res == CH_SUCCESS){
+        ch_flush_complete(ch);
+        lk_lock(&ch->io_lock);
+        res = fl_truncate(&ch->file, fl_page_offset((uint64_t)pages)) == FILE_FAIL ? CH_FAIL : CH_SUCCESS;
+        lk_unlock(&ch->io_lock);
+    }
+    lk_unlock(&ch->lock);
+    return res;
+}
+
 /**
  * @brief       Mark page as deleted
+ * @details     The last page is cut off, disk blocks of other pages are released later
+ *              if hole punching is on.
  * @param[in]   ch: pointer to caching_t
  * @param       page_index: index of page
  * @return      CH_SUCCESS on success, CH_FAIL otherwise
@@ -698,16 +2416,29 @@ int ch_delete_page(caching_t* ch, int64_t page_index){
         return CH_FAIL;
     }
     logger(LL_DEBUG, __func__, "Deleting page %ld", page_index);
-    ch_clear_page(ch, page_index);
-    if(ch_remove(ch, page_index) == CH_FAIL){ // Remove page from cache
+    lk_lock(&ch->lock);
+    ch_shard_t* sh = ch_shard(ch, page_index);
+    lk_lock(&sh->lock);
+    /* with write-ahead log committed page stays in file until deletion is committed */
+    if(!ch->wal){
+        ch_clear(ch, sh, page_index, true);
+    }
+    int res = CH_SUCCESS;
+    if(ch_remove_page(ch, sh, page_index, true) == CH_FAIL){ // Remove page from cache
         logger(LL_ERROR, __func__, "Unable to remove page %ld from cache", page_index);
-        return CH_FAIL;
+        res = CH_FAIL;
     }
-    ch->flags[page_index] = 3; // Mark page as deleted
-    if(page_index == ch_max_page_index(ch)){
-        ch_delete_last_page(ch);
+    else if(ch_entry_create(sh, page_index, 3) == CH_FAIL){ // Mark page as deleted
+        logger(LL_ERROR, __func__, "Unable to mark page %ld as deleted", page_index);
+        res = CH_FAIL;
     }
-    return CH_SUCCESS;
+    lk_unlock(&sh->lock);
+    if(res == CH_SUCCESS && page_index == ch_max_page_index(ch) && !ch->wal){
+        ch_cut_last_page(ch);
+    }
+    else if(res == CH_SUCCESS && ch->punch_holes){
+        ch_punch_later(ch, page_index);
+    }
+    lk_unlock(&ch->lock);
+    return res;
 }
-
-
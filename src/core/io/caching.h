@@ -1,33 +1,182 @@
 #pragma once
 
 #include "file.h"
+#include "syncer.h"
+#include "wal.h"
+#include "utils/lock.h"
+#include <stdatomic.h>
 
-#if __linux__
-#include <bits/types/time_t.h>
-#endif
-
-enum CH_Status {CH_SUCCESS = 0, CH_FAIL = -1, CH_DELETED = -2};
+enum CH_Status {CH_SUCCESS = 0, CH_FAIL = -1, CH_DELETED = -2, CH_PINNED = -3};
 #define KB (1024u)
 #define MB (1024u * KB)
 #define GB (1024u * MB)
 
-#define CH_MAX_MEMORY_USAGE  (50*PAGE_SIZE)
+/* Default cache budget in bytes, can be overridden by CH_BUDGET_ENV or ch_options_t.budget */
+#ifndef CH_MAX_MEMORY_USAGE
+#define CH_MAX_MEMORY_USAGE  (64*MB)
+#endif
+/* Default low watermark: percent of budget left cached after eviction */
+#ifndef CH_LOW_WATERMARK
+#define CH_LOW_WATERMARK 75
+#endif
+#define CH_MIN_BUDGET_PAGES 4
+#define CH_BUDGET_ENV "LLP_CACHE_BUDGET"
+
+/**
+ * Page replacement policy.
+ * CH_POLICY_DEFAULT - CH_DEFAULT_POLICY
+ * CH_POLICY_LEGACY - least recently used scan over all cached pages (ch_unmap_some_pages)
+ * CH_POLICY_2Q     - 2Q: FIFO A1in for new pages, ghost FIFO A1out of pages evicted from A1in,
+ *                    LRU Am for pages referenced again after leaving A1in. Victim selection is O(1).
+ */
+typedef enum ch_policy {CH_POLICY_DEFAULT = 0, CH_POLICY_LEGACY = 1, CH_POLICY_2Q = 2} ch_policy_t;
+
+#ifndef CH_DEFAULT_POLICY
+#define CH_DEFAULT_POLICY CH_POLICY_2Q
+#endif
 
+/* Readahead of scans: tracked streams and window bounds in pages */
+#ifndef CH_RA_STREAMS
+#define CH_RA_STREAMS 8
+#endif
+#ifndef CH_RA_MIN
+#define CH_RA_MIN 4
+#endif
+#ifndef CH_RA_MAX
+#define CH_RA_MAX 256
+#endif
+
+/* Write-back of dirty pages: batch is started when that many pages are dirty, pages written
+ * less than CH_FLUSH_AGE page writes ago are left for later, batch is limited to CH_FLUSH_MAX pages */
+#ifndef CH_FLUSH_BATCH
+#define CH_FLUSH_BATCH 256
+#endif
+#ifndef CH_FLUSH_AGE
+#define CH_FLUSH_AGE 64
+#endif
+#ifndef CH_FLUSH_MAX
+#define CH_FLUSH_MAX 1024
+#endif
+
+/* Deleted pages are punched out of file when that many are gathered and on commit */
+#ifndef CH_PUNCH_BATCH
+#define CH_PUNCH_BATCH 256
+#endif
+
+/* Cache is split into shards by page index, each shard has its own lock, page table and queues.
+ * Cache gets a shard for every CH_SHARD_MIN_PAGES pages of budget, up to CH_SHARDS shards */
+#ifndef CH_SHARDS
+#define CH_SHARDS 16
+#endif
+#ifndef CH_SHARD_MIN_PAGES
+#define CH_SHARD_MIN_PAGES 1024
+#endif
+
+enum CH_Queue {CH_Q_NONE = 0, CH_Q_A1IN = 1, CH_Q_A1OUT = 2, CH_Q_AM = 3};
+
+/* Intrusive list of entries, links are stored in ch_entry_t.prev/next */
+typedef struct ch_list{
+    int64_t head;
+    int64_t tail;
+    size_t size;
+} ch_list_t;
+
+typedef struct ch_options{
+    fl_options_t file;
+    ch_policy_t policy;
+    size_t budget;              /* cache budget in bytes, 0 - default */
+    uint8_t low_watermark;      /* percent of budget, 0 - default */
+    syn_options_t sync;         /* durability */
+    bool wal;                   /* write-ahead log, file is changed only by logged pages, implies FL_BACKEND_PREAD */
+    bool punch_holes;           /* disk blocks of deleted pages are released */
+} ch_options_t;
+
+/* Scan stream, it is identified by the last page it has visited */
+typedef struct ch_ra_stream{
+    int64_t last;               /* last visited page, -1 if stream is free */
+    int64_t ahead;              /* first page which wasn't read ahead */
+    size_t window;              /* readahead depth in pages */
+    uint64_t used;              /* stream clock stamp, for replacement */
+} ch_ra_stream_t;
+
+/* Dirty page handed to flusher, it becomes clean if it wasn't written again until batch is done */
+typedef struct ch_dirty_page{
+    int64_t page_index;
+    uint64_t dirtied;
+} ch_dirty_page_t;
+
+/* Page table entry of tracked page (cached, remembered by 2Q or deleted) */
+typedef struct ch_entry{
+    int64_t page_index;
+    void* page;
+    int64_t prev, next;         /* queue links, next is also free list link */
+    uint64_t last_used;         /* legacy policy: access clock stamp */
+    char flag;
+    char queue;
+    uint8_t referenced;         /* 2Q reference bit */
+    uint32_t pins;              /* pinned page is never evicted */
+    uint8_t kept;               /* one of pins is held by ch_keep till page is deleted */
+    uint8_t dirty;              /* page was modified since it was read or written back */
+    uint8_t flushing;           /* staged copy of page is being written by flusher */
+    uint64_t dirtied;           /* dirty clock stamp of last modification */
+    uint64_t logged;            /* dirty clock stamp of page image in log */
+    off_t spilled;              /* offset of image in log of page evicted before commit */
+} ch_entry_t;
+
+/* Part of cache, its fields are guarded by its lock */
+typedef struct ch_shard{
+    lk_mutex_t lock;
+    size_t size;                            /* cached pages */
+    size_t used, capacity, top;             /* live, allocated and ever used entries */
+    size_t max_used;                        /* live entries before page table growth */
+    ch_entry_t* entries;
+    int64_t free_entry;
+    int64_t* table;                         /* open addressing page index -> entry, -1 empty */
+    size_t table_mask;
+    size_t high_watermark, low_watermark;   /* pages */
+    uint64_t clock;                         /* logical access clock */
+    ch_list_t a1in, a1out, am;
+    void** wb_pages;                        /* evicted pages waiting for batched write-back */
+    size_t wb_count, wb_capacity;
+} ch_shard_t;
+
+/**
+ * Cacher is safe to use from several threads. Locks are taken in order
+ * lock -> shard lock -> io_lock, no thread holds two shard locks except hole punching,
+ * which takes them in order of shards.
+ */
 typedef struct caching{
     file_t file;
-    size_t size, used, max_used, capacity;
-    uint32_t* usage_count;
-    time_t* last_used;
-    void** cached_page_ptr;
-    char* flags;
+    ch_shard_t shards[CH_SHARDS];
+    size_t shard_count;
+    size_t budget;                          /* bytes */
+    size_t high_watermark, low_watermark;   /* pages of all shards */
+    uint8_t low_watermark_pct;
+    ch_policy_t policy;
+    lk_mutex_t lock;                        /* write-back, commit, readahead and hole punching */
+    lk_mutex_t io_lock;                     /* mapping of pages */
+    ch_ra_stream_t ra[CH_RA_STREAMS];
+    uint64_t ra_clock;
+    atomic_size_t dirty;                    /* dirty cached pages */
+    _Atomic uint64_t dirty_clock;           /* page modifications */
+    _Atomic uint64_t flush_clock;           /* dirty clock of last write-back batch */
+    atomic_bool flush_pending;              /* batch is in flight */
+    struct flusher* flusher;                /* background write-back, started with first batch */
+    ch_dirty_page_t* flush_pages;           /* pages of batch in flight */
+    size_t flush_count;
+    syncer_t* syncer;
+    wal_t* wal;                             /* write-ahead log or NULL */
+    bool punch_holes;
+    int64_t* punch_pages;                   /* deleted pages waiting for hole punching */
+    size_t punch_count, punch_capacity;
 } caching_t;
 
 
 
 #define ch_for_each_cached(index, ch) for ( \
-int64_t index = ch_nearest_cached_index((ch)->flags, ch->capacity, ch_begin());\
-(index) != ch_end(ch) && ch_cached(ch, index);                                  \
-(index)++, (index) = ch_nearest_cached_index(ch->flags, ch->capacity, (index)) \
+int64_t index##_entry = ch_nearest_cached_entry((ch), ch_begin()), index = ch_entry_page_index((ch), index##_entry); \
+(uint64_t)(index##_entry) != ch_end(ch);                                                                           \
+index##_entry = ch_nearest_cached_entry((ch), index##_entry + 1), index = ch_entry_page_index((ch), index##_entry) \
 )                                \
 
 off_t ch_file_size(caching_t* ch);
@@ -41,8 +190,12 @@ uint64_t ch_number_pages(caching_t* ch);
 uint64_t ch_page_index(off_t page_offset);
 off_t ch_page_offset(uint64_t page_index);
 int ch_init(const char* file_name, caching_t* ch);
+int ch_init_opt(const char* file_name, caching_t* ch, const ch_options_t* opt);
+int ch_set_budget(caching_t* ch, size_t budget);
+size_t ch_budget(caching_t* ch);
 size_t ch_size(caching_t* ch);
 size_t ch_used(caching_t* ch);
+size_t ch_capacity(caching_t* ch);
 void* ch_cached_page(caching_t* ch, size_t index);
 size_t ch_usage_memory_space(caching_t* ch);
 int ch_page_status(caching_t* ch, size_t index);
@@ -52,7 +205,17 @@ void* ch_get(caching_t* ch, int64_t page_index);
 int ch_remove(caching_t* ch, int64_t index);
 int64_t ch_new_page(caching_t* ch);
 int ch_load_page(caching_t* ch, int64_t page_index, void** page);
+int ch_mark_dirty(caching_t* ch, int64_t page_index);
+int64_t ch_flush(caching_t* ch, bool wait);
+int ch_commit(caching_t* ch);
+int ch_checkpoint(caching_t* ch);
+int64_t ch_prefetch(caching_t* ch, const int64_t* pages, size_t count);
+void ch_readahead(caching_t* ch, int64_t prev_page, int64_t page_index);
 void ch_use_again(caching_t* ch, int64_t page_index);
+int ch_pin(caching_t* ch, int64_t page_index);
+int ch_unpin(caching_t* ch, int64_t page_index);
+int ch_keep(caching_t* ch, int64_t page_index);
+bool ch_pinned(caching_t* ch, int64_t page_index);
 int ch_write(caching_t* ch, int64_t page_index, void* src, size_t size, off_t offset);
 int ch_clear_page(caching_t* ch, int64_t page_index);
 int ch_copy_read(caching_t* ch, int64_t page_index, void* dest, size_t size, off_t offset);
@@ -62,13 +225,15 @@ uint64_t ch_end(caching_t* ch);
 int ch_destroy(caching_t* ch);
 int ch_delete(caching_t* ch);
 int ch_close(caching_t* ch);
-uint32_t ch_find_least_used_count(caching_t* ch);
-time_t ch_find_least_used_time(caching_t* ch);
+uint64_t ch_find_least_used_time(caching_t* ch);
 uint64_t ch_unmap_some_pages(caching_t* ch);
 int ch_delete_last_page(caching_t* ch);
+int ch_truncate(caching_t* ch, int64_t pages);
 int ch_delete_page(caching_t* ch, int64_t page_index);
 bool ch_cached(caching_t *ch, int64_t index);
-int64_t ch_nearest_cached_index(const char *flags, size_t capacity, int64_t index);
+int64_t ch_nearest_cached_entry(caching_t* ch, int64_t entry);
+int64_t ch_entry_page_index(caching_t* ch, int64_t entry);
+ch_entry_t* ch_find_entry(caching_t* ch, int64_t page_index);
 int ch_print_cached_pages(caching_t* ch);
 int ch_print_valid_pages(caching_t* ch);
 
@@ -1,4 +1,8 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
 #include "file.h"
+#include "io_engine.h"
 #include "utils/logger.h"
 #include <fcntl.h>
 #include <inttypes.h>
@@ -42,45 +46,545 @@ int ftruncate(int fd, off_t i);
 
 
 /**
- * @brief Get the size of a file.
+ * @brief Get the size of a file on disk.
  *
- * This function takes a file_t structure and retrieves the size of the file
- * associated with it. It internally uses the stat() system call to obtain the size.
+ * It internally uses the fstat() system call to obtain the size.
  *
  * @param file A pointer to a file_t structure representing the file.
  * @return The size of the file in bytes.
- * @note This function assumes that the specified file exists and has valid permissions.
  */
-off_t fl_file_size(file_t* file) {
+static off_t fl_stat_size(file_t* file) {
     struct stat st;
-    stat(file->filename, &st);
+    if(fstat(file->fd, &st) == -1){
+        return -1;
+    }
     return st.st_size;
 }
 
 /**
- * @brief       File initialization
+ * @brief Get the size of a file.
+ *
+ * File is grown by extents, so the size on disk may be bigger, this function returns
+ * the logical end of file used by pages.
+ *
+ * @param file A pointer to a file_t structure representing the file.
+ * @return The size of the file in bytes.
+ */
+off_t fl_file_size(file_t* file) {
+    return file->file_size;
+}
+
+/**
+ * @brief       Allocate file space up to need bytes
+ * @details     File grows by step equal to its size bounded by grow_min and grow_max,
+ *              fallocate is used when it is supported by file system.
+ * @param[in]   file: pointer to file_t
+ * @param[in]   need: required size
+ * @return      FILE_SUCCESS on success, FILE_FAIL otherwise
+ */
+
+static int fl_grow(file_t* file, off_t need){
+    if(need <= file->phys_size){
+        return FILE_SUCCESS;
+    }
+    size_t step = (size_t)file->phys_size;
+    step = step < file->grow_min ? file->grow_min : step > file->grow_max ? file->grow_max : step;
+    step = (step + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+    off_t new_size = file->phys_size + (off_t)step;
+    if(new_size < need){
+        new_size = need;
+    }
+    logger(LL_DEBUG, __func__, "Growing file %s: %ld -> %ld", file->filename, file->phys_size, new_size);
+#if defined(__linux__)
+    if(fallocate(file->fd, 0, file->phys_size, new_size - file->phys_size) == -1)
+#endif
+    {
+        if(ftruncate(file->fd, new_size) == -1){
+            logger(LL_ERROR, __func__, "Unable change file size: %s %d", strerror(errno), errno);
+            return FILE_FAIL;
+        }
+    }
+    file->phys_size = new_size;
+    return FILE_SUCCESS;
+}
+
+/**
+ * @brief       Zero file range, allocation is kept
+ * @param[in]   file: pointer to file_t
+ * @param[in]   offset: offset of range
+ * @param[in]   size: size of range
+ * @return      FILE_SUCCESS on success, FILE_FAIL otherwise
+ */
+
+static int fl_zero_range(file_t* file, off_t offset, off_t size){
+#if defined(__linux__)
+    if(fallocate(file->fd, FALLOC_FL_ZERO_RANGE | FALLOC_FL_KEEP_SIZE, offset, size) == 0){
+        return FILE_SUCCESS;
+    }
+#endif
+    static const uint8_t zeros[4096] __attribute__((aligned(4096)));
+    for(off_t done = 0; done < size;){
+        size_t len = (size_t)(size - done) < sizeof(zeros) ? (size_t)(size - done) : sizeof(zeros);
+        ssize_t written = pwrite(file->fd, zeros, len, offset + done);
+        if(written == -1){
+            logger(LL_ERROR, __func__, "Unable zero file range: %s %d", strerror(errno), errno);
+            return FILE_FAIL;
+        }
+        done += written;
+    }
+    return FILE_SUCCESS;
+}
+
+/**
+ * @brief       Map anonymous range aligned to huge page size
+ * @param[in]   size: size of range
+ * @param[in]   prot: protection of range
+ * @param[in]   flags: mmap flags
+ * @return      address of range or MAP_FAILED
+ */
+
+static void* fl_map_aligned(size_t size, int prot, int flags){
+    size_t span = size + FL_HUGE_PAGE_SIZE;
+    uint8_t* raw = mmap(NULL, span, prot, flags, -1, 0);
+    if(raw == MAP_FAILED){
+        return MAP_FAILED;
+    }
+    uint8_t* base = (uint8_t*)(((uintptr_t)raw + FL_HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(FL_HUGE_PAGE_SIZE - 1));
+    if(base > raw){
+        munmap(raw, (size_t)(base - raw));
+    }
+    size_t tail = (size_t)((raw + span) - (base + size));
+    if(tail){
+        munmap(base + size, tail);
+    }
+    return base;
+}
+
+/**
+ * @brief       Ask kernel to back range with transparent huge pages
+ * @param[in]   addr: address of range
+ * @param[in]   size: size of range
+ * @return      true if advice was accepted
+ */
+
+static bool fl_advise_huge(void* addr, size_t size){
+#if defined(MADV_HUGEPAGE)
+    if(madvise(addr, size, MADV_HUGEPAGE) == -1){
+        logger(LL_DEBUG, __func__, "Huge pages aren't supported for %p: %s %d", addr, strerror(errno), errno);
+        return false;
+    }
+    return true;
+#else
+    (void)addr;
+    (void)size;
+    return false;
+#endif
+}
+
+#define FL_EXTENT_BYTE(ext)  ((ext) >> 3)
+#define FL_EXTENT_BIT(ext)   (1u << ((ext) & 7))
+
+/**
+ * @brief       Reserve virtual range for extent mapping
+ * @param[in]   file: pointer to file_t
+ * @param[in]   size: bytes to reserve
+ * @return      FILE_SUCCESS on success, FILE_FAIL otherwise
+ */
+
+static int fl_reserve(file_t* file, size_t size){
+    size = (size + FL_EXTENT_SIZE - 1) / FL_EXTENT_SIZE * FL_EXTENT_SIZE;
+    void* base = fl_map_aligned(size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE);
+    if(base == MAP_FAILED){
+        logger(LL_WARN, __func__, "Unable to reserve %zu bytes: %s %d.", size, strerror(errno), errno);
+        return FILE_FAIL;
+    }
+    file->ext_mapped = calloc(FL_EXTENT_BYTE(size / FL_EXTENT_SIZE) + 1, 1);
+    if(!file->ext_mapped){
+        munmap(base, size);
+        return FILE_FAIL;
+    }
+    file->ext_base = base;
+    file->ext_reserved = size;
+    return FILE_SUCCESS;
+}
+
+/**
+ * @brief       Extend reservation in place
+ * @details     Reservation can't be moved because pointers to mapped pages are held by callers,
+ *              so only the range right after it is tried.
+ * @param[in]   file: pointer to file_t
+ * @param[in]   size: minimal new reservation size
+ * @return      FILE_SUCCESS on success, FILE_FAIL otherwise
+ */
+
+static int fl_extend_reserve(file_t* file, size_t size){
+    size_t new_reserved = file->ext_reserved;
+    while(new_reserved < size){
+        new_reserved <<= 1;
+    }
+    size_t add = new_reserved - file->ext_reserved;
+    uint8_t* hint = file->ext_base + file->ext_reserved;
+    void* tail = mmap(hint, add, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if(tail == MAP_FAILED){
+        return FILE_FAIL;
+    }
+    if(tail != hint){
+        munmap(tail, add);
+        return FILE_FAIL;
+    }
+    uint8_t* new_mapped = realloc(file->ext_mapped, FL_EXTENT_BYTE(new_reserved / FL_EXTENT_SIZE) + 1);
+    if(!new_mapped){
+        munmap(tail, add);
+        return FILE_FAIL;
+    }
+    size_t old_bytes = FL_EXTENT_BYTE(file->ext_reserved / FL_EXTENT_SIZE) + 1;
+    memset(new_mapped + old_bytes, 0, FL_EXTENT_BYTE(new_reserved / FL_EXTENT_SIZE) + 1 - old_bytes);
+    file->ext_mapped = new_mapped;
+    file->ext_reserved = new_reserved;
+    logger(LL_DEBUG, __func__, "Reservation extended to %zu bytes", new_reserved);
+    return FILE_SUCCESS;
+}
+
+/**
+ * @brief       Check if address belongs to extent mapping
+ * @param[in]   file: pointer to file_t
+ * @param[in]   addr: address
+ * @return      true if address is inside reserved range
+ */
+
+bool fl_in_extent(file_t* file, void* addr){
+    return file->ext_base && (uint8_t*)addr >= file->ext_base && (uint8_t*)addr < file->ext_base + file->ext_reserved;
+}
+
+/**
+ * @brief       Get number of bytes of extents and frame pool backed by huge pages
+ * @details     Kernel may ignore huge page advice, so actual state is read from /proc/self/smaps.
+ * @param[in]   file: pointer to file_t
+ * @return      bytes backed by huge pages, 0 if it is unknown
+ */
+
+size_t fl_huge_bytes(file_t* file){
+    FILE* smaps = fopen("/proc/self/smaps", "r");
+    if(!smaps){
+        return 0;
+    }
+    uintptr_t ranges[2][2] = {
+            {(uintptr_t)file->ext_base, (uintptr_t)file->ext_base + file->ext_reserved},
+            {(uintptr_t)file->pool, (uintptr_t)file->pool + file->pool_size},
+    };
+    static const char* const fields[] = {
+            "AnonHugePages:", "ShmemPmdMapped:", "FilePmdMapped:", "Shared_Hugetlb:", "Private_Hugetlb:"
+    };
+    size_t total = 0;
+    bool inside = false;
+    char line[256];
+    while(fgets(line, sizeof(line), smaps)){
+        uintptr_t start, end;
+        if(sscanf(line, "%" SCNxPTR "-%" SCNxPTR " ", &start, &end) == 2){
+            inside = false;
+            for(size_t i = 0; i < 2; ++i){
+                inside |= ranges[i][0] != ranges[i][1] && start < ranges[i][1] && end > ranges[i][0];
+            }
+            continue;
+        }
+        if(!inside){
+            continue;
+        }
+        for(size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); ++i){
+            size_t len = strlen(fields[i]);
+            if(strncmp(line, fields[i], len) == 0){
+                total += strtoull(line + len, NULL, 10) * 1024;
+            }
+        }
+    }
+    fclose(smaps);
+    return total;
+}
+
+/**
+ * @brief       Get page address from extent mapping, mapping extent if needed
+ * @param[in]   file: pointer to file_t
+ * @param[in]   offset: offset of page in file
+ * @return      page address or NULL if offset can't be served by extent mapping
+ */
+
+static void* fl_extent_page(file_t* file, off_t offset){
+    if((size_t)offset + PAGE_SIZE > file->ext_reserved && fl_extend_reserve(file, (size_t)offset + PAGE_SIZE) == FILE_FAIL){
+        return NULL;
+    }
+    size_t ext = (size_t)offset / FL_EXTENT_SIZE;
+    if(!(file->ext_mapped[FL_EXTENT_BYTE(ext)] & FL_EXTENT_BIT(ext))){
+        uint8_t* addr = file->ext_base + ext * FL_EXTENT_SIZE;
+        if(mmap(addr, FL_EXTENT_SIZE, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_FIXED, file->fd, (off_t)(ext * FL_EXTENT_SIZE)) == MAP_FAILED){
+            logger(LL_ERROR, __func__ , "Unable to map extent %zu: %s %d.", ext, strerror(errno), errno);
+            return NULL;
+        }
+        if(file->huge_pages){
+            fl_advise_huge(addr, FL_EXTENT_SIZE);
+        }
+        file->ext_mapped[FL_EXTENT_BYTE(ext)] |= FL_EXTENT_BIT(ext);
+        logger(LL_DEBUG, __func__, "Extent %zu mapped on address %p", ext, addr);
+    }
+    return file->ext_base + offset;
+}
+
+/**
+ * @brief       Read or write whole buffer at offset
+ * @param[in]   file: pointer to file_t
+ * @param[in]   buf: buffer
+ * @param[in]   size: size of buffer
+ * @param[in]   offset: offset in file
+ * @param[in]   write: true for pwrite, false for pread
+ * @return      number of bytes transferred, it is less than size only on end of file, -1 on error
+ */
+
+static ssize_t fl_pio(file_t* file, void* buf, size_t size, off_t offset, bool write){
+    size_t done = 0;
+    while(done < size){
+        ssize_t res = write ? pwrite(file->fd, (uint8_t*)buf + done, size - done, offset + (off_t)done)
+                            : pread(file->fd, (uint8_t*)buf + done, size - done, offset + (off_t)done);
+        if(res == -1){
+            if(errno == EINTR){
+                continue;
+            }
+            logger(LL_ERROR, __func__, "Unable to %s file at %ld: %s %d",
+                   write ? "write" : "read", offset, strerror(errno), errno);
+            return -1;
+        }
+        if(res == 0){
+            break;
+        }
+        done += (size_t)res;
+    }
+    return (ssize_t)done;
+}
+
+/**
+ * @brief       Allocate frame pool
+ * @details     Pool is anonymous mapping, so frames are aligned for O_DIRECT and
+ *              memory is committed only for frames which were used. With huge pages
+ *              hugetlb pages are tried first, then transparent huge pages are requested.
+ * @param[in]   file: pointer to file_t
+ * @param[in]   frames: number of frames
+ * @return      FILE_SUCCESS on success, FILE_FAIL otherwise
+ */
+
+static int fl_pool_init(file_t* file, size_t frames){
+    size_t size = frames * PAGE_SIZE;
+    void* pool = MAP_FAILED;
+    fl_huge_t huge = FL_HUGE_NONE;
+#if defined(MAP_HUGETLB)
+    if(file->huge_pages){
+        size_t huge_size = (size + FL_HUGE_PAGE_SIZE - 1) / FL_HUGE_PAGE_SIZE * FL_HUGE_PAGE_SIZE;
+        pool = mmap(NULL, huge_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if(pool != MAP_FAILED){
+            size = huge_size;
+            huge = FL_HUGE_TLB;
+        }
+        else{
+            logger(LL_DEBUG, __func__, "Hugetlb pages are unavailable: %s %d.", strerror(errno), errno);
+        }
+    }
+#endif
+    if(pool == MAP_FAILED){
+        pool = fl_map_aligned(size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE);
+        if(pool == MAP_FAILED){
+            logger(LL_ERROR, __func__, "Unable to allocate pool of %zu frames: %s %d.", frames, strerror(errno), errno);
+            return FILE_FAIL;
+        }
+        if(file->huge_pages && fl_advise_huge(pool, size)){
+            huge = FL_HUGE_ADVISED;
+        }
+    }
+    file->frame_offset = malloc(frames * sizeof(off_t));
+    file->free_frames = malloc(frames * sizeof(uint32_t));
+    if(!file->frame_offset || !file->free_frames){
+        free(file->frame_offset);
+        free(file->free_frames);
+        munmap(pool, size);
+        return FILE_FAIL;
+    }
+    for(size_t i = 0; i < frames; ++i){
+        file->frame_offset[i] = -1;
+        file->free_frames[i] = (uint32_t)(frames - 1 - i);
+    }
+    file->pool = pool;
+    file->pool_frames = frames;
+    file->pool_size = size;
+    file->pool_huge = huge;
+    file->free_count = frames;
+    return FILE_SUCCESS;
+}
+
+/**
+ * @brief       Get number of frames in pool
+ * @param[in]   file: pointer to file_t
+ * @return      number of frames, 0 if file is not served by frame pool
+ */
+
+size_t fl_pool_frames(file_t* file){
+    return file->backend == FL_BACKEND_PREAD ? file->pool_frames : 0;
+}
+
+/**
+ * @brief       Take free frame for page
+ * @details     Recently released frames are taken first, so touched part of pool
+ *              stays close to the cache budget.
+ * @param[in]   file: pointer to file_t
+ * @param[in]   offset: offset of page in file
+ * @return      frame or NULL if pool is exhausted
+ */
+
+static void* fl_frame_alloc(file_t* file, off_t offset){
+    if(file->free_count == 0){
+        logger(LL_ERROR, __func__, "Frame pool of %zu frames is exhausted.", file->pool_frames);
+        return NULL;
+    }
+    uint32_t frame = file->free_frames[--file->free_count];
+    file->frame_offset[frame] = offset;
+    return file->pool + (size_t)frame * PAGE_SIZE;
+}
+
+/**
+ * @brief       Get frame number of address
+ * @param[in]   file: pointer to file_t
+ * @param[in]   addr: address
+ * @return      frame number or -1 if address is not a frame of pool
+ */
+
+static int64_t fl_frame(file_t* file, void* addr){
+    if(!file->pool || (uint8_t*)addr < file->pool || (uint8_t*)addr >= file->pool + file->pool_frames * PAGE_SIZE){
+        return -1;
+    }
+    return ((uint8_t*)addr - file->pool) / PAGE_SIZE;
+}
+
+/**
+ * @brief       Write frame back to file
+ * @param[in]   file: pointer to file_t
+ * @param[in]   frame: frame number
+ * @return      FILE_SUCCESS on success, FILE_FAIL otherwise
+ */
+
+static int fl_frame_write(file_t* file, int64_t frame){
+    off_t offset = file->frame_offset[frame];
+    if(offset < 0 || offset >= file->file_size){
+        return FILE_SUCCESS;
+    }
+    if(fl_pio(file, file->pool + (size_t)frame * PAGE_SIZE, PAGE_SIZE, offset, true) != PAGE_SIZE){
+        return FILE_FAIL;
+    }
+    return FILE_SUCCESS;
+}
+
+/**
+ * @brief       Return frame to pool
+ * @param[in]   file: pointer to file_t
+ * @param[in]   frame: frame number
+ */
+
+static void fl_frame_free(file_t* file, int64_t frame){
+    file->frame_offset[frame] = -1;
+    file->free_frames[file->free_count++] = (uint32_t)frame;
+}
+
+/**
+ * @brief       Open file descriptor
+ * @details     O_DIRECT isn't supported by some file systems (tmpfs), file is opened without it then.
+ * @param[in]   file: pointer to file_t
+ * @param[in]   direct: try to open with O_DIRECT
+ * @return      file descriptor or -1 on error
+ */
+
+static int fl_open(file_t* file, bool direct){
+    int flags = O_RDWR | O_CREAT;
+#if defined(__linux__)
+    if(direct){
+        int fd = open(file->filename, flags | O_DIRECT, S_IWUSR | S_IRUSR);
+        if(fd != -1){
+            file->direct = true;
+            return fd;
+        }
+        logger(LL_WARN, __func__, "Unable to open file with O_DIRECT: %s %d.", strerror(errno), errno);
+    }
+#else
+    (void)direct;
+#endif
+    return open(file->filename,
+                flags, // Read/Write mode, create file if it does not exist
+                S_IWUSR | // User write permission
+                S_IRUSR // User read permission
+    );
+}
+
+/**
+ * @brief       File initialization with default options
  * @param[in]   filename: name of file
  * @param[out]  file: pointer to file_t
  * @return      FILE_SUCCESS on success, FILE_FAIL otherwise
  */
 
 int init_file(const char* file_name, file_t* file){
+    return init_file_opt(file_name, file, NULL);
+}
+
+/**
+ * @brief       File initialization
+ * @param[in]   filename: name of file
+ * @param[out]  file: pointer to file_t
+ * @param[in]   opt: file options or NULL for defaults
+ * @return      FILE_SUCCESS on success, FILE_FAIL otherwise
+ */
+
+int init_file_opt(const char* file_name, file_t* file, const fl_options_t* opt){
     file->filename = (char*)malloc(strlen(file_name)+1);
     strncpy(file->filename, file_name, strlen(file_name)+1);
     logger(LL_DEBUG, __func__ ,"Opening file %s.", file->filename);
-    file->fd = open(file->filename,
-                           O_RDWR | // Read/Write mode
-                           O_CREAT, // Create file if it does not exist
-                           S_IWUSR | // User write permission
-                           S_IRUSR // User read permission
-    );
+    file->backend = opt && opt->backend != FL_BACKEND_DEFAULT ? opt->backend : FL_DEFAULT_BACKEND;
+    file->direct = false;
+    file->fd = fl_open(file, file->backend == FL_BACKEND_PREAD && opt && opt->direct);
     if (file->fd == -1){
         logger(LL_ERROR, __func__ ,"Unable to open file.");
         return FILE_FAIL;
     }
-    file->file_size = fl_file_size(file);
+    file->file_size = file->phys_size = fl_stat_size(file);
     file->max_page_index = fl_max_page_index();
     file->cur_page_offset = 0;
+    file->cur_mmaped_data = NULL;
+    file->grow_min = opt && opt->grow_min ? opt->grow_min : FL_GROW_MIN;
+    file->grow_max = opt && opt->grow_max ? opt->grow_max : FL_GROW_MAX;
+    if(file->grow_max < file->grow_min){
+        file->grow_max = file->grow_min;
+    }
+    file->map_mode = opt && opt->map_mode != FL_MAP_DEFAULT ? opt->map_mode : FL_DEFAULT_MAP_MODE;
+    file->ext_base = NULL;
+    file->ext_mapped = NULL;
+    file->ext_reserved = 0;
+    file->huge_pages = opt && opt->huge_pages;
+    file->pool = NULL;
+    file->pool_frames = file->pool_size = 0;
+    file->pool_huge = FL_HUGE_NONE;
+    file->frame_offset = NULL;
+    file->free_frames = NULL;
+    file->free_count = 0;
+    file->ioe = NULL;
+    if(file->backend == FL_BACKEND_PREAD){
+        if(fl_pool_init(file, opt && opt->frames ? opt->frames : FL_POOL_FRAMES) == FILE_FAIL){
+            close(file->fd);
+            return FILE_FAIL;
+        }
+    }
+    else if(file->map_mode == FL_MAP_EXTENT){
+        size_t reserve = opt && opt->reserve ? opt->reserve : FL_RESERVE_SIZE;
+        if(reserve < (size_t)file->file_size){
+            reserve = (size_t)file->file_size;
+        }
+        if(fl_reserve(file, reserve) == FILE_FAIL){
+            logger(LL_WARN, __func__, "Falling back to page mapping.");
+            file->map_mode = FL_MAP_PAGE;
+        }
+    }
 //    if(fl_file_size(file) != 0){
 //        if(mmap_page(file->cur_page_offset, file) == FILE_FAIL){
 //            logger(LL_ERROR, __func__, "Unable map file");
@@ -103,6 +607,29 @@ int mmap_page(off_t offset, file_t* file){
     if(file->file_size == 0){
         return FILE_FAIL;
     }
+    if(file->backend == FL_BACKEND_PREAD){
+        void* frame = fl_frame_alloc(file, offset);
+        if(frame == NULL){
+            return FILE_FAIL;
+        }
+        ssize_t got = fl_pio(file, frame, PAGE_SIZE, offset, false);
+        if(got == -1){
+            fl_frame_free(file, fl_frame(file, frame));
+            return FILE_FAIL;
+        }
+        memset((uint8_t*)frame + got, 0, PAGE_SIZE - (size_t)got);
+        file->cur_mmaped_data = frame;
+        file->cur_page_offset = offset;
+        return FILE_SUCCESS;
+    }
+    if(file->map_mode == FL_MAP_EXTENT){
+        void* page = fl_extent_page(file, offset);
+        if(page != NULL){
+            file->cur_mmaped_data = page;
+            file->cur_page_offset = offset;
+            return FILE_SUCCESS;
+        }
+    }
     if((file->cur_mmaped_data = mmap(NULL, PAGE_SIZE,
                                             PROT_WRITE |
                                             PROT_READ,
@@ -151,22 +678,56 @@ int sync_page(void* mmaped_data){
     return FILE_SUCCESS;
 }
 
+/**
+ * @brief       Write page back to file
+ * @details     Frame of pool is written by pwrite, mapped page is synchronized by msync.
+ * @param[in]   file: pointer to file_t
+ * @param[in]   mmaped_data: pointer to page
+ * @return      FILE_SUCCESS on success, FILE_FAIL otherwise
+ */
+
+int flush_page(file_t* file, void* mmaped_data){
+    int64_t frame = fl_frame(file, mmaped_data);
+    if(frame != -1){
+        return fl_frame_write(file, frame);
+    }
+    return sync_page(mmaped_data);
+}
+
 /**
  * @brief       Unmap page
+ * @details     Page of extent mapping stays mapped, its frame is only released to the kernel.
+ *              Frame of pool is returned to pool.
  * @param[in]   mmaped_data: pointer to mapped data
  * @param[in]   file: pointer to file_t
+ * @param[in]   write_back: write frame back or synchronize separately mapped page
  * @return      FILE_SUCCESS on success, FILE_FAIL otherwise
  */
 
-int unmap_page(void** mmaped_data, file_t* file){
+static int fl_unmap(void** mmaped_data, file_t* file, bool write_back){
+    int64_t frame = fl_frame(file, *mmaped_data);
+    if(frame != -1){
+        int res = write_back ? fl_frame_write(file, frame) : FILE_SUCCESS;
+        fl_frame_free(file, frame);
+        *mmaped_data = NULL;
+        return res;
+    }
     if(file->file_size == 0){
         return FILE_SUCCESS;
     }
+    if(fl_in_extent(file, *mmaped_data)){
+        if(madvise(*mmaped_data, PAGE_SIZE, MADV_DONTNEED) == -1){
+            logger(LL_ERROR, __func__, "Unable release page with pointer %p: %s %d.", *mmaped_data, strerror(errno), errno);
+            return FILE_FAIL;
+        }
+        *mmaped_data = NULL;
+        return FILE_SUCCESS;
+    }
 
     logger(LL_DEBUG, __func__,
            "Unmapping page from file with pointer %p and file size %" PRIu64,
            mmaped_data, file->file_size);
-    if(sync_page(*mmaped_data) == FILE_FAIL){
+    if(write_back && sync_page(*mmaped_data) == FILE_FAIL){
         return FILE_FAIL;
     }
     if(munmap(*mmaped_data, PAGE_SIZE) == -1){
@@ -178,12 +739,324 @@ int unmap_page(void** mmaped_data, file_t* file){
 }
 
 /**
- * @brief       Close file
+ * @brief       Unmap page, frame of pool is written back and mapped page is synchronized
+ * @param[in]   mmaped_data: pointer to mapped data
+ * @param[in]   file: pointer to file_t
+ * @return      FILE_SUCCESS on success, FILE_FAIL otherwise
+ */
+
+int unmap_page(void** mmaped_data, file_t* file){
+    return fl_unmap(mmaped_data, file, true);
+}
+
+/**
+ * @brief       Unmap page which wasn't modified, nothing is written
+ * @param[in]   mmaped_data: pointer to mapped data
+ * @param[in]   file: pointer to file_t
+ * @return      FILE_SUCCESS on success, FILE_FAIL otherwise
+ */
+
+int release_page(void** mmaped_data, file_t* file){
+    return fl_unmap(mmaped_data, file, false);
+}
+
+/**
+ * @brief       Write range of file back
+ * @details     Only descriptor of file is used, so it is safe to call while other thread works
+ *              with file. Without buffer writeback of file cache is started for the range.
+ * @param[in]   file: pointer to file_t
+ * @param[in]   buf: data to write or NULL
+ * @param[in]   size: size of range
+ * @param[in]   offset: offset of range
+ * @return      FILE_SUCCESS on success, FILE_FAIL otherwise
+ */
+
+int fl_write_back(file_t* file, const void* buf, size_t size, off_t offset){
+    if(buf){
+        return fl_pio(file, (void*)buf, size, offset, true) == (ssize_t)size ? FILE_SUCCESS : FILE_FAIL;
+    }
+#if defined(__linux__)
+    if(sync_file_range(file->fd, offset, (off_t)size, SYNC_FILE_RANGE_WRITE) == -1){
+        logger(LL_ERROR, __func__, "Unable to write back range at %ld: %s %d", offset, strerror(errno), errno);
+        return FILE_FAIL;
+    }
+#endif
+    return FILE_SUCCESS;
+}
+
+/**
+ * @brief       Make data of file durable
+ * @details     Only descriptor of file is used, so it is safe to call while other thread works with file.
+ * @param[in]   file: pointer to file_t
+ * @return      FILE_SUCCESS on success, FILE_FAIL otherwise
+ */
+
+int fl_sync(file_t* file){
+#if defined(__APPLE__)
+    int res = fsync(file->fd);
+#else
+    int res = fdatasync(file->fd);
+#endif
+    if(res == -1){
+        logger(LL_ERROR, __func__, "Unable to sync file: %s %d", strerror(errno), errno);
+        return FILE_FAIL;
+    }
+    return FILE_SUCCESS;
+}
+
+/**
+ * @brief       Read range of file bypassing pages
+ * @param[in]   file: pointer to file_t
+ * @param[out]  buf: destination
+ * @param[in]   size: size of range
+ * @param[in]   offset: offset of range
+ * @return      FILE_SUCCESS if whole range was read, FILE_FAIL otherwise
+ */
+
+int fl_read_at(file_t* file, void* buf, size_t size, off_t offset){
+    return fl_pio(file, buf, size, offset, false) == (ssize_t)size ? FILE_SUCCESS : FILE_FAIL;
+}
+
+/**
+ * @brief       Cut or extend file to size
+ * @details     Preallocated tail is dropped too, so file is never truncated again on close.
+ * @param[in]   file: pointer to file_t
+ * @param[in]   size: new size
+ * @return      FILE_SUCCESS on success, FILE_FAIL otherwise
+ */
+
+int fl_truncate(file_t* file, off_t size){
+    if(ftruncate(file->fd, size) == -1){
+        logger(LL_ERROR, __func__, "Unable change file size: %s %d", strerror(errno), errno);
+        return FILE_FAIL;
+    }
+    file->file_size = file->phys_size = size;
+    file->max_page_index = fl_max_page_index();
+    return FILE_SUCCESS;
+}
+
+/**
+ * @brief       Release disk blocks of file range
+ * @details     Range reads as zeros afterwards, file size is kept.
+ * @param[in]   file: pointer to file_t
+ * @param[in]   offset: offset of range
+ * @param[in]   size: size of range
+ * @return      FILE_SUCCESS on success, FILE_FAIL if file system doesn't support it
+ */
+
+int fl_punch_hole(file_t* file, off_t offset, off_t size){
+#if defined(__linux__)
+    if(fallocate(file->fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset, size) == 0){
+        return FILE_SUCCESS;
+    }
+    logger(LL_WARN, __func__, "Unable to punch hole: %s %d", strerror(errno), errno);
+#else
+    (void)file;
+    (void)offset;
+    (void)size;
+#endif
+    return FILE_FAIL;
+}
+
+/**
+ * @brief       Get disk space allocated to file
+ * @param[in]   file: pointer to file_t
+ * @return      allocated bytes or -1
+ */
+
+off_t fl_disk_size(file_t* file){
+    struct stat st;
+    if(fstat(file->fd, &st) == -1){
+        return -1;
+    }
+    return (off_t)st.st_blocks * 512;
+}
+
+/**
+ * @brief       Hint kernel to read range of file ahead
+ * @details     Range of extent mapping is advised by madvise, sequential range is marked by
+ *              MADV_SEQUENTIAL for whole extents to avoid splitting mappings. Otherwise posix_fadvise
+ *              is used, nothing is done for O_DIRECT file because page cache is bypassed.
+ * @param[in]   file: pointer to file_t
+ * @param[in]   offset: offset of range
+ * @param[in]   size: size of range
+ * @param[in]   sequential: range is read sequentially
+ * @return      FILE_SUCCESS on success, FILE_FAIL otherwise
+ */
+
+int fl_readahead(file_t* file, off_t offset, off_t size, bool sequential){
+    if(offset >= file->file_size || size <= 0){
+        return FILE_SUCCESS;
+    }
+    if(offset + size > file->file_size){
+        size = file->file_size - offset;
+    }
+    if(file->backend == FL_BACKEND_PREAD && file->direct){
+        return FILE_SUCCESS;
+    }
+    if(file->backend != FL_BACKEND_PREAD && file->map_mode == FL_MAP_EXTENT){
+        size_t first = (size_t)offset / FL_EXTENT_SIZE;
+        size_t last = (size_t)(offset + size - 1) / FL_EXTENT_SIZE;
+        bool mapped = true;
+        for(size_t ext = first; ext <= last && mapped; ++ext){
+            mapped = fl_extent_page(file, (off_t)(ext * FL_EXTENT_SIZE)) != NULL;
+        }
+        if(mapped){
+            if(sequential){
+                madvise(file->ext_base + first * FL_EXTENT_SIZE, (last - first + 1) * FL_EXTENT_SIZE, MADV_SEQUENTIAL);
+            }
+            if(madvise(file->ext_base + offset, (size_t)size, MADV_WILLNEED) == -1){
+                logger(LL_DEBUG, __func__, "Unable to advise range: %s %d", strerror(errno), errno);
+                return FILE_FAIL;
+            }
+            return FILE_SUCCESS;
+        }
+    }
+#if defined(__linux__)
+    if(sequential){
+        posix_fadvise(file->fd, offset, size, POSIX_FADV_SEQUENTIAL);
+    }
+    int res = posix_fadvise(file->fd, offset, size, POSIX_FADV_WILLNEED);
+    if(res != 0){
+        logger(LL_DEBUG, __func__, "Unable to advise range: %s %d", strerror(res), res);
+        return FILE_FAIL;
+    }
+#else
+    (void)sequential;
+#endif
+    return FILE_SUCCESS;
+}
+
+/**
+ * @brief       Get I/O engine of file, it is created on first use
+ * @param[in]   file: pointer to file_t
+ * @return      pointer to io_engine_t or NULL on failure
+ */
+
+static io_engine_t* fl_ioe(file_t* file){
+    if(!file->ioe){
+        file->ioe = ioe_init(file->fd);
+        if(file->ioe){
+            logger(LL_DEBUG, __func__, "Using %s I/O engine", ioe_name(file->ioe));
+        }
+    }
+    return file->ioe;
+}
+
+/**
+ * @brief       Map batch of pages
+ * @details     Frames are read by one batch of I/O engine, mapped pages are advised to be read ahead.
+ *              Pages are mapped until frame pool is exhausted.
+ * @param[in]   file: pointer to file_t
+ * @param[in]   offsets: offsets of pages
+ * @param[out]  pages: pointers to pages, NULL for pages which failed
+ * @param[in]   count: number of pages
+ * @return      number of processed pages
+ */
+
+size_t fl_map_pages(file_t* file, const off_t* offsets, void** pages, size_t count){
+    if(file->backend != FL_BACKEND_PREAD){
+        for(size_t i = 0; i < count; ++i){
+            pages[i] = NULL;
+            if(mmap_page(offsets[i], file) == FILE_SUCCESS){
+                pages[i] = file->cur_mmaped_data;
+                madvise(pages[i], PAGE_SIZE, MADV_WILLNEED);
+            }
+        }
+        return count;
+    }
+    ioe_req_t* reqs = malloc(count * sizeof(ioe_req_t));
+    io_engine_t* ioe = fl_ioe(file);
+    if(!reqs || !ioe){
+        free(reqs);
+        return 0;
+    }
+    size_t n = 0;
+    for(; n < count && file->free_count; ++n){
+        pages[n] = fl_frame_alloc(file, offsets[n]);
+        reqs[n] = (ioe_req_t){.buf = pages[n], .size = PAGE_SIZE, .offset = offsets[n], .write = false};
+    }
+    ioe_submit(ioe, reqs, n);
+    for(size_t i = 0; i < n; ++i){
+        if(reqs[i].res < 0){
+            fl_frame_free(file, fl_frame(file, pages[i]));
+            pages[i] = NULL;
+            continue;
+        }
+        memset((uint8_t*)pages[i] + reqs[i].res, 0, PAGE_SIZE - (size_t)reqs[i].res);
+    }
+    free(reqs);
+    return n;
+}
+
+/**
+ * @brief       Unmap batch of pages
+ * @details     Frames are written back by one batch of I/O engine.
+ * @param[in]   file: pointer to file_t
+ * @param[in]   pages: pointers to pages, they are set to NULL
+ * @param[in]   count: number of pages
+ * @return      FILE_SUCCESS on success, FILE_FAIL if any page failed
+ */
+
+int fl_unmap_pages(file_t* file, void** pages, size_t count){
+    int res = FILE_SUCCESS;
+    ioe_req_t* reqs = file->backend == FL_BACKEND_PREAD ? malloc(count * sizeof(ioe_req_t)) : NULL;
+    io_engine_t* ioe = reqs ? fl_ioe(file) : NULL;
+    size_t n = 0;
+    for(size_t i = 0; i < count; ++i){
+        int64_t frame = ioe ? fl_frame(file, pages[i]) : -1;
+        if(frame == -1){
+            if(unmap_page(&pages[i], file) == FILE_FAIL){
+                res = FILE_FAIL;
+            }
+            continue;
+        }
+        if(file->frame_offset[frame] >= 0 && file->frame_offset[frame] < file->file_size){
+            reqs[n++] = (ioe_req_t){.buf = pages[i], .size = PAGE_SIZE, .offset = file->frame_offset[frame], .write = true};
+        }
+    }
+    if(ioe && ioe_submit(ioe, reqs, n) == IOE_FAIL){
+        res = FILE_FAIL;
+    }
+    for(size_t i = 0; ioe && i < count; ++i){
+        int64_t frame = fl_frame(file, pages[i]);
+        if(frame != -1){
+            fl_frame_free(file, frame);
+            pages[i] = NULL;
+        }
+    }
+    free(reqs);
+    return res;
+}
+
+/**
+ * @brief       Close file, preallocated tail is released
  * @param[in]   file: pointer to file_t
  * @return      FILE_SUCCESS on success, FILE_FAIL otherwise
  */
 
 int close_file(file_t* file){
+    if(file->phys_size > file->file_size && ftruncate(file->fd, file->file_size) == -1){
+        logger(LL_WARN, __func__, "Unable to release preallocated space: %s %d", strerror(errno), errno);
+    }
+    if(file->ext_base){
+        munmap(file->ext_base, file->ext_reserved);
+        free(file->ext_mapped);
+        file->ext_base = NULL;
+        file->ext_mapped = NULL;
+        file->ext_reserved = 0;
+    }
+    ioe_destroy(file->ioe);
+    file->ioe = NULL;
+    if(file->pool){
+        munmap(file->pool, file->pool_size);
+        free(file->frame_offset);
+        free(file->free_frames);
+        file->pool = NULL;
+        file->frame_offset = NULL;
+        file->free_frames = NULL;
+        file->pool_frames = file->free_count = 0;
+    }
     close(file->fd);
     file->fd = -1;
     free(file->filename);
@@ -225,14 +1098,23 @@ int init_page(file_t* file){
         return FILE_FAIL;
     }
 
-    if(ftruncate(file->fd,  (off_t) (file->file_size + PAGE_SIZE)) == -1){
-        logger(LL_ERROR, __func__, "Unable change file size: %s %d", strerror(errno), errno);
+    if(fl_grow(file, file->file_size + PAGE_SIZE) == FILE_FAIL){
         return FILE_FAIL;
     }
     file->file_size += PAGE_SIZE;
     ++file->max_page_index;
 
     file->cur_page_offset = file->file_size - PAGE_SIZE;
+    if(file->backend == FL_BACKEND_PREAD){
+        /* new page is zeroed in file, there is nothing to read */
+        void* frame = fl_frame_alloc(file, file->cur_page_offset);
+        if(frame == NULL){
+            return FILE_FAIL;
+        }
+        memset(frame, 0, PAGE_SIZE);
+        file->cur_mmaped_data = frame;
+        return FILE_SUCCESS;
+    }
     if(mmap_page(file->cur_page_offset, file) == FILE_FAIL){
         logger(LL_ERROR, __func__, "Unable to mmap file.");
     }
@@ -241,6 +1123,8 @@ int init_page(file_t* file){
 
 /**
  * @brief       Delete last page in file
+ * @details     Page stays allocated and is zeroed, file is truncated only when
+ *              preallocated tail becomes bigger than maximal growth step.
  * @param[in]   file: pointer to file_t
  * @return      FILE_SUCCESS on success, FILE_FAIL otherwise
  */
@@ -250,11 +1134,18 @@ int delete_last_page(file_t* file){
         return FILE_SUCCESS;
     }
     logger(LL_DEBUG, __func__ , "Starting delete page %ld", fl_page_index(file->file_size - PAGE_SIZE));
-    if(ftruncate(file->fd,  (off_t) (file->file_size - PAGE_SIZE)) == -1){
-        logger(LL_ERROR, __func__, "Unable change file size: %s %d", strerror(errno), errno);
+    off_t new_size = file->file_size - PAGE_SIZE;
+    if(file->phys_size - new_size > (off_t)file->grow_max){
+        if(ftruncate(file->fd, new_size) == -1){
+            logger(LL_ERROR, __func__, "Unable change file size: %s %d", strerror(errno), errno);
+            return FILE_FAIL;
+        }
+        file->phys_size = new_size;
+    }
+    else if(fl_zero_range(file, new_size, PAGE_SIZE) == FILE_FAIL){
         return FILE_FAIL;
     }
-    file->file_size -= PAGE_SIZE;
+    file->file_size = new_size;
     --file->max_page_index;
     return FILE_SUCCESS;
 }
@@ -366,6 +1257,106 @@ static int open_handles(file_t* file){
     return FILE_SUCCESS;
 }
 
+/**
+ * @brief       File initialization, only page mapping is supported
+ * @param[in]   filename: name of file
+ * @param[out]  file: pointer to file_t
+ * @param[in]   opt: ignored
+ * @return      FILE_SUCCESS on success, FILE_FAIL otherwise
+ */
+
+int init_file_opt(const char* file_name, file_t* file, const fl_options_t* opt){
+    (void)opt;
+    return init_file(file_name, file);
+}
+
+bool fl_in_extent(file_t* file, void* addr){
+    (void)file;
+    (void)addr;
+    return false;
+}
+
+size_t fl_pool_frames(file_t* file){
+    (void)file;
+    return 0;
+}
+
+size_t fl_huge_bytes(file_t* file){
+    (void)file;
+    return 0;
+}
+
+int fl_readahead(file_t* file, off_t offset, off_t size, bool sequential){
+    (void)file;
+    (void)offset;
+    (void)size;
+    (void)sequential;
+    return FILE_SUCCESS;
+}
+
+int flush_page(file_t* file, void* mmaped_data){
+    (void)file;
+    return sync_page(mmaped_data);
+}
+
+size_t fl_map_pages(file_t* file, const off_t* offsets, void** pages, size_t count){
+    for(size_t i = 0; i < count; ++i){
+        pages[i] = mmap_page(offsets[i], file) == FILE_SUCCESS ? file->cur_mmaped_data : NULL;
+    }
+    return count;
+}
+
+int fl_unmap_pages(file_t* file, void** pages, size_t count){
+    int res = FILE_SUCCESS;
+    for(size_t i = 0; i < count; ++i){
+        if(unmap_page(&pages[i], file) == FILE_FAIL){
+            res = FILE_FAIL;
+        }
+    }
+    return res;
+}
+
+int release_page(void** mmaped_data, file_t* file){
+    return unmap_page(mmaped_data, file);
+}
+
+int fl_sync(file_t* file){
+    return FlushFileBuffers(file->h_file) ? FILE_SUCCESS : FILE_FAIL;
+}
+
+int fl_read_at(file_t* file, void* buf, size_t size, off_t offset){
+    (void)file;
+    (void)buf;
+    (void)size;
+    (void)offset;
+    return FILE_FAIL;
+}
+
+int fl_truncate(file_t* file, off_t size){
+    (void)file;
+    (void)size;
+    return FILE_FAIL;
+}
+
+int fl_punch_hole(file_t* file, off_t offset, off_t size){
+    (void)file;
+    (void)offset;
+    (void)size;
+    return FILE_FAIL;
+}
+
+off_t fl_disk_size(file_t* file){
+    return fl_file_size(file);
+}
+
+int fl_write_back(file_t* file, const void* buf, size_t size, off_t offset){
+    (void)file;
+    (void)buf;
+    (void)size;
+    (void)offset;
+    return FILE_SUCCESS;
+}
+
 /**
  * \brief       File initialization
  * \param[in]   filename: name of file
@@ -10,6 +10,75 @@
 #include <string.h>
 #include <sys/stat.h>
 
+/**
+ * Mapping mode.
+ * FL_MAP_DEFAULT - FL_DEFAULT_MAP_MODE
+ * FL_MAP_PAGE   - every page is mapped by its own mmap call
+ * FL_MAP_EXTENT - virtual range is reserved once, file is mapped into it by FL_EXTENT_SIZE extents,
+ *                 page address is base + offset. Pages outside of reservation fall back to FL_MAP_PAGE.
+ */
+typedef enum fl_map_mode {FL_MAP_DEFAULT = 0, FL_MAP_PAGE = 1, FL_MAP_EXTENT = 2} fl_map_mode_t;
+
+#ifndef FL_DEFAULT_MAP_MODE
+#define FL_DEFAULT_MAP_MODE FL_MAP_EXTENT
+#endif
+#ifndef FL_EXTENT_SIZE
+#define FL_EXTENT_SIZE (4 * 1024 * 1024)
+#endif
+/* Initial virtual range reservation, it is extended in place when file grows beyond it */
+#ifndef FL_RESERVE_SIZE
+#define FL_RESERVE_SIZE (UINTPTR_MAX > UINT32_MAX ? (size_t)64 << 30 : (size_t)256 << 20)
+#endif
+
+/**
+ * I/O backend.
+ * FL_BACKEND_DEFAULT - FL_DEFAULT_BACKEND
+ * FL_BACKEND_MMAP    - pages are mapped views of file
+ * FL_BACKEND_PREAD   - pages are read to frames of preallocated aligned pool by pread and
+ *                      written back by pwrite, file can be opened with O_DIRECT
+ */
+typedef enum fl_backend {FL_BACKEND_DEFAULT = 0, FL_BACKEND_MMAP = 1, FL_BACKEND_PREAD = 2} fl_backend_t;
+
+#ifndef FL_DEFAULT_BACKEND
+#define FL_DEFAULT_BACKEND FL_BACKEND_MMAP
+#endif
+/* Default number of frames in pool of FL_BACKEND_PREAD */
+#ifndef FL_POOL_FRAMES
+#define FL_POOL_FRAMES 65536
+#endif
+
+/* Huge page size, reserved range and frame pool are aligned to it */
+#ifndef FL_HUGE_PAGE_SIZE
+#define FL_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+#endif
+
+/* File growth step bounds, step doubles with file size from FL_GROW_MIN up to FL_GROW_MAX */
+#ifndef FL_GROW_MIN
+#define FL_GROW_MIN (1024 * 1024)
+#endif
+#ifndef FL_GROW_MAX
+#define FL_GROW_MAX (64 * 1024 * 1024)
+#endif
+
+/**
+ * Huge page backing of frame pool.
+ * FL_HUGE_NONE    - pool is backed by base pages
+ * FL_HUGE_ADVISED - kernel accepted transparent huge page advice, it may still use base pages
+ * FL_HUGE_TLB     - pool is mapped from hugetlb pages
+ */
+typedef enum fl_huge {FL_HUGE_NONE = 0, FL_HUGE_ADVISED = 1, FL_HUGE_TLB = 2} fl_huge_t;
+
+typedef struct fl_options{
+    fl_map_mode_t map_mode;
+    size_t reserve;             /* bytes of virtual range to reserve, 0 - default */
+    size_t grow_min;            /* minimal growth step in bytes, 0 - default */
+    size_t grow_max;            /* maximal growth step in bytes, 0 - default, grow_min == grow_max gives fixed step */
+    fl_backend_t backend;
+    size_t frames;              /* frames in pool of FL_BACKEND_PREAD, 0 - default */
+    bool direct;                /* open file with O_DIRECT, FL_BACKEND_PREAD only */
+    bool huge_pages;            /* back extents and frame pool with huge pages when possible */
+} fl_options_t;
+
 #if defined(_WIN32)
 #define PAGE_SIZE 65536
 #include <windows.h>
@@ -35,8 +104,25 @@ typedef struct file {
     int fd;
     void *cur_mmaped_data;
     off_t cur_page_offset;
-    off_t file_size;
+    off_t file_size;            /* logical end of file */
+    off_t phys_size;            /* allocated size of file */
+    size_t grow_min, grow_max;
     int64_t max_page_index;
+    fl_map_mode_t map_mode;
+    uint8_t* ext_base;          /* reserved virtual range */
+    size_t ext_reserved;        /* bytes reserved */
+    uint8_t* ext_mapped;        /* mapped extents bitmap */
+    fl_backend_t backend;
+    bool huge_pages;
+    bool direct;                /* file is opened with O_DIRECT */
+    uint8_t* pool;              /* frames of FL_BACKEND_PREAD */
+    size_t pool_frames;
+    size_t pool_size;           /* bytes mapped for pool */
+    fl_huge_t pool_huge;        /* huge page backing pool got */
+    off_t* frame_offset;        /* file offset of page in frame, -1 if frame is free */
+    uint32_t* free_frames;      /* stack of free frames, recently used frames are reused first */
+    size_t free_count;
+    struct io_engine* ioe;      /* batched I/O of frames, created on first use */
 } file_t;
 #endif
 
@@ -52,12 +138,27 @@ int64_t fl_current_page_index(file_t* file);
 
 
 int init_file(const char* file_name, file_t* file);
+int init_file_opt(const char* file_name, file_t* file, const fl_options_t* opt);
+bool fl_in_extent(file_t* file, void* addr);
+size_t fl_huge_bytes(file_t* file);
+int fl_readahead(file_t* file, off_t offset, off_t size, bool sequential);
 int close_file(file_t* file);
 int delete_file(file_t* file);
 int mmap_page(off_t offset, file_t* file);
 int map_page_on_addr(off_t offset, file_t* file, void* addr);
 int sync_page(void* mmaped_data);
+int flush_page(file_t* file, void* mmaped_data);
+size_t fl_map_pages(file_t* file, const off_t* offsets, void** pages, size_t count);
+int fl_unmap_pages(file_t* file, void** pages, size_t count);
+size_t fl_pool_frames(file_t* file);
 int unmap_page(void** mmaped_data, file_t* file);
+int release_page(void** mmaped_data, file_t* file);
+int fl_write_back(file_t* file, const void* buf, size_t size, off_t offset);
+int fl_sync(file_t* file);
+int fl_read_at(file_t* file, void* buf, size_t size, off_t offset);
+int fl_truncate(file_t* file, off_t size);
+int fl_punch_hole(file_t* file, off_t offset, off_t size);
+off_t fl_disk_size(file_t* file);
 int init_page(file_t* file);
 int delete_last_page(file_t* file);
 int write_page(file_t* file, void* src, uint64_t size, off_t offset);
@@ -0,0 +1,220 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "flusher.h"
+#include "utils/logger.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__) || defined(__APPLE__) || defined(__unix__)
+#include <pthread.h>
+
+struct flusher{
+    file_t* file;
+    pthread_t thread;
+    bool started;               /* batches are written by caller if thread couldn't be started */
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t done;
+    fls_run_t* runs;            /* current batch, NULL if flusher is idle */
+    size_t count;
+    void* buffer;
+    int status;                 /* status of last finished batch */
+    bool stop;
+};
+
+/**
+ * @brief       Write batch and release it
+ * @param[in]   file: pointer to file_t
+ * @param[in]   runs: runs of batch
+ * @param[in]   count: number of runs
+ * @param[in]   buffer: staged pages
+ * @return      FLS_SUCCESS if every run was written, FLS_FAIL otherwise
+ */
+
+static int fls_write(file_t* file, fls_run_t* runs, size_t count, void* buffer){
+    int status = FLS_SUCCESS;
+    for(size_t i = 0; i < count; ++i){
+        if(fl_write_back(file, runs[i].buf, runs[i].size, runs[i].offset) == FILE_FAIL){
+            logger(LL_ERROR, __func__, "Unable to write back %zu bytes at %ld", runs[i].size, runs[i].offset);
+            status = FLS_FAIL;
+        }
+    }
+    free(runs);
+    free(buffer);
+    return status;
+}
+
+static void* fls_worker(void* arg){
+    flusher_t* fls = arg;
+    pthread_mutex_lock(&fls->lock);
+    while(true){
+        while(!fls->runs && !fls->stop){
+            pthread_cond_wait(&fls->work, &fls->lock);
+        }
+        if(!fls->runs){
+            break;
+        }
+        fls_run_t* runs = fls->runs;
+        size_t count = fls->count;
+        void* buffer = fls->buffer;
+        pthread_mutex_unlock(&fls->lock);
+        int status = fls_write(fls->file, runs, count, buffer);
+        pthread_mutex_lock(&fls->lock);
+        fls->status = status;
+        fls->runs = NULL;
+        fls->buffer = NULL;
+        fls->count = 0;
+        pthread_cond_broadcast(&fls->done);
+    }
+    pthread_mutex_unlock(&fls->lock);
+    return NULL;
+}
+
+/**
+ * @brief       Create flusher of file
+ * @details     Flusher owns one thread, it writes batches of dirty page runs while caller goes on.
+ *              If thread can't be started, batches are written by caller.
+ * @param[in]   file: pointer to file_t
+ * @return      pointer to flusher_t or NULL on failure
+ */
+
+flusher_t* fls_init(file_t* file){
+    flusher_t* fls = calloc(1, sizeof(flusher_t));
+    if(!fls){
+        return NULL;
+    }
+    fls->file = file;
+    fls->status = FLS_SUCCESS;
+    pthread_mutex_init(&fls->lock, NULL);
+    pthread_cond_init(&fls->work, NULL);
+    pthread_cond_init(&fls->done, NULL);
+    if(pthread_create(&fls->thread, NULL, fls_worker, fls) != 0){
+        logger(LL_WARN, __func__, "Unable to start flusher thread: %s, writing synchronously", strerror(errno));
+    }
+    else{
+        fls->started = true;
+    }
+    return fls;
+}
+
+/**
+ * @brief       Hand batch to flusher, previous batch is waited for
+ * @details     Flusher takes ownership of runs and buffer, they are freed after write.
+ * @param[in]   fls: pointer to flusher_t
+ * @param[in]   runs: runs of batch, allocated by malloc
+ * @param[in]   count: number of runs
+ * @param[in]   buffer: staged pages referenced by runs, allocated by malloc, may be NULL
+ * @return      FLS_SUCCESS on success, FLS_FAIL if batch was written synchronously and failed
+ */
+
+int fls_submit(flusher_t* fls, fls_run_t* runs, size_t count, void* buffer){
+    if(!fls->started){
+        fls->status = fls_write(fls->file, runs, count, buffer);
+        return fls->status;
+    }
+    pthread_mutex_lock(&fls->lock);
+    while(fls->runs){
+        pthread_cond_wait(&fls->done, &fls->lock);
+    }
+    fls->runs = runs;
+    fls->count = count;
+    fls->buffer = buffer;
+    pthread_cond_signal(&fls->work);
+    pthread_mutex_unlock(&fls->lock);
+    return FLS_SUCCESS;
+}
+
+bool fls_busy(flusher_t* fls){
+    if(!fls->started){
+        return false;
+    }
+    pthread_mutex_lock(&fls->lock);
+    bool busy = fls->runs != NULL;
+    pthread_mutex_unlock(&fls->lock);
+    return busy;
+}
+
+/**
+ * @brief       Wait until flusher is idle
+ * @param[in]   fls: pointer to flusher_t
+ * @return      status of last batch
+ */
+
+int fls_wait(flusher_t* fls){
+    if(!fls->started){
+        return fls->status;
+    }
+    pthread_mutex_lock(&fls->lock);
+    while(fls->runs){
+        pthread_cond_wait(&fls->done, &fls->lock);
+    }
+    int status = fls->status;
+    pthread_mutex_unlock(&fls->lock);
+    return status;
+}
+
+/**
+ * @brief       Destroy flusher, batch in flight is finished
+ * @param[in]   fls: pointer to flusher_t
+ */
+
+void fls_destroy(flusher_t* fls){
+    if(!fls){
+        return;
+    }
+    if(fls->started){
+        pthread_mutex_lock(&fls->lock);
+        fls->stop = true;
+        pthread_cond_signal(&fls->work);
+        pthread_mutex_unlock(&fls->lock);
+        pthread_join(fls->thread, NULL);
+    }
+    pthread_mutex_destroy(&fls->lock);
+    pthread_cond_destroy(&fls->work);
+    pthread_cond_destroy(&fls->done);
+    free(fls);
+}
+
+#else
+
+struct flusher{
+    file_t* file;
+    int status;
+};
+
+flusher_t* fls_init(file_t* file){
+    flusher_t* fls = calloc(1, sizeof(flusher_t));
+    if(fls){
+        fls->file = file;
+    }
+    return fls;
+}
+
+int fls_submit(flusher_t* fls, fls_run_t* runs, size_t count, void* buffer){
+    fls->status = FLS_SUCCESS;
+    for(size_t i = 0; i < count; ++i){
+        if(fl_write_back(fls->file, runs[i].buf, runs[i].size, runs[i].offset) == FILE_FAIL){
+            fls->status = FLS_FAIL;
+        }
+    }
+    free(runs);
+    free(buffer);
+    return fls->status;
+}
+
+bool fls_busy(flusher_t* fls){
+    (void)fls;
+    return false;
+}
+
+int fls_wait(flusher_t* fls){
+    return fls->status;
+}
+
+void fls_destroy(flusher_t* fls){
+    free(fls);
+}
+
+#endif
@@ -0,0 +1,22 @@
+#pragma once
+#include "file.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Run of adjacent dirty pages written by one request */
+typedef struct fls_run{
+    off_t offset;
+    size_t size;
+    const void* buf;            /* staged copy of pages or NULL to write back file cache of range */
+} fls_run_t;
+
+typedef struct flusher flusher_t;
+
+typedef enum {FLS_SUCCESS = 0, FLS_FAIL = -1} fls_status_t;
+
+flusher_t* fls_init(file_t* file);
+int fls_submit(flusher_t* fls, fls_run_t* runs, size_t count, void* buffer);
+bool fls_busy(flusher_t* fls);
+int fls_wait(flusher_t* fls);
+void fls_destroy(flusher_t* fls);
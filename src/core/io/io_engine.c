@@ -0,0 +1,267 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "io_engine.h"
+#include "utils/logger.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__) || defined(__APPLE__) || defined(__unix__)
+#include <pthread.h>
+#include <unistd.h>
+#if defined(HAVE_LIBURING)
+#include <liburing.h>
+#endif
+
+struct io_engine{
+    int fd;
+#if defined(HAVE_LIBURING)
+    bool uring;
+    struct io_uring ring;
+#endif
+    pthread_t threads[IOE_THREADS];
+    size_t nthreads;
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t done;
+    ioe_req_t* reqs;            /* current batch */
+    size_t count;
+    size_t next;                /* next request to take */
+    size_t finished;
+    bool stop;
+};
+
+/**
+ * @brief       Finish request synchronously
+ * @details     Used for requests of fallback engine and for short transfers of io_uring.
+ * @param[in]   fd: file descriptor
+ * @param[in]   req: request, res holds bytes already transferred
+ */
+
+static void ioe_complete_sync(int fd, ioe_req_t* req){
+    size_t done = (size_t)req->res;
+    while(done < req->size){
+        ssize_t res = req->write ? pwrite(fd, (uint8_t*)req->buf + done, req->size - done, req->offset + (off_t)done)
+                                 : pread(fd, (uint8_t*)req->buf + done, req->size - done, req->offset + (off_t)done);
+        if(res == -1){
+            if(errno == EINTR){
+                continue;
+            }
+            logger(LL_ERROR, __func__, "Unable to %s file at %ld: %s %d",
+                   req->write ? "write" : "read", req->offset, strerror(errno), errno);
+            req->res = -1;
+            return;
+        }
+        if(res == 0){
+            break;
+        }
+        done += (size_t)res;
+    }
+    req->res = (ssize_t)done;
+}
+
+/**
+ * @brief       Take requests of current batch until it is drained
+ * @details     Called with lock held, returns with lock held.
+ * @param[in]   ioe: pointer to io_engine_t
+ */
+
+static void ioe_drain(io_engine_t* ioe){
+    while(ioe->next < ioe->count){
+        ioe_req_t* req = &ioe->reqs[ioe->next++];
+        pthread_mutex_unlock(&ioe->lock);
+        req->res = 0;
+        ioe_complete_sync(ioe->fd, req);
+        pthread_mutex_lock(&ioe->lock);
+        if(++ioe->finished == ioe->count){
+            pthread_cond_signal(&ioe->done);
+        }
+    }
+}
+
+static void* ioe_worker(void* arg){
+    io_engine_t* ioe = arg;
+    pthread_mutex_lock(&ioe->lock);
+    while(!ioe->stop){
+        ioe_drain(ioe);
+        pthread_cond_wait(&ioe->work, &ioe->lock);
+    }
+    pthread_mutex_unlock(&ioe->lock);
+    return NULL;
+}
+
+#if defined(HAVE_LIBURING)
+/**
+ * @brief       Run batch on io_uring
+ * @param[in]   ioe: pointer to io_engine_t
+ * @param[in]   reqs: requests
+ * @param[in]   count: number of requests
+ * @return      IOE_SUCCESS on success, IOE_FAIL if ring failed, requests are finished synchronously then
+ */
+
+static int ioe_submit_uring(io_engine_t* ioe, ioe_req_t* reqs, size_t count){
+    for(size_t start = 0; start < count; start += IOE_QUEUE_DEPTH){
+        size_t batch = count - start < IOE_QUEUE_DEPTH ? count - start : IOE_QUEUE_DEPTH;
+        for(size_t i = start; i < start + batch; ++i){
+            struct io_uring_sqe* sqe = io_uring_get_sqe(&ioe->ring);
+            if(reqs[i].write){
+                io_uring_prep_write(sqe, ioe->fd, reqs[i].buf, (unsigned)reqs[i].size, (uint64_t)reqs[i].offset);
+            }
+            else{
+                io_uring_prep_read(sqe, ioe->fd, reqs[i].buf, (unsigned)reqs[i].size, (uint64_t)reqs[i].offset);
+            }
+            io_uring_sqe_set_data(sqe, &reqs[i]);
+            reqs[i].res = 0;
+        }
+        int ret = io_uring_submit_and_wait(&ioe->ring, (unsigned)batch);
+        if(ret < 0){
+            logger(LL_ERROR, __func__, "Unable to submit requests: %s %d", strerror(-ret), -ret);
+            return IOE_FAIL;
+        }
+        for(size_t i = 0; i < batch; ++i){
+            struct io_uring_cqe* cqe;
+            ret = io_uring_wait_cqe(&ioe->ring, &cqe);
+            if(ret < 0){
+                logger(LL_ERROR, __func__, "Unable to wait completion: %s %d", strerror(-ret), -ret);
+                return IOE_FAIL;
+            }
+            ioe_req_t* req = io_uring_cqe_get_data(cqe);
+            req->res = cqe->res < 0 ? 0 : cqe->res;
+            if(cqe->res < 0 && cqe->res != -EAGAIN && cqe->res != -EINTR){
+                logger(LL_WARN, __func__, "Request at %ld failed: %s %d, retrying synchronously",
+                       req->offset, strerror(-cqe->res), -cqe->res);
+            }
+            io_uring_cqe_seen(&ioe->ring, cqe);
+            /* short transfer or transient error */
+            if((size_t)req->res < req->size){
+                ioe_complete_sync(ioe->fd, req);
+            }
+        }
+    }
+    return IOE_SUCCESS;
+}
+#endif
+
+/**
+ * @brief       Create I/O engine for file
+ * @details     io_uring is used when project is built with liburing and kernel supports it,
+ *              otherwise requests are served by pool of pread/pwrite threads.
+ * @param[in]   fd: file descriptor
+ * @return      pointer to io_engine_t or NULL on failure
+ */
+
+io_engine_t* ioe_init(int fd){
+    io_engine_t* ioe = calloc(1, sizeof(io_engine_t));
+    if(!ioe){
+        return NULL;
+    }
+    ioe->fd = fd;
+#if defined(HAVE_LIBURING)
+    int ret = io_uring_queue_init(IOE_QUEUE_DEPTH, &ioe->ring, 0);
+    if(ret == 0){
+        ioe->uring = true;
+        return ioe;
+    }
+    logger(LL_WARN, __func__, "Unable to init io_uring: %s %d, using threads", strerror(-ret), -ret);
+#endif
+    pthread_mutex_init(&ioe->lock, NULL);
+    pthread_cond_init(&ioe->work, NULL);
+    pthread_cond_init(&ioe->done, NULL);
+    for(size_t i = 0; i < IOE_THREADS; ++i){
+        if(pthread_create(&ioe->threads[i], NULL, ioe_worker, ioe) != 0){
+            logger(LL_WARN, __func__, "Unable to start I/O thread: %s", strerror(errno));
+            break;
+        }
+        ++ioe->nthreads;
+    }
+    return ioe;
+}
+
+/**
+ * @brief       Run batch of requests and wait for all of them
+ * @param[in]   ioe: pointer to io_engine_t
+ * @param[in]   reqs: requests, res of each request is set
+ * @param[in]   count: number of requests
+ * @return      IOE_SUCCESS if no request failed, IOE_FAIL otherwise
+ */
+
+int ioe_submit(io_engine_t* ioe, ioe_req_t* reqs, size_t count){
+    if(count == 0){
+        return IOE_SUCCESS;
+    }
+#if defined(HAVE_LIBURING)
+    if(ioe->uring){
+        if(ioe_submit_uring(ioe, reqs, count) == IOE_FAIL){
+            for(size_t i = 0; i < count; ++i){
+                if(reqs[i].res >= 0 && (size_t)reqs[i].res < reqs[i].size){
+                    ioe_complete_sync(ioe->fd, &reqs[i]);
+                }
+            }
+        }
+    }
+    else
+#endif
+    {
+        pthread_mutex_lock(&ioe->lock);
+        ioe->reqs = reqs;
+        ioe->count = count;
+        ioe->next = 0;
+        ioe->finished = 0;
+        pthread_cond_broadcast(&ioe->work);
+        ioe_drain(ioe);
+        while(ioe->finished < ioe->count){
+            pthread_cond_wait(&ioe->done, &ioe->lock);
+        }
+        ioe->reqs = NULL;
+        ioe->count = ioe->next = ioe->finished = 0;
+        pthread_mutex_unlock(&ioe->lock);
+    }
+    for(size_t i = 0; i < count; ++i){
+        if(reqs[i].res < 0){
+            return IOE_FAIL;
+        }
+    }
+    return IOE_SUCCESS;
+}
+
+const char* ioe_name(io_engine_t* ioe){
+#if defined(HAVE_LIBURING)
+    if(ioe->uring){
+        return "io_uring";
+    }
+#endif
+    (void)ioe;
+    return "threads";
+}
+
+/**
+ * @brief       Destroy I/O engine, threads are joined
+ * @param[in]   ioe: pointer to io_engine_t
+ */
+
+void ioe_destroy(io_engine_t* ioe){
+    if(!ioe){
+        return;
+    }
+#if defined(HAVE_LIBURING)
+    if(ioe->uring){
+        io_uring_queue_exit(&ioe->ring);
+        free(ioe);
+        return;
+    }
+#endif
+    pthread_mutex_lock(&ioe->lock);
+    ioe->stop = true;
+    pthread_cond_broadcast(&ioe->work);
+    pthread_mutex_unlock(&ioe->lock);
+    for(size_t i = 0; i < ioe->nthreads; ++i){
+        pthread_join(ioe->threads[i], NULL);
+    }
+    pthread_mutex_destroy(&ioe->lock);
+    pthread_cond_destroy(&ioe->work);
+    pthread_cond_destroy(&ioe->done);
+    free(ioe);
+}
+
+#endif
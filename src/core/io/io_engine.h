@@ -0,0 +1,31 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/* Maximal number of requests in flight */
+#ifndef IOE_QUEUE_DEPTH
+#define IOE_QUEUE_DEPTH 64
+#endif
+/* Worker threads of fallback engine, caller thread works too */
+#ifndef IOE_THREADS
+#define IOE_THREADS 3
+#endif
+
+typedef struct ioe_req{
+    void* buf;
+    size_t size;
+    off_t offset;
+    bool write;
+    ssize_t res;                /* bytes transferred, less than size only on end of file, -1 on error */
+} ioe_req_t;
+
+typedef struct io_engine io_engine_t;
+
+typedef enum {IOE_SUCCESS = 0, IOE_FAIL = -1} ioe_status_t;
+
+io_engine_t* ioe_init(int fd);
+int ioe_submit(io_engine_t* ioe, ioe_req_t* reqs, size_t count);
+const char* ioe_name(io_engine_t* ioe);
+void ioe_destroy(io_engine_t* ioe);
@@ -8,21 +8,37 @@
 /**
  * Initializes linked_page_t
  * @breif Initializes linked_page_t
+ * @param pager: pointer to pager_t
  * @param mem_start starting offset for not header data
  * @return page_index or LP_FAIL
  */
 
-int64_t lp_init_m(int64_t mem_start){
+int64_t lp_init_m(pager_t* pager, int64_t mem_start){
     logger(LL_DEBUG, __func__, "linked_page_t init.");
-    int64_t page_index = pg_alloc();
+    int64_t page_index = pg_alloc(pager);
     if(page_index == PAGER_FAIL){
         logger(LL_ERROR, __func__, "Unable to allocate page");
         return LP_FAIL;
     }
-    linked_page_t *lp = (linked_page_t *) pg_load_page(page_index);
+    if(lp_init_at(pager, page_index, mem_start) == LP_FAIL){
+        pg_dealloc(pager, page_index);
+        return LP_FAIL;
+    }
+    return page_index;
+}
+
+/**
+ * Initializes linked_page_t on allocated page
+ * @param pager: pointer to pager_t
+ * @param page_index index of allocated page
+ * @param mem_start starting offset for not header data
+ * @return page_index or LP_FAIL
+ */
+
+int64_t lp_init_at(pager_t* pager, int64_t page_index, int64_t mem_start){
+    linked_page_t *lp = (linked_page_t *) pg_load_page(pager, page_index);
     if(lp == NULL){
-        pg_dealloc(page_index);
-        logger(LL_ERROR, __func__, "Unable to allocate page");
+        logger(LL_ERROR, __func__, "Unable to load page %ld", page_index);
         return LP_FAIL;
     }
     lp->next_page = -1;
@@ -34,21 +50,23 @@ int64_t lp_init_m(int64_t mem_start){
 /**
  *  Initializes linked_page_t
  *  @breif Initializes linked_page_t
+ * @param[in]   pager: pointer to pager_t
  * @return page_index or LP_FAIL
  */
 
-int64_t lp_init(void){
-   return lp_init_m(sizeof(linked_page_t));
+int64_t lp_init(pager_t* pager){
+   return lp_init_m(pager, sizeof(linked_page_t));
 }
 
 /**
  * Loads linked_page_t
+ * @param pager: pointer to pager_t
  * @param page_index
  * @return pointer to linked_page_t or NULL
  */
 
-linked_page_t* lp_load(int64_t page_index){
-    linked_page_t *lp = (linked_page_t *) pg_load_page(page_index);
+linked_page_t* lp_load(pager_t* pager, int64_t page_index){
+    linked_page_t *lp = (linked_page_t *) pg_load_page(pager, page_index);
     if(lp == NULL){
         logger(LL_ERROR, __func__, "Unable to allocate page");
         return NULL;
@@ -56,29 +74,47 @@ linked_page_t* lp_load(int64_t page_index){
     return lp;
 }
 
+/**
+ * Loads linked_page_t for reading
+ * @details Page isn't marked dirty, it must not be modified through returned pointer
+ * @param pager: pointer to pager_t
+ * @param page_index
+ * @return pointer to linked_page_t or NULL
+ */
+
+linked_page_t* lp_read(pager_t* pager, int64_t page_index){
+    linked_page_t *lp = (linked_page_t *) pg_read_page(pager, page_index);
+    if(lp == NULL){
+        logger(LL_ERROR, __func__, "Unable to read page %ld", page_index);
+        return NULL;
+    }
+    return lp;
+}
+
 /**
  *  Delete linked_page_t
  *  @breif Destroys linked_page_t
+ *  @param pager: pointer to pager_t
  *  @param page_index index of page to delete
  * @return LP_SUCCESS or LP_FAIL
  */
 
-int lp_delete(int64_t page_index) {
+int lp_delete(pager_t* pager, int64_t page_index) {
     logger(LL_DEBUG, __func__, "Deleting linked page %ld", page_index);
 
-    linked_page_t *current = (linked_page_t *) pg_load_page(page_index);
+    linked_page_t *current = (linked_page_t *) pg_load_page(pager, page_index);
 
     while (current->next_page != -1) {
-        linked_page_t *next = (linked_page_t *) pg_load_page(current->next_page);
+        linked_page_t *next = (linked_page_t *) pg_load_page(pager, current->next_page);
         logger(LL_DEBUG, __func__, "Deleting linked_page_t %ld", current->page_index);
-        if (pg_dealloc(current->page_index) == PAGER_FAIL) {
+        if (pg_dealloc(pager, current->page_index) == PAGER_FAIL) {
             logger(LL_ERROR, __func__, "Unable to deallocate page");
             return LP_FAIL;
         }
         current = next;
     }
 
-    if (pg_dealloc(current->page_index) == PAGER_FAIL) {
+    if (pg_dealloc(pager, current->page_index) == PAGER_FAIL) {
         logger(LL_ERROR, __func__, "Unable to deallocate page");
         return LP_FAIL;
     }
@@ -87,17 +123,18 @@ int lp_delete(int64_t page_index) {
 
 /**
  * @breif       Delete last page in linked_page_t
+ * @param[in]   pager: pointer to pager_t
  * @param[in]   page_index: Fist page index of linked_page_t
  * @return      LP_SUCCESS or LP_FAIL
  */
 
-int lp_delete_last(int64_t page_index) {
+int lp_delete_last(pager_t* pager, int64_t page_index) {
     logger(LL_DEBUG, __func__, "Deleting linked_page_t");
 
-    linked_page_t *current = (linked_page_t *) pg_load_page(page_index);
+    linked_page_t *current = (linked_page_t *) pg_load_page(pager, page_index);
 
     while (current->next_page != -1) {
-        linked_page_t *next = (linked_page_t *) pg_load_page(current->next_page);
+        linked_page_t *next = (linked_page_t *) pg_load_page(pager, current->next_page);
         current = next;
     }
     if(page_index == current->page_index){
@@ -105,7 +142,7 @@ int lp_delete_last(int64_t page_index) {
         return LP_FAIL;
     }
 
-    if (pg_dealloc(current->page_index) == PAGER_FAIL) {
+    if (pg_dealloc(pager, current->page_index) == PAGER_FAIL) {
         logger(LL_ERROR, __func__, "Unable to deallocate page");
         return LP_FAIL;
     }
@@ -123,6 +160,7 @@ LinkedPage* index = lp;\
 
 /**
  * Writes data to ONE linked_page_t
+ * @param pager: pointer to pager_t
  * @param lp  linked_page_t to write to
  * @param src  data to write
  * @param size  size of data to write
@@ -130,14 +168,14 @@ LinkedPage* index = lp;\
  * @return LP_SUCCESS or LP_FAIL
  */
 
-int lp_write_page(linked_page_t *lp, void* src, int64_t size, int64_t src_offset){
+int lp_write_page(pager_t* pager, linked_page_t *lp, void* src, int64_t size, int64_t src_offset){
     logger(LL_DEBUG, __func__, "Writing to linked_page_t %ld", lp->page_index);
     if(size + src_offset > lp_useful_space_size(lp)){
         logger(LL_ERROR, __func__, "Unable to write to linked_page_t %ld, size %ld + offset %ld is too big",
                lp->page_index, size, src_offset);
         return LP_FAIL;
     }
-    if(pg_write(lp->page_index, src, size, (off_t)(lp->mem_start + src_offset)) == PAGER_FAIL){
+    if(pg_write(pager, lp->page_index, src, size, (off_t)(lp->mem_start + src_offset)) == PAGER_FAIL){
         logger(LL_ERROR, __func__, "Unable to write to linked_page_t %ld", lp->page_index);
         return LP_FAIL;
     }
@@ -146,23 +184,25 @@ int lp_write_page(linked_page_t *lp, void* src, int64_t size, int64_t src_offset
 
 /**
  * Loads next linked_page_t and allocates new one if needed
+ * @details Only link to allocated page is written, next page is loaded for reading
+ * @param pager: pointer to pager_t
  * @param lp
  * @return pointer to next linked_page_t or NULL
  */
 
-linked_page_t* lp_load_next(linked_page_t* lp){
+linked_page_t* lp_load_next(pager_t* pager, linked_page_t* lp){
     int64_t page_index = lp->page_index;
     int64_t next_idx = lp->next_page;
     if(lp->next_page == -1){
-        next_idx = lp_init();
+        next_idx = lp_init(pager);
         if(next_idx == LP_FAIL){
             logger(LL_ERROR, __func__, "Unable to allocate new page");
             return NULL;
         }
-        lp =  lp_load(page_index); // cache can remove page from memory after new page init
+        lp =  lp_load(pager, page_index); // cache can remove page from memory after new page init
         lp->next_page = next_idx;
     }
-    linked_page_t* res = lp_load(next_idx);
+    linked_page_t* res = lp_read(pager, next_idx);
     if(res == NULL){
         logger(LL_ERROR, __func__, "Unable to load linked_page_t %ld", next_idx);
         return NULL;
@@ -170,13 +210,28 @@ linked_page_t* lp_load_next(linked_page_t* lp){
     return res;
 }
 
-static int lp_go_to_nova(linked_page_t** lp, int64_t start_idx, int64_t stop_idx){
+/**
+ * Loads next linked_page_t for reading, pages aren't allocated
+ * @param pager: pointer to pager_t
+ * @param lp
+ * @return pointer to next linked_page_t or NULL if there is no next page
+ */
+
+static linked_page_t* lp_read_next(pager_t* pager, linked_page_t* lp){
+    if(lp->next_page == -1){
+        logger(LL_ERROR, __func__, "linked_page_t %ld has no next page", lp->page_index);
+        return NULL;
+    }
+    return lp_read(pager, lp->next_page);
+}
+
+static int lp_go_to_nova(pager_t* pager, linked_page_t** lp, int64_t start_idx, int64_t stop_idx){
     if(!(*lp)){
         logger(LL_ERROR, __func__, "Unable to load linked_page_t");
         return LP_FAIL;
     }
     while (stop_idx > start_idx){
-        *lp = lp_load_next(*lp);
+        *lp = lp_read_next(pager, *lp);
         if(*lp == NULL){
             logger(LL_ERROR, __func__, "Unable to load linked_page_t");
             return LP_FAIL;
@@ -190,18 +245,19 @@ static int lp_go_to_nova(linked_page_t** lp, int64_t start_idx, int64_t stop_idx
 /**
  * Goes to linked_page_t with given index
  * @breif   Goes to linked_page_t with given index
+ * @param[in]   pager: pointer to pager_t
  * @return  pointer to linked_page_t or NULL
  */
 
-linked_page_t* lp_go_to(int64_t start_page_index, int64_t start_idx, int64_t stop_idx){
-    linked_page_t* lp = lp_load(start_page_index);
+linked_page_t* lp_go_to(pager_t* pager, int64_t start_page_index, int64_t start_idx, int64_t stop_idx){
+    linked_page_t* lp = lp_read(pager, start_page_index);
     if(!lp){
         logger(LL_ERROR, __func__, "Unable to load linked_page_t %ld", start_page_index);
         return NULL;
     }
 
     while (stop_idx > start_idx){
-        lp = lp_load_next(lp);
+        lp = lp_load_next(pager, lp);
         if(lp == NULL){
             logger(LL_ERROR, __func__, "Unable to load linked_page_t %ld", start_page_index);
             return NULL;
@@ -215,6 +271,7 @@ linked_page_t* lp_go_to(int64_t start_page_index, int64_t start_idx, int64_t sto
 /**
  *  Writes data to linked_page_t
  *  @breif Writes data to linked_page_t
+ *  @param pager: pointer to pager_t
  *  @param page_index start linked_page_t index
  *  @param src data to write
  *  @param size size of data to write
@@ -222,9 +279,9 @@ linked_page_t* lp_go_to(int64_t start_page_index, int64_t start_idx, int64_t sto
  * @return LP_SUCCESS or LP_FAIL
  */
 
-int lp_write(int64_t page_index, void *src, int64_t size, int64_t src_offset) {
+int lp_write(pager_t* pager, int64_t page_index, void *src, int64_t size, int64_t src_offset) {
 
-    linked_page_t* lp = lp_load(page_index);
+    linked_page_t* lp = lp_read(pager, page_index);
     if(!lp){
         logger(LL_ERROR, __func__, "Unable to load linked_page_t %ld", page_index);
         return LP_FAIL;
@@ -238,7 +295,7 @@ int lp_write(int64_t page_index, void *src, int64_t size, int64_t src_offset) {
     int64_t current_page_idx = 0;
 
     // go to start page of write and allocate new pages if needed
-    lp = lp_go_to(page_index, current_page_idx, starting_page);
+    lp = lp_go_to(pager, page_index, current_page_idx, starting_page);
 
     // write to pages until all data is written
     while (pages_needed > 0) {
@@ -247,7 +304,7 @@ int lp_write(int64_t page_index, void *src, int64_t size, int64_t src_offset) {
                 ? (int64_t)lp_useful_space_size(lp) - starting_offset : size;
 
         // write to page
-        if (lp_write_page(lp, src, size_to_write, starting_offset) == LP_FAIL) {
+        if (lp_write_page(pager, lp, src, size_to_write, starting_offset) == LP_FAIL) {
             logger(LL_ERROR, __func__, "Unable to write to linked_page_t %ld", lp->page_index);
             return LP_FAIL;
         }
@@ -258,7 +315,7 @@ int lp_write(int64_t page_index, void *src, int64_t size, int64_t src_offset) {
         if(pages_needed != 0){
             size -= size_to_write;
             src = (char*)src + size_to_write;
-            lp = lp_load_next(lp);
+            lp = lp_load_next(pager, lp);
         }
     }
     return LP_SUCCESS;
@@ -267,6 +324,7 @@ int lp_write(int64_t page_index, void *src, int64_t size, int64_t src_offset) {
 
 /**
  * Reads data from ONE linked_page_t
+ * @param pager: pointer to pager_t
  * @param lp  linked_page_t to read from
  * @param dest  data to read to
  * @param size  size of data to read
@@ -274,7 +332,7 @@ int lp_write(int64_t page_index, void *src, int64_t size, int64_t src_offset) {
  * @return  LP_SUCCESS or LP_FAIL
  */
 
-int lp_read_copy_page(linked_page_t* lp, void* dest, int64_t size, int64_t src_offset){
+int lp_read_copy_page(pager_t* pager, linked_page_t* lp, void* dest, int64_t size, int64_t src_offset){
     logger(LL_DEBUG, __func__, "Reading from linked_page_t %ld, size: %"PRId64", offset: %"PRId64".",
            lp->page_index, size, src_offset);
     if(size + src_offset > lp_useful_space_size(lp)){
@@ -282,14 +340,14 @@ int lp_read_copy_page(linked_page_t* lp, void* dest, int64_t size, int64_t src_o
                lp->page_index, size, src_offset);
         return LP_FAIL;
     }
-    if(pg_copy_read(lp->page_index, dest, size, (off_t)(lp->mem_start + src_offset)) == PAGER_FAIL){
+    if(pg_copy_read(pager, lp->page_index, dest, size, (off_t)(lp->mem_start + src_offset)) == PAGER_FAIL){
         logger(LL_ERROR, __func__, "Unable to read from linked_page_t %ld", lp->page_index);
         return LP_FAIL;
     }
     return LP_SUCCESS;
 }
 
-int lp_read_copy_nova(linked_page_t* lp, void* dest, int64_t size, int64_t src_offset){
+int lp_read_copy_nova(pager_t* pager, linked_page_t* lp, void* dest, int64_t size, int64_t src_offset){
     if(!lp){
         logger(LL_ERROR, __func__, "Unable to load linked_page_t");
         return LP_FAIL;
@@ -301,7 +359,7 @@ int lp_read_copy_nova(linked_page_t* lp, void* dest, int64_t size, int64_t src_o
     int64_t pages_needed = ceil((double)(size + starting_offset) / (double)lp_useful_space_size(lp));
     int64_t current_page_idx = 0;
 
-    if(lp_go_to_nova(&lp, current_page_idx, starting_page) == LP_FAIL){
+    if(lp_go_to_nova(pager, &lp, current_page_idx, starting_page) == LP_FAIL){
         logger(LL_ERROR, __func__, "Unable to load next linked_page_t");
         return LP_FAIL;
     }
@@ -314,7 +372,7 @@ int lp_read_copy_nova(linked_page_t* lp, void* dest, int64_t size, int64_t src_o
                    lp->page_index, size, src_offset);
             return LP_FAIL;
         }
-        if(lp_read_copy_page(lp, dest, size_to_read, starting_offset) == CH_FAIL){
+        if(lp_read_copy_page(pager, lp, dest, size_to_read, starting_offset) == CH_FAIL){
             logger(LL_ERROR, __func__, "Unable to read from linked_page_t %ld", lp->page_index);
             return LP_FAIL;
         }
@@ -323,7 +381,7 @@ int lp_read_copy_nova(linked_page_t* lp, void* dest, int64_t size, int64_t src_o
         if(pages_needed != 0){
             size -= size_to_read;
             dest = (char*)dest + size_to_read;
-            lp = lp_load_next(lp);
+            lp = lp_read_next(pager, lp);
         }
     }
     return LP_SUCCESS;
@@ -331,6 +389,7 @@ int lp_read_copy_nova(linked_page_t* lp, void* dest, int64_t size, int64_t src_o
 
 /**
  *  Reads data from linked_page_t
+ * @param pager: pointer to pager_t
  * @param page_index  linked_page_t index to read from
  * @param dest  data to read to
  * @param size  virt size of data to read
@@ -338,8 +397,8 @@ int lp_read_copy_nova(linked_page_t* lp, void* dest, int64_t size, int64_t src_o
  * @return LP_SUCCESS or LP_FAIL
  */
 
-int lp_read_copy(int64_t page_index, void* dest, int64_t size, int64_t src_offset){
-    linked_page_t* lp = lp_load(page_index);
+int lp_read_copy(pager_t* pager, int64_t page_index, void* dest, int64_t size, int64_t src_offset){
+    linked_page_t* lp = lp_read(pager, page_index);
 
     if(!lp){
         logger(LL_ERROR, __func__, "Unable to load linked_page_t %ld", page_index);
@@ -352,9 +411,7 @@ int lp_read_copy(int64_t page_index, void* dest, int64_t size, int64_t src_offse
     int64_t pages_needed = ceil((double)(size + starting_offset) / (double)lp_useful_space_size(lp));
     int64_t current_page_idx = 0;
 
-    lp = lp_go_to(lp->page_index, current_page_idx,starting_page);
-
-    if(lp == NULL){
+    if(lp_go_to_nova(pager, &lp, current_page_idx, starting_page) == LP_FAIL){
         logger(LL_ERROR, __func__, "Unable to load linked_page_t %ld", page_index);
         return LP_FAIL;
     }
@@ -367,7 +424,7 @@ int lp_read_copy(int64_t page_index, void* dest, int64_t size, int64_t src_offse
                    lp->page_index, size, src_offset);
             return LP_FAIL;
         }
-        if(lp_read_copy_page(lp, dest, size_to_read, starting_offset) == CH_FAIL){
+        if(lp_read_copy_page(pager, lp, dest, size_to_read, starting_offset) == CH_FAIL){
             logger(LL_ERROR, __func__, "Unable to read from linked_page_t %ld", lp->page_index);
             return LP_FAIL;
         }
@@ -376,7 +433,7 @@ int lp_read_copy(int64_t page_index, void* dest, int64_t size, int64_t src_offse
         if(pages_needed != 0){
             size -= size_to_read;
             dest = (char*)dest + size_to_read;
-            lp = lp_load_next(lp);
+            lp = lp_read_next(pager, lp);
         }
     }
 
@@ -1,142 +1,1448 @@
 #include "pager.h"
-#include "backend/utils/parray64.h"
 #include "caching.h"
 #include "utils/logger.h"
+#include <string.h>
 
-#ifndef PAGER
-pager_t* pg_pager;
-#define PAGER pg_pager
-#endif
+#define pg_group_start(page_index) ((page_index) / PG_GROUP_PAGES * PG_GROUP_PAGES)
+#define PG_WORD_BITS 64
 
-#ifndef DELETED_PAGES_START_INDEX
-#define DELETED_PAGES_START_INDEX 0
-#endif
+/* Header of the first bitmap page */
+typedef struct pg_header{
+    uint64_t magic;             /* PG_MAGIC */
+    uint32_t version;           /* PG_VERSION */
+    uint32_t reserved;
+    int64_t map_page;           /* position of the first page of relocation map, 0 if there is no map */
+    int64_t map_size;           /* entries of saved map */
+} pg_header_t;
+
+/* Page of saved relocation map, pairs of page index and its position in file */
+typedef struct pg_map_page{
+    int64_t next_page;          /* position of the next page of map, 0 for the last one */
+    int64_t count;
+    int64_t entries[][2];
+} pg_map_page_t;
+
+#define PG_MAP_PAGE_ENTRIES ((int64_t)((PAGE_SIZE - sizeof(pg_map_page_t)) / (2 * sizeof(int64_t))))
+
+static inline size_t pg_map_hash(const pg_map_t* map, int64_t key){
+    uint64_t h = (uint64_t)key * 0x9E3779B97F4A7C15ull;
+    return (size_t)(h ^ (h >> 32)) & map->mask;
+}
+
+/**
+ * @brief       Find value of key
+ * @param[in]   map: pointer to pg_map_t
+ * @param[in]   key: key
+ * @return      value or key itself if it isn't in map
+ */
+
+static inline int64_t pg_map_get(const pg_map_t* map, int64_t key){
+    if(map->count == 0){
+        return key;
+    }
+    for(size_t slot = pg_map_hash(map, key); map->keys[slot] != -1; slot = (slot + 1) & map->mask){
+        if(map->keys[slot] == key){
+            return map->values[slot];
+        }
+    }
+    return key;
+}
+
+static int pg_map_grow(pg_map_t* map){
+    size_t capacity = map->keys ? (map->mask + 1) << 1 : 16;
+    int64_t* keys = malloc(capacity * sizeof(int64_t));
+    int64_t* values = malloc(capacity * sizeof(int64_t));
+    if(!keys || !values){
+        free(keys);
+        free(values);
+        logger(LL_ERROR, __func__, "Unable to grow relocation map to %zu slots", capacity);
+        return PAGER_FAIL;
+    }
+    memset(keys, -1, capacity * sizeof(int64_t));
+    pg_map_t grown = {.keys = keys, .values = values, .mask = capacity - 1, .count = map->count};
+    for(size_t slot = 0; map->keys && slot <= map->mask; ++slot){
+        if(map->keys[slot] == -1){
+            continue;
+        }
+        size_t to = pg_map_hash(&grown, map->keys[slot]);
+        while(keys[to] != -1){
+            to = (to + 1) & grown.mask;
+        }
+        keys[to] = map->keys[slot];
+        values[to] = map->values[slot];
+    }
+    free(map->keys);
+    free(map->values);
+    *map = grown;
+    return PAGER_SUCCESS;
+}
+
+/**
+ * @brief       Set value of key, key mapped to itself is removed
+ * @param[in]   map: pointer to pg_map_t
+ * @param[in]   key: key
+ * @param[in]   value: value
+ * @return      PAGER_SUCCESS on success, PAGER_FAIL otherwise
+ */
+
+static int pg_map_set(pg_map_t* map, int64_t key, int64_t value){
+    if(!map->keys || (map->count + 1) * 4 > (map->mask + 1) * 3){
+        if(pg_map_grow(map) == PAGER_FAIL){
+            return PAGER_FAIL;
+        }
+    }
+    size_t slot = pg_map_hash(map, key);
+    while(map->keys[slot] != -1 && map->keys[slot] != key){
+        slot = (slot + 1) & map->mask;
+    }
+    if(map->keys[slot] == -1){
+        if(key == value){
+            return PAGER_SUCCESS;
+        }
+        map->keys[slot] = key;
+        map->values[slot] = value;
+        map->count++;
+        return PAGER_SUCCESS;
+    }
+    if(key != value){
+        map->values[slot] = value;
+        return PAGER_SUCCESS;
+    }
+    /* backward shift deletion keeps probe sequences unbroken */
+    size_t hole = slot;
+    for(size_t next = (hole + 1) & map->mask; map->keys[next] != -1; next = (next + 1) & map->mask){
+        size_t home = pg_map_hash(map, map->keys[next]);
+        if(((next - home) & map->mask) >= ((next - hole) & map->mask)){
+            map->keys[hole] = map->keys[next];
+            map->values[hole] = map->values[next];
+            hole = next;
+        }
+    }
+    map->keys[hole] = -1;
+    map->count--;
+    return PAGER_SUCCESS;
+}
+
+static void pg_map_free(pg_map_t* map){
+    free(map->keys);
+    free(map->values);
+    *map = (pg_map_t){0};
+}
+
+/* Position of page in file, it differs from page index once page was moved by compaction.
+ * It is looked up inside pg_map_enter or while pager is locked */
+static inline int64_t pg_position(pager_t* pager, int64_t page_index){
+    return page_index < 0 ? page_index : pg_map_get(&pager->moved, page_index);
+}
+
+/* Index of page at position in file, pager is locked */
+static inline int64_t pg_page_at(pager_t* pager, int64_t position){
+    return pg_map_get(&pager->owner, position);
+}
+
+/* The last reader wakes compaction waiting for readers to leave */
+static inline void pg_map_leave(pager_t* pager, bool entered){
+    if(entered && atomic_fetch_sub(&pager->map_readers, 1) == 1 && atomic_load(&pager->map_moving)){
+        lk_lock(&pager->map_lock);
+        lk_broadcast(&pager->map_changed);
+        lk_unlock(&pager->map_lock);
+    }
+}
+
+/**
+ * @brief       Enter use of page positions
+ * @details     While pager has several users, thread is counted as map reader from lookup of
+ *              page position till its use, and compaction moves page only when there are no
+ *              readers, so page isn't moved under them and map isn't changed while it is read.
+ *              Reader which finds page moving sleeps till the move is done.
+ *              Like latches, it relies on threads attaching to pager before they work with it together.
+ * @param[in]   pager: pointer to pager_t
+ * @return      true if thread is counted as reader
+ */
+
+static inline bool pg_map_enter(pager_t* pager){
+    if(atomic_load_explicit(&pager->users, memory_order_relaxed) < 2){
+        return false;
+    }
+    for(;;){
+        atomic_fetch_add(&pager->map_readers, 1);
+        if(!atomic_load(&pager->map_moving)){
+            return true;
+        }
+        pg_map_leave(pager, true);
+        lk_lock(&pager->map_lock);
+        while(atomic_load(&pager->map_moving)){
+            lk_wait(&pager->map_changed, &pager->map_lock);
+        }
+        lk_unlock(&pager->map_lock);
+    }
+}
+
+/**
+ * @brief       Change page positions, pager is locked
+ * @details     New readers wait and readers which already look up positions are waited for.
+ * @param[in]   pager: pointer to pager_t
+ */
+
+static void pg_map_exclude(pager_t* pager){
+    atomic_store(&pager->map_moving, true);
+    lk_lock(&pager->map_lock);
+    while(atomic_load(&pager->map_readers)){
+        lk_wait(&pager->map_changed, &pager->map_lock);
+    }
+    lk_unlock(&pager->map_lock);
+}
+
+static void pg_map_admit(pager_t* pager){
+    lk_lock(&pager->map_lock);
+    atomic_store(&pager->map_moving, false);
+    lk_broadcast(&pager->map_changed);
+    lk_unlock(&pager->map_lock);
+}
+
+/* Latch held by calling thread */
+typedef struct pg_held{
+    pager_t* pager;
+    int64_t page_index;
+    bool exclusive;
+    uint32_t depth;             /* latch is taken again by thread which holds it */
+} pg_held_t;
+
+/* Page pinned for calling thread */
+typedef struct pg_hold{
+    pager_t* pager;
+    int64_t position;
+} pg_hold_t;
+
+static _Thread_local pg_held_t pg_held[PG_LATCH_DEPTH];
+static _Thread_local size_t pg_held_count;
+/* While pager has several users, pages loaded by thread inside latch or allocation are pinned
+ * till thread leaves the last of them, so pointers to pages aren't invalidated by other threads */
+static _Thread_local pg_hold_t* pg_holds;
+static _Thread_local size_t pg_hold_count, pg_hold_capacity;
+static _Thread_local pg_map_t pg_hold_map;  /* position -> ~index of hold */
+static _Thread_local uint32_t pg_hold_depth;
+
+/**
+ * @brief       Pin page for calling thread till it leaves its latches
+ * @details     Nothing is done outside latch or while pager has one user. Page which
+ *              couldn't be pinned mustn't be returned, another thread may evict it.
+ * @param[in]   pager: pointer to pager_t
+ * @param[in]   position: position of page
+ * @return      PAGER_SUCCESS on success, PAGER_FAIL otherwise
+ */
+
+static int pg_hold(pager_t* pager, int64_t position){
+    if(!pg_hold_depth || atomic_load_explicit(&pager->users, memory_order_relaxed) < 2){
+        return PAGER_SUCCESS;
+    }
+    int64_t found = pg_map_get(&pg_hold_map, position);
+    if(found < 0 && pg_holds[~found].pager == pager){
+        return PAGER_SUCCESS;
+    }
+    if(pg_hold_count == pg_hold_capacity){
+        size_t capacity = pg_hold_capacity ? pg_hold_capacity * 2 : 16;
+        pg_hold_t* holds = realloc(pg_holds, capacity * sizeof(pg_hold_t));
+        if(!holds){
+            logger(LL_ERROR, __func__, "Unable to allocate holds");
+            return PAGER_FAIL;
+        }
+        pg_holds = holds;
+        pg_hold_capacity = capacity;
+    }
+    if(ch_pin(&pager->ch, position) != CH_SUCCESS){
+        logger(LL_ERROR, __func__, "Unable to pin page %ld", position);
+        return PAGER_FAIL;
+    }
+    if(pg_map_set(&pg_hold_map, position, ~(int64_t)pg_hold_count) == PAGER_FAIL){
+        ch_unpin(&pager->ch, position);
+        logger(LL_ERROR, __func__, "Unable to allocate holds");
+        return PAGER_FAIL;
+    }
+    pg_holds[pg_hold_count++] = (pg_hold_t){.pager = pager, .position = position};
+    return PAGER_SUCCESS;
+}
+
+/**
+ * @brief       Unpin page pinned for calling thread
+ * @param[in]   pager: pointer to pager_t
+ * @param[in]   position: position of page
+ */
+
+static void pg_unhold(pager_t* pager, int64_t position){
+    if(!pg_hold_count){
+        return;
+    }
+    int64_t found = pg_map_get(&pg_hold_map, position);
+    if(found >= 0 || pg_holds[~found].pager != pager){
+        return;
+    }
+    ch_unpin(&pager->ch, position);
+    pg_holds[~found].pager = NULL;
+    pg_map_set(&pg_hold_map, position, position);
+}
+
+static void pg_hold_enter(void){
+    pg_hold_depth++;
+}
+
+static void pg_hold_leave(void){
+    if(--pg_hold_depth){
+        return;
+    }
+    for(size_t i = 0; i < pg_hold_count; ++i){
+        if(pg_holds[i].pager){
+            ch_unpin(&pg_holds[i].pager->ch, pg_holds[i].position);
+        }
+    }
+    free(pg_holds);
+    pg_holds = NULL;
+    pg_hold_count = pg_hold_capacity = 0;
+    pg_map_free(&pg_hold_map);
+}
+
+/* Allocation of pages is serialized */
+static void pg_lock(pager_t* pager){
+    lk_lock(&pager->lock);
+    pg_hold_enter();
+}
+
+static void pg_unlock(pager_t* pager){
+    pg_hold_leave();
+    lk_unlock(&pager->lock);
+}
+
+static pg_header_t* pg_header(pager_t* pager, bool write){
+    void* page = NULL;
+    if(pg_hold(pager, 0) == PAGER_FAIL || (write ? ch_load_page(&pager->ch, 0, &page) != CH_SUCCESS : !(page = ch_read(&pager->ch, 0, 0)))){
+        logger(LL_ERROR, __func__, "Unable to load pager header");
+        return NULL;
+    }
+    return page;
+}
+
+/**
+ * @brief       Get bitmap of group of page
+ * @param[in]   pager: pointer to pager_t
+ * @param[in]   page_index: position of page
+ * @param[in]   write: bitmap is going to be modified
+ * @return      pointer to bitmap words or NULL
+ */
+
+static uint64_t* pg_bitmap(pager_t* pager, int64_t page_index, bool write){
+    int64_t bitmap = pg_group_start(page_index);
+    void* page = NULL;
+    if(pg_hold(pager, bitmap) == PAGER_FAIL || (write ? ch_load_page(&pager->ch, bitmap, &page) != CH_SUCCESS : !(page = ch_read(&pager->ch, bitmap, 0)))){
+        logger(LL_ERROR, __func__, "Unable to load bitmap page %ld", bitmap);
+        return NULL;
+    }
+    return (uint64_t*)((uint8_t*)page + PG_HEADER_SIZE);
+}
+
+static bool pg_used(pager_t* pager, int64_t page_index){
+    const uint64_t* bits = pg_bitmap(pager, page_index, false);
+    int64_t bit = page_index - pg_group_start(page_index);
+    /* page is treated as used if bitmap can't be read */
+    return !bits || bits[bit / PG_WORD_BITS] & (1ull << (bit % PG_WORD_BITS));
+}
+
+static int pg_mark(pager_t* pager, int64_t page_index, bool used){
+    uint64_t* bits = pg_bitmap(pager, page_index, true);
+    if(!bits){
+        return PAGER_FAIL;
+    }
+    int64_t bit = page_index - pg_group_start(page_index);
+    if(used){
+        bits[bit / PG_WORD_BITS] |= 1ull << (bit % PG_WORD_BITS);
+    }
+    else{
+        bits[bit / PG_WORD_BITS] &= ~(1ull << (bit % PG_WORD_BITS));
+    }
+    return PAGER_SUCCESS;
+}
+
+/**
+ * @brief       Find the lowest free page
+ * @details     Search starts at free_hint, every page below it is used. Hint only moves forward
+ *              while pages are allocated and back to freed page, so allocation is amortised O(1).
+ * @param[in]   pager: pointer to pager_t
+ * @return      position of free page, number of pages if every page of file is used, PAGER_FAIL on error
+ */
+
+static int64_t pg_find_free(pager_t* pager){
+    int64_t pages = pg_max_page_index(pager) + 1;
+    for(int64_t start = pager->free_hint; start < pages; start = pg_group_start(start) + PG_GROUP_PAGES){
+        const uint64_t* bits = pg_bitmap(pager, start, false);
+        if(!bits){
+            return PAGER_FAIL;
+        }
+        int64_t group = pg_group_start(start);
+        int64_t first = start - group;
+        for(int64_t word = first / PG_WORD_BITS; word < PG_GROUP_PAGES / PG_WORD_BITS && group + word * PG_WORD_BITS < pages; ++word){
+            uint64_t free_bits = ~bits[word];
+            if(word == first / PG_WORD_BITS){
+                free_bits &= ~0ull << (first % PG_WORD_BITS);
+            }
+            if(free_bits){
+                int64_t page_index = group + word * PG_WORD_BITS + __builtin_ctzll(free_bits);
+                pager->free_hint = page_index < pages ? page_index : pages;
+                return pager->free_hint;
+            }
+        }
+    }
+    pager->free_hint = pages;
+    return pages;
+}
+
+/**
+ * @brief       Find the lowest run of free pages
+ * @details     Run never contains bitmap page, so it lies in one group. Free pages at the end
+ *              of file start run which is completed by appended pages.
+ * @param[in]   pager: pointer to pager_t
+ * @param[in]   count: length of run
+ * @return      position of the first page of run, number of pages if run starts at the end of file,
+ *              PAGER_FAIL on error
+ */
+
+static int64_t pg_find_run(pager_t* pager, int64_t count){
+    int64_t pages = pg_max_page_index(pager) + 1;
+    int64_t run_start = pages, run = 0;
+    for(int64_t position = pager->free_hint; position < pages;){
+        const uint64_t* bits = pg_bitmap(pager, position, false);
+        if(!bits){
+            return PAGER_FAIL;
+        }
+        int64_t group = pg_group_start(position);
+        int64_t end = group + PG_GROUP_PAGES < pages ? group + PG_GROUP_PAGES : pages;
+        for(; position < end; ++position){
+            int64_t bit = position - group;
+            uint64_t word = bits[bit / PG_WORD_BITS];
+            if(bit % PG_WORD_BITS == 0 && word == ~0ull){
+                run = 0;
+                position += PG_WORD_BITS - 1;
+                continue;
+            }
+            if(word & (1ull << (bit % PG_WORD_BITS))){
+                run = 0;
+                continue;
+            }
+            if(run++ == 0){
+                run_start = position;
+            }
+            if(run == count){
+                return run_start;
+            }
+        }
+    }
+    return run ? run_start : pages;
+}
+
+/**
+ * @brief       Append page to file
+ * @details     Page starting a group becomes bitmap of the group and the next page is appended.
+ * @param[in]   pager: pointer to pager_t
+ * @return      index of page or PAGER_FAIL
+ */
+
+static int64_t pg_new_page(pager_t* pager){
+    while(true){
+        int64_t page_index = ch_new_page(&pager->ch);
+        if(page_index == CH_FAIL){
+            return PAGER_FAIL;
+        }
+        if(page_index % PG_GROUP_PAGES != 0){
+            return page_index;
+        }
+        logger(LL_DEBUG, __func__, "Starting bitmap page %ld", page_index);
+        /* new page is zeroed, so group is empty */
+        if(pg_mark(pager, page_index, true) == PAGER_FAIL){
+            return PAGER_FAIL;
+        }
+    }
+}
+
+/**
+ * @brief       Cut free pages at the end of file
+ * @details     File isn't cut below bitmap page of the last group.
+ * @param[in]   pager: pointer to pager_t
+ */
+
+static void pg_trim(pager_t* pager){
+    for(int64_t last = pg_max_page_index(pager); last % PG_GROUP_PAGES != 0 && !pg_used(pager, last); last = pg_max_page_index(pager)){
+        int res = ch_page_status(&pager->ch, last) == 3 ? ch_delete_last_page(&pager->ch)
+                                                          : ch_delete_page(&pager->ch, last);
+        /* cacher may keep file size */
+        if(res == CH_FAIL || pg_max_page_index(pager) == last){
+            break;
+        }
+    }
+    if(pager->free_hint > pg_max_page_index(pager) + 1){
+        pager->free_hint = pg_max_page_index(pager) + 1;
+    }
+}
+
+/**
+ * @brief       Creates pager
+ * @details     The first page of file is bitmap of the first group.
+ * @param[in]   pager: pointer to pager_t
+ * @return      PAGER_SUCCESS on success, PAGER_FAIL otherwise
+ */
+static int pg_create(pager_t* pager){
+    logger(LL_DEBUG, __func__, "Creating pager");
+    if(ch_new_page(&pager->ch) == CH_FAIL || pg_mark(pager, 0, true) == PAGER_FAIL){
+        return PAGER_FAIL;
+    }
+    pg_header_t* header = pg_header(pager, true);
+    if(!header){
+        return PAGER_FAIL;
+    }
+    header->magic = PG_MAGIC;
+    header->version = PG_VERSION;
+    return PAGER_SUCCESS;
+}
+
+/**
+ * @brief       Check format of opened file
+ * @param[in]   pager: pointer to pager_t
+ * @return      PAGER_SUCCESS if file has format of pager, PAGER_FAIL otherwise
+ */
+
+static int pg_check(pager_t* pager){
+    const pg_header_t* header = pg_header(pager, false);
+    if(!header){
+        return PAGER_FAIL;
+    }
+    if(header->magic != PG_MAGIC){
+        logger(LL_ERROR, __func__, "File isn't database file or has format older than version 1");
+        return PAGER_FAIL;
+    }
+    if(header->version != PG_VERSION){
+        logger(LL_ERROR, __func__, "File has format version %u, version %d is supported", header->version, PG_VERSION);
+        return PAGER_FAIL;
+    }
+    return PAGER_SUCCESS;
+}
+
+/**
+ * @brief       Take the lowest free position or append page to file
+ * @param[in]   pager: pointer to pager_t
+ * @return      position of page or PAGER_FAIL
+ */
+
+static int64_t pg_take(pager_t* pager){
+    int64_t position = pg_find_free(pager);
+    if(position == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to find free page");
+        return PAGER_FAIL;
+    }
+    if(position <= pg_max_page_index(pager)){
+        ch_use_again(&pager->ch, position);
+    }
+    else{
+        logger(LL_DEBUG, __func__, "There are no free pages, allocating new page");
+        if((position = pg_new_page(pager)) == PAGER_FAIL){
+            logger(LL_ERROR, __func__, "Unable to load new page");
+            return PAGER_FAIL;
+        }
+    }
+    if(pg_mark(pager, position, true) == PAGER_FAIL){
+        return PAGER_FAIL;
+    }
+    if(pager->free_hint == position){
+        pager->free_hint = position + 1;
+    }
+    return position;
+}
+
+/**
+ * @brief       Free position, page is cut off if it is the last one
+ * @param[in]   pager: pointer to pager_t
+ * @param[in]   position: position of page
+ * @return      PAGER_SUCCESS on success, PAGER_FAIL otherwise
+ */
+
+static int pg_release(pager_t* pager, int64_t position){
+    if(pg_mark(pager, position, false) == PAGER_FAIL){
+        return PAGER_FAIL;
+    }
+    if(position < pager->free_hint){
+        pager->free_hint = position;
+    }
+    ch_delete_page(&pager->ch, position);
+    return PAGER_SUCCESS;
+}
+
+/**
+ * @brief       Read relocation map saved by compaction
+ * @param[in]   pager: pointer to pager_t
+ * @return      PAGER_SUCCESS on success, PAGER_FAIL otherwise
+ */
+
+static int pg_map_load(pager_t* pager){
+    const pg_header_t* header = pg_header(pager, false);
+    if(!header){
+        return PAGER_FAIL;
+    }
+    int64_t size = header->map_size;
+    for(int64_t position = header->map_page; position != 0;){
+        const pg_map_page_t* page = ch_read(&pager->ch, position, 0);
+        if(!page){
+            logger(LL_ERROR, __func__, "Unable to read relocation map page %ld", position);
+            return PAGER_FAIL;
+        }
+        for(int64_t i = 0; i < page->count; ++i){
+            if(pg_map_set(&pager->moved, page->entries[i][0], page->entries[i][1]) == PAGER_FAIL
+               || pg_map_set(&pager->owner, page->entries[i][1], page->entries[i][0]) == PAGER_FAIL){
+                return PAGER_FAIL;
+            }
+        }
+        position = page->next_page;
+    }
+    if((int64_t)pager->moved.count != size){
+        logger(LL_ERROR, __func__, "Relocation map has %zu entries instead of %ld", pager->moved.count, size);
+        return PAGER_FAIL;
+    }
+    return PAGER_SUCCESS;
+}
+
+/* Position is free, positions after the end of file are free too */
+static bool pg_free_at(pager_t* pager, int64_t position){
+    return position > pg_max_page_index(pager) || !pg_used(pager, position);
+}
+
+/**
+ * @brief       Give two free positions each other's page indexes
+ * @param[in]   pager: pointer to pager_t
+ * @param[in]   a: free position
+ * @param[in]   b: free position
+ * @return      PAGER_SUCCESS on success, PAGER_FAIL otherwise
+ */
+
+static int pg_map_swap(pager_t* pager, int64_t a, int64_t b){
+    int64_t index_a = pg_page_at(pager, a);
+    int64_t index_b = pg_page_at(pager, b);
+    if(pg_map_set(&pager->moved, index_a, b) == PAGER_FAIL
+       || pg_map_set(&pager->moved, index_b, a) == PAGER_FAIL
+       || pg_map_set(&pager->owner, a, index_b) == PAGER_FAIL
+       || pg_map_set(&pager->owner, b, index_a) == PAGER_FAIL){
+        return PAGER_FAIL;
+    }
+    return PAGER_SUCCESS;
+}
+
+/**
+ * @brief       Fold relocation map entries of freed position back
+ * @details     Free positions hold no data, so their page indexes can be exchanged freely.
+ *              Index of page freed at position goes back to its own position if that one is
+ *              free, and the index of position itself comes back to it if its page is free,
+ *              so map entries of moved pages disappear as they are freed.
+ * @param[in]   pager: pointer to pager_t
+ * @param[in]   position: freed position
+ * @return      number of folded entries, PAGER_FAIL on error
+ */
+
+static int64_t pg_map_fold(pager_t* pager, int64_t position){
+    if(pager->moved.count == 0){
+        return 0;
+    }
+    size_t count = pager->moved.count;
+    int64_t home = pg_page_at(pager, position);
+    int64_t at = pg_position(pager, position);
+    bool fold_home = home != position && pg_free_at(pager, home);
+    bool fold_at = at != position && at != home && pg_free_at(pager, at);
+    if(!fold_home && !fold_at){
+        return 0;
+    }
+    pg_map_exclude(pager);
+    int res = PAGER_SUCCESS;
+    if(fold_home){
+        res = pg_map_swap(pager, position, home);
+    }
+    if(res == PAGER_SUCCESS && fold_at){
+        res = pg_map_swap(pager, position, at);
+    }
+    pg_map_admit(pager);
+    if(res == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to fold relocation map at %ld", position);
+        return PAGER_FAIL;
+    }
+    logger(LL_DEBUG, __func__, "Relocation map is folded from %zu to %zu entries", count, pager->moved.count);
+    return (int64_t)(count - pager->moved.count);
+}
+
+/**
+ * @brief       Free pages of saved relocation map, map is kept in memory
+ * @param[in]   pager: pointer to pager_t
+ * @return      PAGER_SUCCESS on success, PAGER_FAIL otherwise
+ */
+
+static int pg_map_drop(pager_t* pager){
+    pg_header_t* header = pg_header(pager, true);
+    if(!header){
+        return PAGER_FAIL;
+    }
+    int64_t position = header->map_page;
+    header->map_page = 0;
+    header->map_size = 0;
+    while(position != 0){
+        const pg_map_page_t* page = ch_read(&pager->ch, position, 0);
+        if(!page){
+            logger(LL_ERROR, __func__, "Unable to read relocation map page %ld", position);
+            return PAGER_FAIL;
+        }
+        int64_t next = page->next_page;
+        if(pg_release(pager, position) == PAGER_FAIL || pg_map_fold(pager, position) == PAGER_FAIL){
+            return PAGER_FAIL;
+        }
+        position = next;
+    }
+    return PAGER_SUCCESS;
+}
+
+/**
+ * @brief       Save relocation map to the lowest free pages
+ * @param[in]   pager: pointer to pager_t
+ * @return      PAGER_SUCCESS on success, PAGER_FAIL otherwise
+ */
+
+static int pg_map_save(pager_t* pager){
+    const pg_map_t* map = &pager->moved;
+    int64_t prev = 0;
+    size_t slot = 0;
+    for(size_t saved = 0; saved < map->count;){
+        int64_t position = pg_take(pager);
+        pg_map_page_t* page = NULL;
+        if(position == PAGER_FAIL || ch_load_page(&pager->ch, position, (void**)&page) != CH_SUCCESS){
+            logger(LL_ERROR, __func__, "Unable to allocate relocation map page");
+            return PAGER_FAIL;
+        }
+        page->next_page = 0;
+        page->count = 0;
+        for(; slot <= map->mask && page->count < PG_MAP_PAGE_ENTRIES; ++slot){
+            if(map->keys[slot] != -1){
+                page->entries[page->count][0] = map->keys[slot];
+                page->entries[page->count][1] = map->values[slot];
+                page->count++;
+                saved++;
+            }
+        }
+        void* link = NULL;
+        if(prev == 0){
+            pg_header_t* header = pg_header(pager, true);
+            if(!header){
+                return PAGER_FAIL;
+            }
+            header->map_page = position;
+        }
+        else if(ch_load_page(&pager->ch, prev, &link) == CH_SUCCESS){
+            ((pg_map_page_t*)link)->next_page = position;
+        }
+        else{
+            return PAGER_FAIL;
+        }
+        prev = position;
+    }
+    pg_header_t* header = pg_header(pager, true);
+    if(!header){
+        return PAGER_FAIL;
+    }
+    header->map_size = (int64_t)map->count;
+    return PAGER_SUCCESS;
+}
+
+/**
+ * @brief       Find the highest used page which isn't bitmap
+ * @param[in]   pager: pointer to pager_t
+ * @param[in]   from: position search starts with
+ * @return      position of page, 0 if there is no such page, PAGER_FAIL on error
+ */
+
+static int64_t pg_last_used(pager_t* pager, int64_t from){
+    for(int64_t last = from; last > 0; last = pg_group_start(last) - 1){
+        const uint64_t* bits = pg_bitmap(pager, last, false);
+        if(!bits){
+            return PAGER_FAIL;
+        }
+        int64_t group = pg_group_start(last);
+        for(int64_t word = (last - group) / PG_WORD_BITS; word >= 0; --word){
+            uint64_t used = bits[word];
+            if(word == (last - group) / PG_WORD_BITS){
+                used &= (2ull << ((last - group) % PG_WORD_BITS)) - 1;
+            }
+            if(word == 0){
+                used &= ~1ull;
+            }
+            if(used){
+                return group + word * PG_WORD_BITS + PG_WORD_BITS - 1 - __builtin_clzll(used);
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief       Cut pages after the last used one
+ * @details     File grows in extents, so file left without close has free zeroed tail,
+ *              it isn't treated as pages of file.
+ * @param[in]   pager: pointer to pager_t
+ * @return      PAGER_SUCCESS on success, PAGER_FAIL otherwise
+ */
+
+static int pg_cut_tail(pager_t* pager){
+    int64_t last = pg_last_used(pager, pg_max_page_index(pager));
+    if(last == PAGER_FAIL){
+        return PAGER_FAIL;
+    }
+    if(ch_truncate(&pager->ch, last + 1) == CH_FAIL){
+        logger(LL_ERROR, __func__, "Unable to cut file after page %ld", last);
+        return PAGER_FAIL;
+    }
+    return PAGER_SUCCESS;
+}
+
+/**
+ * @brief       Move page to free position
+ * @details     Page keeps its index, the index of free position moves to the old position of page.
+ * @param[in]   pager: pointer to pager_t
+ * @param[in]   from: position of page
+ * @param[in]   to: free position
+ * @return      PAGER_SUCCESS on success, PAGER_FAIL otherwise
+ */
+
+static int pg_move(pager_t* pager, int64_t from, int64_t to){
+    if(ch_pin(&pager->ch, from) != CH_SUCCESS){
+        logger(LL_ERROR, __func__, "Unable to load page at %ld", from);
+        return PAGER_FAIL;
+    }
+    const void* src = ch_read(&pager->ch, from, 0);
+    void* dest = NULL;
+    ch_use_again(&pager->ch, to);
+    int res = src && ch_load_page(&pager->ch, to, &dest) == CH_SUCCESS ? PAGER_SUCCESS : PAGER_FAIL;
+    if(res == PAGER_SUCCESS){
+        memcpy(dest, src, PAGE_SIZE);
+    }
+    ch_unpin(&pager->ch, from);
+    if(res == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to copy page from %ld to %ld", from, to);
+        return PAGER_FAIL;
+    }
+    int64_t page_index = pg_page_at(pager, from);
+    int64_t free_index = pg_page_at(pager, to);
+    if(pg_map_set(&pager->moved, page_index, to) == PAGER_FAIL
+       || pg_map_set(&pager->moved, free_index, from) == PAGER_FAIL
+       || pg_map_set(&pager->owner, to, page_index) == PAGER_FAIL
+       || pg_map_set(&pager->owner, from, free_index) == PAGER_FAIL){
+        return PAGER_FAIL;
+    }
+    if(pg_mark(pager, to, true) == PAGER_FAIL){
+        return PAGER_FAIL;
+    }
+    if(pager->free_hint == to){
+        pager->free_hint = to + 1;
+    }
+    return pg_release(pager, from);
+}
+
+static int pg_destroy(pager_t* pager, bool remove){
+    if(!pager){
+        logger(LL_ERROR, __func__, "Pager is not open");
+        return PAGER_FAIL;
+    }
+    int res = (remove ? ch_delete(&pager->ch) : ch_close(&pager->ch)) == CH_FAIL ? PAGER_FAIL : PAGER_SUCCESS;
+    if(res == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to %s caching", remove ? "delete" : "close");
+    }
+    pg_map_free(&pager->moved);
+    pg_map_free(&pager->owner);
+    for(size_t i = 0; i <= PG_LATCH_BUCKETS; ++i){
+        pg_latch_t* latch = i < PG_LATCH_BUCKETS ? pager->latches[i] : pager->free_latches;
+        while(latch){
+            pg_latch_t* next = latch->next;
+            lk_cond_destroy(&latch->released);
+            free(latch);
+            latch = next;
+        }
+    }
+    lk_mutex_destroy(&pager->latch_lock);
+    lk_cond_destroy(&pager->map_changed);
+    lk_mutex_destroy(&pager->map_lock);
+    lk_mutex_destroy(&pager->lock);
+    free(pager);
+    return res;
+}
 
 /**
- * @brief       Creates pager
- * @return      PAGER_SUCCESS on success, PAGER_FAIL otherwise
+ * @brief       Initializes pager
+ * @param[in]   file_name: name of file to store data
+ * @return      pointer to pager_t on success, NULL otherwise
  */
-static int pg_create(void){
-    logger(LL_DEBUG, __func__, "Creating pager");
-    PAGER->deleted_pages = -1;
-    PAGER->deleted_pages = pa_init64(sizeof(int64_t), -1);
-    return PAGER_SUCCESS;
+
+pager_t* pg_init(const char* file_name){
+    return pg_init_opt(file_name, NULL);
 }
 
 /**
- * @breif       Initializes pager
+ * @brief       Initializes pager with cacher options
+ * @details     Every pager has its own file and cache, so several databases can be open at once.
+ *              Pager is passed to every call working with its pages, thread which opened it is
+ *              its user.
  * @param[in]   file_name: name of file to store data
- * @return      PAGE_SUCCESS on success, PAGE_FAIL otherwise
+ * @param[in]   opt: cacher options or NULL for defaults
+ * @return      pointer to pager_t on success, NULL otherwise
  */
 
-int pg_init(const char* file_name){
+pager_t* pg_init_opt(const char* file_name, const ch_options_t* opt){
     logger(LL_DEBUG, __func__, "Initializing pager");
-    PAGER = malloc(sizeof(pager_t));
-    if (ch_init(file_name, &PAGER->ch) == CH_FAIL) {
+    pager_t* pager = calloc(1, sizeof(pager_t));
+    if(!pager){
+        logger(LL_ERROR, __func__, "Unable to allocate pager");
+        return NULL;
+    }
+    if (ch_init_opt(file_name, &pager->ch, opt) == CH_FAIL) {
         logger(LL_ERROR, __func__, "Unable to initialize caching");
-        return PAGER_FAIL;
+        free(pager);
+        return NULL;
     }
-    if(pg_max_page_index()){
-        pg_create();
+    lk_mutex_init(&pager->lock);
+    lk_mutex_init(&pager->latch_lock);
+    lk_mutex_init(&pager->map_lock);
+    lk_cond_init(&pager->map_changed);
+    atomic_init(&pager->map_readers, 0);
+    atomic_init(&pager->map_moving, false);
+    atomic_init(&pager->users, 1);
+    int res = PAGER_SUCCESS;
+    if(pg_max_page_index(pager) == -1 && pg_create(pager) == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to create pager");
+        res = PAGER_FAIL;
     }
-    else{
-        PAGER->deleted_pages = 0;
+    else if(pg_check(pager) == PAGER_FAIL){
+        res = PAGER_FAIL;
     }
-    return PAGER_SUCCESS;
+    else if(pg_map_load(pager) == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to load relocation map");
+        res = PAGER_FAIL;
+    }
+    else if(pg_cut_tail(pager) == PAGER_FAIL){
+        res = PAGER_FAIL;
+    }
+    if(res == PAGER_FAIL){
+        pg_destroy(pager, false);
+        return NULL;
+    }
+    return pager;
+}
+
+/**
+ * @brief       Attach calling thread to pager
+ * @details     While pager has several users, latches are taken and pages loaded inside them are
+ *              pinned for their thread. Thread attaches before it latches anything and detaches
+ *              when it is done, thread which opened pager is attached already.
+ * @param[in]   pager: pointer to pager_t
+ */
+
+void pg_attach(pager_t* pager){
+    atomic_fetch_add(&pager->users, 1);
 }
 
+/**
+ * @brief       Detach calling thread from pager
+ * @param[in]   pager: pointer to pager_t
+ */
+
+void pg_detach(pager_t* pager){
+    atomic_fetch_sub(&pager->users, 1);
+}
 
 /**
- * @brief       Delete file and destroy caching
+ * @brief       Delete file and destroy caching, pager is freed
+ * @param[in]   pager: pointer to pager_t
  * @return      PAGE_SUCCESS on success, PAGE_FAIL otherwise
  */
 
-int pg_delete(void){
+int pg_delete(pager_t* pager){
     logger(LL_DEBUG, __func__, "Deleting file");
-    if(ch_delete(&PAGER->ch) == CH_FAIL){
-        logger(LL_ERROR, __func__, "Unable to delete caching");
-        return PAGER_FAIL;
-    }
-    free(PAGER);
-    return PAGER_SUCCESS;
+    return pg_destroy(pager, true);
 }
 
 /**
- * @brief       Close file and destroy caching
+ * @brief       Close file and destroy caching, pager is freed
+ * @param[in]   pager: pointer to pager_t
  * @return      PAGE_SUCCESS on success, PAGE_FAIL otherwise
  */
 
-int pg_close(void){
+int pg_close(pager_t* pager){
     logger(LL_DEBUG, __func__, "Closing file");
-    if(ch_close(&PAGER->ch) == CH_FAIL){
-        logger(LL_ERROR, __func__, "Unable to delete caching");
-        return PAGER_FAIL;
-    }
-    free(PAGER);
-    return PAGER_SUCCESS;
+    return pg_destroy(pager, false);
 }
 /**
  * Allocates page
- * @brief Loads free pages from file or allocates new page
+ * @brief Takes the lowest free page of file or appends new page
+ * @param[in]   pager: pointer to pager_t
  * @return index of page or PAGER_FAIL
  */
 
-int64_t pg_alloc(void){
+int64_t pg_alloc(pager_t* pager){
     logger(LL_DEBUG, __func__, "Allocating page");
-    int64_t page_idx = -1;
+    pg_lock(pager);
+    int64_t position = pg_take(pager);
+    int64_t page_index = position == PAGER_FAIL ? PAGER_FAIL : pg_page_at(pager, position);
+    pg_unlock(pager);
+    return page_index;
+}
 
-    int64_t del_pag_idx = -1;
 
-    if(PAGER->deleted_pages != -1){
-        if((pa_pop64(PAGER->deleted_pages, &del_pag_idx)) == PA_SUCCESS){
-            page_idx = del_pag_idx;
+/**
+ * @brief       Allocate run of pages, pager is locked
+ * @param[in]   pager: pointer to pager_t
+ * @param[in]   count: number of pages
+ * @param[out]  pages: indexes of allocated pages in file order
+ * @return      PAGER_SUCCESS on success, PAGER_FAIL otherwise
+ */
+
+static int pg_take_n(pager_t* pager, int64_t count, int64_t* pages){
+    int64_t start = pg_find_run(pager, count);
+    if(start == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to find free pages");
+        return PAGER_FAIL;
+    }
+    int64_t last = pg_max_page_index(pager);
+    if(start + count - 1 > last){
+        /* appended run starts after bitmap page and ends before the next one */
+        if(start % PG_GROUP_PAGES == 0){
+            start++;
         }
-        if(del_pag_idx != -1){
-            ch_use_again(&PAGER->ch, del_pag_idx);
+        if(pg_group_start(start) != pg_group_start(start + count - 1)){
+            start = pg_group_start(start + count - 1) + 1;
+        }
+        while(pg_max_page_index(pager) < start + count - 1){
+            if(pg_new_page(pager) == PAGER_FAIL){
+                logger(LL_ERROR, __func__, "Unable to load new page");
+                return PAGER_FAIL;
+            }
         }
     }
-
-    if(del_pag_idx == -1 || del_pag_idx > pg_max_page_index()){
-        logger(LL_DEBUG, __func__, "Unable to pop page from deleted pages, allocating new page");
-        if((page_idx = ch_new_page(&PAGER->ch)) == CH_FAIL){
-            logger(LL_ERROR, __func__, "Unable to load new page");
+    for(int64_t i = 0; i < count; ++i){
+        int64_t position = start + i;
+        if(position <= last){
+            ch_use_again(&pager->ch, position);
+        }
+        if(pg_mark(pager, position, true) == PAGER_FAIL){
             return PAGER_FAIL;
         }
+        pages[i] = pg_page_at(pager, position);
     }
-    return page_idx;
+    if(pager->free_hint == start){
+        pager->free_hint = start + count;
+    }
+    return PAGER_SUCCESS;
 }
 
+/**
+ * @brief       Allocate pages lying one after another in file
+ * @details     The lowest run of free pages is taken, file is extended if there is no such run.
+ *              Run doesn't cross bitmap page, so count must be less than PG_GROUP_PAGES.
+ *              Indexes of pages are consecutive unless pages were moved by compaction.
+ * @param[in]   pager: pointer to pager_t
+ * @param[in]   count: number of pages
+ * @param[out]  pages: indexes of allocated pages in file order
+ * @return      PAGER_SUCCESS on success, PAGER_FAIL otherwise
+ */
+
+int pg_alloc_n(pager_t* pager, int64_t count, int64_t* pages){
+    logger(LL_DEBUG, __func__, "Allocating %ld pages", count);
+    if(count <= 0 || count >= PG_GROUP_PAGES){
+        logger(LL_ERROR, __func__, "Unable to allocate run of %ld pages", count);
+        return PAGER_FAIL;
+    }
+    pg_lock(pager);
+    int res = pg_take_n(pager, count, pages);
+    pg_unlock(pager);
+    return res;
+}
 
 /**
  * Deallocates page
- * @warning double deleting same page may cause program crash in future
- * @brief Deallocates page
+ * @brief Marks page as free, free pages at the end of file are cut off
+ * @details Freeing free page is reported and ignored, bitmap pages can't be freed.
+ * @param pager: pointer to pager_t
  * @param page_index
  * @return PAGER_SUCCESS or PAGER_FAIL
  */
 
-int pg_dealloc(int64_t page_index) {
+int pg_dealloc(pager_t* pager, int64_t page_index) {
     logger(LL_DEBUG, __func__, "Deallocating page %ld", page_index);
-    pa_push_unique64(PAGER->deleted_pages, page_index);
-    ch_delete_page(&PAGER->ch, page_index);
+    /* page isn't moved while pager is locked */
+    pg_lock(pager);
+    int64_t position = pg_position(pager, page_index);
+    if(position <= 0 || position > pg_max_page_index(pager) || position % PG_GROUP_PAGES == 0){
+        logger(LL_ERROR, __func__, "Unable to deallocate page %ld", page_index);
+        pg_unlock(pager);
+        return PAGER_FAIL;
+    }
+    pg_unhold(pager, position);
+    int res = PAGER_SUCCESS;
+    int64_t folded = 0;
+    if(!pg_used(pager, position)){
+        logger(LL_WARN, __func__, "Page %ld is already free", page_index);
+    }
+    else if(pg_release(pager, position) == PAGER_FAIL || (folded = pg_map_fold(pager, position)) == PAGER_FAIL){
+        res = PAGER_FAIL;
+    }
+    /* saved map is replaced by folded one */
+    else if(folded && (pg_map_drop(pager) == PAGER_FAIL || pg_map_save(pager) == PAGER_FAIL)){
+        res = PAGER_FAIL;
+    }
+    else{
+        pg_trim(pager);
+    }
+    pg_unlock(pager);
+    return res;
+}
+
+/**
+ * @brief       Compaction step, pager is locked
+ * @param[in]   pager: pointer to pager_t
+ * @param[in]   max_moves: maximal number of pages to move
+ * @return      number of moved pages, 0 if there is nothing to move, PAGER_FAIL on error
+ */
+
+static int64_t pg_compact_locked(pager_t* pager, int64_t max_moves){
+    int64_t last = pg_last_used(pager, pg_max_page_index(pager));
+    int64_t free_position = pg_find_free(pager);
+    if(last == PAGER_FAIL || free_position == PAGER_FAIL){
+        return PAGER_FAIL;
+    }
+    int64_t end = pg_max_page_index(pager);
+    if(free_position > last && (end == 0 || end % PG_GROUP_PAGES != 0)){
+        return 0;
+    }
+    /* map pages are saved again after moves, so they don't stay at the end */
+    if(pg_map_drop(pager) == PAGER_FAIL){
+        return PAGER_FAIL;
+    }
+    int64_t moves = 0;
+    /* pinned pages are skipped, pages below them are moved */
+    for(int64_t from = pg_max_page_index(pager); moves < max_moves; from = last - 1){
+        last = pg_last_used(pager, from);
+        free_position = pg_find_free(pager);
+        if(last == PAGER_FAIL || free_position == PAGER_FAIL){
+            return PAGER_FAIL;
+        }
+        if(free_position > last){
+            break;
+        }
+        /* readers don't look up positions while page is checked and moved */
+        pg_map_exclude(pager);
+        bool pinned = ch_pinned(&pager->ch, last);
+        int res = pinned ? PAGER_SUCCESS : pg_move(pager, last, free_position);
+        pg_map_admit(pager);
+        if(pinned){
+            logger(LL_DEBUG, __func__, "Page at %ld is pinned, it isn't moved", last);
+            continue;
+        }
+        if(res == PAGER_FAIL){
+            return PAGER_FAIL;
+        }
+        pg_trim(pager);
+        moves++;
+    }
+    /* group left without pages is cut off with its bitmap */
+    for(end = pg_max_page_index(pager); end > 0 && end % PG_GROUP_PAGES == 0; end = pg_max_page_index(pager)){
+        ch_delete_page(&pager->ch, end);
+        if(pg_max_page_index(pager) == end){
+            break;
+        }
+        pg_trim(pager);
+    }
+    if(pg_map_save(pager) == PAGER_FAIL){
+        return PAGER_FAIL;
+    }
+    logger(LL_DEBUG, __func__, "Moved %ld pages, %zu pages are relocated", moves, pager->moved.count);
+    return moves;
+}
+
+/**
+ * @brief       Compact file by moving pages from its end to free pages
+ * @details     The last used page is moved to the lowest free page until max_moves pages are
+ *              moved, so compaction can be done in small steps between other work. Moved page
+ *              keeps its index, pager translates it to new position, so references stored in
+ *              pages stay valid. Pinned pages, pages kept by pg_keep among them, aren't moved,
+ *              pages below them are. Free pages at the end of file and emptied groups are cut off.
+ *              Other threads may use pager while it is compacted: page pinned or held by them
+ *              isn't moved and positions aren't looked up while page is moved. Pointers to pages
+ *              which aren't pinned, kept or held are invalidated.
+ *              File with write-ahead log isn't compacted, it can't be shrunk before checkpoint.
+ * @param[in]   pager: pointer to pager_t
+ * @param[in]   max_moves: maximal number of pages to move
+ * @return      number of moved pages, 0 if nothing can be moved, PAGER_FAIL on error
+ */
+
+int64_t pg_compact(pager_t* pager, int64_t max_moves){
+    if(pager->ch.wal){
+        logger(LL_ERROR, __func__, "File with write-ahead log can't be compacted");
+        return PAGER_FAIL;
+    }
+    pg_lock(pager);
+    int64_t moves = pg_compact_locked(pager, max_moves);
+    pg_unlock(pager);
+    return moves;
+}
+
+/**
+ * @brief       Commit written pages according to durability mode of cache options
+ * @param[in]   pager: pointer to pager_t
+ * @return      PAGER_SUCCESS on success, PAGER_FAIL otherwise
+ */
+
+int pg_commit(pager_t* pager){
+    if(ch_commit(&pager->ch) == CH_FAIL){
+        logger(LL_ERROR, __func__, "Unable to commit");
+        return PAGER_FAIL;
+    }
+    return PAGER_SUCCESS;
+}
+
+int pg_rm_cached(pager_t* pager, int64_t page_index){
+    bool entered = pg_map_enter(pager);
+    int64_t position = pg_position(pager, page_index);
+    pg_unhold(pager, position);
+    ch_remove(&pager->ch, position);
+    pg_map_leave(pager, entered);
+    return PAGER_SUCCESS;
+}
+
+/**
+ * @brief       Pin page, it stays cached and pointers to it stay valid until it is unpinned
+ * @param[in]   pager: pointer to pager_t
+ * @param[in]   page_index: index of page
+ * @return      page_index on success, PAGER_FAIL otherwise
+ */
+
+int64_t pg_pin(pager_t* pager, int64_t page_index){
+    if(page_index < 0){
+        return PAGER_FAIL;
+    }
+    bool entered = pg_map_enter(pager);
+    int res = ch_pin(&pager->ch, pg_position(pager, page_index));
+    pg_map_leave(pager, entered);
+    if(res != CH_SUCCESS){
+        logger(LL_ERROR, __func__, "Unable to pin page %ld", page_index);
+        return PAGER_FAIL;
+    }
+    return page_index;
+}
+
+/**
+ * @brief       Keep page cached and in its place till it is deallocated
+ * @details     Page is pinned once however many times it is kept, compaction doesn't move it,
+ *              so pointers to it stay valid. It is meant for pages of long living handles.
+ * @param[in]   pager: pointer to pager_t
+ * @param[in]   page_index: index of page
+ * @return      PAGER_SUCCESS on success, PAGER_FAIL otherwise
+ */
+
+int pg_keep(pager_t* pager, int64_t page_index){
+    bool entered = pg_map_enter(pager);
+    int res = ch_keep(&pager->ch, pg_position(pager, page_index));
+    pg_map_leave(pager, entered);
+    if(res != CH_SUCCESS){
+        logger(LL_ERROR, __func__, "Unable to keep page %ld", page_index);
+        return PAGER_FAIL;
+    }
     return PAGER_SUCCESS;
 }
 
-int pg_rm_cached(int64_t page_index){
-    ch_remove(&PAGER->ch, page_index);
+/**
+ * @brief       Unpin page
+ * @param[in]   pager: pointer to pager_t
+ * @param[in]   page_index: index of page
+ * @return      PAGER_SUCCESS on success, PAGER_FAIL otherwise
+ */
+
+int pg_unpin(pager_t* pager, int64_t page_index){
+    bool entered = pg_map_enter(pager);
+    int res = ch_unpin(&pager->ch, pg_position(pager, page_index));
+    pg_map_leave(pager, entered);
+    return res == CH_SUCCESS ? PAGER_SUCCESS : PAGER_FAIL;
+}
+
+/**
+ * @brief       Cleanup of pg_pinned variable
+ * @param[in]   pin: pointer to pinned page, negative index is ignored
+ */
+
+void pg_unpin_scoped(pg_scoped_t* pin){
+    if(pin->page_index >= 0){
+        pg_unpin(pin->pager, pin->page_index);
+    }
+}
+
+/**
+ * @brief       Find latch of page, latch_lock is held
+ * @param[in]   pager: pointer to pager_t
+ * @param[in]   page_index: index of page
+ * @param[in]   create: create latch if page has none
+ * @return      pointer to latch or NULL
+ */
+
+static pg_latch_t* pg_latch_find(pager_t* pager, int64_t page_index, bool create){
+    pg_latch_t** bucket = &pager->latches[pg_map_hash(&(pg_map_t){.mask = PG_LATCH_BUCKETS - 1}, page_index)];
+    for(pg_latch_t* latch = *bucket; latch; latch = latch->next){
+        if(latch->page_index == page_index){
+            return latch;
+        }
+    }
+    if(!create){
+        return NULL;
+    }
+    pg_latch_t* latch = pager->free_latches;
+    if(latch){
+        pager->free_latches = latch->next;
+    }
+    else if((latch = malloc(sizeof(pg_latch_t)))){
+        lk_cond_init(&latch->released);
+    }
+    else{
+        logger(LL_ERROR, __func__, "Unable to allocate latch of page %ld", page_index);
+        return NULL;
+    }
+    latch->page_index = page_index;
+    latch->readers = 0;
+    latch->users = 0;
+    latch->next = *bucket;
+    *bucket = latch;
+    return latch;
+}
+
+/**
+ * @brief       Return unused latch to free list, latch_lock is held
+ * @param[in]   pager: pointer to pager_t
+ * @param[in]   latch: pointer to latch
+ */
+
+static void pg_latch_drop(pager_t* pager, pg_latch_t* latch){
+    pg_latch_t** link = &pager->latches[pg_map_hash(&(pg_map_t){.mask = PG_LATCH_BUCKETS - 1}, latch->page_index)];
+    while(*link != latch){
+        link = &(*link)->next;
+    }
+    *link = latch->next;
+    latch->next = pager->free_latches;
+    pager->free_latches = latch;
+}
+
+/**
+ * @brief       Latch page
+ * @details     Shared latch is held by any number of readers, exclusive latch by one writer.
+ *              Latch is reentrant, thread holding exclusive latch may take it again in any mode,
+ *              thread holding shared latch can't upgrade it. Latches are taken only while pager
+ *              has several users, pages loaded inside latch stay pinned for thread until
+ *              it releases its last latch. Latches of different pages are taken in order of
+ *              structures: table, then its schema and varchar manager, metatable before new table.
+ * @param[in]   pager: pointer to pager_t
+ * @param[in]   page_index: index of page
+ * @param[in]   exclusive: latch is taken for modification
+ * @return      page_index on success, PAGER_FAIL otherwise
+ */
+
+int64_t pg_latch(pager_t* pager, int64_t page_index, bool exclusive){
+    if(page_index < 0 || !pager){
+        return PAGER_FAIL;
+    }
+    for(size_t i = pg_held_count; i-- > 0;){
+        pg_held_t* held = &pg_held[i];
+        if(held->pager != pager || held->page_index != page_index){
+            continue;
+        }
+        if(exclusive && !held->exclusive){
+            logger(LL_ERROR, __func__, "Shared latch of page %ld can't be upgraded", page_index);
+            return PAGER_FAIL;
+        }
+        held->depth++;
+        return page_index;
+    }
+    if(atomic_load_explicit(&pager->users, memory_order_relaxed) < 2){
+        return page_index;
+    }
+    if(pg_held_count == PG_LATCH_DEPTH){
+        logger(LL_ERROR, __func__, "Too many latches are held, page %ld isn't latched", page_index);
+        return PAGER_FAIL;
+    }
+    lk_lock(&pager->latch_lock);
+    pg_latch_t* latch = pg_latch_find(pager, page_index, true);
+    if(!latch){
+        lk_unlock(&pager->latch_lock);
+        return PAGER_FAIL;
+    }
+    latch->users++;
+    while(exclusive ? latch->readers != 0 : latch->readers < 0){
+        lk_wait(&latch->released, &pager->latch_lock);
+    }
+    latch->readers = exclusive ? -1 : latch->readers + 1;
+    lk_unlock(&pager->latch_lock);
+    pg_held[pg_held_count++] = (pg_held_t){.pager = pager, .page_index = page_index, .exclusive = exclusive, .depth = 1};
+    pg_hold_enter();
+    return page_index;
+}
+
+/**
+ * @brief       Release latch of page
+ * @details     Latch which wasn't taken because pager had one user is silently accepted.
+ * @param[in]   pager: pointer to pager_t
+ * @param[in]   page_index: index of page
+ * @return      PAGER_SUCCESS
+ */
+
+int pg_unlatch(pager_t* pager, int64_t page_index){
+    for(size_t i = pg_held_count; i-- > 0;){
+        pg_held_t* held = &pg_held[i];
+        if(held->pager != pager || held->page_index != page_index){
+            continue;
+        }
+        if(--held->depth){
+            return PAGER_SUCCESS;
+        }
+        lk_lock(&pager->latch_lock);
+        pg_latch_t* latch = pg_latch_find(pager, page_index, false);
+        latch->readers = held->exclusive ? 0 : latch->readers - 1;
+        if(latch->readers == 0){
+            lk_broadcast(&latch->released);
+        }
+        if(--latch->users == 0){
+            pg_latch_drop(pager, latch);
+        }
+        lk_unlock(&pager->latch_lock);
+        *held = pg_held[--pg_held_count];
+        pg_hold_leave();
+        return PAGER_SUCCESS;
+    }
     return PAGER_SUCCESS;
 }
 
+/**
+ * @brief       Cleanup of pg_latched variable
+ * @param[in]   latch: pointer to latched page, negative index is ignored
+ */
+
+void pg_unlatch_scoped(pg_scoped_t* latch){
+    if(latch->page_index >= 0){
+        pg_unlatch(latch->pager, latch->page_index);
+    }
+}
+
 /**
  * @brief       Loads page
+ * @param[in]   pager: pointer to pager_t
  * @param[in]   page_index: index of page
  * @return      pointer to page or NULL
  */
 
-void* pg_load_page(int64_t page_index) {
+void* pg_load_page(pager_t* pager, int64_t page_index) {
     logger(LL_DEBUG, __func__, "Loading page %ld", page_index);
     void* page_ptr = NULL;
-    int res = ch_load_page(&PAGER->ch, page_index, &page_ptr);
+    bool entered = pg_map_enter(pager);
+    int64_t position = pg_position(pager, page_index);
+    int res = pg_hold(pager, position) == PAGER_FAIL ? CH_FAIL : ch_load_page(&pager->ch, position, &page_ptr);
+    pg_map_leave(pager, entered);
     if (res == CH_FAIL) {
         logger(LL_ERROR, __func__, "Unable to load page %ld", page_index);
         return NULL;
@@ -148,8 +1454,72 @@ void* pg_load_page(int64_t page_index) {
     return page_ptr;
 }
 
+/**
+ * @brief       Loads page for reading
+ * @details     Page isn't marked dirty, so it is evicted without write-back if it wasn't modified otherwise.
+ * @param[in]   pager: pointer to pager_t
+ * @param[in]   page_index: index of page
+ * @return      pointer to page or NULL
+ */
+
+const void* pg_read_page(pager_t* pager, int64_t page_index){
+    bool entered = pg_map_enter(pager);
+    int64_t position = pg_position(pager, page_index);
+    const void* page_ptr = pg_hold(pager, position) == PAGER_FAIL ? NULL : ch_read(&pager->ch, position, 0);
+    pg_map_leave(pager, entered);
+    if(page_ptr == NULL){
+        logger(LL_ERROR, __func__, "Unable to load page %ld", page_index);
+    }
+    return page_ptr;
+}
+
+/**
+ * @brief       Load pages ahead of use
+ * @param[in]   pager: pointer to pager_t
+ * @param[in]   pages: indexes of pages
+ * @param[in]   count: number of pages
+ * @return      number of loaded pages or PAGER_FAIL
+ */
+
+int64_t pg_prefetch(pager_t* pager, const int64_t* pages, size_t count){
+    int64_t* positions = NULL;
+    bool entered = pg_map_enter(pager);
+    if(pager->moved.count && count){
+        if(!(positions = malloc(count * sizeof(int64_t)))){
+            pg_map_leave(pager, entered);
+            return PAGER_FAIL;
+        }
+        for(size_t i = 0; i < count; ++i){
+            positions[i] = pg_position(pager, pages[i]);
+        }
+        pages = positions;
+    }
+    int64_t res = ch_prefetch(&pager->ch, pages, count);
+    pg_map_leave(pager, entered);
+    free(positions);
+    if(res == CH_FAIL){
+        logger(LL_ERROR, __func__, "Unable to prefetch %zu pages", count);
+        return PAGER_FAIL;
+    }
+    return res;
+}
+
+/**
+ * @brief       Read ahead for scan
+ * @param[in]   pager: pointer to pager_t
+ * @param[in]   prev_page: page left by scan or -1 for new scan
+ * @param[in]   page_index: page scan steps to
+ */
+
+void pg_readahead(pager_t* pager, int64_t prev_page, int64_t page_index){
+    bool entered = pg_map_enter(pager);
+    ch_readahead(&pager->ch, pg_position(pager, prev_page), pg_position(pager, page_index));
+    pg_map_leave(pager, entered);
+}
+
 /**
  * @brief       Write to page
+ * @param[in]   pager: pointer to pager_t
  * @param[in]   page_index: page index
  * @param[in]   src: source
  * @param[in]   size: size to write
@@ -157,11 +1527,13 @@ void* pg_load_page(int64_t page_index) {
  * @return      PAGER_SUCCESS on success, PAGER_FAIL otherwise
  */
 
-int pg_write(int64_t page_index, void* src, size_t size, off_t offset){
+int pg_write(pager_t* pager, int64_t page_index, void* src, size_t size, off_t offset){
     logger(LL_DEBUG, __func__,
            "Writing to page, page index: %ld, src: %p, size: %ld, offset: %ld",
            page_index, src, size, offset);
-    int res = ch_write(&PAGER->ch, page_index, src, size, offset);
+    bool entered = pg_map_enter(pager);
+    int res = ch_write(&pager->ch, pg_position(pager, page_index), src, size, offset);
+    pg_map_leave(pager, entered);
     if(res == CH_FAIL){
         logger(LL_ERROR, __func__,
                "Unable to write to page, page index: %ld, src: %p, size: %ld, offset: %ld",
@@ -173,6 +1545,7 @@ int pg_write(int64_t page_index, void* src, size_t size, off_t offset){
 
 /**
  * @brief       Read from page
+ * @param[in]   pager: pointer to pager_t
  * @param[in]   page_index: page index
  * @param[out]  dest: destination
  * @param[in]   size: size to read
@@ -180,9 +1553,12 @@ int pg_write(int64_t page_index, void* src, size_t size, off_t offset){
  * @return      PAGER_SUCCESS on success, PAGER_FAIL otherwise
  */
 
-int pg_copy_read(int64_t page_index, void* dest, size_t size, off_t offset){
+int pg_copy_read(pager_t* pager, int64_t page_index, void* dest, size_t size, off_t offset){
     logger(LL_DEBUG, __func__, "Reading from page");
-    if(ch_copy_read(&PAGER->ch, page_index, dest, size, offset) == CH_FAIL){
+    bool entered = pg_map_enter(pager);
+    int res = ch_copy_read(&pager->ch, pg_position(pager, page_index), dest, size, offset);
+    pg_map_leave(pager, entered);
+    if(res == CH_FAIL){
         logger(LL_ERROR, __func__, "Unable to read from page");
         return PAGER_FAIL;
     }
@@ -191,28 +1567,89 @@ int pg_copy_read(int64_t page_index, void* dest, size_t size, off_t offset){
 
 /**
  * @brief   Get current file size
+ * @param[in]   pager: pointer to pager_t
  * @return  file size
  */
 
-off_t pg_file_size(void){
-    return ch_file_size(&PAGER->ch);
+off_t pg_file_size(pager_t* pager){
+    return ch_file_size(&pager->ch);
+}
+
+/**
+ * @brief   Get disk space allocated to file
+ * @details It is less than file size if blocks of free pages were released by hole punching.
+ * @param[in]   pager: pointer to pager_t
+ * @return  allocated bytes or -1
+ */
+
+off_t pg_disk_size(pager_t* pager){
+    return fl_disk_size(&pager->ch.file);
 }
 
-#define $pg_max_page_index() (PAGER->ch.file.max_page_index)
+#define $pg_max_page_index(pager) (pager->ch.file.max_page_index)
 
 /**
  * @brief   Get current max page index
  * @return  max page index
  */
- int64_t pg_max_page_index(void){
-     return $pg_max_page_index();
- }
+int64_t pg_max_page_index(pager_t* pager){
+    return $pg_max_page_index(pager);
+}
+
+/**
+ * @brief       Check that page is in file
+ * @details     Index of moved page may be above max page index.
+ * @param[in]   pager: pointer to pager_t
+ * @param[in]   page_index: index of page
+ * @return      true if page is in file
+ */
+
+bool pg_exists(pager_t* pager, int64_t page_index){
+    bool entered = pg_map_enter(pager);
+    int64_t position = pg_position(pager, page_index);
+    pg_map_leave(pager, entered);
+    return position >= 0 && position <= $pg_max_page_index(pager);
+}
 /**
  * @brief   Get current cached size
+ * @param[in]   pager: pointer to pager_t
  * @return  cached size
  */
-size_t pg_cached_size(void){
-    return ch_size(&PAGER->ch);
+size_t pg_cached_size(pager_t* pager){
+    return ch_size(&pager->ch);
  }
 
+/**
+ * @brief       Set cache budget of opened database
+ * @param[in]   pager: pointer to pager_t
+ * @param[in]   budget: budget in bytes
+ * @return      PAGER_SUCCESS on success, PAGER_FAIL otherwise
+ */
+
+int pg_set_cache_budget(pager_t* pager, size_t budget){
+    if(ch_set_budget(&pager->ch, budget) == CH_FAIL){
+        logger(LL_ERROR, __func__, "Unable to set cache budget");
+        return PAGER_FAIL;
+    }
+    return PAGER_SUCCESS;
+}
+
+/**
+ * @brief       Get cache budget
+ * @param[in]   pager: pointer to pager_t
+ * @return      budget in bytes
+ */
+
+size_t pg_cache_budget(pager_t* pager){
+    return ch_budget(&pager->ch);
+}
 
+/**
+ * @brief       Get number of bytes of mapped pages backed by huge pages
+ * @param[in]   pager: pointer to pager_t
+ * @return      bytes backed by huge pages
+ */
+
+size_t pg_huge_bytes(pager_t* pager){
+    return fl_huge_bytes(&pager->ch.file);
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include "caching.h"
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
 
@@ -7,25 +8,114 @@
 #define PAGE_POOL_SIZE 100
 #endif
 
+/* Free space bitmap: page g * PG_GROUP_PAGES holds bits of the PG_GROUP_PAGES pages starting with it
+ * after header of PG_HEADER_SIZE bytes, bit is set for used page. Bitmap page marks itself as used
+ * and is never freed. Header of the first bitmap page is pager header. */
+#define PG_HEADER_SIZE 64
+#define PG_GROUP_PAGES ((int64_t)(PAGE_SIZE - PG_HEADER_SIZE) * 8)
+
+/* Pager header starts with magic and version of file format, file of other format isn't opened.
+ * Versions:
+ *  1 - free page bitmap and relocation map of compaction
+ *  2 - occupancy and chain head bitmaps in chunk header
+ *  3 - compact header of single-block rows */
+#define PG_MAGIC 0x0000004244504c4cull   /* "LLPDB" */
+#define PG_VERSION 3
+
+/* Open addressing page index -> page index map, -1 key is empty slot */
+typedef struct pg_map{
+    int64_t* keys;
+    int64_t* values;
+    size_t mask;
+    size_t count;
+} pg_map_t;
+
+/* Latches of pager are kept in that many hash chains */
+#ifndef PG_LATCH_BUCKETS
+#define PG_LATCH_BUCKETS 64
+#endif
+/* Different latches held by one thread at once */
+#ifndef PG_LATCH_DEPTH
+#define PG_LATCH_DEPTH 16
+#endif
+
+/* Latch of page, readers is -1 while it is held exclusively */
+typedef struct pg_latch{
+    int64_t page_index;
+    int64_t readers;
+    uint32_t users;             /* threads holding or waiting for latch */
+    lk_cond_t released;
+    struct pg_latch* next;
+} pg_latch_t;
+
 typedef struct pager{
     caching_t ch;
-    int64_t deleted_pages; // index of parray page with deleted pages
+    int64_t free_hint; // every page below it is used
+    pg_map_t moved;     // page index -> position in file of pages moved by compaction
+    pg_map_t owner;     // position in file -> page index, inverse of moved
+    atomic_int map_readers;  // threads looking up positions in moved
+    atomic_bool map_moving;  // compaction is moving page, lookups wait for it
+    lk_mutex_t map_lock;     // waits for map_readers and map_moving
+    lk_cond_t map_changed;   // the last reader left or move is done
+    lk_mutex_t lock;    // allocation, guards free space bitmap and free_hint
+    atomic_int users;   // threads attached to pager
+    lk_mutex_t latch_lock;
+    pg_latch_t* latches[PG_LATCH_BUCKETS];
+    pg_latch_t* free_latches;
 } pager_t;
 
 enum PagerStatuses{PAGER_SUCCESS = 0, PAGER_FAIL = -1, PAGER_DELETED=-2};
 
+/* Page of pager held by pg_pinned or pg_latched variable, negative index holds nothing */
+typedef struct pg_scoped{
+    pager_t* pager;
+    int64_t page_index;
+} pg_scoped_t;
+
+/**
+ * Variable holding index returned by pg_pin, page is unpinned when variable leaves its scope,
+ * so pager must stay open till then.
+ * pg_scoped_t pin pg_pinned = {pager, pg_pin(pager, page_index)};
+ */
+#define pg_pinned __attribute__((cleanup(pg_unpin_scoped)))
 
-int pg_init(const char* file_name);
-int pg_delete(void);
-int pg_close(void);
-int64_t pg_alloc(void);
-int pg_dealloc(int64_t page_index);
-int pg_rm_cached(int64_t page_index);
-void* pg_load_page(int64_t page_index);
-int pg_write(int64_t page_index, void* src, size_t size, off_t offset);
-int pg_copy_read(int64_t page_index, void* dest, size_t size, off_t offset);
-off_t pg_file_size(void);
-int64_t pg_max_page_index(void);
-size_t pg_cached_size(void);
+/**
+ * Variable holding index returned by pg_latch, latch is released when variable leaves its scope.
+ * pg_scoped_t latch pg_latched = {pager, pg_latch(pager, page_index, exclusive)};
+ */
+#define pg_latched __attribute__((cleanup(pg_unlatch_scoped)))
 
 
+pager_t* pg_init(const char* file_name);
+pager_t* pg_init_opt(const char* file_name, const ch_options_t* opt);
+void pg_attach(pager_t* pager);
+void pg_detach(pager_t* pager);
+int pg_delete(pager_t* pager);
+int pg_close(pager_t* pager);
+int64_t pg_alloc(pager_t* pager);
+int pg_alloc_n(pager_t* pager, int64_t count, int64_t* pages);
+int pg_dealloc(pager_t* pager, int64_t page_index);
+int pg_rm_cached(pager_t* pager, int64_t page_index);
+int pg_commit(pager_t* pager);
+int64_t pg_pin(pager_t* pager, int64_t page_index);
+int pg_unpin(pager_t* pager, int64_t page_index);
+int pg_keep(pager_t* pager, int64_t page_index);
+void pg_unpin_scoped(pg_scoped_t* pin);
+int64_t pg_latch(pager_t* pager, int64_t page_index, bool exclusive);
+int pg_unlatch(pager_t* pager, int64_t page_index);
+void pg_unlatch_scoped(pg_scoped_t* latch);
+void* pg_load_page(pager_t* pager, int64_t page_index);
+const void* pg_read_page(pager_t* pager, int64_t page_index);
+int64_t pg_prefetch(pager_t* pager, const int64_t* pages, size_t count);
+void pg_readahead(pager_t* pager, int64_t prev_page, int64_t page_index);
+int pg_write(pager_t* pager, int64_t page_index, void* src, size_t size, off_t offset);
+int pg_copy_read(pager_t* pager, int64_t page_index, void* dest, size_t size, off_t offset);
+off_t pg_file_size(pager_t* pager);
+off_t pg_disk_size(pager_t* pager);
+int64_t pg_max_page_index(pager_t* pager);
+bool pg_exists(pager_t* pager, int64_t page_index);
+int64_t pg_compact(pager_t* pager, int64_t max_moves);
+size_t pg_cached_size(pager_t* pager);
+int pg_set_cache_budget(pager_t* pager, size_t budget);
+size_t pg_cache_budget(pager_t* pager);
+size_t pg_huge_bytes(pager_t* pager);
@@ -0,0 +1,222 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "syncer.h"
+#include "utils/logger.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__) || defined(__APPLE__) || defined(__unix__)
+#include <pthread.h>
+#include <time.h>
+
+/* Committer waiting for sync which covers its ticket */
+typedef struct syn_waiter{
+    uint64_t ticket;
+    int status;                 /* status of sync which covered ticket */
+    bool done;
+    struct syn_waiter* next;
+} syn_waiter_t;
+
+struct syncer{
+    file_t* file;
+    syn_mode_t mode;
+    uint32_t interval_ms;
+    pthread_mutex_t lock;
+    pthread_cond_t done;        /* sync finished */
+    pthread_cond_t tick;        /* wakes periodic thread on stop */
+    pthread_t thread;
+    bool started;
+    bool stop;
+    bool syncing;               /* some committer is syncing file */
+    uint64_t requested;         /* last commit ticket */
+    syn_waiter_t* waiters;      /* committers whose tickets aren't synced yet */
+    uint64_t count;             /* syncs of file */
+};
+
+static void* syn_periodic(void* arg){
+    syncer_t* syn = arg;
+    pthread_mutex_lock(&syn->lock);
+    while(!syn->stop){
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += syn->interval_ms / 1000;
+        deadline.tv_nsec += (long)(syn->interval_ms % 1000) * 1000000L;
+        if(deadline.tv_nsec >= 1000000000L){
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        while(!syn->stop && pthread_cond_timedwait(&syn->tick, &syn->lock, &deadline) != ETIMEDOUT);
+        if(syn->stop){
+            break;
+        }
+        pthread_mutex_unlock(&syn->lock);
+        int res = fl_sync(syn->file);
+        pthread_mutex_lock(&syn->lock);
+        syn->count++;
+        if(res == FILE_FAIL){
+            logger(LL_ERROR, __func__, "Unable to sync file");
+        }
+    }
+    pthread_mutex_unlock(&syn->lock);
+    return NULL;
+}
+
+/**
+ * @brief       Create sync scheduler of file
+ * @details     Periodic mode starts thread which syncs file every interval.
+ * @param[in]   file: pointer to file_t
+ * @param[in]   opt: options or NULL for defaults
+ * @return      pointer to syncer_t or NULL on failure
+ */
+
+syncer_t* syn_init(file_t* file, const syn_options_t* opt){
+    syncer_t* syn = calloc(1, sizeof(syncer_t));
+    if(!syn){
+        return NULL;
+    }
+    syn->file = file;
+    syn->mode = opt && opt->mode != SYN_MODE_DEFAULT ? opt->mode : SYN_DEFAULT_MODE;
+    syn->interval_ms = opt && opt->interval_ms ? opt->interval_ms : SYN_DEFAULT_INTERVAL_MS;
+    pthread_mutex_init(&syn->lock, NULL);
+    pthread_cond_init(&syn->done, NULL);
+    pthread_cond_init(&syn->tick, NULL);
+    if(syn->mode == SYN_MODE_PERIODIC){
+        if(pthread_create(&syn->thread, NULL, syn_periodic, syn) != 0){
+            logger(LL_WARN, __func__, "Unable to start sync thread: %s, syncing on commit", strerror(errno));
+            syn->mode = SYN_MODE_COMMIT;
+        }
+        else{
+            syn->started = true;
+        }
+    }
+    return syn;
+}
+
+syn_mode_t syn_mode(syncer_t* syn){
+    return syn->mode;
+}
+
+/**
+ * @brief       Make data written to file durable
+ * @details     Only commit mode syncs here. Each commit takes a ticket, the first committer
+ *              syncs file for every ticket taken before the sync started, committers which
+ *              came meanwhile wait and the next one of them syncs for all of them. Each
+ *              committer gets status of the sync which covered its ticket. Thread safe.
+ * @param[in]   syn: pointer to syncer_t
+ * @return      SYN_SUCCESS on success, SYN_FAIL if sync failed
+ */
+
+int syn_commit(syncer_t* syn){
+    if(syn->mode != SYN_MODE_COMMIT){
+        return SYN_SUCCESS;
+    }
+    pthread_mutex_lock(&syn->lock);
+    syn_waiter_t self = {.ticket = ++syn->requested, .status = SYN_SUCCESS, .next = syn->waiters};
+    syn->waiters = &self;
+    while(!self.done){
+        if(syn->syncing){
+            pthread_cond_wait(&syn->done, &syn->lock);
+            continue;
+        }
+        syn->syncing = true;
+        uint64_t target = syn->requested;
+        pthread_mutex_unlock(&syn->lock);
+        int res = fl_sync(syn->file);
+        pthread_mutex_lock(&syn->lock);
+        syn->syncing = false;
+        syn->count++;
+        /* sync covered every ticket up to target, later syncs don't change their status */
+        for(syn_waiter_t** waiter = &syn->waiters; *waiter;){
+            if((*waiter)->ticket > target){
+                waiter = &(*waiter)->next;
+                continue;
+            }
+            (*waiter)->status = res == FILE_SUCCESS ? SYN_SUCCESS : SYN_FAIL;
+            (*waiter)->done = true;
+            *waiter = (*waiter)->next;
+        }
+        pthread_cond_broadcast(&syn->done);
+    }
+    pthread_mutex_unlock(&syn->lock);
+    return self.status;
+}
+
+uint64_t syn_count(syncer_t* syn){
+    pthread_mutex_lock(&syn->lock);
+    uint64_t count = syn->count;
+    pthread_mutex_unlock(&syn->lock);
+    return count;
+}
+
+/**
+ * @brief       Destroy syncer, file is synced unless durability is off
+ * @param[in]   syn: pointer to syncer_t
+ */
+
+void syn_destroy(syncer_t* syn){
+    if(!syn){
+        return;
+    }
+    if(syn->started){
+        pthread_mutex_lock(&syn->lock);
+        syn->stop = true;
+        pthread_cond_signal(&syn->tick);
+        pthread_mutex_unlock(&syn->lock);
+        pthread_join(syn->thread, NULL);
+    }
+    if(syn->mode != SYN_MODE_NONE && fl_sync(syn->file) == FILE_FAIL){
+        logger(LL_ERROR, __func__, "Unable to sync file");
+    }
+    pthread_mutex_destroy(&syn->lock);
+    pthread_cond_destroy(&syn->done);
+    pthread_cond_destroy(&syn->tick);
+    free(syn);
+}
+
+#else
+
+struct syncer{
+    file_t* file;
+    syn_mode_t mode;
+    uint64_t count;
+};
+
+syncer_t* syn_init(file_t* file, const syn_options_t* opt){
+    syncer_t* syn = calloc(1, sizeof(syncer_t));
+    if(syn){
+        syn->file = file;
+        syn->mode = opt && opt->mode != SYN_MODE_DEFAULT ? opt->mode : SYN_DEFAULT_MODE;
+        /* no background thread, periodic mode syncs on commit */
+        if(syn->mode == SYN_MODE_PERIODIC){
+            syn->mode = SYN_MODE_COMMIT;
+        }
+    }
+    return syn;
+}
+
+syn_mode_t syn_mode(syncer_t* syn){
+    return syn->mode;
+}
+
+int syn_commit(syncer_t* syn){
+    if(syn->mode != SYN_MODE_COMMIT){
+        return SYN_SUCCESS;
+    }
+    syn->count++;
+    return fl_sync(syn->file) == FILE_SUCCESS ? SYN_SUCCESS : SYN_FAIL;
+}
+
+uint64_t syn_count(syncer_t* syn){
+    return syn->count;
+}
+
+void syn_destroy(syncer_t* syn){
+    if(syn && syn->mode != SYN_MODE_NONE){
+        fl_sync(syn->file);
+    }
+    free(syn);
+}
+
+#endif
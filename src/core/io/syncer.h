@@ -0,0 +1,34 @@
+#pragma once
+#include "file.h"
+#include <stdint.h>
+
+/**
+ * Durability of written pages.
+ * SYN_MODE_DEFAULT  - SYN_DEFAULT_MODE
+ * SYN_MODE_NONE     - file is never synced, data is durable when kernel writes it
+ * SYN_MODE_PERIODIC - file is synced every interval_ms by background thread
+ * SYN_MODE_COMMIT   - commit returns when file is synced, concurrent commits share one sync
+ */
+typedef enum syn_mode {SYN_MODE_DEFAULT = 0, SYN_MODE_NONE = 1, SYN_MODE_PERIODIC = 2, SYN_MODE_COMMIT = 3} syn_mode_t;
+
+#ifndef SYN_DEFAULT_MODE
+#define SYN_DEFAULT_MODE SYN_MODE_NONE
+#endif
+#ifndef SYN_DEFAULT_INTERVAL_MS
+#define SYN_DEFAULT_INTERVAL_MS 1000
+#endif
+
+typedef struct syn_options{
+    syn_mode_t mode;
+    uint32_t interval_ms;       /* period of SYN_MODE_PERIODIC, 0 - default */
+} syn_options_t;
+
+typedef struct syncer syncer_t;
+
+typedef enum {SYN_SUCCESS = 0, SYN_FAIL = -1} syn_status_t;
+
+syncer_t* syn_init(file_t* file, const syn_options_t* opt);
+syn_mode_t syn_mode(syncer_t* syn);
+int syn_commit(syncer_t* syn);
+uint64_t syn_count(syncer_t* syn);
+void syn_destroy(syncer_t* syn);
@@ -0,0 +1,440 @@
+#include "wal.h"
+#include "utils/lock.h"
+#include "utils/logger.h"
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WAL_MAGIC 0x4C415752u /* "RWAL" */
+
+/* Log and data file are accessed by pread/pwrite only, nothing is mapped */
+static const fl_options_t WAL_FILE_OPT = {.map_mode = FL_MAP_PAGE, .backend = FL_BACKEND_MMAP};
+
+struct wal{
+    lk_mutex_t lock;            /* log is shared by threads of cacher */
+    file_t file;
+    syncer_t* syncer;
+    uint64_t lsn;               /* number of next record */
+    off_t end;                  /* end of records written to log */
+    off_t synced;               /* records before this offset are durable */
+    uint8_t* buffer;            /* records which aren't written yet */
+    size_t used;
+    uint32_t pending;           /* pages logged since last commit */
+    uint64_t pages;             /* number of pages in file at last commit */
+};
+
+static char* wal_name(const char* file_name){
+    size_t len = strlen(file_name);
+    char* name = malloc(len + sizeof(WAL_SUFFIX));
+    if(name){
+        memcpy(name, file_name, len);
+        memcpy(name + len, WAL_SUFFIX, sizeof(WAL_SUFFIX));
+    }
+    return name;
+}
+
+/**
+ * @brief       FNV-1a over 64-bit words
+ * @param[in]   hash: hash of preceding data
+ * @param[in]   data: data, size is multiple of 8
+ * @param[in]   size: size of data
+ * @return      hash
+ */
+
+static uint64_t wal_hash(uint64_t hash, const void* data, size_t size){
+    const uint8_t* bytes = data;
+    for(size_t i = 0; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)){
+        uint64_t word;
+        memcpy(&word, bytes + i, sizeof(word));
+        hash = (hash ^ word) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+static uint32_t wal_checksum(const wal_rec_t* rec, const void* page){
+    wal_rec_t header = *rec;
+    header.checksum = 0;
+    uint64_t hash = wal_hash(0xCBF29CE484222325ull, &header, sizeof(header));
+    if(page){
+        hash = wal_hash(hash, page, PAGE_SIZE);
+    }
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+/**
+ * @brief       Write gathered records to log
+ * @param[in]   wal: pointer to wal_t
+ * @return      WAL_SUCCESS on success, WAL_FAIL otherwise
+ */
+
+static int wal_write(wal_t* wal){
+    if(!wal->used){
+        return WAL_SUCCESS;
+    }
+    if(fl_write_back(&wal->file, wal->buffer, wal->used, wal->end) == FILE_FAIL){
+        logger(LL_ERROR, __func__, "Unable to write %zu bytes to log", wal->used);
+        wal->used = 0;
+        return WAL_FAIL;
+    }
+    wal->end += (off_t)wal->used;
+    wal->file.file_size = wal->file.phys_size = wal->end;
+    wal->used = 0;
+    return WAL_SUCCESS;
+}
+
+/**
+ * @brief       Append record to buffer, buffer is written when it is full
+ * @param[in]   wal: pointer to wal_t
+ * @param[in]   type: type of record
+ * @param[in]   value: page index or number of pages
+ * @param[in]   page: page image of WAL_REC_PAGE or NULL
+ * @return      WAL_SUCCESS on success, WAL_FAIL otherwise
+ */
+
+static int wal_append(wal_t* wal, uint32_t type, int64_t value, const void* page){
+    size_t size = sizeof(wal_rec_t) + (page ? PAGE_SIZE : 0);
+    if(wal->used + size > WAL_BUFFER_SIZE && wal_write(wal) == WAL_FAIL){
+        return WAL_FAIL;
+    }
+    wal_rec_t rec = {.magic = WAL_MAGIC, .type = type, .lsn = wal->lsn++, .value = value,
+                     .count = type == WAL_REC_COMMIT ? wal->pending : 0};
+    rec.checksum = wal_checksum(&rec, page);
+    memcpy(wal->buffer + wal->used, &rec, sizeof(rec));
+    if(page){
+        memcpy(wal->buffer + wal->used + sizeof(rec), page, PAGE_SIZE);
+    }
+    wal->used += size;
+    return WAL_SUCCESS;
+}
+
+/**
+ * @brief       Read record at offset of log
+ * @param[in]   log: pointer to file_t of log
+ * @param[in]   offset: offset of record
+ * @param[out]  rec: record
+ * @param[out]  page: page image of WAL_REC_PAGE
+ * @param[in]   lsn: expected number of record, 0 if it is the first record
+ * @return      size of record or 0 if there is no valid record
+ */
+
+static size_t wal_read(file_t* log, off_t offset, wal_rec_t* rec, void* page, uint64_t lsn){
+    if(fl_read_at(log, rec, sizeof(wal_rec_t), offset) == FILE_FAIL || rec->magic != WAL_MAGIC){
+        return 0;
+    }
+    if(lsn ? rec->lsn != lsn : rec->type != WAL_REC_CHECKPOINT){
+        return 0;
+    }
+    bool has_page = rec->type == WAL_REC_PAGE;
+    if(has_page && fl_read_at(log, page, PAGE_SIZE, offset + (off_t)sizeof(wal_rec_t)) == FILE_FAIL){
+        return 0;
+    }
+    if(wal_checksum(rec, has_page ? page : NULL) != rec->checksum){
+        return 0;
+    }
+    return sizeof(wal_rec_t) + (has_page ? PAGE_SIZE : 0);
+}
+
+/**
+ * @brief       Replay log of file left by crash
+ * @details     Log starts with checkpoint record, pages are written to file only when commit
+ *              record of their transaction is found. Replay stops at the first torn or corrupted
+ *              record. File is cut to the number of pages of last commit, synced and the log is
+ *              removed. Nothing is done if there is no log.
+ * @param[in]   file_name: name of data file
+ * @return      WAL_SUCCESS on success, WAL_FAIL otherwise
+ */
+
+int wal_recover(const char* file_name){
+    char* name = wal_name(file_name);
+    if(!name){
+        return WAL_FAIL;
+    }
+    FILE* probe = fopen(name, "rb");
+    if(!probe){
+        free(name);
+        return WAL_SUCCESS;
+    }
+    fclose(probe);
+    file_t log, data;
+    if(init_file_opt(name, &log, &WAL_FILE_OPT) == FILE_FAIL){
+        free(name);
+        return WAL_FAIL;
+    }
+    free(name);
+    if(init_file_opt(file_name, &data, &WAL_FILE_OPT) == FILE_FAIL){
+        close_file(&log);
+        return WAL_FAIL;
+    }
+    int res = WAL_SUCCESS;
+    int64_t pages = -1;
+    size_t commits = 0;
+    size_t n = 0, capacity = 0;
+    int64_t* indexes = NULL;
+    uint8_t* images = NULL;
+    wal_rec_t rec;
+    uint64_t lsn = 0;
+    for(off_t offset = 0;;){
+        if(n == capacity){
+            capacity = capacity ? capacity * 2 : 16;
+            int64_t* new_indexes = realloc(indexes, capacity * sizeof(int64_t));
+            indexes = new_indexes ? new_indexes : indexes;
+            uint8_t* new_images = realloc(images, capacity * PAGE_SIZE);
+            images = new_images ? new_images : images;
+            if(!new_indexes || !new_images){
+                res = WAL_FAIL;
+                break;
+            }
+        }
+        size_t size = wal_read(&log, offset, &rec, images + n * PAGE_SIZE, lsn);
+        if(!size){
+            break;
+        }
+        offset += (off_t)size;
+        lsn = rec.lsn + 1;
+        if(rec.type == WAL_REC_PAGE){
+            indexes[n++] = rec.value;
+            continue;
+        }
+        if(rec.type == WAL_REC_COMMIT && rec.count == n){
+            for(size_t i = 0; i < n; ++i){
+                if(fl_write_back(&data, images + i * PAGE_SIZE, PAGE_SIZE, fl_page_offset(indexes[i])) == FILE_FAIL){
+                    res = WAL_FAIL;
+                }
+            }
+            commits++;
+        }
+        else if(rec.type != WAL_REC_CHECKPOINT){
+            break;
+        }
+        pages = rec.value;
+        n = 0;
+    }
+    free(indexes);
+    free(images);
+    if(pages >= 0 && fl_truncate(&data, fl_page_offset(pages)) == FILE_FAIL){
+        res = WAL_FAIL;
+    }
+    if(fl_sync(&data) == FILE_FAIL){
+        res = WAL_FAIL;
+    }
+    close_file(&data);
+    if(res == WAL_SUCCESS){
+        logger(LL_INFO, __func__, "Replayed %zu commits, file has %"PRId64" pages", commits, pages);
+        delete_file(&log);
+    }
+    else{
+        logger(LL_ERROR, __func__, "Unable to replay log, it is kept");
+        close_file(&log);
+    }
+    return res;
+}
+
+/**
+ * @brief       Start new log of file
+ * @details     Log is started with checkpoint record, so file must be consistent.
+ * @param[in]   file_name: name of data file
+ * @param[in]   sync: durability of commits, NULL for default
+ * @param[in]   pages: number of pages in file
+ * @return      pointer to wal_t or NULL on failure
+ */
+
+wal_t* wal_open(const char* file_name, const syn_options_t* sync, uint64_t pages){
+    wal_t* wal = calloc(1, sizeof(wal_t));
+    char* name = wal_name(file_name);
+    if(wal){
+        wal->buffer = malloc(WAL_BUFFER_SIZE);
+    }
+    if(!wal || !name || !wal->buffer || init_file_opt(name, &wal->file, &WAL_FILE_OPT) == FILE_FAIL){
+        logger(LL_ERROR, __func__, "Unable to open log of %s", file_name);
+        free(name);
+        if(wal){
+            free(wal->buffer);
+        }
+        free(wal);
+        return NULL;
+    }
+    free(name);
+    lk_mutex_init(&wal->lock);
+    wal->pages = pages;
+    wal->syncer = syn_init(&wal->file, sync);
+    if(!wal->syncer || wal_checkpoint(wal) == WAL_FAIL){
+        wal_close(wal, true);
+        return NULL;
+    }
+    return wal;
+}
+
+/**
+ * @brief       Log redo image of page
+ * @details     Image is copied, page may be changed or evicted right after the call.
+ * @param[in]   wal: pointer to wal_t
+ * @param[in]   page_index: index of page
+ * @param[in]   page: page
+ * @return      WAL_SUCCESS on success, WAL_FAIL otherwise
+ */
+
+int wal_log(wal_t* wal, int64_t page_index, const void* page){
+    lk_lock(&wal->lock);
+    int res = wal_append(wal, WAL_REC_PAGE, page_index, page);
+    if(res == WAL_SUCCESS){
+        wal->pending++;
+    }
+    lk_unlock(&wal->lock);
+    return res;
+}
+
+/**
+ * @brief       Log image of page evicted before commit
+ * @details     Record is like the one of wal_log, it is committed by the next commit record and
+ *              ignored by recovery without it. Image stays readable by wal_read_page till checkpoint.
+ * @param[in]   wal: pointer to wal_t
+ * @param[in]   page_index: index of page
+ * @param[in]   page: page
+ * @return      offset of image in log or -1 on failure
+ */
+
+off_t wal_spill(wal_t* wal, int64_t page_index, const void* page){
+    lk_lock(&wal->lock);
+    off_t offset = -1;
+    if(wal_append(wal, WAL_REC_PAGE, page_index, page) == WAL_SUCCESS){
+        wal->pending++;
+        offset = wal->end + (off_t)(wal->used - PAGE_SIZE);
+    }
+    lk_unlock(&wal->lock);
+    return offset;
+}
+
+/**
+ * @brief       Read page image logged by wal_spill
+ * @param[in]   wal: pointer to wal_t
+ * @param[in]   offset: offset of image in log
+ * @param[out]  page: page
+ * @return      WAL_SUCCESS on success, WAL_FAIL otherwise
+ */
+
+int wal_read_page(wal_t* wal, off_t offset, void* page){
+    lk_lock(&wal->lock);
+    int res = WAL_SUCCESS;
+    if(offset >= wal->end){
+        /* record isn't written yet */
+        memcpy(page, wal->buffer + (offset - wal->end), PAGE_SIZE);
+    }
+    else if(fl_read_at(&wal->file, page, PAGE_SIZE, offset) == FILE_FAIL){
+        logger(LL_ERROR, __func__, "Unable to read page image at %ld of log", offset);
+        res = WAL_FAIL;
+    }
+    lk_unlock(&wal->lock);
+    return res;
+}
+
+/**
+ * @brief       Commit pages logged since previous commit
+ * @details     Page records and commit record go to log by one write, log is synced
+ *              according to durability mode.
+ * @param[in]   wal: pointer to wal_t
+ * @param[in]   pages: number of pages in file
+ * @return      WAL_SUCCESS on success, WAL_FAIL otherwise
+ */
+
+int wal_commit(wal_t* wal, uint64_t pages){
+    lk_lock(&wal->lock);
+    if(wal_append(wal, WAL_REC_COMMIT, (int64_t)pages, NULL) == WAL_FAIL){
+        lk_unlock(&wal->lock);
+        return WAL_FAIL;
+    }
+    wal->pending = 0;
+    wal->pages = pages;
+    off_t end = wal->end + (off_t)wal->used;
+    int res = wal_write(wal) == WAL_FAIL || syn_commit(wal->syncer) == SYN_FAIL ? WAL_FAIL : WAL_SUCCESS;
+    if(res == WAL_SUCCESS && syn_mode(wal->syncer) == SYN_MODE_COMMIT){
+        wal->synced = end;
+    }
+    lk_unlock(&wal->lock);
+    return res;
+}
+
+/**
+ * @brief       Make committed records durable
+ * @details     It is called before logged pages are written to data file, so file is never
+ *              ahead of log. Nothing is done without durability.
+ * @param[in]   wal: pointer to wal_t
+ * @return      WAL_SUCCESS on success, WAL_FAIL otherwise
+ */
+
+int wal_sync(wal_t* wal){
+    if(syn_mode(wal->syncer) == SYN_MODE_NONE){
+        return WAL_SUCCESS;
+    }
+    lk_lock(&wal->lock);
+    int res = WAL_SUCCESS;
+    if(wal->synced != wal->end){
+        off_t end = wal->end;
+        res = fl_sync(&wal->file) == FILE_FAIL ? WAL_FAIL : WAL_SUCCESS;
+        if(res == WAL_SUCCESS){
+            wal->synced = end;
+        }
+    }
+    lk_unlock(&wal->lock);
+    return res;
+}
+
+static int wal_restart(wal_t* wal){
+    logger(LL_DEBUG, __func__, "Checkpoint of %"PRIu64" pages, log size %ld", wal->pages, wal->end + (off_t)wal->used);
+    if(fl_truncate(&wal->file, 0) == FILE_FAIL){
+        return WAL_FAIL;
+    }
+    wal->end = wal->synced = 0;
+    wal->used = 0;
+    wal->pending = 0;
+    wal->lsn = 1;
+    if(wal_append(wal, WAL_REC_CHECKPOINT, (int64_t)wal->pages, NULL) == WAL_FAIL || wal_write(wal) == WAL_FAIL){
+        return WAL_FAIL;
+    }
+    if(syn_mode(wal->syncer) != SYN_MODE_NONE && fl_sync(&wal->file) == FILE_FAIL){
+        return WAL_FAIL;
+    }
+    wal->synced = wal->end;
+    return WAL_SUCCESS;
+}
+
+/**
+ * @brief       Restart log, file must already hold committed pages and be synced
+ * @param[in]   wal: pointer to wal_t
+ * @return      WAL_SUCCESS on success, WAL_FAIL otherwise
+ */
+
+int wal_checkpoint(wal_t* wal){
+    lk_lock(&wal->lock);
+    int res = wal_restart(wal);
+    lk_unlock(&wal->lock);
+    return res;
+}
+
+off_t wal_size(wal_t* wal){
+    lk_lock(&wal->lock);
+    off_t size = wal->end + (off_t)wal->used;
+    lk_unlock(&wal->lock);
+    return size;
+}
+
+/**
+ * @brief       Close log
+ * @param[in]   wal: pointer to wal_t
+ * @param[in]   remove_log: remove log file, file must be checkpointed
+ */
+
+void wal_close(wal_t* wal, bool remove_log){
+    if(!wal){
+        return;
+    }
+    syn_destroy(wal->syncer);
+    if(remove_log){
+        delete_file(&wal->file);
+    }
+    else{
+        close_file(&wal->file);
+    }
+    free(wal->buffer);
+    lk_mutex_destroy(&wal->lock);
+    free(wal);
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include "file.h"
+#include "syncer.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Log of file "name" is "name" WAL_SUFFIX */
+#define WAL_SUFFIX "-wal"
+/* Log is checkpointed on commit when it grows beyond this size */
+#ifndef WAL_CHECKPOINT_SIZE
+#define WAL_CHECKPOINT_SIZE (16 * 1024 * 1024)
+#endif
+/* Records are gathered in buffer of this size and written by one request */
+#ifndef WAL_BUFFER_SIZE
+#define WAL_BUFFER_SIZE (1024 * 1024)
+#endif
+
+/**
+ * Log record, PAGE record is followed by page image.
+ * WAL_REC_PAGE       - redo image of page, value is page index
+ * WAL_REC_COMMIT     - pages logged since previous commit are committed, value is number of pages in file
+ * WAL_REC_CHECKPOINT - first record of log, file is consistent, value is number of pages in file
+ */
+enum wal_rec_type {WAL_REC_PAGE = 1, WAL_REC_COMMIT = 2, WAL_REC_CHECKPOINT = 3};
+
+typedef struct wal_rec{
+    uint32_t magic;
+    uint32_t type;
+    uint64_t lsn;               /* records are numbered sequentially from checkpoint */
+    int64_t value;
+    uint32_t count;             /* commit: number of pages in transaction */
+    uint32_t checksum;          /* FNV-1a of record with zero checksum and page image */
+} wal_rec_t;
+
+typedef struct wal wal_t;
+
+typedef enum {WAL_SUCCESS = 0, WAL_FAIL = -1} wal_status_t;
+
+int wal_recover(const char* file_name);
+wal_t* wal_open(const char* file_name, const syn_options_t* sync, uint64_t pages);
+int wal_log(wal_t* wal, int64_t page_index, const void* page);
+off_t wal_spill(wal_t* wal, int64_t page_index, const void* page);
+int wal_read_page(wal_t* wal, off_t offset, void* page);
+int wal_commit(wal_t* wal, uint64_t pages);
+int wal_sync(wal_t* wal);
+int wal_checkpoint(wal_t* wal);
+off_t wal_size(wal_t* wal);
+void wal_close(wal_t* wal, bool remove_log);
@@ -4,76 +4,148 @@
 #include "page_pool.h"
 #include "utils/logger.h"
 
-#include <math.h>
+#define LB_ROWID_MASK (LB_NEXT - 1)
 
 /**
- * \brief       Allocates new linked block, with custom memory start
- * \param[in]   page_pool: pointer to page pool
- * \param[in]   mem_start: memory start
- * \return      chblix or chblix_fail
+ * @brief       Get next block of row from header
+ * @param[in]   lb: header of block
+ * @return      chblix of next block or chblix_fail if row ends in this block
  */
 
-chblix_t lb_alloc_m(page_pool_t* page_pool, int64_t mem_start){
-    logger(LL_DEBUG, __func__, "Linked_block allocating start.");
-    if(page_pool == NULL){
-        logger(LL_ERROR, __func__, "Invalid argument: page_pool is NULL");
+static chblix_t lb_next(const linked_block_t* lb){
+    if(!(lb->link & LB_NEXT)){
         return chblix_fail();
     }
+    return rowid_unpack(lb->link & LB_ROWID_MASK);
+}
 
-    chblix_t chblix = ppl_alloc_nova(page_pool);
-    if (chblix.block_idx == -1) {
-        logger(LL_ERROR, __func__, "Unable to allocate block");
-        return chblix_fail();
+/**
+ * @brief       Make header of block which is continued by next block
+ * @param[in]   next: chblix of next block
+ * @return      header of block
+ */
+
+static linked_block_t lb_link(chblix_t next){
+    return (linked_block_t){.link = LB_USED | LB_NEXT | rowid_pack(next)};
+}
+
+/**
+ * @brief       Read header of linked block
+ * @param[in]   pager: pointer to pager_t
+ * @param[in]   ppl: Page pool pointer
+ * @param[in]   chunk: pointer to chunk of block, it is loaded if it is NULL or isn't chunk of block
+ * @param[in]   chblix: Chunk Block Index
+ * @param[out]  lb: Linked Block header
+ * @return      LB_SUCCESS on success, LB_FAIL otherwise
+ */
+
+static int lb_load_header(pager_t* pager, page_pool_t* ppl, chunk_t* chunk, const chblix_t* chblix, linked_block_t* lb){
+    if(chunk == NULL || chunk->page_index != chblix->chunk_idx){
+        chunk = ppl_read_chunk(pager, chblix->chunk_idx);
+        if(chunk == NULL){
+            logger(LL_ERROR, __func__, "Unable to load chunk %ld", chblix->chunk_idx);
+            return LB_FAIL;
+        }
     }
+    return ppl_read_block_nova(pager, ppl, (linked_page_t*)chunk, chblix, lb, sizeof(linked_block_t), 0) == PPL_FAIL
+           ? LB_FAIL : LB_SUCCESS;
+}
 
-    chunk_t* chunk = ppl_load_chunk(chblix.chunk_idx);
+/**
+ * @brief       Update header of linked block, data of block is left as it is
+ * @param[in]   pager: pointer to pager_t
+ * @param[in]   ppl: Page pool pointer
+ * @param[in]   chblix: Chunk Block Index
+ * @param[in]   lb: Linked Block header
+ * @return      LB_SUCCESS on success, LB_FAIL otherwise
+ */
 
-    linked_block_t* lb = malloc(page_pool->block_size); /* Don't forget to free it */
-    lb_load_nova_pppp(page_pool, chunk,  &chblix, lb);
+static int lb_update_header(pager_t* pager, page_pool_t* ppl, const chblix_t* chblix, const linked_block_t* lb){
+    if(ppl_write_block_nova(pager, ppl, chblix, (void*)lb, sizeof(linked_block_t), 0) != PPL_SUCCESS){
+        logger(LL_ERROR, __func__, "Unable to write block header");
+        return LB_FAIL;
+    }
+    return LB_SUCCESS;
+}
 
-    lb->next_block = chblix_fail();
-    lb->prev_block = chblix_fail();
-    lb->chblix = chblix;
-    lb->flag = LB_USED;
-    lb->mem_start = mem_start;
+/**
+ * \brief       Allocates new linked block and links it after previous one
+ * \details     Block without previous one starts row, it is marked in chain head bitmap of its chunk.
+ * \param[in]   pager: pointer to pager_t
+ * \param[in]   page_pool: pointer to page pool
+ * \param[in]   prev: chblix of the last block of row or chblix_fail
+ * \return      chblix or chblix_fail
+ */
 
-    lb_update_nova(page_pool, &chblix, lb);
+static chblix_t lb_alloc_linked(pager_t* pager, page_pool_t* page_pool, chblix_t prev){
+    chblix_t chblix = ppl_alloc_nova(pager, page_pool);
+    if (chblix.block_idx == -1) {
+        logger(LL_ERROR, __func__, "Unable to allocate block");
+        return chblix_fail();
+    }
 
-    logger(LL_DEBUG, __func__,
-           "Linked_block allocating finished. Linked_block chunk_index: %ld, block_index: %ld",
-           chblix.chunk_idx, chblix.block_idx);
+    linked_block_t lb = {.link = LB_USED};
+    if(lb_update_header(pager, page_pool, &chblix, &lb) == LB_FAIL){
+        return chblix_fail();
+    }
 
-    free(lb);
+    if(prev.block_idx == -1){
+        chunk_t* chunk = ppl_load_chunk(pager, chblix.chunk_idx);
+        if(chunk == NULL){
+            logger(LL_ERROR, __func__, "Unable to load chunk %ld", chblix.chunk_idx);
+            return chblix_fail();
+        }
+        ppl_bit_set(ppl_head_bits(chunk), chblix.block_idx);
+    }
+    else{
+        linked_block_t prev_lb = lb_link(chblix);
+        if(lb_update_header(pager, page_pool, &prev, &prev_lb) == LB_FAIL){
+            return chblix_fail();
+        }
+    }
     return chblix;
 }
 
-
 /**
  * \brief       Allocates new linked block
+ * \param[in]   pager: pointer to pager_t
  * \param[in]   page_pool: pointer to page pool
  * \return      chblix or chblix_fail
  */
 
-chblix_t lb_alloc(page_pool_t* page_pool) {
-    return lb_alloc_m(page_pool, sizeof(linked_block_t));
+chblix_t lb_alloc(pager_t* pager, page_pool_t* page_pool) {
+    logger(LL_DEBUG, __func__, "Linked_block allocating start.");
+    if(page_pool == NULL){
+        logger(LL_ERROR, __func__, "Invalid argument: page_pool is NULL");
+        return chblix_fail();
+    }
+
+    chblix_t chblix = lb_alloc_linked(pager, page_pool, chblix_fail());
+
+    logger(LL_DEBUG, __func__,
+           "Linked_block allocating finished. Linked_block chunk_index: %ld, block_index: %ld",
+           chblix.chunk_idx, chblix.block_idx);
+
+    return chblix;
 }
 
 /**
  * \brief       Loads linked block
+ * \param[in]   pager: pointer to pager_t
  * \param[in]   page_pool_idx: Fist page index of page pool
  * \param[in]   chblix: Chunk Block Index
  * \param[out]  lb: Linked Block pointer
  * \return      LB_SUCCESS on success, LB_FAIL otherwise
  */
 
-int lb_load(int64_t page_pool_index, const chblix_t* chblix, linked_block_t* lb) {
-    page_pool_t *ppl = ppl_load(page_pool_index);
+int lb_load(pager_t* pager, int64_t page_pool_index, const chblix_t* chblix, linked_block_t* lb) {
+    page_pool_t *ppl = ppl_read(pager, page_pool_index);
     if (ppl == NULL) {
         logger(LL_ERROR, __func__, "Unable to load page pool");
         return LB_FAIL;
     }
 
-    if(ppl_read_block(page_pool_index, chblix, lb, ppl->block_size, 0) != PPL_SUCCESS){
+    if(ppl_read_block(pager, page_pool_index, chblix, lb, ppl->block_size, 0) != PPL_SUCCESS){
         logger(LL_ERROR, __func__, "Unable to read block");
         return LB_FAIL;
     }
@@ -83,14 +155,15 @@ int lb_load(int64_t page_pool_index, const chblix_t* chblix, linked_block_t* lb)
 
 /**
  * @brief       Update linked block
+ * @param[in]   pager: pointer to pager_t
  * @param[in]   ppl: Page pool pointer
  * @param[in]   chblix: Chunk Block Index
  * @param[in]   lb: Linked Block pointer
  * @return      LB_SUCCESS on success, LB_FAIL otherwise
  */
 
-int lb_update_nova(page_pool_t* ppl, const chblix_t* chblix, linked_block_t* lb){
-    if(ppl_write_block_nova(ppl, chblix, lb, ppl->block_size, 0) != PPL_SUCCESS){
+int lb_update_nova(pager_t* pager, page_pool_t* ppl, const chblix_t* chblix, linked_block_t* lb){
+    if(ppl_write_block_nova(pager, ppl, chblix, lb, ppl->block_size, 0) != PPL_SUCCESS){
         logger(LL_ERROR, __func__, "Unable to read block");
         return LB_FAIL;
     }
@@ -99,20 +172,21 @@ int lb_update_nova(page_pool_t* ppl, const chblix_t* chblix, linked_block_t* lb)
 
 /**
  * @brief       Update linked block
+ * @param[in]   pager: pointer to pager_t
  * @param[in]   ppidx: Fist page index of page pool
  * @param[in]   chblix: Chunk Block Index
  * @param[in]   lb: Linked Block pointer
  * @return      LB_SUCCESS on success, LB_FAIL otherwise
  */
 
-int lb_update(int64_t ppidx, const chblix_t* chblix, linked_block_t* lb) {
-    page_pool_t *ppl = ppl_load(ppidx);
+int lb_update(pager_t* pager, int64_t ppidx, const chblix_t* chblix, linked_block_t* lb) {
+    page_pool_t *ppl = ppl_read(pager, ppidx);
     if (ppl == NULL) {
         logger(LL_ERROR, __func__, "Unable to load page pool");
         return LB_FAIL;
     }
 
-    if(ppl_write_block(ppidx, chblix, lb, ppl->block_size, 0) != PPL_SUCCESS){
+    if(ppl_write_block(pager, ppidx, chblix, lb, ppl->block_size, 0) != PPL_SUCCESS){
         logger(LL_ERROR, __func__, "Unable to read block");
         return LB_FAIL;
     }
@@ -120,136 +194,108 @@ int lb_update(int64_t ppidx, const chblix_t* chblix, linked_block_t* lb) {
     return LB_SUCCESS;
 }
 
-int lb_dealloc_nova(page_pool_t* ppl, linked_block_t* lb){
-    chblix_t fail = chblix_fail();
-    while (chblix_cmp(&lb->next_block, &fail) != 0) {
-        chblix_t next_block_idx = lb->next_block;
-
-        /* Setting flag to free */
-        lb->flag = LB_FREE;
-        lb_update_nova(ppl, &lb->chblix, lb);
+/**
+ * @brief       Deallocates row, every block of it is returned to page pool
+ * @param[in]   pager: pointer to pager_t
+ * @param[in]   ppl: Page pool pointer
+ * @param[in]   chunk: pointer to chunk of the first block or NULL
+ * @param[in]   chblix: chblix of the first block of row
+ * @return      LB_SUCCESS on success, LB_FAIL otherwise
+ */
 
-        /* Deallocating block */
-        if (ppl_dealloc_nova(ppl, &lb->chblix) == PPL_FAIL) {
-            logger(LL_ERROR, __func__, "Unable to deallocate block");
-            free(lb);
+int lb_dealloc_nova(pager_t* pager, page_pool_t* ppl, chunk_t* chunk, const chblix_t* chblix){
+    chblix_t block = *chblix;
+    while (chblix_cmp(&block, &CHBLIX_FAIL) != 0) {
+        linked_block_t lb;
+        if (lb_load_header(pager, ppl, chunk, &block, &lb) == LB_FAIL) {
+            logger(LL_ERROR, __func__, "Unable to read block");
             return LB_FAIL;
         }
+        chblix_t next = lb_next(&lb);
 
-        /* Loading next block */
-        if (lb_load_nova_ppp(ppl, &next_block_idx, lb) == LB_FAIL) {
-            logger(LL_ERROR, __func__, "Unable to read block");
-            free(lb);
+        /* Deallocating block, its header is overwritten by free list */
+        if (ppl_dealloc_nova(pager, ppl, &block) == PPL_FAIL) {
+            logger(LL_ERROR, __func__, "Unable to deallocate block");
             return LB_FAIL;
         }
-
-    }
-
-    /* Setting flag to free */
-    lb->flag = LB_FREE;
-    lb_update_nova(ppl, &lb->chblix, lb);
-
-    /* Deallocating block */
-    if (ppl_dealloc_nova(ppl, &lb->chblix) == PPL_FAIL) {
-        logger(LL_ERROR, __func__, "Unable to deallocate block");
-        free(lb);
-        return LB_FAIL;
+        block = next;
+        chunk = NULL;
     }
     return LB_SUCCESS;
 }
 
 /**
  * @brief       Deallocates linked block
+ * @param[in]   pager: pointer to pager_t
  * @param[in]   ppidx: Fist page index of page pool
  * @param[in]   chblix: Chunk Block Index
  * @return      LB_SUCCESS on success, LB_FAIL otherwise
  */
 
-int lb_dealloc(int64_t ppidx, chblix_t* chblix){
-    page_pool_t* page_pool = lb_ppl_load(ppidx);
+int lb_dealloc(pager_t* pager, int64_t ppidx, chblix_t* chblix){
+    page_pool_t* page_pool = lb_ppl_load(pager, ppidx);
     if(page_pool == NULL){
         logger(LL_ERROR, __func__, "Unable to load page pool");
         return LB_FAIL;
     }
-    chunk_t *chunk = ppl_load_chunk(chblix->chunk_idx);
-    if(chunk == NULL){
-        logger(LL_ERROR, __func__, "Unable to load chunk");
-        return LB_FAIL;
-    }
-
-    linked_block_t* lb = malloc(page_pool->block_size); /* Don't forget to free it */
-    if (lb_load_nova_pppp(page_pool,chunk, chblix, lb) == LB_FAIL) {
-        logger(LL_ERROR, __func__, "Unable to read block");
-        free(lb);
-        return LB_FAIL;
-    }
-    if(lb_dealloc_nova(page_pool, lb) == LB_FAIL){
+    if(lb_dealloc_nova(pager, page_pool, NULL, chblix) == LB_FAIL){
         logger(LL_ERROR, __func__, "Failed to deallocate row");
         return LB_FAIL;
     }
-    free(lb);
     return LB_SUCCESS;
 }
 
 /**
- * \brief       Loads next linked block
+ * \brief       Get next block of row, it is allocated if row ends in this block
+ * \param[in]   pager: pointer to pager_t
  * \param[in]   ppl: Page pool pointer
  * \param[in]   chblix: chblix of Linked Block
- * \return      pointer to linked_block_t on success, `NULL` otherwise
+ * \return      chblix of next block on success, `chblix_fail()` otherwise
  */
 
-chblix_t lb_get_next_nova(page_pool_t* ppl, const chblix_t* chblix){
+chblix_t lb_get_next_nova(pager_t* pager, page_pool_t* ppl, const chblix_t* chblix){
     if (ppl == NULL) {
         logger(LL_ERROR, __func__, "Unable to load page pool");
         return chblix_fail();
     }
-    /* Loading Linked Block */
-    linked_block_t* lb = malloc(ppl->block_size); /* Don't forget to free it */
-    lb_load_nova_ppp(ppl, (chblix_t*)chblix, lb);
+    linked_block_t lb;
+    if (lb_load_header(pager, ppl, NULL, chblix, &lb) == LB_FAIL) {
+        logger(LL_ERROR, __func__, "Unable to read block");
+        return chblix_fail();
+    }
 
-    chblix_t fail = chblix_fail();
-    chblix_t next_block_idx = lb->next_block;
-    if (chblix_cmp(&next_block_idx, &fail) == 0) {
+    chblix_t next_block_idx = lb_next(&lb);
+    if (chblix_cmp(&next_block_idx, &CHBLIX_FAIL) == 0) {
         /* Allocating new block */
-        next_block_idx = lb_alloc(ppl);
+        next_block_idx = lb_alloc_linked(pager, ppl, *chblix);
         if (next_block_idx.block_idx == -1) {
             logger(LL_ERROR, __func__, "Unable to allocate block");
-            free(lb);
             return chblix_fail();
         }
-        linked_block_t* next_lb = malloc(ppl->block_size); /* Don't forget to free it */
-        lb_load_nova_ppp(ppl, &next_block_idx, next_lb);
-        next_lb->prev_block = lb->chblix;
-        lb_update_nova(ppl, &next_block_idx, next_lb);
-        free(next_lb);
-        lb->next_block = next_block_idx;
-        lb_update_nova(ppl, chblix, lb);
     }
-
-    free(lb);
     return next_block_idx;
-
 }
 
 
 /**
  * \brief       Go to block
+ * \param[in]   pager: pointer to pager_t
  * \param[in]   ppl: Page pool pointer
  * \param[in]   chblix: Chunk Block Index
  * \param[in]   current_block_idx: Current block index
- * \param[in]   block_idx: Block index to go to
+ * \param[in]   block_idx: Block index to go to, missing blocks are allocated
  * \return      chblix_t on success, `chblix_fail()` otherwise
  */
 
-chblix_t lb_go_to_nova(page_pool_t* ppl,
+chblix_t lb_go_to_nova(pager_t* pager, page_pool_t* ppl,
                        chblix_t* chblix,
                        int64_t current_block_idx,
                        int64_t block_idx){
     int64_t counter = current_block_idx;
     chblix_t res = *chblix;
     /* Go to block */
-    while (counter != block_idx) {
-        res = lb_get_next_nova(ppl, chblix);
+    while (counter != block_idx && chblix_cmp(&res, &CHBLIX_FAIL) != 0) {
+        res = lb_get_next_nova(pager, ppl, &res);
         counter++;
     }
 
@@ -258,85 +304,19 @@ chblix_t lb_go_to_nova(page_pool_t* ppl,
 }
 
 /**
- * \brief       Loads next linked block
- * \param[in]   page_pool_idx: Fist page index of page pool
- * \param[in]   chblix: chblix of Linked Block
- * \return      pointer to linked_block_t on success, `NULL` otherwise
- */
-
-static chblix_t lb_get_next(int64_t page_pool_index,
-                     const chblix_t* chblix){
-
-    /* Loading Page Pool*/
-    page_pool_t *ppl = ppl_load(page_pool_index);
-    if (ppl == NULL) {
-        logger(LL_ERROR, __func__, "Unable to load page pool");
-        return chblix_fail();
-    }
-
-    /* Loading Linked Block */
-    linked_block_t* lb = malloc(ppl->block_size); /* Don't forget to free it */
-    lb_load(page_pool_index, chblix, lb);
-
-    chblix_t fail = chblix_fail();
-    chblix_t next_block_idx = lb->next_block;
-    if (chblix_cmp(&next_block_idx, &fail) == 0) {
-        /* Allocating new block */
-        next_block_idx = lb_alloc(ppl);
-        if (next_block_idx.block_idx == -1) {
-            logger(LL_ERROR, __func__, "Unable to allocate block");
-            free(lb);
-            return chblix_fail();
-        }
-        linked_block_t* next_lb = malloc(ppl->block_size); /* Don't forget to free it */
-        lb_load(page_pool_index, &next_block_idx, next_lb);
-        next_lb->prev_block = lb->chblix;
-        lb_update(page_pool_index, &next_block_idx, next_lb);
-        free(next_lb);
-        lb->next_block = next_block_idx;
-        lb_update(page_pool_index, chblix, lb);
-    }
-
-    free(lb);
-    return next_block_idx;
-}
-
-/**
- * \brief       Go to block
- * \param[in]   page_pool_idx: Fist page index of page pool
- * \param[in]   chblix: Chunk Block Index
- * \param[in]   current_block_idx: Current block index
- * \param[in]   block_idx: Block index to go to
- * \return      chblix_t on success, `chblix_fail()` otherwise
- */
-
-static chblix_t lb_go_to(int64_t pplidx,
-                  chblix_t* chblix,
-                  int64_t current_block_idx,
-                  int64_t block_idx) {
-
-    int64_t counter = current_block_idx;
-    chblix_t res = *chblix;
-    /* Go to block */
-    while (counter != block_idx) {
-        res = lb_get_next(pplidx, chblix);
-        counter++;
-    }
-
-    return res;
-}
-
-/**
- * \brief       Read from linked block
+ * \brief       Write to linked block
+ * \details     Row which fits in its block is written at once, row which overflows it is
+ *              continued in next blocks, they are allocated when needed.
+ * \param[in]   pager: pointer to pager_t
  * \param[in]   ppl: Page Pool pointer
  * \param[in]   chblix: Chunk Block Index
  * \param[in]   src: Source to write
- * \param[in]   size: Size to read
- * \param[in]   src_offset: Offset in block to write
+ * \param[in]   size: Size to write
+ * \param[in]   src_offset: Offset in row to write
  * \return      LB_SUCCESS on success, LB_FAIL otherwise
  */
 
-int lb_write(page_pool_t* ppl,
+int lb_write(pager_t* pager, page_pool_t* ppl,
                   chblix_t* chblix,
                   void *src,
                   int64_t size,
@@ -350,74 +330,58 @@ int lb_write(page_pool_t* ppl,
     logger(LL_DEBUG, __func__, "Write to Linked Block %ld %ld size: %ld, offset: %ld"
             , chblix->block_idx, chblix->chunk_idx, size, src_offset);
 
-    /* Loading Linked Block */
-    linked_block_t* lb = malloc(ppl->block_size); /* Don't forget to free it */
-    if (lb_load(page_pool_index(ppl), chblix, lb) == LB_FAIL) {
-        logger(LL_ERROR, __func__, "Unable to read block");
-        free(lb);
-        return LB_FAIL;
-    }
-
-    /* Initializing variables */
-    int64_t useful_space_size = ppl->block_size - lb->mem_start;
-    int64_t start_block = floor((double) src_offset / (double) useful_space_size);
+    int64_t useful_space_size = lb_block_data_size(ppl);
     int64_t start_offset = src_offset % useful_space_size;
-    int64_t blocks_needed = ceil((double)(size + start_offset) / (double) useful_space_size);
-    int64_t total_size = size;
-    int64_t current_block_idx = 0;
-    int64_t header_offset =  lb->mem_start;
 
     /* Go to start block of write and allocate new blocks if needed */
-    chblix_t start_point = chblix_fail();
-    start_point = lb_go_to(page_pool_index(ppl), chblix, current_block_idx, start_block);
+    chblix_t block = lb_go_to_nova(pager, ppl, chblix, 0, src_offset / useful_space_size);
 
     /* Write to blocks until all data is written */
-    while (blocks_needed > 0){
+    while (true){
+        if (chblix_cmp(&block, &CHBLIX_FAIL) == 0) {
+            logger(LL_ERROR, __func__, "Unable to get block");
+            return LB_FAIL;
+        }
+
         /* Calculate size to write */
-        int64_t size_to_write = total_size > useful_space_size - start_offset
-                                ? useful_space_size - start_offset : total_size;
+        int64_t size_to_write = size > useful_space_size - start_offset
+                                ? useful_space_size - start_offset : size;
 
         /* Write to block */
-        if (ppl_write_block_nova(ppl, &start_point, src, size_to_write, header_offset + start_offset) == PPL_FAIL) {
+        if (ppl_write_block_nova(pager, ppl, &block, src, size_to_write,
+                                 (int64_t)sizeof(linked_block_t) + start_offset) == PPL_FAIL) {
             logger(LL_ERROR, __func__, "Unable to write to block");
-            free(lb);
             return LB_FAIL;
         }
 
         /* Update variables */
-        blocks_needed--;
-
-        if(blocks_needed > 0){
-            total_size -= useful_space_size - start_offset;
-            src = (uint8_t*)src + useful_space_size - start_offset;
-            start_offset = 0;
-
-            /* Go to next block */
-            start_point = lb_get_next(page_pool_index(ppl), &lb->chblix);
-            lb_load(page_pool_index(ppl), &start_point, lb);
-
+        size -= size_to_write;
+        if (size == 0) {
+            return LB_SUCCESS;
         }
+        src = (uint8_t*)src + size_to_write;
+        start_offset = 0;
 
+        /* Go to next block */
+        block = lb_get_next_nova(pager, ppl, &block);
     }
-
-    free(lb);
-    return LB_SUCCESS;
 }
 
-
-
 /**
  * @brief       Read from linked block
+ * @details     Row which fits in its block is read without reading its header,
+ *              blocks of row which overflows it are followed by headers.
+ * @param[in]   pager: pointer to pager_t
  * @param[in]   ppl: Page Pool pointer
  * @param[in]   chunk: pointer to chunk
  * @param[in]   chblix: Chunk Block Index
  * @param[out]  dest: Destination to read
  * @param[in]   size: Size to read
- * @param[in]   src_offset: Offset in block to read
+ * @param[in]   src_offset: Offset in row to read
  * @return      LB_SUCCESS on success, LB_FAIL otherwise
  */
 
-int lb_read_nova(page_pool_t* ppl,
+int lb_read_nova(pager_t* pager, page_pool_t* ppl,
                  chunk_t* chunk,
                  chblix_t* chblix,
                  void *dest,
@@ -425,192 +389,149 @@ int lb_read_nova(page_pool_t* ppl,
                  int64_t src_offset){
     logger(LL_DEBUG, __func__, "Reading Linked Block %ld %ld size: %ld, offset: %ld"
             , chblix->block_idx, chblix->chunk_idx, size, src_offset);
-    if(!ppl || !chunk->capacity || !chblix){
+    if(!ppl || !chunk || !chunk->capacity || !chblix){
         logger(LL_ERROR, __func__, "Invalid arguments");
         return LB_FAIL;
     }
 
-    /* Loading Linked Block */
-    linked_block_t* lb = malloc(ppl->block_size); /* Don't forget to free it */
-    if (lb_load_nova_pppp(ppl, chunk, chblix, lb) == LB_FAIL) {
-        logger(LL_ERROR, __func__, "Unable to read block");
-        free(lb);
-        return LB_FAIL;
-    }
-    /* Initializing variables */
-    int64_t useful_space_size = ppl->block_size - lb->mem_start;
-    int64_t start_block = floor((double) src_offset / (double) useful_space_size);
+    int64_t useful_space_size = lb_block_data_size(ppl);
     int64_t start_offset = src_offset % useful_space_size;
-    int64_t blocks_needed = ceil((double)(size + start_offset) / (double) useful_space_size);
-    int64_t total_size = size;
-    int64_t current_block_idx = 0;
-    int64_t header_offset = lb->mem_start;
 
-    /* Go to start block of write and allocate new blocks if needed */
-    chblix_t start_point = chblix_fail();
-    start_point = lb_go_to_nova(ppl, chblix, current_block_idx, start_block);
-    linked_page_t* start_chunk = lp_load(start_point.chunk_idx);
+    /* Go to start block of read */
+    chblix_t block = *chblix;
+    for(int64_t i = src_offset / useful_space_size; i > 0 && chblix_cmp(&block, &CHBLIX_FAIL) != 0; --i){
+        linked_block_t lb;
+        block = lb_load_header(pager, ppl, chunk, &block, &lb) == LB_FAIL ? chblix_fail() : lb_next(&lb);
+    }
+
+    /* Read from blocks until all data is read */
+    while (true){
+        if (chblix_cmp(&block, &CHBLIX_FAIL) == 0) {
+            logger(LL_ERROR, __func__, "Row ends before %ld bytes are read", size);
+            return LB_FAIL;
+        }
+        if (chunk->page_index != block.chunk_idx && !(chunk = ppl_read_chunk(pager, block.chunk_idx))) {
+            logger(LL_ERROR, __func__, "Unable to load chunk %ld", block.chunk_idx);
+            return LB_FAIL;
+        }
 
-    /* Write to blocks until all data is written */
-    while (blocks_needed > 0){
         /* Calculate size to read */
-        int64_t size_to_read = total_size > useful_space_size - start_offset
-                               ? useful_space_size - start_offset : total_size;
+        int64_t size_to_read = size > useful_space_size - start_offset
+                               ? useful_space_size - start_offset : size;
 
-        /* Write to block */
-        if (ppl_read_block_nova(ppl, start_chunk, &start_point, dest, size_to_read, header_offset + start_offset) == PPL_FAIL) {
-            logger(LL_ERROR, __func__, "Unable to write to block");
-            free(lb);
+        /* Read from block */
+        if (ppl_read_block_nova(pager, ppl, (linked_page_t*)chunk, &block, dest, size_to_read,
+                                (int64_t)sizeof(linked_block_t) + start_offset) == PPL_FAIL) {
+            logger(LL_ERROR, __func__, "Unable to read from block");
             return LB_FAIL;
         }
 
         /* Update variables */
-        blocks_needed--;
-
-        if(blocks_needed > 0){
-            total_size -= (useful_space_size - start_offset);
-            dest = (uint8_t*)dest + useful_space_size - start_offset;
-            start_offset = 0;
-
-            /* Go to next block */
-            start_point = lb_get_next_nova(ppl, &lb->chblix);
-            lb_load_nova_ppp(ppl, &start_point, lb);
-
+        size -= size_to_read;
+        if (size == 0) {
+            return LB_SUCCESS;
         }
+        dest = (uint8_t*)dest + size_to_read;
+        start_offset = 0;
 
+        /* Go to next block */
+        linked_block_t lb;
+        block = lb_load_header(pager, ppl, chunk, &block, &lb) == LB_FAIL ? chblix_fail() : lb_next(&lb);
     }
-    free(lb);
-    return LB_SUCCESS;
-
 }
 
-int lb_read_nova_5(page_pool_t* ppl,
+int lb_read_nova_5(pager_t* pager, page_pool_t* ppl,
                    chblix_t* chblix,
                    void *dest,
                    int64_t size,
                    int64_t src_offset){
-    chunk_t* chunk = ppl_load_chunk(chblix->chunk_idx);
-    return lb_read_nova(ppl, chunk, chblix, dest, size, src_offset);
+    chunk_t* chunk = ppl_read_chunk(pager, chblix->chunk_idx);
+    return lb_read_nova(pager, ppl, chunk, chblix, dest, size, src_offset);
 
 }
 
 /**
  * @brief       Read from linked block
+ * @param[in]   pager: pointer to pager_t
  * @param[in]   pplidx: Fist page index of page pool
  * @param[in]   chblix: Chunk Block Index
  * @param[out]  dest: Destination to read
  * @param[in]   size: Size to read
- * @param[in]   src_offset: Offset in block to read
+ * @param[in]   src_offset: Offset in row to read
  * @return      LB_SUCCESS on success, LB_FAIL otherwise
  */
 
-int lb_read(int64_t pplidx,
+int lb_read(pager_t* pager, int64_t pplidx,
             chblix_t* chblix,
             void *dest,
             int64_t size,
             int64_t src_offset){
 
-    logger(LL_DEBUG, __func__, "Reading Linked Block %ld %ld size: %ld, offset: %ld"
-            , chblix->block_idx, chblix->chunk_idx, size, src_offset);
-
     /* Loading Page Pool*/
-    page_pool_t *ppl = ppl_load(pplidx);
+    page_pool_t *ppl = ppl_read(pager, pplidx);
     if (ppl == NULL) {
         logger(LL_ERROR, __func__, "Unable to load page pool");
         return LB_FAIL;
     }
+    return lb_read_nova_5(pager, ppl, chblix, dest, size, src_offset);
+}
 
-    /* Loading Linked Block */
-    linked_block_t* lb = malloc(ppl->block_size); /* Don't forget to free it */
-    if (lb_load(pplidx, chblix, lb) == LB_FAIL) {
-        logger(LL_ERROR, __func__, "Unable to read block");
-        free(lb);
-        return LB_FAIL;
-    }
-
-    /* Initializing variables */
-    int64_t useful_space_size = ppl->block_size - lb->mem_start;
-    int64_t start_block = floor((double) src_offset / (double) useful_space_size);
-    int64_t start_offset = src_offset % useful_space_size;
-    int64_t blocks_needed = ceil((double)(size + start_offset) / (double) useful_space_size);
-    int64_t total_size = size;
-    int64_t current_block_idx = 0;
-    int64_t header_offset = lb->mem_start;
-
-    /* Go to start block of write and allocate new blocks if needed */
-    chblix_t start_point = chblix_fail();
-    start_point = lb_go_to(pplidx, chblix, current_block_idx, start_block);
-
-    /* Write to blocks until all data is written */
-    while (blocks_needed > 0){
-        /* Calculate size to read */
-        int64_t size_to_read = total_size > useful_space_size - start_offset
-                               ? useful_space_size - start_offset : total_size;
-
-        /* Write to block */
-        if (ppl_read_block(pplidx, &start_point, dest, size_to_read, header_offset + start_offset) == PPL_FAIL) {
-            logger(LL_ERROR, __func__, "Unable to write to block");
-            free(lb);
-            return LB_FAIL;
-        }
-
-        /* Update variables */
-        blocks_needed--;
-
-        if(blocks_needed > 0){
-            total_size -= (useful_space_size - start_offset);
-            dest = (uint8_t*) dest + useful_space_size - start_offset;
-            start_offset = 0;
-
-            /* Go to next block */
-            start_point = lb_get_next(pplidx, &lb->chblix);
-            lb_load(pplidx, &start_point, lb);
-
-        }
+/**
+ * @brief       Get row data in page of its chunk
+ * @details     Row isn't copied, pointer is valid while chunk page is pinned and nobody changes row.
+ *              Only the first block of row is viewed, block data size bytes are available.
+ * @param[in]   ppl: Page Pool pointer
+ * @param[in]   chunk: pointer to chunk of row
+ * @param[in]   chblix: Chunk Block Index
+ * @return      pointer to row data, NULL if block doesn't lie in the first page of chunk
+ */
 
+const void* lb_view(page_pool_t* ppl, chunk_t* chunk, const chblix_t* chblix){
+    if(!ppl || !chunk || !chblix || chunk->page_index != chblix->chunk_idx
+       || chblix->block_idx < 0 || chblix->block_idx >= chunk->capacity){
+        return NULL;
     }
-    free(lb);
-    return LB_SUCCESS;
+    int64_t offset = chblix->block_idx * ppl->block_size;
+    if(offset + ppl->block_size > lp_useful_space_size((linked_page_t*)chunk)){
+        return NULL;
+    }
+    return (const char*)chunk + chunk->lp_header.mem_start + offset + sizeof(linked_block_t);
 }
 
-
-
-
 /**
  * @brief       Get useful space size of linked block
+ * @param[in]   pager: pointer to pager_t
  * @param[in]   ppidx: Fist page index of page pool
  * @param[in]   chblix: Chunk Block Index
  * @return      useful space size on success, LB_FAIL otherwise
  */
 
-int64_t lb_useful_space_size(int64_t ppidx, chblix_t* chblix){
-    page_pool_t *ppl = ppl_load(ppidx);
-    linked_block_t* lb = malloc(ppl->block_size); /* Don't forget to free it */
-    if(lb_load(ppidx, chblix, lb) == LB_FAIL){
-        logger(LL_ERROR, __func__, "Unable to load linked block");
-        free(lb);
+int64_t lb_useful_space_size(pager_t* pager, int64_t ppidx, chblix_t* chblix){
+    (void)chblix;
+    page_pool_t *ppl = ppl_read(pager, ppidx);
+    if(ppl == NULL){
+        logger(LL_ERROR, __func__, "Unable to load page pool");
         return LB_FAIL;
     }
-    int64_t res = PAGE_SIZE - lb->mem_start;
-    free(lb);
-    return res;
+    return lb_block_data_size(ppl);
 }
 
 /**
  * @brief       Initialize page pool for Linked Blocks
+ * @param[in]   pager: pointer to pager_t
  * @param[in]   block_size: Size of block
  * @return      page pool index on success, LB_FAIL otherwise
  */
 
-int64_t lb_ppl_init(int64_t block_size){
-    int64_t ppidx = ppl_init(block_size + (int64_t)sizeof(linked_block_t));
+int64_t lb_ppl_init(pager_t* pager, int64_t block_size){
+    int64_t ppidx = ppl_init(pager, block_size + (int64_t)sizeof(linked_block_t));
     if(ppidx == PPL_FAIL){
         logger(LL_ERROR, __func__, "Unable to initialize page pool block size: %ld"
                , block_size);
         return LB_FAIL;
     }
 
-    page_pool_t *ppl = ppl_load(ppidx);
+    page_pool_t *ppl = ppl_load(pager, ppidx);
     if(ppl == NULL){
         logger(LL_ERROR, __func__, "Unable to load page pool with index: %ld"
                , ppidx);
@@ -621,20 +542,33 @@ int64_t lb_ppl_init(int64_t block_size){
 
 /**
  * @brief       Load existing page pool for Linked Blocks
+ * @param[in]   pager: pointer to pager_t
+ * @param[in]   ppidx: Fist page index of page pool
+ * @return      pointer to page pool on success, `NULL` otherwise
+ */
+
+page_pool_t* lb_ppl_load(pager_t* pager, int64_t ppidx){
+    return ppl_load(pager, ppidx);
+}
+
+/**
+ * @brief       Load existing page pool for Linked Blocks for reading
+ * @details     Pool isn't marked dirty, it must not be modified through returned pointer.
+ * @param[in]   pager: pointer to pager_t
  * @param[in]   ppidx: Fist page index of page pool
  * @return      pointer to page pool on success, `NULL` otherwise
  */
 
-page_pool_t* lb_ppl_load(int64_t ppidx){
-    return ppl_load(ppidx);
+page_pool_t* lb_ppl_read(pager_t* pager, int64_t ppidx){
+    return ppl_read(pager, ppidx);
 }
 
 
 /**
  * @brief Finds the nearest valid block to the given block index within a chunk of a page pool.
  *
- * The nearest valid block is determined by searching for the closest block index that is marked as valid
- * and is within the boundaries of the chunk.
+ * The nearest valid block is the first block starting at block_idx which is set in chain head
+ * bitmap of the chunk, it is found word by word without reading blocks.
  *
  * @param[in]   ppl: The pointer to the page pool.
  * @param[in]   chunk: The pointer to the chunk.
@@ -646,29 +580,33 @@ static int64_t lb_nearest_valid_block(page_pool_t* ppl, chunk_t* chunk, int64_t
     logger(LL_DEBUG, __func__, "Searching for nearest valid block\n"
                             " pool: %ld, block: %ld, chunk: %ld",
         ppl->lp_header.page_index, block_idx, chunk->page_index);
-    chblix_t chblix = {.block_idx = block_idx, .chunk_idx = chunk->page_index};
-    linked_block_t* temp = malloc(ppl->block_size);
-    while (chblix.block_idx != chunk->capacity){
-        if(lb_valid(ppl, chunk, chblix)){
-            free(temp);
-            return chblix.block_idx;
+    if(block_idx < 0 || block_idx >= chunk->capacity){
+        return LB_FAIL;
+    }
+    const uint64_t* heads = ppl_head_bits(chunk);
+    int64_t words = ppl_bitmap_words(chunk->capacity);
+    int64_t word = block_idx / PPL_WORD_BITS;
+    uint64_t bits = heads[word] & (~0ull << (block_idx % PPL_WORD_BITS));
+    while(!bits){
+        if(++word == words){
+            return LB_FAIL;
         }
-        chblix.block_idx++;
+        bits = heads[word];
     }
-
-    free(temp);
-    return LB_FAIL;
+    return word * PPL_WORD_BITS + __builtin_ctzll(bits);
 }
 
 /**
  * @brief       Get nearest valid chblix
+ * @param[in]   pager: pointer to pager_t
  * @param[in]   ppl: Page pool pointer
  * @param[in]   chblix: Chunk Block Index
  * @param[in]   current_chunk: pointer to chunk
+ * @param[in,out] pinned: index of pinned current chunk, pin is moved to next chunk, may be NULL
  * @return      chblix_t on success, `chblix_fail()` otherwise
  */
 
-chblix_t lb_nearest_valid_chblix(page_pool_t* ppl, chblix_t chblix, chunk_t** current_chunk){
+chblix_t lb_nearest_valid_chblix(pager_t* pager, page_pool_t* ppl, chblix_t chblix, chunk_t** current_chunk, int64_t* pinned){
     // If there is no chunk, return fail immediately
     if(current_chunk == NULL || *current_chunk == NULL){
         return chblix_fail();
@@ -697,9 +635,15 @@ chblix_t lb_nearest_valid_chblix(page_pool_t* ppl, chblix_t chblix, chunk_t** cu
         // If there's a next chunk, load it.
         if((*current_chunk)->next_page != -1){
             int64_t chunkid = (*current_chunk)->page_index;
-            *current_chunk = ppl_load_chunk((*current_chunk)->next_page);
+            int64_t next_page = (*current_chunk)->next_page;
+            pg_readahead(pager, chunkid, next_page);
+            *current_chunk = ppl_read_chunk(pager, next_page);
             chblix.block_idx = 0;
-            pg_rm_cached(chunkid);
+            if(pinned && *pinned == chunkid){
+                *pinned = pg_pin(pager, next_page);
+                pg_unpin(pager, chunkid);
+            }
+            pg_rm_cached(pager, chunkid);
         }
         if(!(*current_chunk)->capacity){
             logger(LL_ERROR, __func__, "Invalid arguments");
@@ -712,7 +656,7 @@ chblix_t lb_nearest_valid_chblix(page_pool_t* ppl, chblix_t chblix, chunk_t** cu
     return chblix_fail();
 }
 
-chblix_t lb_pool_start(page_pool_t* ppl, chunk_t** chunk){
+chblix_t lb_pool_start(pager_t* pager, page_pool_t* ppl, chunk_t** chunk, int64_t* pinned){
     // Check if the pointers are NULL before attempting to access their members.
     if(ppl == NULL || chunk == NULL ){
         logger(LL_ERROR, __func__, "Invalid arguments ppl: %p, chunk: %p", ppl, chunk);
@@ -727,58 +671,43 @@ chblix_t lb_pool_start(page_pool_t* ppl, chunk_t** chunk){
         return chblix_fail();
     }
     chblix_t start_chblix = {.block_idx = 0, .chunk_idx = (*chunk)->page_index};
-    return lb_nearest_valid_chblix(ppl, start_chblix, chunk);
+    return lb_nearest_valid_chblix(pager, ppl, start_chblix, chunk, pinned);
 }
 
-bool lb_valid(page_pool_t* ppl, chunk_t* chunk, chblix_t chblix){
+/**
+ * @brief       Check if block is allocated and starts chain of linked blocks
+ * @param[in]   pager: pointer to pager_t
+ * @param[in]   ppl: Page pool pointer
+ * @param[in]   chunk: pointer to chunk of block, it is loaded if it isn't chunk of block
+ * @param[in]   chblix: Chunk Block Index
+ * @return      true if block starts chain
+ */
+
+bool lb_valid(pager_t* pager, page_pool_t* ppl, chunk_t* chunk, chblix_t chblix){
     if(chblix_cmp(&chblix, &CHBLIX_FAIL) == 0){
         return false;
     }
-    linked_block_t* linked_block = malloc(ppl->block_size);
-    if(lb_load_nova_pppp(ppl, chunk,  &chblix, linked_block) == LB_FAIL){
-        logger(LL_ERROR, __func__, "Unable to load linked block");
-        free(linked_block);
-        return false;
-    }
-    if(linked_block->flag == LB_FREE){
-        free(linked_block);
-        return false;
+    if(chunk == NULL || chunk->page_index != chblix.chunk_idx){
+        chunk = ppl_read_chunk(pager, chblix.chunk_idx);
+        if(chunk == NULL){
+            logger(LL_ERROR, __func__, "Unable to load chunk %ld of pool %ld", chblix.chunk_idx, page_pool_index(ppl));
+            return false;
+        }
     }
-    if(chblix_cmp(&linked_block->prev_block, &CHBLIX_FAIL) != 0){
-        free(linked_block);
+    if(chblix.block_idx < 0 || chblix.block_idx >= chunk->capacity){
         return false;
     }
-    free(linked_block);
-    return chblix_cmp(&chblix, &CHBLIX_FAIL) != 0;
-}
-
-int lb_load_nova_pppp(page_pool_t* ppl, chunk_t* chunk, chblix_t* chblix, linked_block_t* linked_block){
-    return ppl_read_block_nova(ppl,
-                               (linked_page_t*)chunk,
-                               chblix,
-                               linked_block,
-                               ppl->block_size,
-                               0) == PPL_FAIL ? LB_FAIL : LB_SUCCESS;
-}
-
-int lb_load_nova_ppp(page_pool_t* ppl, chblix_t* chblix, linked_block_t* linked_block){
-    chunk_t* chunk = ppl_load_chunk(chblix->block_idx);
-    return ppl_read_block_nova(ppl,
-                               (linked_page_t*)chunk,
-                               chblix,
-                               linked_block,
-                               ppl->block_size,
-                               0) == PPL_FAIL ? LB_FAIL : LB_SUCCESS;
+    return ppl_bit_test(ppl_head_bits(chunk), chblix.block_idx);
 }
 
-int64_t lb_print_used(page_pool_t* ppl){
+int64_t lb_print_used(pager_t* pager, page_pool_t* ppl){
     int64_t count = 0;
-    chunk_t* chunk = ppl_load_chunk(ppl->head);
-    chblix_t chblix = lb_pool_start(ppl, &chunk);
+    chunk_t* chunk = ppl_read_chunk(pager, ppl->head);
+    chblix_t chblix = lb_pool_start(pager, ppl, &chunk, NULL);
     int64_t prev_chunk_idx = -1;
     for (;
     chblix_cmp(&chblix, &CHBLIX_FAIL) != 0;
-    ++chblix.block_idx, chblix = lb_nearest_valid_chblix(ppl,chblix, &chunk)){
+    ++chblix.block_idx, chblix = lb_nearest_valid_chblix(pager, ppl,chblix, &chunk, NULL)){
         if(prev_chunk_idx != chunk->page_index){
             printf("\nChunk: %"PRId64"\n", chblix.chunk_idx);
             prev_chunk_idx = chunk->page_index;
@@ -3,6 +3,7 @@
 #include "core/io/caching.h"
 #include "core/io/pager.h"
 #include "utils/logger.h"
+#include <string.h>
 
 /**
  * \brief   Function to return fail chblix_t
@@ -35,27 +36,79 @@ int chblix_cmp(const chblix_t* chblix1, const chblix_t* chblix2){
     return -1;
 }
 
+/**
+ * \brief       Pack chblix in row id
+ * \param[in]   chblix: chblix of block or chblix_fail
+ * \return      row id, ROWID_FAIL for chblix_fail
+ */
+
+rowid_t rowid_pack(chblix_t chblix){
+    if(chblix.block_idx < 0 || chblix.chunk_idx < 0){
+        return ROWID_FAIL;
+    }
+    return (rowid_t)chblix.chunk_idx << PPL_ROWID_BLOCK_BITS | (rowid_t)chblix.block_idx;
+}
+
+/**
+ * \brief       Split row id in chunk and block indexes
+ * \param[in]   rowid: row id or ROWID_FAIL
+ * \return      chblix of block, chblix_fail for ROWID_FAIL
+ */
+
+chblix_t rowid_unpack(rowid_t rowid){
+    if(rowid == ROWID_FAIL){
+        return chblix_fail();
+    }
+    return (chblix_t){.chunk_idx = rowid_chunk(rowid), .block_idx = rowid_block(rowid)};
+}
+
 /**
  * \brief       Initialize chunk
+ * \param[in]   pager: pointer to pager_t
  * \param[in]   page_index: Chunk_t index
  * \return      chunk index on success, PPL_FAIL otherwise
  */
 
-int64_t ppl_chunk_init(page_pool_t* ppl){
+int64_t ppl_chunk_init(pager_t* pager, page_pool_t* ppl){
     logger(LL_DEBUG, __func__, "Initializing chunk");
-    int64_t page_index = lp_init_m(sizeof(chunk_t));
-    if(page_index == LP_FAIL){
+    int64_t page_index = pg_alloc(pager);
+    if(page_index == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to allocate chunk");
+        return PPL_FAIL;
+    }
+    return ppl_chunk_init_at(pager, ppl, page_index);
+}
+
+/**
+ * \brief       Initialize chunk on allocated page
+ * \details     Bitmaps of chunk follow its header and blocks follow bitmaps.
+ * \param[in]   pager: pointer to pager_t
+ * \param[in]   ppl: page pool
+ * \param[in]   page_index: index of allocated page
+ * \return      chunk index on success, PPL_FAIL otherwise
+ */
+
+int64_t ppl_chunk_init_at(pager_t* pager, page_pool_t* ppl, int64_t page_index){
+    if(lp_init_at(pager, page_index, sizeof(chunk_t)) == LP_FAIL){
         logger(LL_ERROR, __func__, "Unable to load chunk");
         return PPL_FAIL;
     }
-    chunk_t* chunk = ppl_load_chunk(page_index);
+    chunk_t* chunk = ppl_load_chunk(pager, page_index);
     chunk->page_index = page_index;
-    if(ppl->block_size > lp_useful_space_size((linked_page_t*)chunk)){
+    chunk->capacity = lp_useful_space_size((linked_page_t*)chunk) / ppl->block_size;
+    while(chunk->capacity > 1 &&
+          (int64_t)(2 * ppl_bitmap_words(chunk->capacity) * sizeof(uint64_t)) + chunk->capacity * ppl->block_size
+          > lp_useful_space_size((linked_page_t*)chunk)){
+        chunk->capacity--;
+    }
+    if(chunk->capacity < 1){
         chunk->capacity = 1;
     }
-    else{
-        chunk->capacity = lp_useful_space_size((linked_page_t*)chunk) / ppl->block_size;
+    if(chunk->capacity > (int64_t)PPL_ROWID_BLOCK_MASK + 1){
+        chunk->capacity = (int64_t)PPL_ROWID_BLOCK_MASK + 1;
     }
+    chunk->lp_header.mem_start = (int64_t)(sizeof(chunk_t) + 2 * ppl_bitmap_words(chunk->capacity) * sizeof(uint64_t));
+    memset(chunk->bitmap, 0, 2 * ppl_bitmap_words(chunk->capacity) * sizeof(uint64_t));
     chunk->next = 0;
     chunk->num_of_free_blocks = chunk->capacity;
     chunk->num_of_used_blocks = 0;
@@ -66,18 +119,19 @@ int64_t ppl_chunk_init(page_pool_t* ppl){
 
 /**
  * \brief       Create page
+ * \param[in]   pager: pointer to pager_t
  * \param[in]   ppl: Chunk pool
  * \param[in]   page_index: Chunk_t index
  * \return      Pointer to page on success, `NULL` otherwise
  */
 
-chunk_t* ppl_create_page(page_pool_t* ppl){
+chunk_t* ppl_create_page(pager_t* pager, page_pool_t* ppl){
     logger(LL_DEBUG, __func__, "Creating page");
 
     // Allocate page
     // Initialize page
-    int64_t page_idx = ppl_chunk_init(ppl);
-    chunk_t* page = ppl_load_chunk(page_idx);
+    int64_t page_idx = ppl_chunk_init(pager, ppl);
+    chunk_t* page = ppl_load_chunk(pager, page_idx);
     if(!page){
         logger(LL_ERROR, __func__, "Unable to initialize page");
         return NULL;
@@ -93,21 +147,22 @@ chunk_t* ppl_create_page(page_pool_t* ppl){
  * This function loads a chunk from some source based on the given chunk index.
  * The chunk index indicates the specific chunk to be loaded.
  *
+ * @param[in]   pager: pointer to pager_t
  * @param[in]   chunk_index: The index of the chunk to be loaded.
  * @return chunk_t*     The loaded chunk.
  */
 
-chunk_t* ppl_load_chunk(int64_t chunk_index){
+chunk_t* ppl_load_chunk(pager_t* pager, int64_t chunk_index){
     logger(LL_DEBUG, __func__, "Loading page %ld", chunk_index);
 
-    if(chunk_index > pg_max_page_index()){
+    if(!pg_exists(pager, chunk_index)){
         logger(LL_ERROR, __func__,
                "chunk_t index is out of range %ld, max index: %ld",
-               chunk_index, pg_max_page_index());
+               chunk_index, pg_max_page_index(pager));
         return NULL;
     }
 
-    chunk_t* chunk = (chunk_t*) lp_load(chunk_index);
+    chunk_t* chunk = (chunk_t*) lp_load(pager, chunk_index);
     if(chunk == NULL){
         logger(LL_ERROR, __func__, "Unable to load page %ld", chunk_index);
         return NULL;
@@ -116,22 +171,41 @@ chunk_t* ppl_load_chunk(int64_t chunk_index){
     return chunk;
 }
 
+/**
+ * @brief       Load chunk for reading
+ * @details     Chunk isn't marked dirty, it must not be modified through returned pointer.
+ * @param[in]   pager: pointer to pager_t
+ * @param[in]   chunk_index: index of the chunk
+ * @return      pointer to chunk or NULL
+ */
+
+chunk_t* ppl_read_chunk(pager_t* pager, int64_t chunk_index){
+    if(!pg_exists(pager, chunk_index)){
+        logger(LL_ERROR, __func__,
+               "chunk_t index is out of range %ld, max index: %ld",
+               chunk_index, pg_max_page_index(pager));
+        return NULL;
+    }
+    return (chunk_t*) pg_read_page(pager, chunk_index);
+}
+
 /**
  * @brief Delete page
+ * @param pager: pointer to pager_t
  * @param chunk
  * @return PPL_SUCCESS or PPL_FAIL
  */
 
-int ppl_delete_chunk(chunk_t* chunk){
+int ppl_delete_chunk(pager_t* pager, chunk_t* chunk){
     logger(LL_DEBUG, __func__, "Destroying page %ld", chunk->page_index);
-    if(lp_delete(chunk->page_index) == PAGER_FAIL){
+    if(lp_delete(pager, chunk->page_index) == PAGER_FAIL){
         logger(LL_ERROR, __func__, "Unable to delete chunk %ld", chunk->page_index);
         return PPL_FAIL;
     }
     return PPL_SUCCESS;
 }
 
-int ppl_write_block_nova(page_pool_t* ppl, const chblix_t* chblix, void* src, int64_t size, int64_t src_offset){
+int ppl_write_block_nova(pager_t* pager, page_pool_t* ppl, const chblix_t* chblix, void* src, int64_t size, int64_t src_offset){
     logger(LL_DEBUG, __func__, "Writing to page %ld, block %ld", chblix->chunk_idx, chblix->block_idx);
     if(chblix->block_idx == -1){
         logger(LL_ERROR, __func__, "Unable to write to block with index -1");
@@ -147,7 +221,7 @@ int ppl_write_block_nova(page_pool_t* ppl, const chblix_t* chblix, void* src, in
     int64_t page_index = chblix->chunk_idx;
     off_t offset = (off_t)(chblix->block_idx * ppl->block_size + src_offset);
 
-    if(lp_write(page_index, src, size, offset) == CH_FAIL){
+    if(lp_write(pager, page_index, src, size, offset) == CH_FAIL){
         logger(LL_ERROR, __func__, "Unable to write to page %ld", page_index);
         return PPL_FAIL;
     }
@@ -156,6 +230,7 @@ int ppl_write_block_nova(page_pool_t* ppl, const chblix_t* chblix, void* src, in
 
 /**
  * @brief       Writes to block
+ * @param[in]   pager: pointer to pager_t
  * @param[in]   ppidx: Page pool index
  * @param[in]   chblix chunk_t and block index
  * @param[in]   src source to write from
@@ -164,20 +239,21 @@ int ppl_write_block_nova(page_pool_t* ppl, const chblix_t* chblix, void* src, in
  * @return      PPL_SUCCESS or PPL_FAIL
  */
 
-int ppl_write_block(int64_t ppidx, const chblix_t* chblix, void* src, int64_t size, int64_t src_offset){
+int ppl_write_block(pager_t* pager, int64_t ppidx, const chblix_t* chblix, void* src, int64_t size, int64_t src_offset){
     logger(LL_DEBUG, __func__, "Writing to page %ld, block %ld", chblix->chunk_idx, chblix->block_idx);
 
-    page_pool_t* ppl = ppl_load(ppidx);
+    page_pool_t* ppl = ppl_read(pager, ppidx);
     if(ppl == NULL){
         logger(LL_ERROR, __func__, "Unable to load page pool");
         return PPL_FAIL;
     }
-    return ppl_write_block_nova(ppl, chblix, src, size, src_offset);
+    return ppl_write_block_nova(pager, ppl, chblix, src, size, src_offset);
 }
 
 /**
  * \brief       Read from block
  * \note        Don't forget to free memory
+ * @param[in]   pager: pointer to pager_t
  * @param[in]   ppidx: Page pool index
  * \param[in]   chblix: Chunk and block index
  * \param[out]  dest: Destination to read to
@@ -186,25 +262,26 @@ int ppl_write_block(int64_t ppidx, const chblix_t* chblix, void* src, int64_t si
  * \return      PP_SUCCESS or PP_FAIL
  */
 
-int ppl_read_block(int64_t ppidx, const chblix_t* chblix, void* dest,  int64_t size, int64_t src_offset){
+int ppl_read_block(pager_t* pager, int64_t ppidx, const chblix_t* chblix, void* dest,  int64_t size, int64_t src_offset){
     logger(LL_DEBUG, __func__, "Reading from page %ld", chblix->chunk_idx);
 
-    page_pool_t *ppl = ppl_load(ppidx);
+    page_pool_t *ppl = ppl_read(pager, ppidx);
     if(ppl == NULL){
         logger(LL_ERROR, __func__, "Unable to load page pool");
         return PPL_FAIL;
     }
-    linked_page_t* lp = lp_load(chblix->chunk_idx);
+    linked_page_t* lp = lp_read(pager, chblix->chunk_idx);
     if(lp == NULL){
         logger(LL_ERROR, __func__, "Unable to linked_page");
         return PPL_FAIL;
     }
-    return ppl_read_block_nova(ppl, lp, chblix, dest, size, src_offset);
+    return ppl_read_block_nova(pager, ppl, lp, chblix, dest, size, src_offset);
 }
 
 /**
  * \brief       Read from block
  * \note        Don't forget to free memory
+ * \param[in]   pager: pointer to pager_t
  * \param[in]   ppl: Page pool index
  * \param[in]   lp: linked page pointer
  * \param[in]   chblix: Chunk and block index
@@ -214,7 +291,7 @@ int ppl_read_block(int64_t ppidx, const chblix_t* chblix, void* dest,  int64_t s
  * \return      PP_SUCCESS or PP_FAIL
  */
 
-int ppl_read_block_nova(page_pool_t* ppl, linked_page_t* lp, const chblix_t* chblix, void* dest,  int64_t size, int64_t src_offset){
+int ppl_read_block_nova(pager_t* pager, page_pool_t* ppl, linked_page_t* lp, const chblix_t* chblix, void* dest,  int64_t size, int64_t src_offset){
     /* Check if size is greater than block size */
     if(src_offset + size > ppl->block_size){
         logger(LL_ERROR, __func__, "Size + Offset is greater than block size");
@@ -228,7 +305,7 @@ int ppl_read_block_nova(page_pool_t* ppl, linked_page_t* lp, const chblix_t* chb
         return PPL_FAIL;
     }
 
-    if(lp_read_copy_nova(lp, dest, size, offset) == LP_FAIL){
+    if(lp_read_copy_nova(pager, lp, dest, size, offset) == LP_FAIL){
         logger(LL_ERROR, __func__, "Unable to read from page");
         return PPL_FAIL;
     }
@@ -237,17 +314,90 @@ int ppl_read_block_nova(page_pool_t* ppl, linked_page_t* lp, const chblix_t* chb
 }
 
 
+/**
+ * \brief       Append extent of new chunks to page pool
+ * \details     Chunks lie one after another in file and are linked in file order after tail,
+ *              they are pushed to wait so that they are popped in the same order. Extent holds
+ *              as many chunks as pool has, up to PPL_EXTENT_MAX.
+ * \param[in]   pager: pointer to pager_t
+ * \param[in]   ppl: page pool
+ * \param[in]   current: current chunk
+ * \return      PPL_SUCCESS or PPL_FAIL
+ */
+
+static int ppl_pool_extend(pager_t* pager, page_pool_t* ppl, chunk_t* current){
+    /* pool at most doubles, so small pools don't hold many spare chunks */
+    int64_t count = ppl->chunks < PPL_EXTENT_MAX ? ppl->chunks : PPL_EXTENT_MAX;
+    if(count < 1){
+        count = 1;
+    }
+    int64_t pages[PPL_EXTENT_MAX];
+    int64_t prev = current->page_index;
+    if(current->next_page != -1){
+        chunk_t* tail = ppl_load_chunk(pager, ppl->tail);
+        if(!tail){
+            logger(LL_ERROR, __func__, "Unable to load tail");
+            return PPL_FAIL;
+        }
+        if(tail->next_page != -1){
+            logger(LL_ERROR, __func__, "Tail next page is not -1");
+            return PPL_FAIL;
+        }
+        prev = tail->page_index;
+    }
+    if(pg_alloc_n(pager, count, pages) == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to allocate %ld chunks", count);
+        return PPL_FAIL;
+    }
+    for(int64_t i = 0; i < count; i++){
+        if(ppl_chunk_init_at(pager, ppl, pages[i]) == PPL_FAIL){
+            return PPL_FAIL;
+        }
+        chunk_t* prev_chunk = ppl_load_chunk(pager, prev);
+        if(!prev_chunk){
+            logger(LL_ERROR, __func__, "Unable to load chunk %ld", prev);
+            return PPL_FAIL;
+        }
+        prev_chunk->next_page = pages[i];
+        chunk_t* chunk = ppl_load_chunk(pager, pages[i]);
+        if(!chunk){
+            logger(LL_ERROR, __func__, "Unable to load chunk %ld", pages[i]);
+            return PPL_FAIL;
+        }
+        chunk->prev_page = prev;
+        prev = pages[i];
+    }
+    ppl->tail = prev;
+    ppl->chunks += count;
+    for(int64_t i = count - 1; i >= 0; i--){
+        if(pa_append64(pager, ppl->wait, pages[i]) != PA_SUCCESS){
+            logger(LL_ERROR, __func__, "Unable to push chunk %ld to wait", pages[i]);
+            return PPL_FAIL;
+        }
+    }
+    return PPL_SUCCESS;
+}
+
 /**
  * \brief   Expand page pool
+ * \param[in]   pager: pointer to pager_t
  * \param[in]   ppl: page pool
  * \return  PPL_SUCCESS or PPL_FAIL
  */
 
-int ppl_pool_expand(page_pool_t* ppl){
+int ppl_pool_expand(pager_t* pager, page_pool_t* ppl){
     logger(LL_DEBUG, __func__, "Expanding page pool");
+    /* pool and current chunk stay valid while extent is initialized */
+    pg_scoped_t pool_pin pg_pinned = {pager, pg_pin(pager, page_pool_index(ppl))};
+    pg_scoped_t current_pin pg_pinned = {pager, pg_pin(pager, ppl->current_idx)};
+    /* pool header is changed, pool could be loaded for reading */
+    if(!ppl_load(pager, page_pool_index(ppl))){
+        logger(LL_ERROR, __func__, "Unable to load page pool %ld", page_pool_index(ppl));
+        return PPL_FAIL;
+    }
 
     // Load current page
-    chunk_t* current = ppl_load_chunk(ppl->current_idx);
+    chunk_t* current = ppl_load_chunk(pager, ppl->current_idx);
     if(!current){
         logger(LL_ERROR, __func__, "Unable to load current page");
         return PPL_FAIL;
@@ -256,17 +406,17 @@ int ppl_pool_expand(page_pool_t* ppl){
     chunk_t* new_page = NULL;
     int64_t npidx = -1;
 
-    if(pa_exists64(ppl->wait, current->page_index)){
+    if(pa_exists64(pager, ppl->wait, current->page_index)){
         logger(LL_ERROR, __func__, "Current page is already in wait");
         return PPL_FAIL;
     }
 
     /* Check if there is free page */
 
-    int res = pa_pop64(ppl->wait, &npidx);
+    int res = pa_pop64(pager, ppl->wait, &npidx);
     switch (res) {
         case PA_SUCCESS: {
-            new_page = ppl_load_chunk(npidx);
+            new_page = ppl_load_chunk(pager, npidx);
             if(!new_page){
                 logger(LL_ERROR, __func__, "Unable to load new page");
                 return PPL_FAIL;
@@ -274,29 +424,15 @@ int ppl_pool_expand(page_pool_t* ppl){
             break;
         }
         case PA_EMPTY: {
-            new_page = ppl_create_page(ppl);
-            if(!new_page){
+            if(ppl_pool_extend(pager, ppl, current) == PPL_FAIL){
                 logger(LL_ERROR, __func__, "Unable to create new page");
                 return PPL_FAIL;
             }
-            if(current->next_page == -1){
-                current->next_page = new_page->page_index;
-                new_page->prev_page = current->page_index;
-            }
-            else{
-                chunk_t* tail = ppl_load_chunk(ppl->tail);
-                if(!tail){
-                    logger(LL_ERROR, __func__, "Unable to load tail");
-                    return PPL_FAIL;
-                }
-                if(tail->next_page != -1){
-                    logger(LL_ERROR, __func__, "Tail next page is not -1");
-                    return PPL_FAIL;
-                }
-                tail->next_page = new_page->page_index;
-                new_page->prev_page = tail->page_index;
+            /* the first chunk of extent is used now, the others wait */
+            if(pa_pop64(pager, ppl->wait, &npidx) != PA_SUCCESS || !(new_page = ppl_load_chunk(pager, npidx))){
+                logger(LL_ERROR, __func__, "Unable to load new page");
+                return PPL_FAIL;
             }
-            ppl->tail = new_page->page_index;
             break;
         }
         case PA_FAIL: {
@@ -309,43 +445,49 @@ int ppl_pool_expand(page_pool_t* ppl){
         }
     }
 
-    if(current->page_index == new_page->page_index){
+    if(current_pin.page_index == new_page->page_index){
         logger(LL_ERROR, __func__, "Error while expanding page pool, pages have same index");
         return PPL_FAIL;
     }
-    pg_rm_cached(ppl->current_idx);
+    pg_rm_cached(pager, ppl->current_idx);
     ppl->current_idx = new_page->page_index;
     return PPL_SUCCESS;
 }
 
 /**
  * @brief       Allocates page
+ * @param[in]   pager: pointer to pager_t
  * @param[in]   ppl: Page pool pointer
  * @return      chblix_t or CHBLIX_FAIL
  */
 
-chblix_t ppl_alloc_nova(page_pool_t* ppl){
+chblix_t ppl_alloc_nova(pager_t* pager, page_pool_t* ppl){
     logger(LL_DEBUG, __func__, "Allocating page");
+    pg_scoped_t latch pg_latched = {pager, pg_latch(pager, page_pool_index(ppl), true)};
+    if(latch.page_index == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to latch page pool %ld", page_pool_index(ppl));
+        return chblix_fail();
+    }
     // Load current page
-    chunk_t* current = ppl_load_chunk(ppl->current_idx);
+    chunk_t* current = ppl_load_chunk(pager, ppl->current_idx);
     if(!current){
         logger(LL_ERROR, __func__, "Unable to load current page");
         return (chblix_t){.chunk_idx = PPL_FAIL, .block_idx = PPL_FAIL};
     }
-    // Check if next block not already initialized
-    if(current->num_of_used_blocks < current->capacity){
-        chblix_t chblix = {.chunk_idx = current->page_index, .block_idx = current->num_of_used_blocks };
-        current->num_of_used_blocks++;
-        ppl_write_block_nova(ppl, &chblix, &current->num_of_used_blocks,
-                        sizeof(int64_t), 0);
-    }
     if (current->num_of_free_blocks == 0){
         current->next = -1;
-        if(ppl_pool_expand(ppl) == PPL_FAIL){
+        if(ppl_pool_expand(pager, ppl) == PPL_FAIL){
             logger(LL_ERROR, __func__, "Unable to expand page pool");
             return chblix_fail();
         }
-        current = ppl_load_chunk(ppl->current_idx);
+        current = ppl_load_chunk(pager, ppl->current_idx);
+    }
+    // Check if next block not already initialized, it is done on chunk blocks are taken from
+    if(current->num_of_used_blocks < current->capacity){
+        chblix_t chblix = {.chunk_idx = current->page_index, .block_idx = current->num_of_used_blocks };
+        current->num_of_used_blocks++;
+        ppl_write_block_nova(pager, ppl, &chblix, &current->num_of_used_blocks,
+                        sizeof(int64_t), 0);
     }
 
     chblix_t chblixres;
@@ -353,11 +495,12 @@ chblix_t ppl_alloc_nova(page_pool_t* ppl){
     chblixres.block_idx = current->next;
     chblixres.chunk_idx = current->page_index;
     current->num_of_free_blocks--;
+    ppl_bit_set(ppl_used_bits(current), chblixres.block_idx);
 
     if(current->num_of_free_blocks > 0){
         chblix_t templix = {.chunk_idx = current->page_index, .block_idx = current->next };
         int64_t next = -1;
-        ppl_read_block_nova(ppl, (linked_page_t*)current, &templix, &next, sizeof(int64_t), 0);
+        ppl_read_block_nova(pager, ppl, (linked_page_t*)current, &templix, &next, sizeof(int64_t), 0);
         if(next != -1) current->next = next;
     }
 
@@ -368,39 +511,45 @@ chblix_t ppl_alloc_nova(page_pool_t* ppl){
 
 /**
  * @brief       Allocates page
+ * @param[in]   pager: pointer to pager_t
  * @param[in]   ppidx: Page pool index
  * @return      chblix_t or CHBLIX_FAIL
  */
 
-chblix_t ppl_alloc(int64_t ppidx) {
+chblix_t ppl_alloc(pager_t* pager, int64_t ppidx) {
     logger(LL_DEBUG, __func__, "Allocating page");
 
     /* Load page pool */
-    page_pool_t *ppl = ppl_load(ppidx);
+    page_pool_t *ppl = ppl_load(pager, ppidx);
     if(ppl == NULL){
         logger(LL_ERROR, __func__, "Unable to load page pool %ld", ppidx);
         return CHBLIX_FAIL;
     }
-    return ppl_alloc_nova(ppl);
+    return ppl_alloc_nova(pager, ppl);
 }
 
 /**
  * @brief Reduces page pool
+ * @param pager: pointer to pager_t
  * @param ppl  chunk_t pool
  * @param page  chunk_t to reduce
  * @return  PPL_SUCCESS or PPL_FAIL
  */
 
-int ppl_pool_reduce(page_pool_t* ppl, chunk_t* page){
+int ppl_pool_reduce(pager_t* pager, page_pool_t* ppl, chunk_t* page){
     logger(LL_DEBUG, __func__,
            "Reducing page pool, chunk: %ld, chunk.prev: %ld, chunk.next: %ld",
            page->page_index, page->prev_page, page->next_page);
-
+    /* pool header is changed, pool could be loaded for reading */
+    if(!ppl_load(pager, page_pool_index(ppl))){
+        logger(LL_ERROR, __func__, "Unable to load page pool %ld", page_pool_index(ppl));
+        return PPL_FAIL;
+    }
 
     if(ppl->current_idx == page->page_index){
         int64_t prev_page_idx = page->page_index;
-        ppl_pool_expand(ppl);
-        page = ppl_load_chunk(prev_page_idx);
+        ppl_pool_expand(pager, ppl);
+        page = ppl_load_chunk(pager, prev_page_idx);
 
     }
 
@@ -408,7 +557,7 @@ int ppl_pool_reduce(page_pool_t* ppl, chunk_t* page){
     chunk_t* next_page = NULL;
 
     if(page->prev_page != -1){
-        prev_page = ppl_load_chunk(page->prev_page);
+        prev_page = ppl_load_chunk(pager, page->prev_page);
 
         if(!prev_page){
             logger(LL_ERROR, __func__, "Unable to load prev page %ld", page->prev_page);
@@ -417,7 +566,7 @@ int ppl_pool_reduce(page_pool_t* ppl, chunk_t* page){
     }
 
     if(page->next_page != -1){
-        next_page = ppl_load_chunk(page->next_page);
+        next_page = ppl_load_chunk(pager, page->next_page);
 
         if(!next_page){
             logger(LL_ERROR, __func__, "Unable to load next page %ld", page->next_page);
@@ -442,25 +591,31 @@ int ppl_pool_reduce(page_pool_t* ppl, chunk_t* page){
         return PPL_SUCCESS;
     }
 
-    if (pa_delete_unique64(ppl->wait, page->page_index) == PA_FAIL){
+    if (pa_delete_unique64(pager, ppl->wait, page->page_index) == PA_FAIL){
         logger(LL_ERROR, __func__, "Unable to delete page %ld from wait %ld",
                page->page_index, ppl->wait);
         return PPL_FAIL;
     }
 
-    if(ppl_delete_chunk(page) == PPL_FAIL){
+    if(ppl_delete_chunk(pager, page) == PPL_FAIL){
         logger(LL_ERROR, __func__, "Unable to delete page");
         return PPL_FAIL;
     }
+    ppl->chunks--;
 
     return PPL_SUCCESS;
 
 }
 
-int ppl_dealloc_nova(page_pool_t* ppl, chblix_t* chblix){
+int ppl_dealloc_nova(pager_t* pager, page_pool_t* ppl, chblix_t* chblix){
     logger(LL_DEBUG, __func__, "Deallocating page");
+    pg_scoped_t latch pg_latched = {pager, pg_latch(pager, page_pool_index(ppl), true)};
+    if(latch.page_index == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to latch page pool %ld", page_pool_index(ppl));
+        return PPL_FAIL;
+    }
     // Load current page
-    chunk_t* page = ppl_load_chunk(chblix->chunk_idx);
+    chunk_t* page = ppl_load_chunk(pager, chblix->chunk_idx);
     if(!page){
         logger(LL_ERROR, __func__, "Unable to load page");
         return PPL_FAIL;
@@ -473,38 +628,41 @@ int ppl_dealloc_nova(page_pool_t* ppl, chblix_t* chblix){
         next_idx = page->num_of_used_blocks;
     }
 
-    ppl_write_block_nova(ppl, chblix, &next_idx, sizeof(int64_t), 0);
+    ppl_write_block_nova(pager, ppl, chblix, &next_idx, sizeof(int64_t), 0);
     page->next = chblix->block_idx;
     page->num_of_free_blocks++;
+    ppl_bit_clear(ppl_used_bits(page), chblix->block_idx);
+    ppl_bit_clear(ppl_head_bits(page), chblix->block_idx);
 
 
     if(page->num_of_free_blocks == page->capacity){
-        ppl_pool_reduce(ppl, page);
+        ppl_pool_reduce(pager, ppl, page);
         return PPL_SUCCESS;
     }
     if(ppl->current_idx != page->page_index) {
-        pa_push_unique64(ppl->wait, chblix->chunk_idx);
+        pa_push_unique64(pager, ppl->wait, chblix->chunk_idx);
     }
     return PPL_SUCCESS;
 }
 
 /**
  * @brief       Deallocates block
+ * @param[in]   pager: pointer to pager_t
  * @param[in]   ppidx: Page pool index
  * @param[in]   chblix: Chunk and block index
  * @return      PPL_SUCCESS or PPL_FAIL
  */
 
-int ppl_dealloc(int64_t ppidx, chblix_t* chblix){
+int ppl_dealloc(pager_t* pager, int64_t ppidx, chblix_t* chblix){
     logger(LL_DEBUG, __func__, "Deallocating page");
 
     /* Load page pool */
-    page_pool_t *ppl = ppl_load(ppidx);
+    page_pool_t *ppl = ppl_load(pager, ppidx);
     if(ppl == NULL){
         logger(LL_ERROR, __func__, "Unable to load page pool %ld", ppidx);
         return PPL_FAIL;
     }
-    return ppl_dealloc_nova(ppl, chblix);
+    return ppl_dealloc_nova(pager, ppl, chblix);
 }
 
 
@@ -513,18 +671,19 @@ int ppl_dealloc(int64_t ppidx, chblix_t* chblix){
 
 /**
  * @brief Initializes page_pool
+ * @param pager: pointer to pager_t
  * @param block_size
  * @param start_page_index
  * @return ppl_index or PPL_FAIL
  */
 
-int64_t ppl_init(int64_t block_size){
+int64_t ppl_init(pager_t* pager, int64_t block_size){
     logger(LL_DEBUG, __func__, "Initializing page pool");
 
-    int64_t page_index = lp_init();
+    int64_t page_index = lp_init(pager);
 
     // Load page pool
-    page_pool_t* ppl = (page_pool_t*)lp_load(page_index);
+    page_pool_t* ppl = (page_pool_t*)lp_load(pager, page_index);
     if(!ppl){
         logger(LL_ERROR, __func__, "Unable to load page");
         return PPL_FAIL;
@@ -533,7 +692,7 @@ int64_t ppl_init(int64_t block_size){
     ppl->block_size = block_size;
 
     // Initialize first page pool
-    int64_t chunk_idx = ppl_chunk_init(ppl);
+    int64_t chunk_idx = ppl_chunk_init(pager, ppl);
     if(chunk_idx == PPL_FAIL){
         logger(LL_ERROR, __func__, "Unable to initialize page");
         return PPL_FAIL;
@@ -541,9 +700,10 @@ int64_t ppl_init(int64_t block_size){
     ppl->current_idx = chunk_idx;
     ppl->head = ppl->current_idx;
     ppl->tail = ppl->head;
+    ppl->chunks = 1;
 
     // Initialize wait
-    ppl->wait  = pa_init64(sizeof(int64_t), -1);
+    ppl->wait  = pa_init64(pager, sizeof(int64_t), -1);
     if(ppl->wait  == PA_FAIL){
         logger(LL_ERROR, __func__, "Unable to initialize wait");
         return PPL_FAIL;
@@ -554,20 +714,23 @@ int64_t ppl_init(int64_t block_size){
 
 /**
  * Load existing page_pool_t from file
+ * @details Page of pool is kept till pool is destroyed, so returned handle isn't invalidated
+ *          by eviction or compaction.
+ * @param   pager: pointer to pager_t
  * @param   start_page_index
  * @return  pointer to page_pool_t or NULL
  */
 
-page_pool_t* ppl_load(int64_t start_page_index){
+page_pool_t* ppl_load(pager_t* pager, int64_t start_page_index){
     logger(LL_DEBUG, __func__, "Loading chunk_t Pool %ld.", start_page_index);
-    if(start_page_index > pg_max_page_index()){
+    if(!pg_exists(pager, start_page_index)){
         logger(LL_ERROR, __func__, "You need to init page pool before");
         return NULL;
     }
 
     // Load page pool
-    page_pool_t* ppl = (page_pool_t*)lp_load(start_page_index);
-    if(!ppl){
+    page_pool_t* ppl = (page_pool_t*)lp_load(pager, start_page_index);
+    if(!ppl || pg_keep(pager, start_page_index) == PAGER_FAIL){
         logger(LL_ERROR, __func__, "Unable to load page");
         return NULL;
     }
@@ -575,46 +738,69 @@ page_pool_t* ppl_load(int64_t start_page_index){
     return ppl;
 }
 
+/**
+ * @brief       Load existing page pool for reading
+ * @details     Pool isn't marked dirty, it must not be modified through returned pointer.
+ *              Page of pool is kept like by ppl_load.
+ * @param[in]   pager: pointer to pager_t
+ * @param[in]   start_page_index: index of the pool
+ * @return      pointer to page_pool_t or NULL
+ */
+
+page_pool_t* ppl_read(pager_t* pager, int64_t start_page_index){
+    if(!pg_exists(pager, start_page_index)){
+        logger(LL_ERROR, __func__, "You need to init page pool before");
+        return NULL;
+    }
+    page_pool_t* ppl = (page_pool_t*)lp_read(pager, start_page_index);
+    if(!ppl || pg_keep(pager, start_page_index) == PAGER_FAIL){
+        logger(LL_ERROR, __func__, "Unable to read page");
+        return NULL;
+    }
+    return ppl;
+}
+
 /**
  * @brief       Destroys page pool
+ * @param[in]   pager: pointer to pager_t
  * @param[in]   pplidx: Page pool index
  * @return      PPL_SUCCESS or PPL_FAIL
  */
 
-int ppl_destroy(int64_t pplidx){
+int ppl_destroy(pager_t* pager, int64_t pplidx){
     logger(LL_DEBUG, __func__, "Destroying page pool");
-    page_pool_t* ppl = ppl_load(pplidx);
+    page_pool_t* ppl = ppl_load(pager, pplidx);
     if(!ppl){
         logger(LL_ERROR, __func__, "Unable to load page pool");
         return PPL_FAIL;
     }
 
-    chunk_t* chunk  = ppl_load_chunk(ppl->head);
+    chunk_t* chunk  = ppl_load_chunk(pager, ppl->head);
     while(chunk->next_page != -1){
-        chunk_t* next_chunk = ppl_load_chunk(chunk->next_page);
+        chunk_t* next_chunk = ppl_load_chunk(pager, chunk->next_page);
         if(!next_chunk){
             logger(LL_ERROR, __func__, "Unable to load next page");
             return PPL_FAIL;
         }
-        if(ppl_delete_chunk(chunk) == PPL_FAIL){
+        if(ppl_delete_chunk(pager, chunk) == PPL_FAIL){
             logger(LL_ERROR, __func__, "Unable to delete page");
             return PPL_FAIL;
         }
         chunk = next_chunk;
     }
 
-    if(ppl_delete_chunk(chunk) == PPL_FAIL){
+    if(ppl_delete_chunk(pager, chunk) == PPL_FAIL){
         logger(LL_ERROR, __func__, "Unable to delete page");
         return PPL_FAIL;
     }
 
     if(ppl->wait != -1){
-        if(pa_destroy(ppl->wait) == PA_FAIL){
+        if(pa_destroy(pager, ppl->wait) == PA_FAIL){
             logger(LL_ERROR, __func__, "Unable to delete wait");
             return PPL_FAIL;
         }
     }
-    if(lp_delete(pplidx) == LP_FAIL){
+    if(lp_delete(pager, pplidx) == LP_FAIL){
         logger(LL_ERROR, __func__, "Unable to delete page pool");
         return PPL_FAIL;
     }
@@ -1,15 +1,32 @@
 #pragma once
 
 #include "core/io/linked_pages.h"
+#include "core/io/pager.h"
 #include <stdint.h>
 
 #define sizeof_Page_Header (sizeof(int64_t) * 7)
 
+/* Pool grows by extents of chunks lying one after another in file, extent holds as many chunks as pool
+ * already has, up to PPL_EXTENT_MAX, so spare chunks never outnumber used ones */
+#ifndef PPL_EXTENT_MAX
+#define PPL_EXTENT_MAX 64
+#endif
+
 typedef struct chblix{
     int64_t block_idx;
     int64_t chunk_idx;
 } chblix_t;
 
+/* Row id is chblix packed in one word: chunk index << PPL_ROWID_BLOCK_BITS | block index.
+ * Chunk capacity is limited by PPL_ROWID_BLOCK_BITS, so every block has its row id */
+typedef uint64_t rowid_t;
+
+#ifndef PPL_ROWID_BLOCK_BITS
+#define PPL_ROWID_BLOCK_BITS 20
+#endif
+#define PPL_ROWID_BLOCK_MASK ((1ull << PPL_ROWID_BLOCK_BITS) - 1)
+#define ROWID_FAIL UINT64_MAX
+
 typedef struct chunk {
     linked_page_t lp_header;
     int64_t page_index;
@@ -19,6 +36,7 @@ typedef struct chunk {
     int64_t next;
     int64_t prev_page;
     int64_t next_page;
+    uint64_t bitmap[];  // occupancy bitmap, then chain head bitmap, ppl_bitmap_words(capacity) words each
 } chunk_t;
 
 typedef struct page_pool {
@@ -28,6 +46,7 @@ typedef struct page_pool {
     int64_t tail;
     int64_t block_size;
     int64_t wait; // parray index
+    int64_t chunks; // chunks linked in pool
 } page_pool_t;
 
 typedef enum {PPL_SUCCESS = 0, PPL_FAIL = -1, PPL_EMPTY = 1} page_pool_status_t;
@@ -35,23 +54,40 @@ typedef enum {PPL_SUCCESS = 0, PPL_FAIL = -1, PPL_EMPTY = 1} page_pool_status_t;
 #define CHBLIX_FAIL (chblix_t){.block_idx = -1, .chunk_idx = -1}
 chblix_t chblix_fail(void);
 int chblix_cmp(const chblix_t* chblix1, const chblix_t* chblix2);
+rowid_t rowid_pack(chblix_t chblix);
+chblix_t rowid_unpack(rowid_t rowid);
+#define rowid_chunk(rowid) ((int64_t)((rowid) >> PPL_ROWID_BLOCK_BITS))
+#define rowid_block(rowid) ((int64_t)((rowid) & PPL_ROWID_BLOCK_MASK))
 
 #define page_pool_index(ppl) (ppl->lp_header.page_index)
 
-int64_t ppl_chunk_init(page_pool_t* ppl);
-chunk_t* ppl_create_page(page_pool_t* ppl);
-chunk_t* ppl_load_chunk(int64_t chunk_index);
-int ppl_delete_chunk(chunk_t* chunk);
-int ppl_write_block_nova(page_pool_t* ppl, const chblix_t* chblix, void* src, int64_t size, int64_t src_offset);
-int ppl_write_block(int64_t ppidx, const chblix_t* chblix, void* src, int64_t size, int64_t src_offset);
-int ppl_read_block(int64_t ppidx, const chblix_t* chblix, void* dest,  int64_t size, int64_t src_offset);
-int ppl_read_block_nova(page_pool_t* ppl, linked_page_t* lp, const chblix_t* chblix, void* dest,  int64_t size, int64_t src_offset);
-int ppl_pool_expand(page_pool_t* ppl);
-chblix_t ppl_alloc_nova(page_pool_t* ppl);
-chblix_t ppl_alloc(int64_t ppidx);
-int ppl_pool_reduce(page_pool_t* ppl, chunk_t* page);
-int ppl_dealloc_nova(page_pool_t* ppl, chblix_t* chblix);
-int ppl_dealloc(int64_t ppidx, chblix_t* chblix);
-int64_t ppl_init(int64_t block_size);
-page_pool_t* ppl_load(int64_t start_page_index);
-int ppl_destroy(int64_t pplidx);
+#define PPL_WORD_BITS 64
+#define ppl_bitmap_words(capacity) (((capacity) + PPL_WORD_BITS - 1) / PPL_WORD_BITS)
+/* Bit of block is set in occupancy bitmap while block is allocated */
+#define ppl_used_bits(chunk) ((chunk)->bitmap)
+/* Bit of block is set in chain head bitmap while block is allocated and starts chain of linked blocks */
+#define ppl_head_bits(chunk) ((chunk)->bitmap + ppl_bitmap_words((chunk)->capacity))
+#define ppl_bit_test(bits, block_idx) (((bits)[(block_idx) / PPL_WORD_BITS] >> ((block_idx) % PPL_WORD_BITS)) & 1)
+#define ppl_bit_set(bits, block_idx) ((bits)[(block_idx) / PPL_WORD_BITS] |= 1ull << ((block_idx) % PPL_WORD_BITS))
+#define ppl_bit_clear(bits, block_idx) ((bits)[(block_idx) / PPL_WORD_BITS] &= ~(1ull << ((block_idx) % PPL_WORD_BITS)))
+
+int64_t ppl_chunk_init(pager_t* pager, page_pool_t* ppl);
+int64_t ppl_chunk_init_at(pager_t* pager, page_pool_t* ppl, int64_t page_index);
+chunk_t* ppl_create_page(pager_t* pager, page_pool_t* ppl);
+chunk_t* ppl_load_chunk(pager_t* pager, int64_t chunk_index);
+chunk_t* ppl_read_chunk(pager_t* pager, int64_t chunk_index);
+int ppl_delete_chunk(pager_t* pager, chunk_t* chunk);
+int ppl_write_block_nova(pager_t* pager, page_pool_t* ppl, const chblix_t* chblix, void* src, int64_t size, int64_t src_offset);
+int ppl_write_block(pager_t* pager, int64_t ppidx, const chblix_t* chblix, void* src, int64_t size, int64_t src_offset);
+int ppl_read_block(pager_t* pager, int64_t ppidx, const chblix_t* chblix, void* dest,  int64_t size, int64_t src_offset);
+int ppl_read_block_nova(pager_t* pager, page_pool_t* ppl, linked_page_t* lp, const chblix_t* chblix, void* dest,  int64_t size, int64_t src_offset);
+int ppl_pool_expand(pager_t* pager, page_pool_t* ppl);
+chblix_t ppl_alloc_nova(pager_t* pager, page_pool_t* ppl);
+chblix_t ppl_alloc(pager_t* pager, int64_t ppidx);
+int ppl_pool_reduce(pager_t* pager, page_pool_t* ppl, chunk_t* page);
+int ppl_dealloc_nova(pager_t* pager, page_pool_t* ppl, chblix_t* chblix);
+int ppl_dealloc(pager_t* pager, int64_t ppidx, chblix_t* chblix);
+int64_t ppl_init(pager_t* pager, int64_t block_size);
+page_pool_t* ppl_load(pager_t* pager, int64_t start_page_index);
+page_pool_t* ppl_read(pager_t* pager, int64_t start_page_index);
+int ppl_destroy(pager_t* pager, int64_t pplidx);
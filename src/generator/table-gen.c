@@ -5,12 +5,13 @@
 
 /**
  * @brief       Generate empty table
+ * @param[in]   pager: handle of database
  * @param[in]   mtabidx: meta table index
  * @param[in]   gentabMgr_ptr: pointer to generate table manager
  * @return      return tablix on success, TABLE_FAIL otherwise
  */
 
-table_t* gen_empty_table(db_t* db, gentab_mgr* gentabMgr_ptr, schema_t* schema){
+table_t* gen_empty_table(pager_t* pager, db_t* db, gentab_mgr* gentabMgr_ptr, schema_t* schema){
     int64_t number_of_fields = 1 + arc4random_uniform(80);
     for(int64_t i = 0; i < number_of_fields; ++i){
         int64_t size = 8 + i%10;
@@ -22,19 +23,19 @@ table_t* gen_empty_table(db_t* db, gentab_mgr* gentabMgr_ptr, schema_t* schema){
         datatype_t type = arc4random_uniform(5);
         switch (type) {
             case DT_VARCHAR:
-                sch_add_varchar_field(schema, field_name);
+                sch_add_varchar_field(pager, schema, field_name);
                 break;
             case DT_CHAR:
-                sch_add_char_field(schema, field_name, field_size);
+                sch_add_char_field(pager, schema, field_name, field_size);
                 break;
             case DT_INT:
-                sch_add_int_field(schema, field_name);
+                sch_add_int_field(pager, schema, field_name);
                 break;
             case DT_FLOAT:
-                sch_add_float_field(schema, field_name);
+                sch_add_float_field(pager, schema, field_name);
                 break;
             case DT_BOOL:
-                sch_add_bool_field(schema, field_name);
+                sch_add_bool_field(pager, schema, field_name);
                 break;
             default:
                 break;
@@ -47,18 +48,19 @@ table_t* gen_empty_table(db_t* db, gentab_mgr* gentabMgr_ptr, schema_t* schema){
     snprintf(str, size, "GEN_%llu", gentabMgr_ptr->next_index);
     strncpy(table_name, str, size);
     gentabMgr_ptr->next_index++;
-    table_t* table = tab_init(db, table_name, schema);
+    table_t* table = tab_init(pager, db, table_name, schema);
     free(table_name);
     return table;
 }
 
 /**
  * @brief       Generate random element
+ * @param[in]   pager: handle of database
  * @param[in]   field: pointer to field
  * @return      pointer to element on success, NULL otherwise
  */
 
-int gen_fill_element(db_t* db, field_t* field, uint8_t* element){
+int gen_fill_element(pager_t* pager, db_t* db, field_t* field, uint8_t* element){
     switch (field->type) {
         case DT_INT: {
             int64_t rand_num = INT16_MIN + arc4random_uniform(INT16_MAX - INT16_MIN + 1);
@@ -91,8 +93,8 @@ int gen_fill_element(db_t* db, field_t* field, uint8_t* element){
             for(int64_t i = 0; i < size; ++i){
                 rand_varchar[i] = (char)((uint32_t)'a' + arc4random_uniform(26));
             }
-            vch_ticket_t ticket = vch_add(db->varchar_mgr_idx, rand_varchar);
-            if(chblix_cmp(&ticket.block, &CHBLIX_FAIL) == 0){
+            vch_ticket_t ticket = vch_add(pager, db->varchar_mgr_idx, rand_varchar);
+            if(ticket.block == ROWID_FAIL){
                 logger(LL_ERROR, __func__, "Failed to add varchar");
                 return -1;
             }
@@ -109,14 +111,15 @@ int gen_fill_element(db_t* db, field_t* field, uint8_t* element){
 
 /**
  * @brief       Generate random row
+ * @param       pager: handle of database
  * @param       schema: pointer to schema
  * @return      pointer to row on success, NULL otherwise
  */
 
-int gen_fill_row(db_t* db, schema_t* schema, uint8_t* row){
-    sch_for_each(schema, chunk, field, chblix, schema_index(schema)){
+int gen_fill_row(pager_t* pager, db_t* db, schema_t* schema, uint8_t* row){
+    sch_for_each(pager, schema, chunk, field, chblix, schema_index(schema)){
         uint8_t* element = malloc(field.size);
-        if(gen_fill_element(db, &field, element)!=0){
+        if(gen_fill_element(pager, db, &field, element)!=0){
             logger(LL_ERROR, __func__, "Failed to generate element");
             free(element);
             return -1;
@@ -129,21 +132,22 @@ int gen_fill_row(db_t* db, schema_t* schema, uint8_t* row){
 
 /**
  * @brief       Generate random rows
+ * @param[in]   pager: handle of database
  * @param[in]   tablix: index of the table
  * @param[in]   number: number of rows to generate
  * @return      TABLE_SUCCESS on success, TABLE_FAIL otherwise
  */
 
-int gen_fill_rows(db_t* db, table_t* table, schema_t* schema, int64_t number){
+int gen_fill_rows(pager_t* pager, db_t* db, table_t* table, schema_t* schema, int64_t number){
     for(int64_t i = 0; i < number; ++i){
         uint8_t* row = malloc(schema->slot_size);
-        gen_fill_row(db, schema, row);
+        gen_fill_row(pager, db, schema, row);
         if(row == NULL){
             logger(LL_ERROR, __func__, "Failed to generate row");
             return TABLE_FAIL;
         }
-        chblix_t res = tab_insert(table, schema, row);
-        if(chblix_cmp(&res, &CHBLIX_FAIL) == 0){
+        rowid_t res = tab_insert(pager, table, schema, row);
+        if(res == ROWID_FAIL){
             logger(LL_ERROR, __func__, "Failed to insert row");
             return TABLE_FAIL;
         }
@@ -152,15 +156,15 @@ int gen_fill_rows(db_t* db, table_t* table, schema_t* schema, int64_t number){
     return TABLE_SUCCESS;
 }
 
-table_t* gen_table(db_t* db, gentab_mgr* gentabMgr_ptr, int64_t min_number_of_rows){
-    schema_t* schema = sch_init();
-    table_t* table = gen_empty_table(db, gentabMgr_ptr, schema);
+table_t* gen_table(pager_t* pager, db_t* db, gentab_mgr* gentabMgr_ptr, int64_t min_number_of_rows){
+    schema_t* schema = sch_init(pager);
+    table_t* table = gen_empty_table(pager, db, gentabMgr_ptr, schema);
     if(table == NULL){
         logger(LL_ERROR, __func__, "Failed to generate empty table");
         return NULL;
     }
     int64_t number_of_rows = min_number_of_rows + arc4random_uniform(min_number_of_rows * 10 - min_number_of_rows + 1);
-    if(gen_fill_rows(db, table, schema, number_of_rows) == TABLE_FAIL){
+    if(gen_fill_rows(pager, db, table, schema, number_of_rows) == TABLE_FAIL){
         logger(LL_ERROR, __func__, "Failed to generate rows");
         return NULL;
     }
@@ -0,0 +1,37 @@
+#pragma once
+
+/* Locks of storage engine, they do nothing where threads aren't supported */
+#if defined(__linux__) || defined(__APPLE__) || defined(__unix__)
+#include <pthread.h>
+
+typedef pthread_mutex_t lk_mutex_t;
+typedef pthread_cond_t lk_cond_t;
+
+#define lk_mutex_init(m)        pthread_mutex_init((m), NULL)
+#define lk_mutex_destroy(m)     pthread_mutex_destroy(m)
+#define lk_lock(m)              pthread_mutex_lock(m)
+#define lk_trylock(m)           (pthread_mutex_trylock(m) == 0)
+#define lk_unlock(m)            pthread_mutex_unlock(m)
+
+#define lk_cond_init(c)         pthread_cond_init((c), NULL)
+#define lk_cond_destroy(c)      pthread_cond_destroy(c)
+#define lk_wait(c, m)           pthread_cond_wait((c), (m))
+#define lk_broadcast(c)         pthread_cond_broadcast(c)
+
+#else
+
+typedef int lk_mutex_t;
+typedef int lk_cond_t;
+
+#define lk_mutex_init(m)        ((void)(m))
+#define lk_mutex_destroy(m)     ((void)(m))
+#define lk_lock(m)              ((void)(m))
+#define lk_trylock(m)           ((void)(m), 1)
+#define lk_unlock(m)            ((void)(m))
+
+#define lk_cond_init(c)         ((void)(c))
+#define lk_cond_destroy(c)      ((void)(c))
+#define lk_wait(c, m)           ((void)(c), (void)(m))
+#define lk_broadcast(c)         ((void)(c))
+
+#endif
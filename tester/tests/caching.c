@@ -1,6 +1,11 @@
 #include "../src/test.h"
 #include "core/io/caching.h"
 #include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
 
 DEFINE_TEST(write_and_read){
     caching_t* caching = malloc(sizeof(caching_t));
@@ -284,8 +289,463 @@ DEFINE_TEST(unsafe_read){
 }
 
 
+#define TEST_BUDGET ((size_t)(50 * PAGE_SIZE))
 
+static void evict_and_read_back(ch_policy_t policy){
+    caching_t* caching = malloc(sizeof(caching_t));
+    ch_options_t opt = {.policy = policy, .budget = TEST_BUDGET};
+    assert(ch_init_opt("test.db", caching, &opt) == CH_SUCCESS);
+    size_t pages = 4 * (TEST_BUDGET / PAGE_SIZE);
+    for(size_t i = 0; i < pages; i++){
+        int64_t page = ch_new_page(caching);
+        assert(ch_write(caching, page, &i, sizeof(i), 0) == CH_SUCCESS);
+        assert(ch_usage_memory_space(caching) <= TEST_BUDGET);
+    }
+    for(size_t i = 0; i < pages; i++){
+        size_t value = 0;
+        assert(ch_copy_read(caching, (int64_t)i, &value, sizeof(value), 0) == CH_SUCCESS);
+        assert(value == i);
+    }
+    ch_delete(caching);
+    free(caching);
+}
+
+DEFINE_TEST(eviction_policies){
+    evict_and_read_back(CH_POLICY_2Q);
+    evict_and_read_back(CH_POLICY_LEGACY);
+}
+
+DEFINE_TEST(hot_page_survives_scan){
+    caching_t* caching = malloc(sizeof(caching_t));
+    ch_options_t opt = {.policy = CH_POLICY_2Q, .budget = TEST_BUDGET};
+    assert(ch_init_opt("test.db", caching, &opt) == CH_SUCCESS);
+    char str[] = "hot";
+    int64_t hot = ch_new_page(caching);
+    ch_write(caching, hot, str, sizeof(str), 0);
+    for(size_t i = 0; i < 8 * (TEST_BUDGET / PAGE_SIZE); i++){
+        ch_new_page(caching);
+        char read_str[sizeof(str)];
+        assert(ch_copy_read(caching, hot, read_str, sizeof(str), 0) == CH_SUCCESS);
+        assert(strcmp(str, read_str) == 0);
+    }
+    assert(ch_cached(caching, hot));
+    assert(ch_find_entry(caching, hot)->queue == CH_Q_AM);
+    ch_delete(caching);
+    free(caching);
+}
+
+DEFINE_TEST(live_budget_resize){
+    caching_t* caching = malloc(sizeof(caching_t));
+    ch_options_t opt = {.policy = CH_POLICY_2Q, .budget = TEST_BUDGET, .low_watermark = 50};
+    assert(ch_init_opt("test.db", caching, &opt) == CH_SUCCESS);
+    assert(ch_budget(caching) == TEST_BUDGET);
+    for(size_t i = 0; i < 2 * (TEST_BUDGET / PAGE_SIZE); i++){
+        int64_t page = ch_new_page(caching);
+        assert(ch_write(caching, page, &i, sizeof(i), 0) == CH_SUCCESS);
+    }
+    assert(ch_size(caching) >= TEST_BUDGET / PAGE_SIZE / 2);
+    assert(ch_set_budget(caching, 10 * PAGE_SIZE) == CH_SUCCESS);
+    assert(ch_size(caching) <= 5);
+    for(size_t i = 0; i < 2 * (TEST_BUDGET / PAGE_SIZE); i++){
+        size_t value = 0;
+        assert(ch_copy_read(caching, (int64_t)i, &value, sizeof(value), 0) == CH_SUCCESS);
+        assert(value == i);
+        assert(ch_size(caching) <= 10);
+    }
+    assert(ch_set_budget(caching, TEST_BUDGET) == CH_SUCCESS);
+    for(size_t i = 0; i < TEST_BUDGET / PAGE_SIZE; i++){
+        void* page = NULL;
+        assert(ch_load_page(caching, (int64_t)i, &page) == CH_SUCCESS);
+    }
+    assert(ch_size(caching) > 10);
+    ch_delete(caching);
+    free(caching);
+}
+DEFINE_TEST(metadata_follows_resident_set){
+    caching_t* caching = malloc(sizeof(caching_t));
+    ch_options_t opt = {.policy = CH_POLICY_2Q, .budget = TEST_BUDGET};
+    assert(ch_init_opt("test.db", caching, &opt) == CH_SUCCESS);
+    size_t pages = 20 * (TEST_BUDGET / PAGE_SIZE);
+    for(size_t i = 0; i < pages; i++){
+        int64_t page = ch_new_page(caching);
+        assert(ch_write(caching, page, &i, sizeof(i), 0) == CH_SUCCESS);
+    }
+    assert(ch_used(caching) <= 2 * (TEST_BUDGET / PAGE_SIZE));
+    assert(ch_capacity(caching) < pages / 4);
+    for(size_t i = pages; i-- > 0;){
+        size_t value = 0;
+        assert(ch_copy_read(caching, (int64_t)i, &value, sizeof(value), 0) == CH_SUCCESS);
+        assert(value == i);
+    }
+    assert(ch_delete_page(caching, 3) == CH_SUCCESS);
+    assert(ch_page_status(caching, 3) == 3);
+    void* page = NULL;
+    assert(ch_load_page(caching, 3, &page) == CH_DELETED);
+    assert(ch_size(caching) == (size_t)ch_print_cached_pages(caching));
+    ch_delete(caching);
+    free(caching);
+}
+
+DEFINE_TEST(frame_pool_backend){
+    caching_t* caching = malloc(sizeof(caching_t));
+    ch_options_t opt = {.file = {.backend = FL_BACKEND_PREAD, .frames = 32, .direct = true},
+                        .budget = 2 * TEST_BUDGET};
+    assert(ch_init_opt("test.db", caching, &opt) == CH_SUCCESS);
+    assert(ch_budget(caching) <= (size_t)(32 * PAGE_SIZE));
+    size_t pages = 4 * 32;
+    for(size_t i = 0; i < pages; i++){
+        int64_t page = ch_new_page(caching);
+        assert(ch_write(caching, page, &i, sizeof(i), 0) == CH_SUCCESS);
+    }
+    ch_close(caching);
+    assert(ch_init_opt("test.db", caching, &opt) == CH_SUCCESS);
+    for(size_t i = 0; i < pages; i++){
+        size_t value = 0;
+        assert(ch_copy_read(caching, (int64_t)i, &value, sizeof(value), 0) == CH_SUCCESS);
+        assert(value == i);
+    }
+    ch_delete(caching);
+    free(caching);
+}
+
+DEFINE_TEST(batched_prefetch){
+    caching_t* caching = malloc(sizeof(caching_t));
+    ch_options_t opt = {.file = {.backend = FL_BACKEND_PREAD, .frames = 128}, .budget = TEST_BUDGET};
+    assert(ch_init_opt("test.db", caching, &opt) == CH_SUCCESS);
+    size_t pages = 2 * (TEST_BUDGET / PAGE_SIZE);
+    for(size_t i = 0; i < pages; i++){
+        int64_t page = ch_new_page(caching);
+        assert(ch_write(caching, page, &i, sizeof(i), 0) == CH_SUCCESS);
+    }
+    ch_close(caching);
+    assert(ch_init_opt("test.db", caching, &opt) == CH_SUCCESS);
+    int64_t indexes[] = {3, 5, 7, 5, 1000};
+    assert(ch_prefetch(caching, indexes, 5) == 3);
+    assert(ch_cached(caching, 3) && ch_cached(caching, 5) && ch_cached(caching, 7));
+    assert(ch_prefetch(caching, indexes, 3) == 0);
+    int64_t range[TEST_BUDGET / PAGE_SIZE];
+    for(size_t i = 0; i < TEST_BUDGET / PAGE_SIZE; i++){
+        range[i] = (int64_t)(i + 10);
+    }
+    int64_t loaded = ch_prefetch(caching, range, TEST_BUDGET / PAGE_SIZE);
+    assert(loaded > 0 && (size_t)loaded <= caching->high_watermark - caching->low_watermark);
+    assert(ch_usage_memory_space(caching) <= TEST_BUDGET);
+    for(size_t i = 0; i < pages; i++){
+        size_t value = 0;
+        assert(ch_copy_read(caching, (int64_t)i, &value, sizeof(value), 0) == CH_SUCCESS);
+        assert(value == i);
+    }
+    ch_delete(caching);
+    free(caching);
+}
+
+DEFINE_TEST(scan_readahead){
+    caching_t* caching = malloc(sizeof(caching_t));
+    ch_options_t opt = {.file = {.backend = FL_BACKEND_PREAD, .frames = 1024}, .budget = 512 * PAGE_SIZE};
+    assert(ch_init_opt("test.db", caching, &opt) == CH_SUCCESS);
+    for(size_t i = 0; i < 600; i++){
+        assert(ch_new_page(caching) == (int64_t)i);
+    }
+    ch_close(caching);
+    assert(ch_init_opt("test.db", caching, &opt) == CH_SUCCESS);
+    ch_readahead(caching, -1, 0);
+    assert(ch_cached(caching, 0) && ch_cached(caching, CH_RA_MIN - 1));
+    assert(!ch_cached(caching, CH_RA_MIN));
+    for(int64_t i = 1; i < 200; i++){
+        ch_readahead(caching, i - 1, i);
+        assert(ch_cached(caching, i));
+    }
+    ch_ra_stream_t* stream = NULL;
+    for(size_t i = 0; i < CH_RA_STREAMS; i++){
+        if(caching->ra[i].last == 199){
+            stream = &caching->ra[i];
+        }
+    }
+    assert(stream != NULL && stream->window > CH_RA_MIN);
+    size_t window = stream->window;
+    ch_readahead(caching, 199, 500);
+    assert(stream->last == 500 && stream->window == window / 2);
+    assert(ch_cached(caching, 500));
+    ch_delete(caching);
+    free(caching);
+}
+
+DEFINE_TEST(pinned_page_survives_eviction){
+    caching_t* caching = malloc(sizeof(caching_t));
+    ch_options_t opt = {.file = {.backend = FL_BACKEND_PREAD, .frames = 128}, .budget = TEST_BUDGET};
+    assert(ch_init_opt("test.db", caching, &opt) == CH_SUCCESS);
+    size_t pages = 4 * (TEST_BUDGET / PAGE_SIZE);
+    for(size_t i = 0; i < pages; i++){
+        assert(ch_new_page(caching) == (int64_t)i);
+    }
+    assert(ch_pin(caching, 1) == CH_SUCCESS);
+    void* page = NULL;
+    assert(ch_load_page(caching, 1, &page) == CH_SUCCESS);
+    size_t value = 42;
+    memcpy(page, &value, sizeof(value));
+    assert(ch_remove(caching, 1) == CH_PINNED);
+    for(size_t i = 2; i < pages; i++){
+        void* other = NULL;
+        assert(ch_load_page(caching, (int64_t)i, &other) == CH_SUCCESS);
+    }
+    assert(ch_cached(caching, 1));
+    void* same = NULL;
+    assert(ch_load_page(caching, 1, &same) == CH_SUCCESS);
+    assert(same == page && *(size_t*)same == 42);
+    assert(ch_unpin(caching, 1) == CH_SUCCESS);
+    assert(ch_unpin(caching, 1) == CH_FAIL);
+    assert(ch_remove(caching, 1) == CH_SUCCESS);
+    assert(!ch_cached(caching, 1));
+    value = 0;
+    assert(ch_copy_read(caching, 1, &value, sizeof(value), 0) == CH_SUCCESS);
+    assert(value == 42);
+    ch_delete(caching);
+    free(caching);
+}
+
+static size_t file_value(int64_t page_index){
+    size_t value = 0;
+    FILE* file = fopen("test.db", "rb");
+    assert(file != NULL);
+    assert(fseek(file, page_index * PAGE_SIZE, SEEK_SET) == 0);
+    assert(fread(&value, sizeof(value), 1, file) == 1);
+    fclose(file);
+    return value;
+}
+
+DEFINE_TEST(dirty_page_write_back){
+    caching_t* caching = malloc(sizeof(caching_t));
+    ch_options_t opt = {.file = {.backend = FL_BACKEND_PREAD, .frames = 1024}, .budget = 512 * PAGE_SIZE};
+    assert(ch_init_opt("test.db", caching, &opt) == CH_SUCCESS);
+    size_t pages = 2 * CH_FLUSH_BATCH;
+    for(size_t i = 0; i < pages; i++){
+        int64_t page = ch_new_page(caching);
+        assert(ch_write(caching, page, &i, sizeof(i), 0) == CH_SUCCESS);
+    }
+    /* background batch was started */
+    assert(caching->flusher != NULL);
+    assert(ch_flush(caching, true) >= 0);
+    assert(caching->dirty == 0);
+    for(size_t i = 0; i < pages; i++){
+        assert(file_value((int64_t)i) == i);
+    }
+    /* clean page is dropped, file isn't written */
+    size_t value = 0;
+    assert(ch_copy_read(caching, 5, &value, sizeof(value), 0) == CH_SUCCESS);
+    FILE* file = fopen("test.db", "r+b");
+    size_t external = 1000;
+    assert(fseek(file, 5 * PAGE_SIZE, SEEK_SET) == 0 && fwrite(&external, sizeof(external), 1, file) == 1);
+    fclose(file);
+    assert(ch_remove(caching, 5) == CH_SUCCESS);
+    assert(file_value(5) == external);
+    /* dirty page is written on eviction */
+    value = 77;
+    assert(ch_write(caching, 6, &value, sizeof(value), 0) == CH_SUCCESS);
+    assert(caching->dirty == 1);
+    assert(ch_remove(caching, 6) == CH_SUCCESS);
+    assert(caching->dirty == 0 && file_value(6) == 77);
+    ch_delete(caching);
+    free(caching);
+}
+
+#define COMMIT_THREADS 8
+#define COMMITS 32
+
+static void* commit_worker(void* arg){
+    caching_t* caching = arg;
+    for(int i = 0; i < COMMITS; i++){
+        assert(syn_commit(caching->syncer) == SYN_SUCCESS);
+    }
+    return NULL;
+}
+
+DEFINE_TEST(group_commit){
+    caching_t* caching = malloc(sizeof(caching_t));
+    ch_options_t opt = {.sync = {.mode = SYN_MODE_COMMIT}};
+    assert(ch_init_opt("test.db", caching, &opt) == CH_SUCCESS);
+    size_t value = 42;
+    int64_t page = ch_new_page(caching);
+    assert(ch_write(caching, page, &value, sizeof(value), 0) == CH_SUCCESS);
+    assert(ch_commit(caching) == CH_SUCCESS);
+    assert(caching->dirty == 0 && syn_count(caching->syncer) == 1);
+    pthread_t threads[COMMIT_THREADS];
+    for(int i = 0; i < COMMIT_THREADS; i++){
+        assert(pthread_create(&threads[i], NULL, commit_worker, caching) == 0);
+    }
+    for(int i = 0; i < COMMIT_THREADS; i++){
+        pthread_join(threads[i], NULL);
+    }
+    uint64_t syncs = syn_count(caching->syncer);
+    /* concurrent commits share syncs */
+    assert(syncs > 1 && syncs < 1 + COMMIT_THREADS * COMMITS);
+    ch_delete(caching);
+
+    opt = (ch_options_t){.sync = {.mode = SYN_MODE_PERIODIC, .interval_ms = 5}};
+    assert(ch_init_opt("test.db", caching, &opt) == CH_SUCCESS);
+    assert(ch_commit(caching) == CH_SUCCESS);
+    clock_t start = clock();
+    while(syn_count(caching->syncer) == 0 && clock() - start < 5 * CLOCKS_PER_SEC);
+    assert(syn_count(caching->syncer) > 0);
+    ch_delete(caching);
+    free(caching);
+}
+
+#define WAL_PAGES 64
+
+DEFINE_TEST(wal_crash_recovery){
+    ch_options_t opt = {.budget = 16 * PAGE_SIZE, .sync = {.mode = SYN_MODE_COMMIT}, .wal = true};
+    pid_t pid = fork();
+    assert(pid != -1);
+    if(pid == 0){
+        caching_t caching;
+        if(ch_init_opt("test.db", &caching, &opt) != CH_SUCCESS){
+            _exit(1);
+        }
+        /* committed pages outnumber budget, so logged pages are evicted to file */
+        for(size_t i = 0; i < WAL_PAGES; i++){
+            int64_t page = ch_new_page(&caching);
+            if(ch_write(&caching, page, &i, sizeof(i), 0) != CH_SUCCESS || (i % 8 == 7 && ch_commit(&caching) != CH_SUCCESS)){
+                _exit(1);
+            }
+        }
+        /* changes which aren't committed */
+        size_t junk = 1000;
+        for(int64_t i = 0; i < 4; i++){
+            ch_write(&caching, i, &junk, sizeof(junk), 0);
+        }
+        ch_new_page(&caching);
+        /* crash, nothing is closed */
+        _exit(0);
+    }
+    int status = 0;
+    assert(waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    for(int64_t i = 0; i < 4; i++){
+        assert(file_value(i) != 1000);
+    }
+    /* torn record at the end of log */
+    FILE* log = fopen("test.db" WAL_SUFFIX, "ab");
+    assert(log != NULL);
+    uint32_t torn[3] = {0x4C415752u, WAL_REC_PAGE, 0};
+    fwrite(torn, sizeof(torn), 1, log);
+    fclose(log);
+
+    caching_t* caching = malloc(sizeof(caching_t));
+    assert(ch_init_opt("test.db", caching, NULL) == CH_SUCCESS);
+    assert(fopen("test.db" WAL_SUFFIX, "rb") == NULL);
+    assert(ch_number_pages(caching) == WAL_PAGES);
+    for(size_t i = 0; i < WAL_PAGES; i++){
+        size_t value = 0;
+        assert(ch_copy_read(caching, (int64_t)i, &value, sizeof(value), 0) == CH_SUCCESS);
+        assert(value == i);
+    }
+    ch_delete(caching);
+    free(caching);
+}
 
+/**
+ * Child writes WAL_PAGES pages with values from first, commits them, overwrites them with values
+ * from first + 1000, so pages which aren't committed are evicted, and crashes.
+ */
+static void wal_spill_crash(int64_t first, bool commit){
+    ch_options_t opt = {.budget = 16 * PAGE_SIZE, .sync = {.mode = SYN_MODE_COMMIT}, .wal = true};
+    pid_t pid = fork();
+    assert(pid != -1);
+    if(pid == 0){
+        caching_t caching;
+        if(ch_init_opt("test.db", &caching, &opt) != CH_SUCCESS){
+            _exit(1);
+        }
+        for(int64_t i = 0; i < WAL_PAGES; i++){
+            int64_t value = first + i;
+            if((first == 0 && ch_new_page(&caching) != i) || ch_write(&caching, i, &value, sizeof(value), 0) != CH_SUCCESS){
+                _exit(1);
+            }
+        }
+        if(ch_commit(&caching) != CH_SUCCESS){
+            _exit(1);
+        }
+        for(int64_t i = 0; i < WAL_PAGES; i++){
+            int64_t value = first + 1000 + i;
+            if(ch_write(&caching, i, &value, sizeof(value), 0) != CH_SUCCESS){
+                _exit(1);
+            }
+        }
+        /* evicted pages are read back with their changes */
+        for(int64_t i = 0; i < WAL_PAGES; i++){
+            int64_t value = -1;
+            if(ch_copy_read(&caching, i, &value, sizeof(value), 0) != CH_SUCCESS || value != first + 1000 + i){
+                _exit(1);
+            }
+        }
+        if(commit && ch_commit(&caching) != CH_SUCCESS){
+            _exit(1);
+        }
+        _exit(0);
+    }
+    int status = 0;
+    assert(waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+DEFINE_TEST(wal_spill_recovery){
+    /* crash in the middle of operation, evicted changes aren't committed */
+    wal_spill_crash(0, false);
+    for(int64_t i = 0; i < WAL_PAGES; i++){
+        assert(file_value(i) < 1000);
+    }
+    caching_t caching;
+    assert(ch_init_opt("test.db", &caching, NULL) == CH_SUCCESS);
+    for(int64_t i = 0; i < WAL_PAGES; i++){
+        int64_t value = -1;
+        assert(ch_copy_read(&caching, i, &value, sizeof(value), 0) == CH_SUCCESS);
+        assert(value == i);
+    }
+    assert(ch_close(&caching) == CH_SUCCESS);
+
+    /* evicted changes are committed by the next commit */
+    wal_spill_crash(100, true);
+    assert(ch_init_opt("test.db", &caching, NULL) == CH_SUCCESS);
+    for(int64_t i = 0; i < WAL_PAGES; i++){
+        int64_t value = -1;
+        assert(ch_copy_read(&caching, i, &value, sizeof(value), 0) == CH_SUCCESS);
+        assert(value == 1100 + i);
+    }
+    ch_delete(&caching);
+}
+
+#define HOLE_PAGES 200
+
+DEFINE_TEST(hole_punching){
+    for(int wal = 0; wal < 2; wal++){
+        caching_t caching;
+        ch_options_t opt = {.punch_holes = true, .wal = wal};
+        assert(ch_init_opt("test.db", &caching, &opt) == CH_SUCCESS);
+        for(int64_t i = 0; i < HOLE_PAGES; i++){
+            assert(ch_new_page(&caching) == i);
+            assert(ch_write(&caching, i, &i, sizeof(i), 0) == CH_SUCCESS);
+        }
+        assert(ch_checkpoint(&caching) == CH_SUCCESS);
+        off_t used = fl_disk_size(&caching.file);
+        for(int64_t i = 10; i < HOLE_PAGES - 10; i++){
+            assert(ch_delete_page(&caching, i) == CH_SUCCESS);
+        }
+        /* with write-ahead log blocks are released only when deletion is committed */
+        assert(!wal || fl_disk_size(&caching.file) == used);
+        assert(ch_commit(&caching) == CH_SUCCESS);
+        assert(fl_disk_size(&caching.file) <= used - (HOLE_PAGES - 40) * PAGE_SIZE);
+        for(int64_t i = 0; i < HOLE_PAGES; i++){
+            if(i >= 10 && i < HOLE_PAGES - 10){
+                continue;
+            }
+            int64_t value = -1;
+            assert(ch_copy_read(&caching, i, &value, sizeof(value), 0) == CH_SUCCESS);
+            assert(value == i);
+        }
+        ch_use_again(&caching, HOLE_PAGES / 2);
+        const int64_t* page = ch_read(&caching, HOLE_PAGES / 2, 0);
+        assert(page && page[0] == 0);
+        ch_delete(&caching);
+    }
+}
 
 int main(){
     RUN_SINGLE_TEST(write_and_read);
@@ -295,5 +755,18 @@ int main(){
     RUN_SINGLE_TEST(write_after_closing);
     RUN_SINGLE_TEST(delete_last_page);
     RUN_SINGLE_TEST(unsafe_read);
+    RUN_SINGLE_TEST(eviction_policies);
+    RUN_SINGLE_TEST(hot_page_survives_scan);
+    RUN_SINGLE_TEST(live_budget_resize);
+    RUN_SINGLE_TEST(metadata_follows_resident_set);
+    RUN_SINGLE_TEST(frame_pool_backend);
+    RUN_SINGLE_TEST(batched_prefetch);
+    RUN_SINGLE_TEST(scan_readahead);
+    RUN_SINGLE_TEST(pinned_page_survives_eviction);
+    RUN_SINGLE_TEST(dirty_page_write_back);
+    RUN_SINGLE_TEST(group_commit);
+    RUN_SINGLE_TEST(wal_crash_recovery);
+    RUN_SINGLE_TEST(wal_spill_recovery);
+    RUN_SINGLE_TEST(hole_punching);
 //    RUN_SINGLE_TEST(cache_memory_save);
 }
\ No newline at end of file
@@ -128,9 +128,188 @@ DEFINE_TEST(delete_last_page){
     free(file);
 }
 
+DEFINE_TEST(extent_mapping){
+    file_t* file = malloc(sizeof(file_t));
+    fl_options_t opt = {.map_mode = FL_MAP_EXTENT, .reserve = FL_EXTENT_SIZE};
+    assert(init_file_opt("test.db", file, &opt) == FILE_SUCCESS);
+    if(fl_file_size(file) > 0){
+        assert(delete_file(file) == FILE_SUCCESS);
+        assert(init_file_opt("test.db", file, &opt) == FILE_SUCCESS);
+    }
+    assert(file->map_mode == FL_MAP_EXTENT);
+    size_t pages = 3 * FL_EXTENT_SIZE / PAGE_SIZE;
+    for(size_t i = 0; i < pages; i++){
+        assert(init_page(file) == FILE_SUCCESS);
+        write_page(file, &i, sizeof(i), 0);
+    }
+    for(size_t i = 0; i < pages; i++){
+        assert(mmap_page(fl_page_offset(i), file) == FILE_SUCCESS);
+        void* page = fl_cur_mmaped_data(file);
+        if(fl_in_extent(file, page)){
+            assert((uint8_t*)page == file->ext_base + fl_page_offset(i));
+        }
+        size_t value;
+        read_page(file, &value, sizeof(value), 0);
+        assert(value == i);
+        assert(unmap_page(&file->cur_mmaped_data, file) == FILE_SUCCESS);
+    }
+    assert(mmap_page(0, file) == FILE_SUCCESS);
+    void* first = fl_cur_mmaped_data(file);
+    assert(unmap_page(&file->cur_mmaped_data, file) == FILE_SUCCESS);
+    assert(mmap_page(0, file) == FILE_SUCCESS);
+    assert(fl_cur_mmaped_data(file) == first);
+    assert(delete_file(file) == FILE_SUCCESS);
+    free(file);
+}
+
+DEFINE_TEST(page_mapping){
+    file_t* file = malloc(sizeof(file_t));
+    fl_options_t opt = {.map_mode = FL_MAP_PAGE};
+    assert(init_file_opt("test.db", file, &opt) == FILE_SUCCESS);
+    if(fl_file_size(file) > 0){
+        assert(delete_file(file) == FILE_SUCCESS);
+        assert(init_file_opt("test.db", file, &opt) == FILE_SUCCESS);
+    }
+    char str[] = "12345678";
+    init_page(file);
+    off_t page_offset = file->cur_page_offset;
+    write_page(file, str, sizeof(str), 0);
+    assert(!fl_in_extent(file, fl_cur_mmaped_data(file)));
+    unmap_page(&file->cur_mmaped_data, file);
+    mmap_page(page_offset, file);
+    char read_str[sizeof(str)];
+    read_page(file, read_str, sizeof(str), 0);
+    assert(strcmp(str, read_str) == 0);
+    unmap_page(&file->cur_mmaped_data, file);
+    assert(delete_file(file) == FILE_SUCCESS);
+    free(file);
+}
+
+DEFINE_TEST(batched_growth){
+    file_t* file = malloc(sizeof(file_t));
+    fl_options_t opt = {.grow_min = 16 * PAGE_SIZE, .grow_max = 64 * PAGE_SIZE};
+    assert(init_file_opt("test.db", file, &opt) == FILE_SUCCESS);
+    if(fl_file_size(file) > 0){
+        assert(delete_file(file) == FILE_SUCCESS);
+        assert(init_file_opt("test.db", file, &opt) == FILE_SUCCESS);
+    }
+    int growths = 0;
+    off_t phys_size = file->phys_size;
+    for(size_t i = 0; i < 256; i++){
+        assert(init_page(file) == FILE_SUCCESS);
+        assert(fl_file_size(file) == (off_t)((i + 1) * PAGE_SIZE));
+        assert(file->phys_size >= fl_file_size(file));
+        if(file->phys_size != phys_size){
+            growths++;
+            phys_size = file->phys_size;
+        }
+        write_page(file, &i, sizeof(i), 0);
+        unmap_page(&file->cur_mmaped_data, file);
+    }
+    assert(growths <= 6);
+    assert(delete_last_page(file) == FILE_SUCCESS);
+    assert(fl_file_size(file) == 255 * PAGE_SIZE);
+    assert(init_page(file) == FILE_SUCCESS);
+    size_t value = 1;
+    read_page(file, &value, sizeof(value), 0);
+    assert(value == 0);
+    unmap_page(&file->cur_mmaped_data, file);
+    assert(close_file(file) == FILE_SUCCESS);
+
+    assert(init_file_opt("test.db", file, &opt) == FILE_SUCCESS);
+    assert(fl_file_size(file) == 256 * PAGE_SIZE);
+    assert(file->phys_size == fl_file_size(file));
+    assert(delete_file(file) == FILE_SUCCESS);
+    free(file);
+}
+
+DEFINE_TEST(frame_pool){
+    file_t* file = malloc(sizeof(file_t));
+    fl_options_t opt = {.backend = FL_BACKEND_PREAD, .frames = 2};
+    assert(init_file_opt("test.db", file, &opt) == FILE_SUCCESS);
+    if(fl_file_size(file) > 0){
+        assert(delete_file(file) == FILE_SUCCESS);
+        assert(init_file_opt("test.db", file, &opt) == FILE_SUCCESS);
+    }
+    assert(fl_pool_frames(file) == 2);
+    char str[] = "12345678";
+    init_page(file);
+    off_t page_offset = file->cur_page_offset;
+    write_page(file, str, sizeof(str), 0);
+    void* frame = fl_cur_mmaped_data(file);
+    assert((uintptr_t)frame % PAGE_SIZE == 0);
+    assert(flush_page(file, frame) == FILE_SUCCESS);
+    char read_str[sizeof(str)];
+    assert(pread(file->fd, read_str, sizeof(str), page_offset) == sizeof(str));
+    assert(strcmp(str, read_str) == 0);
+    assert(mmap_page(page_offset, file) == FILE_SUCCESS);
+    void* second = fl_cur_mmaped_data(file);
+    assert(second != frame);
+    assert(mmap_page(page_offset, file) == FILE_FAIL);
+    unmap_page(&frame, file);
+    assert(mmap_page(page_offset, file) == FILE_SUCCESS);
+    read_page(file, read_str, sizeof(str), 0);
+    assert(strcmp(str, read_str) == 0);
+    unmap_page(&file->cur_mmaped_data, file);
+    unmap_page(&second, file);
+    assert(delete_file(file) == FILE_SUCCESS);
+    free(file);
+}
+
+/* Transparent huge pages may be used for advised ranges, unknown state is taken as enabled */
+static bool thp_enabled(void){
+    FILE* sys = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+    if(!sys){
+        return true;
+    }
+    char line[128] = {0};
+    bool enabled = !fgets(line, sizeof(line), sys) || !strstr(line, "[never]");
+    fclose(sys);
+    return enabled;
+}
+
+DEFINE_TEST(huge_pages){
+    file_t* file = malloc(sizeof(file_t));
+    fl_options_t opt = {.backend = FL_BACKEND_PREAD, .frames = 1024, .huge_pages = true};
+    assert(init_file_opt("test.db", file, &opt) == FILE_SUCCESS);
+    if(fl_file_size(file) > 0){
+        assert(delete_file(file) == FILE_SUCCESS);
+        assert(init_file_opt("test.db", file, &opt) == FILE_SUCCESS);
+    }
+    assert((uintptr_t)file->pool % FL_HUGE_PAGE_SIZE == 0);
+    for(size_t i = 0; i < 1024; i++){
+        assert(init_page(file) == FILE_SUCCESS);
+        write_page(file, &i, sizeof(i), 0);
+    }
+    /* huge page accounting of pool must agree with backing it got */
+    size_t huge = fl_huge_bytes(file);
+    assert(huge % FL_HUGE_PAGE_SIZE == 0 && huge <= file->pool_size);
+    if(file->pool_huge == FL_HUGE_TLB){
+        assert(file->pool_size % FL_HUGE_PAGE_SIZE == 0 && huge > 0);
+    }
+    else if(file->pool_huge == FL_HUGE_NONE || !thp_enabled()){
+        assert(huge == 0);
+    }
+    assert(delete_file(file) == FILE_SUCCESS);
+
+    fl_options_t ext_opt = {.map_mode = FL_MAP_EXTENT, .huge_pages = true};
+    assert(init_file_opt("test.db", file, &ext_opt) == FILE_SUCCESS);
+    assert((uintptr_t)file->ext_base % FL_HUGE_PAGE_SIZE == 0);
+    assert(init_page(file) == FILE_SUCCESS);
+    assert(fl_in_extent(file, fl_cur_mmaped_data(file)));
+    assert(fl_huge_bytes(file) <= file->ext_reserved);
+    assert(delete_file(file) == FILE_SUCCESS);
+    free(file);
+}
+
 int main(){
     RUN_SINGLE_TEST(write_and_read);
     RUN_SINGLE_TEST(two_write);
     RUN_SINGLE_TEST(two_pages);
     RUN_SINGLE_TEST(delete_last_page);
+    RUN_SINGLE_TEST(extent_mapping);
+    RUN_SINGLE_TEST(page_mapping);
+    RUN_SINGLE_TEST(batched_growth);
+    RUN_SINGLE_TEST(frame_pool);
+    RUN_SINGLE_TEST(huge_pages);
 }
\ No newline at end of file
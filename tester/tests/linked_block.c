@@ -5,199 +5,290 @@
 #include "core/page_pool/linked_blocks.h"
 
 DEFINE_TEST(write_read){
-    assert(pg_init("test.db") == PAGER_SUCCESS);
+    pager_t* pager = pg_init("test.db");
+    assert(pager != NULL);
     char str[] = "12345678";
-    int64_t pool_idx = lb_ppl_init(9);
-    page_pool_t* page_pool = lb_ppl_load(pool_idx);
-    chblix_t block1 = lb_alloc(page_pool);
-    assert(lb_write(page_pool, &block1, str, sizeof(str), 0) == LB_SUCCESS);
+    int64_t pool_idx = lb_ppl_init(pager, 9);
+    page_pool_t* page_pool = lb_ppl_load(pager, pool_idx);
+    chblix_t block1 = lb_alloc(pager, page_pool);
+    assert(lb_write(pager, page_pool, &block1, str, sizeof(str), 0) == LB_SUCCESS);
     char* read_str = malloc(sizeof(str));
-    lb_read(page_pool_index(page_pool), &block1, read_str, sizeof(str), 0);
+    lb_read(pager, page_pool_index(page_pool), &block1, read_str, sizeof(str), 0);
     assert(strcmp(str, read_str) == 0);
     free(read_str);
-    pg_delete();
+    pg_delete(pager);
 }
 
 DEFINE_TEST(several_write){
-    assert(pg_init("test.db") == PAGER_SUCCESS);
+    pager_t* pager = pg_init("test.db");
+    assert(pager != NULL);
     char str[] = "12345678";
     int64_t block_size = 9;
-    int64_t pool_idx = lb_ppl_init(block_size);
-    page_pool_t* page_pool = lb_ppl_load(pool_idx);
+    int64_t pool_idx = lb_ppl_init(pager, block_size);
+    page_pool_t* page_pool = lb_ppl_load(pager, pool_idx);
     int64_t count = 466;
     chblix_t blocks[count];
     for(int64_t i = 0; i < count; i++){
-        chblix_t block = lb_alloc(page_pool);
+        chblix_t block = lb_alloc(pager, page_pool);
         blocks[i] = block;
-        lb_write(page_pool, &block, str, sizeof(str), 0);
+        lb_write(pager, page_pool, &block, str, sizeof(str), 0);
     }
     for(int64_t i = 0; i < count; i++){
         chblix_t block = blocks[i];
         char* read_str = malloc(sizeof(str));
-        lb_read(page_pool_index(page_pool), &block, read_str, sizeof(str), 0);
+        lb_read(pager, page_pool_index(page_pool), &block, read_str, sizeof(str), 0);
         assert(strcmp(str, read_str) == 0);
         free(read_str);
     }
-    pg_delete();
+    pg_delete(pager);
 }
 
 DEFINE_TEST(close_and_open){
-    assert(pg_init("test.db") == PAGER_SUCCESS);
+    pager_t* pager = pg_init("test.db");
+    assert(pager != NULL);
     char str[] = "12345678";
     int64_t block_size = 9;
-    int64_t ppidx = lb_ppl_init(block_size);
-    page_pool_t* page_pool = lb_ppl_load(ppidx);
+    int64_t ppidx = lb_ppl_init(pager, block_size);
+    page_pool_t* page_pool = lb_ppl_load(pager, ppidx);
     int64_t count = (int64_t)(PAGE_SIZE - sizeof_Page_Header) / block_size;
     count--; // to prevent page_pool expand
     chblix_t blocks[count];
     for(int64_t i = 0; i < count ; i++){
-        chblix_t block = lb_alloc(page_pool);
+        chblix_t block = lb_alloc(pager, page_pool);
         blocks[i] = block;
-        lb_write(page_pool, &block, str, sizeof(str), 0);
+        lb_write(pager, page_pool, &block, str, sizeof(str), 0);
     }
-    pg_close();
-    assert(pg_init("test.db") == PAGER_SUCCESS);
+    pg_close(pager);
+    pager = pg_init("test.db");
+    assert(pager != NULL);
     for(int64_t i = 0; i < count; i++){
         chblix_t block = blocks[i];
         char* read_str = malloc(sizeof(str));
-        lb_read(ppidx, &block, read_str, sizeof(str), 0);
+        lb_read(pager, ppidx, &block, read_str, sizeof(str), 0);
         assert(strcmp(str, read_str) == 0);
         free(read_str);
     }
-    pg_delete();
+    pg_delete(pager);
 }
 
 DEFINE_TEST(dealloc){
-    assert(pg_init("test.db") == PAGER_SUCCESS);
+    pager_t* pager = pg_init("test.db");
+    assert(pager != NULL);
     char str[] = "12345678";
     int64_t block_size = 9;
-    int64_t ppidx = lb_ppl_init(block_size);
-    page_pool_t* ppl = lb_ppl_load(ppidx);
-    linked_page_t* linkedPage = lp_load(ppl->current_idx);
+    int64_t ppidx = lb_ppl_init(pager, block_size);
+    page_pool_t* ppl = lb_ppl_load(pager, ppidx);
+    linked_page_t* linkedPage = lp_load(pager, ppl->current_idx);
     int64_t count = lp_useful_space_size(linkedPage) / ppl->block_size;
     chblix_t blocks[3 * count];
     for(int64_t i = 0; i < 3 * count ; i++){
-        chblix_t block = lb_alloc(ppl);
+        chblix_t block = lb_alloc(pager, ppl);
         blocks[i] = block;
-        lb_write(ppl, &block, str, sizeof(str), 0);
+        lb_write(pager, ppl, &block, str, sizeof(str), 0);
     }
     for(int64_t i = count; i < 2 * count ; i++){
         chblix_t block = blocks[i];
-        lb_dealloc(ppidx, &block);
+        lb_dealloc(pager, ppidx, &block);
     }
-    int64_t page = pg_alloc();
+    int64_t page = pg_alloc(pager);
     assert(page == blocks[count].chunk_idx);
 
-    pg_delete();
+    pg_delete(pager);
 
 }
 
 DEFINE_TEST(ultra_wide_page){
-    assert(pg_init("test.db") == PAGER_SUCCESS);
+    pager_t* pager = pg_init("test.db");
+    assert(pager != NULL);
     char str[] = "12345678";
     int64_t block_size = 2 * PAGE_SIZE;
-    int64_t ppidx = lb_ppl_init(block_size);
-    page_pool_t* ppl = lb_ppl_load(ppidx);
+    int64_t ppidx = lb_ppl_init(pager, block_size);
+    page_pool_t* ppl = lb_ppl_load(pager, ppidx);
     int64_t count = 2;
     chblix_t blocks[count];
     for(int64_t i = 0; i < count; i++){
-        chblix_t block = lb_alloc(ppl);
+        chblix_t block = lb_alloc(pager, ppl);
         blocks[i] = block;
-        lb_write(ppl, &block, str, sizeof(str), PAGE_SIZE + 1000);
+        lb_write(pager, ppl, &block, str, sizeof(str), PAGE_SIZE + 1000);
     }
     for(int64_t i = 0; i < count; i++){
         chblix_t block = blocks[i];
         char* read_str = malloc(sizeof(str));
-        lb_read(ppidx, &block, read_str, sizeof(str), PAGE_SIZE+1000);
+        lb_read(pager, ppidx, &block, read_str, sizeof(str), PAGE_SIZE+1000);
         assert(strcmp(str, read_str) == 0);
         free(read_str);
     }
-    pg_delete();
+    pg_delete(pager);
 }
 
 DEFINE_TEST(varchar){
-    assert(pg_init("test.db") == PAGER_SUCCESS);
+    pager_t* pager = pg_init("test.db");
+    assert(pager != NULL);
     char str1[] = "0123456789ABCDEF";
     char str2[] = "45678ABCDEF";
     int64_t block_size = 10;
-    int64_t ppidx = lb_ppl_init(block_size);
-    page_pool_t* ppl = lb_ppl_load(ppidx);
+    int64_t ppidx = lb_ppl_init(pager, block_size);
+    page_pool_t* ppl = lb_ppl_load(pager, ppidx);
     int64_t count = 2;
     chblix_t blocks[count];
-    chblix_t block = lb_alloc(ppl);
+    chblix_t block = lb_alloc(pager, ppl);
     blocks[0] = block;
-    lb_write(ppl, &block, str1, sizeof(str1), 0);
+    lb_write(pager, ppl, &block, str1, sizeof(str1), 0);
 
-    block = lb_alloc(ppl);
+    block = lb_alloc(pager, ppl);
     blocks[1] = block;
-    lb_write(ppl, &block, str2, sizeof(str2), 0);
+    lb_write(pager, ppl, &block, str2, sizeof(str2), 0);
 
     char* read_str1 = malloc(sizeof(str1));
-    lb_read(ppidx, &blocks[0], read_str1, sizeof(str1), 0);
+    lb_read(pager, ppidx, &blocks[0], read_str1, sizeof(str1), 0);
     assert(strcmp(str1, read_str1) == 0);
     free(read_str1);
 
     char* read_str2 = malloc(sizeof(str2));
-    lb_read(ppidx, &blocks[1], read_str2, sizeof(str2), 0);
+    lb_read(pager, ppidx, &blocks[1], read_str2, sizeof(str2), 0);
     assert(strcmp(str2, read_str2) == 0);
     free(read_str2);
 
-    pg_delete();
+    pg_delete(pager);
 }
 
 DEFINE_TEST(foreach){
-    assert(pg_init("test.db") == PAGER_SUCCESS);
+    pager_t* pager = pg_init("test.db");
+    assert(pager != NULL);
     char str[] = "12345678";
     int64_t block_size = 9;
-    int64_t pool_idx = lb_ppl_init(block_size);
-    page_pool_t* ppl = lb_ppl_load(pool_idx);
+    int64_t pool_idx = lb_ppl_init(pager, block_size);
+    page_pool_t* ppl = lb_ppl_load(pager, pool_idx);
     int64_t count = 2;
     chblix_t blocks[count];
     for(int64_t i = 0; i < count; i++){
-        chblix_t block = lb_alloc(ppl);
+        chblix_t block = lb_alloc(pager, ppl);
         blocks[i] = block;
-        lb_write(ppl, &block, str, sizeof(str), 0);
+        lb_write(pager, ppl, &block, str, sizeof(str), 0);
     }
-    lb_for_each(chunk, chblix, ppl){
-        char* read_srt = malloc(sizeof(str));
-        lb_read(page_pool_index(ppl), &chblix, read_srt, sizeof(str), 0);
-        assert(strcmp(str, read_srt) == 0);
-        free(read_srt);
+    {
+        lb_for_each(pager, chunk, chblix, ppl){
+            char* read_srt = malloc(sizeof(str));
+            lb_read(pager, page_pool_index(ppl), &chblix, read_srt, sizeof(str), 0);
+            assert(strcmp(str, read_srt) == 0);
+            free(read_srt);
+        }
     }
-    pg_delete();
+    pg_delete(pager);
 }
 
 DEFINE_TEST(insert_number){
-    assert(pg_init("test.db") == PAGER_SUCCESS);
+    pager_t* pager = pg_init("test.db");
+    assert(pager != NULL);
     int64_t num = 123456789;
-    int64_t pool_idx = lb_ppl_init(sizeof(num));
-    page_pool_t* ppl = lb_ppl_load(pool_idx);
-    chblix_t block = lb_alloc(ppl);
-    lb_write(ppl, &block, &num, sizeof(num), 0);
+    int64_t pool_idx = lb_ppl_init(pager, sizeof(num));
+    page_pool_t* ppl = lb_ppl_load(pager, pool_idx);
+    chblix_t block = lb_alloc(pager, ppl);
+    lb_write(pager, ppl, &block, &num, sizeof(num), 0);
     int64_t read_num;
-    lb_read(pool_idx, &block, &read_num, sizeof(num), 0);
+    lb_read(pager, pool_idx, &block, &read_num, sizeof(num), 0);
     assert(num == read_num);
-    pg_delete();
+    pg_delete(pager);
 }
 
 DEFINE_TEST(big_string){
-    assert(pg_init("test.db") == PAGER_SUCCESS);
+    pager_t* pager = pg_init("test.db");
+    assert(pager != NULL);
     char* str = "This is a big string\n "
                 "with multiple lines\n "
                 "and it is very long\n"
                 "and it is very long\n";
-    int64_t pplidx = lb_ppl_init(30);
-    page_pool_t* ppl = lb_ppl_load(pplidx);
-    chblix_t block = lb_alloc(ppl);
-    lb_write(ppl, &block, str, (int64_t)strlen(str) + 1, 0);
+    int64_t pplidx = lb_ppl_init(pager, 30);
+    page_pool_t* ppl = lb_ppl_load(pager, pplidx);
+    chblix_t block = lb_alloc(pager, ppl);
+    lb_write(pager, ppl, &block, str, (int64_t)strlen(str) + 1, 0);
     char* read_str = malloc(strlen(str) + 1);
-    lb_read(pplidx, &block, read_str, (int64_t)strlen(str) + 1, 0);
+    lb_read(pager, pplidx, &block, read_str, (int64_t)strlen(str) + 1, 0);
     assert(strcmp(str, read_str) == 0);
     free(read_str);
-    pg_delete();
+    pg_delete(pager);
 }
 
 
+DEFINE_TEST(foreach_chain_heads){
+    pager_t* pager = pg_init("test.db");
+    assert(pager != NULL);
+    int64_t pool_idx = lb_ppl_init(pager, sizeof(int64_t) + 1);
+    page_pool_t* ppl = lb_ppl_load(pager, pool_idx);
+    int64_t count = 3000;
+    chblix_t* blocks = malloc(count * sizeof(chblix_t));
+    int64_t data[5] = {0};
+    for(int64_t i = 0; i < count; i++){
+        blocks[i] = lb_alloc(pager, ppl);
+        data[0] = i;
+        /* every third row spans several linked blocks */
+        assert(lb_write(pager, ppl, &blocks[i], data, i % 3 ? (int64_t)sizeof(int64_t) : (int64_t)sizeof(data), 0) == LB_SUCCESS);
+    }
+    int64_t expected_count = 0, expected_sum = 0;
+    for(int64_t i = 0; i < count; i++){
+        if(i % 5 == 0){
+            assert(lb_dealloc(pager, pool_idx, &blocks[i]) == LB_SUCCESS);
+            assert(!lb_valid(pager, ppl, NULL, blocks[i]));
+        }
+        else{
+            expected_count++;
+            expected_sum += i;
+        }
+    }
+    /* only chain heads are visited, continuation and freed blocks are skipped */
+    int64_t visited = 0, sum = 0;
+    {
+        lb_for_each(pager, chunk, chblix, ppl){
+            int64_t value;
+            assert(lb_read(pager, pool_idx, &chblix, &value, sizeof(value), 0) == LB_SUCCESS);
+            visited++;
+            sum += value;
+        }
+        assert(visited == expected_count);
+        assert(sum == expected_sum);
+        free(blocks);
+    }
+    pg_delete(pager);
+}
+
+DEFINE_TEST(overflow_chain){
+    pager_t* pager = pg_init("test.db");
+    assert(pager != NULL);
+    int64_t pool_idx = lb_ppl_init(pager, sizeof(int64_t));
+    page_pool_t* ppl = lb_ppl_load(pager, pool_idx);
+    /* row which fits in its block carries only 8 byte header */
+    assert(ppl->block_size == (int64_t)(sizeof(int64_t) + sizeof(linked_block_t)));
+    assert(lb_block_data_size(ppl) == (int64_t)sizeof(int64_t));
+    int64_t data[5] = {1, 2, 3, 4, 5};
+    /* single-block row keeps chunk alive after overflowing row is deallocated */
+    chblix_t keep = lb_alloc(pager, ppl);
+    assert(lb_write(pager, ppl, &keep, data, sizeof(int64_t), 0) == LB_SUCCESS);
+    chblix_t row = lb_alloc(pager, ppl);
+    assert(lb_write(pager, ppl, &row, data, sizeof(data), 0) == LB_SUCCESS);
+    chunk_t* chunk = ppl_read_chunk(pager, row.chunk_idx);
+    int64_t used = 0, heads = 0;
+    for(int64_t i = 0; i < ppl_bitmap_words(chunk->capacity); i++){
+        used += __builtin_popcountll(ppl_used_bits(chunk)[i]);
+        heads += __builtin_popcountll(ppl_head_bits(chunk)[i]);
+    }
+    assert(used == 6 && heads == 2);
+    /* read across blocks from the middle of row */
+    int64_t part[2];
+    assert(lb_read(pager, pool_idx, &row, part, sizeof(part), 2 * sizeof(int64_t) + 4) == LB_SUCCESS);
+    assert(memcmp(part, (char*)data + 2 * sizeof(int64_t) + 4, sizeof(part)) == 0);
+    /* every block of row is deallocated */
+    assert(lb_dealloc(pager, pool_idx, &row) == LB_SUCCESS);
+    chunk = ppl_read_chunk(pager, row.chunk_idx);
+    used = 0, heads = 0;
+    for(int64_t i = 0; i < ppl_bitmap_words(chunk->capacity); i++){
+        used += __builtin_popcountll(ppl_used_bits(chunk)[i]);
+        heads += __builtin_popcountll(ppl_head_bits(chunk)[i]);
+    }
+    assert(used == 1 && heads == 1);
+    assert(lb_valid(pager, ppl, chunk, keep) && !lb_valid(pager, ppl, chunk, row));
+    pg_delete(pager);
+}
+
 int main(){
     RUN_SINGLE_TEST(write_read);
     RUN_SINGLE_TEST(several_write);
@@ -208,4 +299,6 @@ int main(){
     RUN_SINGLE_TEST(foreach);
     RUN_SINGLE_TEST(insert_number);
     RUN_SINGLE_TEST(big_string);
+    RUN_SINGLE_TEST(foreach_chain_heads);
+    RUN_SINGLE_TEST(overflow_chain);
 }
\ No newline at end of file
@@ -6,110 +6,162 @@
 #include <stdio.h>
 
 DEFINE_TEST(write_and_read){
-    assert(pg_init("test.db") == PAGER_SUCCESS);
+    pager_t* pager = pg_init("test.db");
+    assert(pager != NULL);
     char str[] = "12345678";
-    int64_t ppidx = ppl_init(9);
-    chblix_t block1 = ppl_alloc(ppidx);
-    ppl_write_block(ppidx, &block1, str, sizeof(str), 0);
+    int64_t ppidx = ppl_init(pager, 9);
+    chblix_t block1 = ppl_alloc(pager, ppidx);
+    ppl_write_block(pager, ppidx, &block1, str, sizeof(str), 0);
     char* read_str = malloc(sizeof(str));
-    ppl_read_block(ppidx, &block1, read_str, sizeof(str), 0);
+    ppl_read_block(pager, ppidx, &block1, read_str, sizeof(str), 0);
     assert(strcmp(str, read_str) == 0);
     free(read_str);
-    pg_delete();
+    pg_delete(pager);
 }
 
 DEFINE_TEST(several_write){
-    assert(pg_init("test.db") == PAGER_SUCCESS);
+    pager_t* pager = pg_init("test.db");
+    assert(pager != NULL);
     char str[] = "12345678";
     int64_t block_size = 9;
-    int64_t ppidx = ppl_init(block_size);
+    int64_t ppidx = ppl_init(pager, block_size);
     int64_t count = (int64_t)(PAGE_SIZE - sizeof_Page_Header) / block_size;
     chblix_t blocks[count];
     for(int64_t i = 0; i < count; i++){
-        chblix_t block = ppl_alloc(ppidx);
+        chblix_t block = ppl_alloc(pager, ppidx);
         blocks[i] = block;
-        ppl_write_block(ppidx, &block, str, sizeof(str), 0);
+        ppl_write_block(pager, ppidx, &block, str, sizeof(str), 0);
     }
     for(int64_t i = 0; i < count; i++){
         chblix_t block = blocks[i];
         char* read_str = malloc(sizeof(str));
-        ppl_read_block(ppidx, &block, read_str, sizeof(str), 0);
+        ppl_read_block(pager, ppidx, &block, read_str, sizeof(str), 0);
         assert(strcmp(str, read_str) == 0);
         free(read_str);
     }
-    pg_delete();
+    pg_delete(pager);
 }
 
 DEFINE_TEST(close_and_open){
-    assert(pg_init("test.db") == PAGER_SUCCESS);
+    pager_t* pager = pg_init("test.db");
+    assert(pager != NULL);
     char str[] = "12345678";
     int64_t block_size = 9;
-    int64_t ppidx = ppl_init(block_size);
+    int64_t ppidx = ppl_init(pager, block_size);
     int64_t count = (int64_t)(PAGE_SIZE - sizeof_Page_Header) / block_size;
     count--; // to prevent page_pool expand
     chblix_t blocks[count];
     for(int64_t i = 0; i < count ; i++){
-        chblix_t block = ppl_alloc(ppidx);
+        chblix_t block = ppl_alloc(pager, ppidx);
         blocks[i] = block;
-        ppl_write_block(ppidx, &block, str, sizeof(str), 0);
+        ppl_write_block(pager, ppidx, &block, str, sizeof(str), 0);
     }
-    pg_close();
-    assert(pg_init("test.db") == PAGER_SUCCESS);
+    pg_close(pager);
+    pager = pg_init("test.db");
+    assert(pager != NULL);
     for(int64_t i = 0; i < count; i++){
         chblix_t block = blocks[i];
         char* read_str = malloc(sizeof(str));
-        ppl_read_block(ppidx, &block, read_str, sizeof(str), 0);
+        ppl_read_block(pager, ppidx, &block, read_str, sizeof(str), 0);
         assert(strcmp(str, read_str) == 0);
         free(read_str);
     }
-    pg_delete();
+    pg_delete(pager);
 }
 
 DEFINE_TEST(dealloc){
-    assert(pg_init("test.db") == PAGER_SUCCESS);
+    pager_t* pager = pg_init("test.db");
+    assert(pager != NULL);
     char str[] = "12345678";
     int64_t block_size = 9;
-    int64_t ppidx = ppl_init(block_size);
-    page_pool_t* ppl = ppl_load(ppidx);
-    linked_page_t* linkedPage = lp_load(ppl->current_idx);
+    int64_t ppidx = ppl_init(pager, block_size);
+    page_pool_t* ppl = ppl_load(pager, ppidx);
+    linked_page_t* linkedPage = lp_load(pager, ppl->current_idx);
     int64_t count = lp_useful_space_size(linkedPage) / block_size;
     chblix_t blocks[3 * count];
     for(int64_t i = 0; i < 3 * count ; i++){
-        chblix_t block = ppl_alloc(ppidx);
+        chblix_t block = ppl_alloc(pager, ppidx);
         blocks[i] = block;
-        ppl_write_block(ppidx, &block, str, sizeof(str), 0);
+        ppl_write_block(pager, ppidx, &block, str, sizeof(str), 0);
     }
     for(int64_t i = count; i < 2 * count ; i++){
         chblix_t block = blocks[i];
-        ppl_dealloc(ppidx, &block);
+        ppl_dealloc(pager, ppidx, &block);
     }
-    int64_t page = pg_alloc();
+    int64_t page = pg_alloc(pager);
     assert(page == blocks[count].chunk_idx);
 
-    pg_delete();
+    pg_delete(pager);
 
 }
 
 DEFINE_TEST(ultra_wide_page){
-    assert(pg_init("test.db") == PAGER_SUCCESS);
+    pager_t* pager = pg_init("test.db");
+    assert(pager != NULL);
     char str[] = "12345678";
     int64_t block_size = 2 * PAGE_SIZE;
-    int64_t ppidx = ppl_init(block_size);
+    int64_t ppidx = ppl_init(pager, block_size);
     int64_t count = 2;
     chblix_t blocks[count];
     for(int64_t i = 0; i < count; i++){
-        chblix_t block = ppl_alloc(ppidx);
+        chblix_t block = ppl_alloc(pager, ppidx);
         blocks[i] = block;
-        ppl_write_block(ppidx, &block, str, sizeof(str), PAGE_SIZE+1000);
+        ppl_write_block(pager, ppidx, &block, str, sizeof(str), PAGE_SIZE+1000);
     }
     for(int64_t i = 0; i < count; i++){
         chblix_t block = blocks[i];
         char* read_str = malloc(sizeof(str));
-        ppl_read_block(ppidx, &block, read_str, sizeof(str), PAGE_SIZE+1000);
+        ppl_read_block(pager, ppidx, &block, read_str, sizeof(str), PAGE_SIZE+1000);
         assert(strcmp(str, read_str) == 0);
         free(read_str);
     }
-    pg_delete();
+    pg_delete(pager);
+}
+
+DEFINE_TEST(rowid){
+    pager_t* pager = pg_init("test.db");
+    assert(pager != NULL);
+    int64_t ppidx = ppl_init(pager, 9);
+    chblix_t blocks[3];
+    for(int64_t i = 0; i < 3; i++){
+        blocks[i] = ppl_alloc(pager, ppidx);
+        rowid_t rowid = rowid_pack(blocks[i]);
+        chblix_t block = rowid_unpack(rowid);
+        assert(chblix_cmp(&block, &blocks[i]) == 0);
+        assert(rowid_chunk(rowid) == blocks[i].chunk_idx && rowid_block(rowid) == blocks[i].block_idx);
+    }
+    /* row ids are ordered as chblixes */
+    assert(rowid_pack(blocks[0]) < rowid_pack(blocks[1]) && rowid_pack(blocks[1]) < rowid_pack(blocks[2]));
+    assert(rowid_pack(chblix_fail()) == ROWID_FAIL);
+    chblix_t fail = rowid_unpack(ROWID_FAIL);
+    assert(chblix_cmp(&fail, &CHBLIX_FAIL) == 0);
+    pg_delete(pager);
+}
+
+DEFINE_TEST(extent_capped){
+    pager_t* pager = pg_init("test.db");
+    assert(pager != NULL);
+    int64_t block_size = PAGE_SIZE / 4;
+    int64_t ppidx = ppl_init(pager, block_size);
+    int64_t used = 0;
+    int64_t last = -1;
+    for(int64_t i = 0; i < 20; i++){
+        chblix_t block = ppl_alloc(pager, ppidx);
+        assert(block.chunk_idx != -1);
+        if(block.chunk_idx != last){
+            used++;
+            last = block.chunk_idx;
+        }
+    }
+    /* spare chunks never outnumber used ones */
+    page_pool_t* ppl = ppl_read(pager, ppidx);
+    int64_t linked = 0;
+    for(int64_t chunk = ppl->head; chunk != -1; chunk = ppl_read_chunk(pager, chunk)->next_page){
+        linked++;
+    }
+    assert(linked == ppl->chunks);
+    assert(linked <= 2 * used);
+    assert(pg_delete(pager) == PAGER_SUCCESS);
 }
 
 int main(){
@@ -118,4 +170,6 @@ int main(){
     RUN_SINGLE_TEST(close_and_open);
     RUN_SINGLE_TEST(dealloc);
     RUN_SINGLE_TEST(ultra_wide_page);
+    RUN_SINGLE_TEST(rowid);
+    RUN_SINGLE_TEST(extent_capped);
 }
\ No newline at end of file
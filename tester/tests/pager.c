@@ -1,49 +1,375 @@
 #include "../src/test.h"
 #include "core/io/pager.h"
 #include "core/io/caching.h"
+#include <pthread.h>
 #include <stdio.h>
 
 DEFINE_TEST(allocate_deallocate){
-    assert(pg_init("test.db") == PAGER_SUCCESS);
-    if(pg_file_size() != 0){
-        assert(pg_delete() == PAGER_SUCCESS);
-        assert(pg_init("test.db") == PAGER_SUCCESS);
+    pager_t* pager = pg_init("test.db");
+    assert(pager != NULL);
+    if(pg_file_size(pager) != 0){
+        assert(pg_delete(pager) == PAGER_SUCCESS);
+        pager = pg_init("test.db");
+        assert(pager != NULL);
     }
-    int64_t page1 = pg_alloc();
+    int64_t page1 = pg_alloc(pager);
     assert(page1 == 1);
-    int64_t page2 = pg_alloc();
+    int64_t page2 = pg_alloc(pager);
     assert(page2 == 2);
-    int64_t page3 = pg_alloc();
+    int64_t page3 = pg_alloc(pager);
     assert(page3 == 3);
-    pg_dealloc(page2);
-    int64_t page4 = pg_alloc();
+    pg_dealloc(pager, page2);
+    int64_t page4 = pg_alloc(pager);
     assert(page4 == 2);
-    pg_dealloc(page1);
-    pg_delete();
+    pg_dealloc(pager, page1);
+    pg_delete(pager);
 }
 
 DEFINE_TEST(double_dealloc){
-    assert(pg_init("test.db") == PAGER_SUCCESS);
-    if(pg_file_size() != 0){
-        assert(pg_delete() == PAGER_SUCCESS);
-        assert(pg_init("test.db") == PAGER_SUCCESS);
+    pager_t* pager = pg_init("test.db");
+    assert(pager != NULL);
+    if(pg_file_size(pager) != 0){
+        assert(pg_delete(pager) == PAGER_SUCCESS);
+        pager = pg_init("test.db");
+        assert(pager != NULL);
     }
-    int64_t page1 = pg_alloc();
+    int64_t page1 = pg_alloc(pager);
     assert(page1 == 1);
-    int64_t page2 = pg_alloc();
+    int64_t page2 = pg_alloc(pager);
     assert(page2 == 2);
-    int64_t page3 = pg_alloc();
+    int64_t page3 = pg_alloc(pager);
     assert(page3 == 3);
-    pg_dealloc(page2);
-    pg_dealloc(page2);
-    int64_t page4 = pg_alloc();
+    pg_dealloc(pager, page2);
+    pg_dealloc(pager, page2);
+    int64_t page4 = pg_alloc(pager);
     assert(page4 == 2);
-    pg_dealloc(page1);
-    pg_delete();
+    pg_dealloc(pager, page1);
+    pg_delete(pager);
 }
 
+DEFINE_TEST(free_page_bitmap){
+    pager_t* pager = pg_init("test.db");
+    assert(pager != NULL);
+    if(pg_file_size(pager) != 0){
+        assert(pg_delete(pager) == PAGER_SUCCESS);
+        pager = pg_init("test.db");
+        assert(pager != NULL);
+    }
+    int64_t group = PG_GROUP_PAGES;
+    int64_t pages = group + 100;
+    /* page starting the second group is its bitmap */
+    for(int64_t i = 1; i < pages; i++){
+        assert(pg_alloc(pager) == (i < group ? i : i + 1));
+    }
+    for(int64_t i = 10; i < 100; i++){
+        assert(pg_dealloc(pager, i) == PAGER_SUCCESS);
+    }
+    assert(pg_dealloc(pager, group) == PAGER_FAIL);
+    /* the lowest free page goes first */
+    assert(pg_alloc(pager) == 10);
+    assert(pg_alloc(pager) == 11);
+    assert(pg_close(pager) == PAGER_SUCCESS);
+
+    /* bitmap is persistent */
+    pager = pg_init("test.db");
+    assert(pager != NULL);
+    assert(pg_alloc(pager) == 12);
+    assert(pg_dealloc(pager, 12) == PAGER_SUCCESS);
+    /* free pages at the end are cut off, file isn't cut below bitmap page */
+    int64_t last = pg_max_page_index(pager);
+    assert(pg_dealloc(pager, last - 1) == PAGER_SUCCESS);
+    assert(pg_max_page_index(pager) == last);
+    assert(pg_dealloc(pager, last) == PAGER_SUCCESS);
+    assert(pg_max_page_index(pager) == last - 2);
+    for(int64_t i = group + 1; i <= last - 2; i++){
+        assert(pg_dealloc(pager, i) == PAGER_SUCCESS);
+    }
+    assert(pg_max_page_index(pager) == group);
+    assert(pg_alloc(pager) == 12);
+    pg_delete(pager);
+}
+
+DEFINE_TEST(compaction){
+    pager_t* pager = pg_init("test.db");
+    assert(pager != NULL);
+    if(pg_file_size(pager) != 0){
+        assert(pg_delete(pager) == PAGER_SUCCESS);
+        pager = pg_init("test.db");
+        assert(pager != NULL);
+    }
+    int64_t count = PG_GROUP_PAGES + 200;
+    int64_t* pages = malloc(count * sizeof(int64_t));
+    for(int64_t i = 0; i < count; i++){
+        pages[i] = pg_alloc(pager);
+        assert(pg_write(pager, pages[i], &pages[i], sizeof(int64_t), 0) == PAGER_SUCCESS);
+    }
+    int64_t kept = 0;
+    for(int64_t i = 0; i < count; i++){
+        if(i % 16 == 15){
+            pages[kept++] = pages[i];
+        }
+        else{
+            assert(pg_dealloc(pager, pages[i]) == PAGER_SUCCESS);
+        }
+    }
+    int64_t last = pg_max_page_index(pager);
+    int64_t step;
+    while((step = pg_compact(pager, 64)) > 0);
+    assert(step == 0);
+    /* second group is cut off, only pages of relocation map are added to kept ones */
+    assert(pg_max_page_index(pager) < last);
+    assert(pg_max_page_index(pager) < kept + 32);
+    for(int64_t i = 0; i < kept; i++){
+        int64_t value = -1;
+        assert(pg_copy_read(pager, pages[i], &value, sizeof(int64_t), 0) == PAGER_SUCCESS);
+        assert(value == pages[i]);
+    }
+    assert(pg_close(pager) == PAGER_SUCCESS);
+
+    /* moved pages keep their indexes after reopening */
+    pager = pg_init("test.db");
+    assert(pager != NULL);
+    int64_t added[100];
+    for(int64_t i = 0; i < 100; i++){
+        added[i] = pg_alloc(pager);
+        assert(pg_write(pager, added[i], &added[i], sizeof(int64_t), 0) == PAGER_SUCCESS);
+    }
+    for(int64_t i = 0; i < kept; i++){
+        int64_t value = -1;
+        assert(pg_copy_read(pager, pages[i], &value, sizeof(int64_t), 0) == PAGER_SUCCESS);
+        assert(value == pages[i]);
+    }
+    for(int64_t i = 0; i < 100; i++){
+        int64_t value = -1;
+        assert(pg_copy_read(pager, added[i], &value, sizeof(int64_t), 0) == PAGER_SUCCESS);
+        assert(value == added[i]);
+    }
+    /* relocation map shrinks as moved pages are freed */
+    size_t moved = pager->moved.count;
+    assert(moved > 0);
+    for(int64_t i = 0; i < kept; i++){
+        assert(pg_dealloc(pager, pages[i]) == PAGER_SUCCESS);
+    }
+    for(int64_t i = 0; i < 100; i++){
+        assert(pg_dealloc(pager, added[i]) == PAGER_SUCCESS);
+    }
+    assert(pager->moved.count == 0);
+    assert(pg_close(pager) == PAGER_SUCCESS);
+    pager = pg_init("test.db");
+    assert(pager != NULL);
+    assert(pager->moved.count == 0);
+    for(int64_t i = 0; i < 100; i++){
+        added[i] = pg_alloc(pager);
+        assert(pg_write(pager, added[i], &added[i], sizeof(int64_t), 0) == PAGER_SUCCESS);
+    }
+    for(int64_t i = 0; i < 100; i++){
+        int64_t value = -1;
+        assert(pg_copy_read(pager, added[i], &value, sizeof(int64_t), 0) == PAGER_SUCCESS);
+        assert(value == added[i]);
+    }
+    free(pages);
+    pg_delete(pager);
+
+    /* file with write-ahead log isn't compacted */
+    ch_options_t opt = {.wal = true};
+    pager = pg_init_opt("test.db", &opt);
+    assert(pager != NULL);
+    assert(pg_alloc(pager) != PAGER_FAIL);
+    assert(pg_compact(pager, 64) == PAGER_FAIL);
+    pg_delete(pager);
+}
+
+typedef struct reader{
+    pager_t* pager;
+    const int64_t* pages;
+    int64_t count;
+    atomic_bool done;
+    int64_t reads;
+} reader_t;
+
+static void* compaction_reader(void* arg){
+    reader_t* reader = arg;
+    pager_t* pager = reader->pager;
+    pg_attach(pager);
+    for(int64_t round = 1; !atomic_load(&reader->done); round++){
+        for(int64_t i = 0; i < reader->count; i++){
+            int64_t value = -1;
+            assert(pg_copy_read(pager, reader->pages[i], &value, sizeof(int64_t), 0) == PAGER_SUCCESS);
+            assert(value == reader->pages[i]);
+            /* write isn't lost in old position of moved page */
+            assert(pg_write(pager, reader->pages[i], &round, sizeof(int64_t), sizeof(int64_t)) == PAGER_SUCCESS);
+            assert(pg_copy_read(pager, reader->pages[i], &value, sizeof(int64_t), sizeof(int64_t)) == PAGER_SUCCESS);
+            assert(value == round);
+            assert(pg_pin(pager, reader->pages[i]) == reader->pages[i]);
+            const int64_t* page = pg_read_page(pager, reader->pages[i]);
+            assert(page && *page == reader->pages[i]);
+            assert(pg_unpin(pager, reader->pages[i]) == PAGER_SUCCESS);
+            reader->reads++;
+        }
+    }
+    pg_detach(pager);
+    return NULL;
+}
+
+DEFINE_TEST(compaction_concurrent_read){
+    pager_t* pager = pg_init("test.db");
+    assert(pager != NULL);
+    if(pg_file_size(pager) != 0){
+        assert(pg_delete(pager) == PAGER_SUCCESS);
+        pager = pg_init("test.db");
+        assert(pager != NULL);
+    }
+    int64_t count = PG_GROUP_PAGES + 200;
+    int64_t* pages = malloc(count * sizeof(int64_t));
+    for(int64_t i = 0; i < count; i++){
+        pages[i] = pg_alloc(pager);
+        assert(pg_write(pager, pages[i], &pages[i], sizeof(int64_t), 0) == PAGER_SUCCESS);
+    }
+    int64_t kept = 0;
+    for(int64_t i = 0; i < count; i++){
+        if(i % 16 == 15){
+            pages[kept++] = pages[i];
+        }
+        else{
+            assert(pg_dealloc(pager, pages[i]) == PAGER_SUCCESS);
+        }
+    }
+    /* reader looks pages up while they are moved */
+    reader_t reader = {.pager = pager, .pages = pages, .count = kept, .reads = 0};
+    atomic_init(&reader.done, false);
+    pthread_t thread;
+    assert(pthread_create(&thread, NULL, compaction_reader, &reader) == 0);
+    int64_t last = pg_max_page_index(pager);
+    int64_t step, moves = 0;
+    while((step = pg_compact(pager, 4)) > 0){
+        moves += step;
+    }
+    atomic_store(&reader.done, true);
+    pthread_join(thread, NULL);
+    /* pages pinned by reader are skipped, they are moved alone */
+    while((step = pg_compact(pager, 64)) > 0){
+        moves += step;
+    }
+    assert(step == 0);
+    assert(moves > 0);
+    assert(reader.reads > 0);
+    assert(pg_max_page_index(pager) < last);
+    for(int64_t i = 0; i < kept; i++){
+        int64_t value = -1;
+        assert(pg_copy_read(pager, pages[i], &value, sizeof(int64_t), 0) == PAGER_SUCCESS);
+        assert(value == pages[i]);
+    }
+    free(pages);
+    pg_delete(pager);
+}
+
+DEFINE_TEST(contiguous_alloc){
+    pager_t* pager = pg_init("test.db");
+    assert(pager != NULL);
+    if(pg_file_size(pager) != 0){
+        assert(pg_delete(pager) == PAGER_SUCCESS);
+        pager = pg_init("test.db");
+        assert(pager != NULL);
+    }
+    int64_t pages[64];
+    assert(pg_alloc_n(pager, 0, pages) == PAGER_FAIL);
+    assert(pg_alloc_n(pager, 64, pages) == PAGER_SUCCESS);
+    for(int64_t i = 1; i < 64; i++){
+        assert(pages[i] == pages[i - 1] + 1);
+    }
+    /* single free pages are skipped, freed run is reused */
+    assert(pg_dealloc(pager, pages[3]) == PAGER_SUCCESS);
+    for(int64_t i = 10; i < 20; i++){
+        assert(pg_dealloc(pager, pages[i]) == PAGER_SUCCESS);
+    }
+    int64_t run[8];
+    assert(pg_alloc_n(pager, 8, run) == PAGER_SUCCESS);
+    for(int64_t i = 0; i < 8; i++){
+        assert(run[i] == pages[10] + i);
+    }
+    /* run longer than any free one is appended */
+    int64_t last = pg_max_page_index(pager);
+    int64_t tail[16];
+    assert(pg_alloc_n(pager, 16, tail) == PAGER_SUCCESS);
+    for(int64_t i = 0; i < 16; i++){
+        assert(tail[i] == last + 1 + i);
+    }
+    assert(pg_alloc(pager) == pages[3]);
+    assert(pg_delete(pager) == PAGER_SUCCESS);
+}
+
+DEFINE_TEST(file_format){
+    pager_t* pager = pg_init("test.db");
+    assert(pager != NULL);
+    if(pg_file_size(pager) != 0){
+        assert(pg_delete(pager) == PAGER_SUCCESS);
+        pager = pg_init("test.db");
+        assert(pager != NULL);
+    }
+    assert(pg_alloc(pager) == 1);
+    assert(pg_close(pager) == PAGER_SUCCESS);
+
+    /* newer version isn't opened */
+    FILE* file = fopen("test.db", "r+b");
+    assert(file);
+    uint32_t version = PG_VERSION + 1;
+    assert(fseek(file, sizeof(uint64_t), SEEK_SET) == 0);
+    assert(fwrite(&version, sizeof(version), 1, file) == 1);
+    assert(fclose(file) == 0);
+    assert(pg_init("test.db") == NULL);
+
+    /* file without magic, like the one with deleted pages array on the first page, isn't opened */
+    int64_t* deleted_pages = calloc(1, PAGE_SIZE);
+    assert(deleted_pages);
+    deleted_pages[1] = 3;
+    deleted_pages[2] = 2;
+    deleted_pages[3] = 1;
+    file = fopen("test.db", "wb");
+    assert(file);
+    assert(fwrite(deleted_pages, PAGE_SIZE, 1, file) == 1);
+    assert(fwrite(deleted_pages, PAGE_SIZE, 1, file) == 1);
+    assert(fclose(file) == 0);
+    free(deleted_pages);
+    assert(pg_init("test.db") == NULL);
+    assert(remove("test.db") == 0);
+}
+
+DEFINE_TEST(preallocated_tail){
+    pager_t* pager = pg_init("test.db");
+    assert(pager != NULL);
+    if(pg_file_size(pager) != 0){
+        assert(pg_delete(pager) == PAGER_SUCCESS);
+        pager = pg_init("test.db");
+        assert(pager != NULL);
+    }
+    for(int64_t i = 1; i <= 10; i++){
+        assert(pg_alloc(pager) == i);
+    }
+    assert(pg_dealloc(pager, 5) == PAGER_SUCCESS);
+    assert(pg_close(pager) == PAGER_SUCCESS);
+
+    /* file left without close keeps zeroed preallocated tail, it crosses start of the next group */
+    FILE* file = fopen("test.db", "r+b");
+    assert(file);
+    assert(fseek(file, (long)((PG_GROUP_PAGES + 100) * PAGE_SIZE - 1), SEEK_SET) == 0);
+    assert(fputc(0, file) == 0);
+    assert(fclose(file) == 0);
+
+    pager = pg_init("test.db");
+    assert(pager != NULL);
+    assert(pg_max_page_index(pager) == 10);
+    assert(pg_alloc(pager) == 5);
+    assert(pg_alloc(pager) == 11);
+    assert(pg_delete(pager) == PAGER_SUCCESS);
+}
 
 int main(){
     RUN_SINGLE_TEST(allocate_deallocate);
     RUN_SINGLE_TEST(double_dealloc);
+    RUN_SINGLE_TEST(free_page_bitmap);
+    RUN_SINGLE_TEST(compaction);
+    RUN_SINGLE_TEST(compaction_concurrent_read);
+    RUN_SINGLE_TEST(contiguous_alloc);
+    RUN_SINGLE_TEST(file_format);
+    RUN_SINGLE_TEST(preallocated_tail);
 }
\ No newline at end of file
@@ -5,40 +5,43 @@
 #include "backend/utils/parray.h"
 
 DEFINE_TEST(write_and_read){
-    assert(pg_init("test.db") == PAGER_SUCCESS);
+    pager_t* pager = pg_init("test.db");
+    assert(pager != NULL);
     char str[] = "1234567";
-    int64_t array = pa_init(sizeof(str));
+    int64_t array = pa_init(pager, sizeof(str));
     for(int64_t i = 0; i < 1000; i++){
-        pa_append(array, str, sizeof(str));
+        pa_append(pager, array, str, sizeof(str));
     }
     for(int64_t i = 0; i < 1000; i++){
         char* read_str = malloc(sizeof(str));
-        pa_at(array, i, read_str);
+        pa_at(pager, array, i, read_str);
         assert(strcmp(str, read_str) == 0);
         free(read_str);
     }
-    pa_destroy(array);
-    pg_delete();
+    pa_destroy(pager, array);
+    pg_delete(pager);
 }
 
 DEFINE_TEST(close_and_open){
-    assert(pg_init("test.db") == PAGER_SUCCESS);
+    pager_t* pager = pg_init("test.db");
+    assert(pager != NULL);
     char str[] = "1234567";
-    int64_t array = pa_init(sizeof(str));
+    int64_t array = pa_init(pager, sizeof(str));
     for(int64_t i = 0; i < 3000; i++){
-        pa_append(array, str, sizeof(str));
+        pa_append(pager, array, str, sizeof(str));
     }
-    pg_close();
+    pg_close(pager);
 
-    assert(pg_init("test.db") == PAGER_SUCCESS);
+    pager = pg_init("test.db");
+    assert(pager != NULL);
     for(int64_t i = 0; i < 3000; i++){
         char* read_str = malloc(sizeof(str));
-        pa_at(array, i, read_str);
+        pa_at(pager, array, i, read_str);
         assert(strcmp(str, read_str) == 0);
         free(read_str);
     }
-    pa_destroy(array);
-    pg_delete();
+    pa_destroy(pager, array);
+    pg_delete(pager);
 }
 
 
@@ -1,40 +1,102 @@
 #include "../src/test.h"
 #include "core/io/pager.h"
 #include "backend/table/schema.h"
+#include <pthread.h>
 
 DEFINE_TEST(create_add_foreach_sch){
-    assert(pg_init("test.db") == PAGER_SUCCESS);
-    schema_t* schema = sch_init();
-    sch_add_char_field(schema, "NAME", 10);
-    sch_add_int_field(schema, "CREDIT");
-    sch_add_float_field(schema, "DEBIT");
-    sch_add_bool_field(schema, "STUDENT");
-    sch_for_each(schema, chunk, field, chblix, schema_index(schema)){
-        printf("%s\n",field.name);
+    pager_t* pager = pg_init("test.db");
+    assert(pager != NULL);
+    schema_t* schema = sch_init(pager);
+    sch_add_char_field(pager, schema, "NAME", 10);
+    sch_add_int_field(pager, schema, "CREDIT");
+    sch_add_float_field(pager, schema, "DEBIT");
+    sch_add_bool_field(pager, schema, "STUDENT");
+    {
+        sch_for_each(pager, schema, chunk, field, chblix, schema_index(schema)){
+            printf("%s\n",field.name);
+        }
     }
-    pg_delete();
+    pg_delete(pager);
 }
 
 DEFINE_TEST(delete_field){
-    assert(pg_init("test.db") == PAGER_SUCCESS);
-    schema_t* schema = sch_init();
+    pager_t* pager = pg_init("test.db");
+    assert(pager != NULL);
+    schema_t* schema = sch_init(pager);
     if(schema == NULL){
        exit(EXIT_FAILURE);
     }
-    sch_add_char_field(schema, "NAME", 10);
-    sch_add_int_field(schema, "CREDIT");
-    sch_add_float_field(schema, "DEBIT");
-    sch_add_bool_field(schema, "STUDENT");
-    sch_delete_field(schema, "STUDENT");
+    sch_add_char_field(pager, schema, "NAME", 10);
+    sch_add_int_field(pager, schema, "CREDIT");
+    sch_add_float_field(pager, schema, "DEBIT");
+    sch_add_bool_field(pager, schema, "STUDENT");
+    sch_delete_field(pager, schema, "STUDENT");
     field_t temp;
-    int res = sch_get_field(schema, "STUDENT", &temp);
+    int res = sch_get_field(pager, schema, "STUDENT", &temp);
     assert(res == SCHEMA_NOT_FOUND);
-    res = sch_get_field(schema, "DEBIT", &temp);
+    res = sch_get_field(pager, schema, "DEBIT", &temp);
     assert(res == SCHEMA_SUCCESS);
-    pg_delete();
+    pg_delete(pager);
+}
+
+#define ADDERS 4
+#define ADDER_FIELDS 50
+
+typedef struct adder{
+    pager_t* pager;
+    int64_t schidx;
+    int64_t id;
+} adder_t;
+
+static void* field_adder(void* arg){
+    adder_t* adder = arg;
+    pager_t* pager = adder->pager;
+    pg_attach(pager);
+    schema_t* schema = sch_read(pager, adder->schidx);
+    char name[MAX_NAME_LENGTH];
+    for(int64_t i = 0; i < ADDER_FIELDS; i++){
+        snprintf(name, MAX_NAME_LENGTH, "F%ld_%ld", adder->id, i);
+        assert(sch_add_int_field(pager, schema, name) == SCHEMA_SUCCESS);
+        field_t field;
+        assert(sch_get_field(pager, schema, name, &field) == SCHEMA_SUCCESS);
+    }
+    pg_detach(pager);
+    return NULL;
+}
+
+DEFINE_TEST(concurrent_add_field){
+    pager_t* pager = pg_init("test.db");
+    assert(pager != NULL);
+    schema_t* schema = sch_init(pager);
+    assert(schema != NULL);
+    int64_t schidx = schema_index(schema);
+    adder_t adders[ADDERS];
+    pthread_t threads[ADDERS];
+    for(int64_t i = 0; i < ADDERS; i++){
+        adders[i] = (adder_t){.pager = pager, .schidx = schidx, .id = i};
+        assert(pthread_create(&threads[i], NULL, field_adder, &adders[i]) == 0);
+    }
+    for(int64_t i = 0; i < ADDERS; i++){
+        pthread_join(threads[i], NULL);
+    }
+    /* every field got its own offset */
+    schema = sch_read(pager, schidx);
+    assert(schema->slot_size == ADDERS * ADDER_FIELDS * (int64_t)sizeof(int64_t));
+    int64_t count = 0;
+    uint64_t offsets = 0;
+    {
+        sch_for_each(pager, schema, chunk, field, chblix, schidx){
+            count++;
+            offsets += field.offset;
+        }
+        assert(count == ADDERS * ADDER_FIELDS);
+        assert(offsets == sizeof(int64_t) * (uint64_t)(count * (count - 1) / 2));
+    }
+    pg_delete(pager);
 }
 
 int main(){
     RUN_SINGLE_TEST(create_add_foreach_sch);
     RUN_SINGLE_TEST(delete_field);
+    RUN_SINGLE_TEST(concurrent_add_field);
 }
\ No newline at end of file
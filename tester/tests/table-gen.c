@@ -4,16 +4,17 @@
 #include "generator/table-gen.h"
 
 DEFINE_TEST(generate_table){
-    db_t* db = db_init("test.db");
+    pager_t* pager = db_init("test.db");
+    db_t* db = db_get(pager);
     assert(db != NULL);
     gentab_mgr gentabMgr;
     gentabMgr.next_index = 0;
-    table_t* table = gen_table(db, &gentabMgr, 100);
-    schema_t* schema = sch_load(table->schidx);
+    table_t* table = gen_table(pager, db, &gentabMgr, 100);
+    schema_t* schema = sch_load(pager, table->schidx);
     assert(table != NULL);
-    tab_print(db, table, schema);
-    assert(tab_drop(db, table) == TABLE_SUCCESS);
-    db_drop();
+    tab_print(pager, db, table, schema);
+    assert(tab_drop(pager, db, table) == TABLE_SUCCESS);
+    db_drop(pager);
 }
 
 int main(){
@@ -2,12 +2,13 @@
 #include "core/io/pager.h"
 #include "backend/table/schema.h"
 #include "backend/table/table.h"
+#include <pthread.h>
 #ifdef LOGGER_LEVEL
 #undef LOGGER_LEVEL
 #endif
 #define LOGGER_LEVEL 2
 
-static void insert_data(table_t* table, schema_t* schema, int64_t count){
+static void insert_data(pager_t* pager, table_t* table, schema_t* schema, int64_t count){
     tab_row(
             char NAME[10];
             char SURNAME[10];
@@ -21,54 +22,54 @@ static void insert_data(table_t* table, schema_t* schema, int64_t count){
         row.CREDIT = 10;
         row.DEBIT = 10.5f;
         row.STUDENT = true;
-        chblix_t res = tab_insert(table, schema, &row);
+        rowid_t res = tab_insert(pager, table, schema, &row);
         strncpy(row.NAME, "Nick", 10);
         strncpy(row.SURNAME, "Johnson", 10);
         row.CREDIT = 20;
         row.DEBIT = 20.5f;
         row.STUDENT = false;
-        res = tab_insert(table, schema, &row);
+        res = tab_insert(pager, table, schema, &row);
         strncpy(row.NAME, "John", 10);
         strncpy(row.SURNAME, "Doe", 10);
         row.CREDIT = 30;
         row.DEBIT = 30.5f;
         row.STUDENT = true;
-        res = tab_insert(table, schema, &row);
+        res = tab_insert(pager, table, schema, &row);
     }
 }
 
-static schema_t* init_schema(void){
-    schema_t* schema = sch_init();
+static schema_t* init_schema(pager_t* pager){
+    schema_t* schema = sch_init(pager);
     if(schema == NULL){
         exit(EXIT_FAILURE);
     }
     const size_t char_count = 10;
-    sch_add_char_field(schema, "NAME", char_count);
-    sch_add_char_field(schema, "SURNAME", char_count);
-    sch_add_int_field(schema, "CREDIT");
-    sch_add_float_field(schema, "DEBIT");
-    sch_add_bool_field(schema, "STUDENT");
+    sch_add_char_field(pager, schema, "NAME", char_count);
+    sch_add_char_field(pager, schema, "SURNAME", char_count);
+    sch_add_int_field(pager, schema, "CREDIT");
+    sch_add_float_field(pager, schema, "DEBIT");
+    sch_add_bool_field(pager, schema, "STUDENT");
     return schema;
 }
 
-table_t* table_bank(db_t* db, int count){
-    schema_t* schema = init_schema();
-    table_t* table = tab_init(db, "BANK", schema);
+table_t* table_bank(pager_t* pager, db_t* db, int count){
+    schema_t* schema = init_schema(pager);
+    table_t* table = tab_init(pager, db, "BANK", schema);
     if(table == NULL){
         logger(LL_ERROR, __func__, "Unable to init table");
         exit(EXIT_FAILURE);
     }
-    insert_data(table, schema, count);
+    insert_data(pager, table, schema, count);
     return table;
 }
 
-table_t* table_student(db_t* db, int count){
-    schema_t* schema =  sch_init();
-    sch_add_int_field(schema, "ID");
-    sch_add_char_field(schema, "NAME", 10);
-    sch_add_float_field(schema, "SCORE");
-    sch_add_bool_field(schema, "PASS");
-    table_t* table = tab_init(db, "STUDENTS", schema);
+table_t* table_student(pager_t* pager, db_t* db, int count){
+    schema_t* schema =  sch_init(pager);
+    sch_add_int_field(pager, schema, "ID");
+    sch_add_char_field(pager, schema, "NAME", 10);
+    sch_add_float_field(pager, schema, "SCORE");
+    sch_add_bool_field(pager, schema, "PASS");
+    table_t* table = tab_init(pager, db, "STUDENTS", schema);
     tab_row(
             int64_t ID;
             char NAME[10];
@@ -79,186 +80,381 @@ table_t* table_student(db_t* db, int count){
     strncpy(row.NAME,"John", 10);
     row.SCORE = 10.5f;
     row.PASS = true;
-    chblix_t res = tab_insert(table, schema, &row);
+    rowid_t res = tab_insert(pager, table, schema, &row);
 
     row.ID = 2;
     strncpy(row.NAME,"Nick", 10);
     row.SCORE = 20.5f;
     row.PASS = false;
-    res = tab_insert(table, schema, &row);
+    res = tab_insert(pager, table, schema, &row);
 
     row.ID = 3;
     strncpy(row.NAME,"Alex", 10);
     row.SCORE = 30.5f;
     row.PASS = true;
-    res = tab_insert(table,schema,  &row);
+    res = tab_insert(pager, table,schema,  &row);
 
     row.ID = 4;
     strncpy(row.NAME,"Smith", 10);
     row.SCORE = 40.5f;
     row.PASS = false;
-    res = tab_insert(table,schema,  &row);
+    res = tab_insert(pager, table,schema,  &row);
 
     return table;
 }
 
 
 DEFINE_TEST(create_add_foreach){
-    db_t* db = db_init("test.db");
-    schema_t* schema = init_schema();
-    table_t* table = tab_init(db, "test", schema);
-    insert_data(table, schema, 1);
+    pager_t* pager = db_init("test.db");
+    db_t* db = db_get(pager);
+    schema_t* schema = init_schema(pager);
+    table_t* table = tab_init(pager, db, "test", schema);
+    insert_data(pager, table, schema, 1);
     field_t field;
-    sch_get_field(schema, "CREDIT", &field);
+    sch_get_field(pager, schema, "CREDIT", &field);
     int64_t* element = malloc(field.size);
     int64_t ans[3];
     int counter = 0;
-    tab_for_each_element(table,chunk, chblix, element, (&field)){
-        ans[counter++] = *element;
+    {
+        tab_for_each_element(pager, table,chunk, chblix, element, (&field)){
+            ans[counter++] = *element;
+        }
+        assert(ans[0] == 10);
+        assert(ans[1] == 20);
+        assert(ans[2] == 30);
+        free(element);
     }
-    assert(ans[0] == 10);
-    assert(ans[1] == 20);
-    assert(ans[2] == 30);
-    free(element);
-    db_drop();
+    db_drop(pager);
 }
 
 DEFINE_TEST(update) {
-    db_t* db = db_init("test.db");
-    schema_t* schema = init_schema();
-    table_t* table = tab_init(db, "test", schema);
-    insert_data(table, schema, 1);
+    pager_t* pager = db_init("test.db");
+    db_t* db = db_get(pager);
+    schema_t* schema = init_schema(pager);
+    table_t* table = tab_init(pager, db, "test", schema);
+    insert_data(pager, table, schema, 1);
     field_t field;
-    sch_get_field(schema, "CREDIT", &field);
+    sch_get_field(pager, schema, "CREDIT", &field);
     int64_t element = 30;
-    chblix_t res = tab_get_row(db,table, schema, &field, &element, DT_INT);
-    assert(chblix_cmp(&res, &CHBLIX_FAIL) != 0);
+    rowid_t res = tab_get_row(pager, db,table, schema, &field, &element, DT_INT);
+    assert(res != ROWID_FAIL);
     int64_t new_element = 100;
-    assert(tab_update_element(table, &res, &(field), &new_element) == TABLE_SUCCESS);
+    assert(tab_update_element(pager, table, res, &(field), &new_element) == TABLE_SUCCESS);
     int64_t read_element;
-    assert(tab_get_element(table_index(table), &res, &(field), &read_element) == TABLE_SUCCESS);
+    assert(tab_get_element(pager, table, res, &(field), &read_element) == TABLE_SUCCESS);
     assert(read_element == 100);
-    db_drop();
+    db_drop(pager);
+}
+
+DEFINE_TEST(row_view){
+    pager_t* pager = db_init("test.db");
+    db_t* db = db_get(pager);
+    table_t* table = table_student(pager, db, 1);
+    schema_t* schema = sch_load(pager, table->schidx);
+    field_t field;
+    sch_get_field(pager, schema, "ID", &field);
+    int64_t element = 3;
+    rowid_t res = tab_get_row(pager, db,table, schema, &field, &element, DT_INT);
+    assert(res != ROWID_FAIL);
+    {
+        pg_scoped_t pin pg_pinned = {pager, -1};
+        const void* view = tab_row_view(pager, table, res, &pin.page_index);
+        assert(view != NULL && pin.page_index == rowid_chunk(res));
+        char* row = malloc(schema->slot_size);
+        assert(tab_select_row(pager, table, res, row) == TABLE_SUCCESS);
+        assert(memcmp(view, row, schema->slot_size) == 0);
+        /* view is the row in page, so update is seen through it */
+        int64_t id = 30;
+        assert(tab_update_element(pager, table, res, &field, &id) == TABLE_SUCCESS);
+        assert(memcmp((const char*)view + field.offset, &id, sizeof(id)) == 0);
+        assert(pg_unpin(pager, pin.page_index) == PAGER_SUCCESS);
+        assert(tab_delete_nova(pager, table, NULL, res) == TABLE_SUCCESS);
+        assert(tab_row_view(pager, table, res, &pin.page_index) == NULL && pin.page_index == -1);
+        free(row);
+    }
+    db_drop(pager);
+}
+
+DEFINE_TEST(read_only){
+    pager_t* pager = db_init("test.db");
+    db_t* db = db_get(pager);
+    table_t* table = table_student(pager, db, 1);
+    int64_t tablix = table_index(table);
+    schema_t* schema = sch_read(pager, table->schidx);
+    tab_row(
+            int64_t ID;
+            char NAME[10];
+            float SCORE;
+            bool PASS;
+    );
+    /* rows lie in several chunks */
+    for(int64_t i = 5; i < 1000; i++){
+        row.ID = i;
+        assert(tab_insert(pager, table, schema, &row) != ROWID_FAIL);
+    }
+    field_t field;
+    assert(sch_get_field(pager, schema, "ID", &field) == SCHEMA_SUCCESS);
+    int64_t element = 3;
+    rowid_t res = tab_get_row(pager, db, table, schema, &field, &element, DT_INT);
+    assert(res != ROWID_FAIL);
+    /* reads don't modify pages, so nothing is marked dirty */
+    uint64_t clock = atomic_load(&pager->ch.dirty_clock);
+    assert(tab_select_row(pager, table, res, &row) == TABLE_SUCCESS);
+    assert(row.ID == 3);
+    assert(tab_get_element(pager, table, res, &field, &element) == TABLE_SUCCESS);
+    assert(element == 3);
+    assert(mtab_find_table_by_name(pager, db->meta_table_idx, "STUDENTS") == tablix);
+    int64_t count = 0;
+    {
+        tab_for_each_row(pager, table, chunk, chblix, &row, schema){
+            count++;
+        }
+        assert(count == 999);
+        assert(atomic_load(&pager->ch.dirty_clock) == clock);
+    }
+    db_drop(pager);
+}
+
+DEFINE_TEST(cursor){
+    pager_t* pager = db_init("test.db");
+    db_t* db = db_get(pager);
+    schema_t* schema = sch_init(pager);
+    sch_add_int_field(pager, schema, "ID");
+    sch_add_char_field(pager, schema, "NAME", 10);
+    table_t* table = tab_init(pager, db, "CURSOR", schema);
+    tab_row(
+            int64_t ID;
+            char NAME[10];
+    );
+    int64_t count = 5000, expected_count = 0, expected_sum = 0;
+    for(int64_t i = 0; i < count; i++){
+        row.ID = i;
+        strncpy(row.NAME, "Alex", 10);
+        rowid_t rowid = tab_insert(pager, table, schema, &row);
+        assert(rowid != ROWID_FAIL);
+        /* every third row is deleted, so chunks have gaps */
+        if(i % 3 == 0){
+            assert(tab_delete_nova(pager, table, NULL, rowid) == TABLE_SUCCESS);
+        }
+        else{
+            expected_count++;
+            expected_sum += i;
+        }
+    }
+    rowid_t rowids[100];
+    row_t rows[100];
+    tab_cursor_t cursor;
+    assert(tab_cursor_open(pager, &cursor, table) == TABLE_SUCCESS);
+    int64_t fetched, visited = 0, sum = 0;
+    while((fetched = tab_cursor_next_batch(pager, &cursor, rowids, rows, 100)) > 0){
+        for(int64_t i = 0; i < fetched; i++){
+            visited++;
+            sum += rows[i].ID;
+            assert(strcmp(rows[i].NAME, "Alex") == 0);
+            int64_t id;
+            field_t field;
+            assert(sch_get_field(pager, schema, "ID", &field) == SCHEMA_SUCCESS);
+            assert(tab_get_element(pager, table, rowids[i], &field, &id) == TABLE_SUCCESS);
+            assert(id == rows[i].ID);
+        }
+    }
+    assert(fetched == 0);
+    assert(tab_cursor_next_batch(pager, &cursor, rowids, rows, 100) == 0);
+    tab_cursor_close(pager, &cursor);
+    assert(visited == expected_count);
+    assert(sum == expected_sum);
+    db_drop(pager);
+}
+
+DEFINE_TEST(cursor_write){
+    pager_t* pager = db_init("test.db");
+    db_t* db = db_get(pager);
+    schema_t* schema = sch_init(pager);
+    sch_add_int_field(pager, schema, "ID");
+    sch_add_char_field(pager, schema, "NAME", 10);
+    table_t* table = tab_init(pager, db, "CURSOR", schema);
+    tab_row(
+            int64_t ID;
+            char NAME[10];
+    );
+    int64_t count = 5000, expected_sum = 0;
+    for(int64_t i = 0; i < count; i++){
+        row.ID = i;
+        strncpy(row.NAME, "Alex", 10);
+        assert(tab_insert(pager, table, schema, &row) != ROWID_FAIL);
+    }
+    rowid_t rowids[100];
+    row_t rows[100];
+    tab_cursor_t cursor;
+    /* read only cursor doesn't delete rows */
+    assert(tab_cursor_open(pager, &cursor, table) == TABLE_SUCCESS);
+    assert(tab_cursor_next_batch(pager, &cursor, rowids, rows, 1) == 1);
+    assert(tab_cursor_delete(pager, &cursor, rowids[0]) == TABLE_FAIL);
+    tab_cursor_close(pager, &cursor);
+    /* cursor is opened inside exclusive latch of table, rows other than odd ones are deleted,
+     * so chunks are emptied and freed during scan */
+    {
+        pg_scoped_t latch pg_latched = {pager, pg_latch(pager, table_index(table), true)};
+        assert(latch.page_index != PAGER_FAIL);
+        assert(tab_cursor_open_write(pager, &cursor, table) == TABLE_SUCCESS);
+        int64_t fetched, visited = 0;
+        while((fetched = tab_cursor_next_batch(pager, &cursor, rowids, rows, 100)) > 0){
+            for(int64_t i = 0; i < fetched; i++){
+                visited++;
+                if(rows[i].ID % 2 == 0 || rows[i].ID < count / 2){
+                    assert(tab_cursor_delete(pager, &cursor, rowids[i]) == TABLE_SUCCESS);
+                }
+                else{
+                    expected_sum += rows[i].ID;
+                }
+            }
+            /* rows which aren't fetched yet aren't deleted */
+            if(cursor.chunk){
+                chblix_t next = {.block_idx = cursor.block_idx, .chunk_idx = cursor.chunk->page_index};
+                assert(tab_cursor_delete(pager, &cursor, rowid_pack(next)) == TABLE_FAIL);
+            }
+        }
+        assert(fetched == 0);
+        tab_cursor_close(pager, &cursor);
+        assert(visited == count);
+        int64_t sum = 0, left = 0;
+        tab_for_each_row(pager, table, chunk, chblix, &row, schema){
+            sum += row.ID;
+            left++;
+        }
+        assert(left == count / 4);
+        assert(sum == expected_sum);
+    }
+    db_drop(pager);
 }
 
 DEFINE_TEST(delete){
-    db_t* db = db_init("test.db");
-    schema_t* schema = init_schema();
-    table_t* table = tab_init(db, "test", schema);
+    pager_t* pager = db_init("test.db");
+    db_t* db = db_get(pager);
+    schema_t* schema = init_schema(pager);
+    table_t* table = tab_init(pager, db, "test", schema);
 
-    insert_data(table, schema, 1);
+    insert_data(pager, table, schema, 1);
     field_t field;
-    sch_get_field(schema, "CREDIT", &field);
+    sch_get_field(pager, schema, "CREDIT", &field);
     int64_t element = 30;
-    chblix_t res = tab_get_row(db,table, schema, &field, &element, DT_INT);
-    chunk_t* chunk = ppl_load_chunk(res.chunk_idx);
-    assert(chblix_cmp(&res, &CHBLIX_FAIL) != 0);
-    assert(tab_delete_nova(table, chunk, &res) == TABLE_SUCCESS);
-    res = tab_get_row(db,table, schema, &field, &element, DT_INT);
-    assert(chblix_cmp(&res, &CHBLIX_FAIL) == 0);
-    db_drop();
+    rowid_t res = tab_get_row(pager, db,table, schema, &field, &element, DT_INT);
+    chunk_t* chunk = ppl_load_chunk(pager, rowid_chunk(res));
+    assert(res != ROWID_FAIL);
+    assert(tab_delete_nova(pager, table, chunk, res) == TABLE_SUCCESS);
+    res = tab_get_row(pager, db,table, schema, &field, &element, DT_INT);
+    assert(res == ROWID_FAIL);
+    db_drop(pager);
 }
 
 DEFINE_TEST(get_table_after_close){
-    db_t* db = db_init("test.db");
-    table_t* table = table_student(db, 1);
-    db_close();
-    db = db_init("test.db");
-    int64_t tabix = mtab_find_table_by_name(db->meta_table_idx, "STUDENTS");
-    table_t *table2 = tab_load(tabix);
+    pager_t* pager = db_init("test.db");
+    db_t* db = db_get(pager);
+    table_t* table = table_student(pager, db, 1);
+    db_close(pager);
+    pager = db_init("test.db");
+    db = db_get(pager);
+    int64_t tabix = mtab_find_table_by_name(pager, db->meta_table_idx, "STUDENTS");
+    table_t *table2 = tab_load(pager, tabix);
     assert(table2 != NULL);
-    db_drop();
+    db_drop(pager);
 }
 
 DEFINE_TEST(varchar){
-    db_t* db = db_init("test.db");
+    pager_t* pager = db_init("test.db");
+    db_t* db = db_get(pager);
 
     char* big_string = "This is a big string\n "
                        "with multiple lines\n "
                        "and it is very long\n"
                        "and it is very long\n";
 
-    schema_t* schema = sch_init();
-    sch_add_varchar_field(schema, "NAME");
-    sch_add_varchar_field(schema, "SURNAME");
-    sch_add_varchar_field(schema, "BIG_STRING");
-    table_t* table = tab_init(db, "test", schema);
+    schema_t* schema = sch_init(pager);
+    sch_add_varchar_field(pager, schema, "NAME");
+    sch_add_varchar_field(pager, schema, "SURNAME");
+    sch_add_varchar_field(pager, schema, "BIG_STRING");
+    table_t* table = tab_init(pager, db, "test", schema);
     tab_row(
             vch_ticket_t NAME;
             vch_ticket_t SURNAME;
             vch_ticket_t BIG_STRING;
     );
-    row.NAME = vch_add(db->varchar_mgr_idx, "Alex");
-    row.SURNAME = vch_add(db->varchar_mgr_idx, "Smith");
-    row.BIG_STRING = vch_add(db->varchar_mgr_idx, big_string);
-    chblix_t res = tab_insert(table, schema, &row);
-    assert(chblix_cmp(&res, &CHBLIX_FAIL) != 0);
+    row.NAME = vch_add(pager, db->varchar_mgr_idx, "Alex");
+    row.SURNAME = vch_add(pager, db->varchar_mgr_idx, "Smith");
+    row.BIG_STRING = vch_add(pager, db->varchar_mgr_idx, big_string);
+    rowid_t res = tab_insert(pager, table, schema, &row);
+    assert(res != ROWID_FAIL);
     field_t field;
-    sch_get_field(schema, "BIG_STRING", &field);
+    sch_get_field(pager, schema, "BIG_STRING", &field);
     vch_ticket_t* element = malloc(field.size);
-    tab_for_each_element(table, chunk, chblix, element, &field){
-        char* str = malloc(element->size);
-        vch_get(db->varchar_mgr_idx, element, str);
-        assert(!strcmp(big_string, str));
-        free(str);
+    {
+        tab_for_each_element(pager, table, chunk, chblix, element, &field){
+            char* str = malloc(element->size);
+            vch_get(pager, db->varchar_mgr_idx, element, str);
+            assert(!strcmp(big_string, str));
+            free(str);
+        }
+        free(element);
     }
-    free(element);
-    db_drop();
+    db_drop(pager);
 }
 
 DEFINE_TEST(several_tables){
-    db_t* db = db_init("test.db");
+    pager_t* pager = db_init("test.db");
+    db_t* db = db_get(pager);
 
-    schema_t* schema = sch_init();
-    sch_add_varchar_field(schema, "NAME");
-    sch_add_varchar_field(schema, "SURNAME");
+    schema_t* schema = sch_init(pager);
+    sch_add_varchar_field(pager, schema, "NAME");
+    sch_add_varchar_field(pager, schema, "SURNAME");
     tab_row(
             vch_ticket_t NAME;
             vch_ticket_t SURNAME;
             vch_ticket_t BIG_STRING;
     );
-    sch_add_varchar_field(schema, "BIG_STRING");
-    table_t* table1 = tab_init(db, "BIG_STR", schema);
+    sch_add_varchar_field(pager, schema, "BIG_STRING");
+    table_t* table1 = tab_init(pager, db, "BIG_STR", schema);
 
 
-    schema_t* schema2 = sch_init();
-    sch_add_int_field(schema2, "ID");
-    sch_add_varchar_field(schema2, "NAME");
-    sch_add_float_field(schema2, "SCORE");
-    sch_add_bool_field(schema2, "PASS");
-    table_t* table2 = tab_init(db, "STUDENTS", schema2);
+    schema_t* schema2 = sch_init(pager);
+    sch_add_int_field(pager, schema2, "ID");
+    sch_add_varchar_field(pager, schema2, "NAME");
+    sch_add_float_field(pager, schema2, "SCORE");
+    sch_add_bool_field(pager, schema2, "PASS");
+    table_t* table2 = tab_init(pager, db, "STUDENTS", schema2);
 
-    int64_t read_tablix1 = mtab_find_table_by_name(db->meta_table_idx, "BIG_STR");
+    int64_t read_tablix1 = mtab_find_table_by_name(pager, db->meta_table_idx, "BIG_STR");
     assert(read_tablix1 == table_index(table1));
 
-    int64_t read_tablix2 = mtab_find_table_by_name(db->meta_table_idx, "STUDENTS");
+    int64_t read_tablix2 = mtab_find_table_by_name(pager, db->meta_table_idx, "STUDENTS");
     assert(read_tablix2 == table_index(table2));
 
-    db_drop();
+    db_drop(pager);
 }
 
 DEFINE_TEST(print){
-    db_t* db = db_init("test.db");
-    schema_t* schema = init_schema();
-    table_t* table = tab_init(db, "test", schema);
-    insert_data(table, schema, 2);
-    tab_print(db, table, schema);
-    db_drop();
+    pager_t* pager = db_init("test.db");
+    db_t* db = db_get(pager);
+    schema_t* schema = init_schema(pager);
+    table_t* table = tab_init(pager, db, "test", schema);
+    insert_data(pager, table, schema, 2);
+    tab_print(pager, db, table, schema);
+    db_drop(pager);
 }
 
 DEFINE_TEST(join){
-    db_t* db = db_init("test.db");
-    table_t* left = table_bank(db, 1);
-    schema_t* left_schema = sch_load(left->schidx);
-    tab_print(db, left, left_schema);
-    table_t* right = table_student(db, 1);
-    schema_t* right_schema = sch_load(right->schidx);
-    tab_print(db, right, right_schema);
+    pager_t* pager = db_init("test.db");
+    db_t* db = db_get(pager);
+    table_t* left = table_bank(pager, db, 1);
+    schema_t* left_schema = sch_load(pager, left->schidx);
+    tab_print(pager, db, left, left_schema);
+    table_t* right = table_student(pager, db, 1);
+    schema_t* right_schema = sch_load(pager, right->schidx);
+    tab_print(pager, db, right, right_schema);
     field_t left_field;
-    sch_get_field(left_schema, "NAME", &left_field);
+    sch_get_field(pager, left_schema, "NAME", &left_field);
     field_t right_field;
-    sch_get_field(right_schema, "NAME", &right_field);
-    table_t* join_tablix = tab_join(db,
+    sch_get_field(pager, right_schema, "NAME", &right_field);
+    table_t* join_tablix = tab_join(pager, db,
                                    left,
                                    left_schema,
                                    right,
@@ -266,71 +462,76 @@ DEFINE_TEST(join){
                                    &left_field,
                                    &right_field,"JOIN");
     assert(join_tablix != NULL);
-    tab_print(db, join_tablix, sch_load(join_tablix->schidx));
-    db_drop();
+    tab_print(pager, db, join_tablix, sch_load(pager, join_tablix->schidx));
+    db_drop(pager);
 }
 
 DEFINE_TEST(select){
-    db_t* db = db_init("test.db");
-    table_t* table = table_student(db, 1);
-    schema_t *schema = sch_load(table->schidx);
+    pager_t* pager = db_init("test.db");
+    db_t* db = db_get(pager);
+    table_t* table = table_student(pager, db, 1);
+    schema_t *schema = sch_load(pager, table->schidx);
     float value = 20.0f;
     field_t sel_field;
-    assert(sch_get_field(schema, "SCORE", &sel_field) == SCHEMA_SUCCESS);
-    table_t* sel_table_t = tab_select_op(db, table, schema, &sel_field, "SELECT",  COND_GT, &value, DT_FLOAT);
-    tab_print(db,sel_table_t, sch_load(sel_table_t->schidx));
-    schema_t* sel_schema = sch_load(sel_table_t->schidx);
+    assert(sch_get_field(pager, schema, "SCORE", &sel_field) == SCHEMA_SUCCESS);
+    table_t* sel_table_t = tab_select_op(pager, db, table, schema, &sel_field, "SELECT",  COND_GT, &value, DT_FLOAT);
+    tab_print(pager, db,sel_table_t, sch_load(pager, sel_table_t->schidx));
+    schema_t* sel_schema = sch_load(pager, sel_table_t->schidx);
     field_t* field = malloc(sizeof(field_t));
-    assert(sch_get_field(sel_schema,  "SCORE", field) == SCHEMA_SUCCESS);
+    assert(sch_get_field(pager, sel_schema,  "SCORE", field) == SCHEMA_SUCCESS);
     float element;
-    tab_for_each_element(sel_table_t,chunk, chblix, &element, field){
-        assert(element > value);
-    }
-    tab_drop(db, sel_table_t);
+    {
+        tab_for_each_element(pager, sel_table_t,chunk, chblix, &element, field){
+            assert(element > value);
+        }
+        tab_drop(pager, db, sel_table_t);
 
-    sel_table_t = tab_select_op(db, table, schema, &sel_field, "SELECT", COND_GTE, &value, DT_FLOAT);
-    assert(sch_get_field(sel_schema,  "SCORE", field) == SCHEMA_SUCCESS);
-    tab_for_each_element(sel_table_t, chunk2, chblix2, &element, field){
-        assert(element >= value);
-    }
-    tab_drop(db, sel_table_t);
+        sel_table_t = tab_select_op(pager, db, table, schema, &sel_field, "SELECT", COND_GTE, &value, DT_FLOAT);
+        sel_schema = sch_load(pager, sel_table_t->schidx);
+        assert(sch_get_field(pager, sel_schema,  "SCORE", field) == SCHEMA_SUCCESS);
+        tab_for_each_element(pager, sel_table_t, chunk2, chblix2, &element, field){
+            assert(element >= value);
+        }
+        tab_drop(pager, db, sel_table_t);
 
-    sel_table_t = tab_select_op(db,table, schema, &sel_field, "SELECT", COND_LT, &value, DT_FLOAT);
-    sel_schema = sch_load(sel_table_t->schidx);
-    assert(sch_get_field(sel_schema,  "SCORE", field) == SCHEMA_SUCCESS);
-    tab_for_each_element(sel_table_t, chunk3, chblix3, &element, field){
-        assert(element < value);
-    }
-    tab_drop(db, sel_table_t);
+        sel_table_t = tab_select_op(pager, db,table, schema, &sel_field, "SELECT", COND_LT, &value, DT_FLOAT);
+        sel_schema = sch_load(pager, sel_table_t->schidx);
+        assert(sch_get_field(pager, sel_schema,  "SCORE", field) == SCHEMA_SUCCESS);
+        tab_for_each_element(pager, sel_table_t, chunk3, chblix3, &element, field){
+            assert(element < value);
+        }
+        tab_drop(pager, db, sel_table_t);
 
-    sel_table_t = tab_select_op(db,table, schema, &sel_field, "SELECT", COND_LTE, &value, DT_FLOAT);
-    sel_schema = sch_load(sel_table_t->schidx);
-    assert(sch_get_field(sel_schema,  "SCORE", field) == SCHEMA_SUCCESS);
-    tab_for_each_element(sel_table_t, chunk4, chblix4, &element, field){
-        assert(element <= value);
-    }
-    tab_drop(db, sel_table_t);
-
-    value = 10.5f;
-    sel_table_t = tab_select_op(db,table, schema, &sel_field, "SELECT", COND_NEQ, &value, DT_FLOAT);
-    sel_schema = sch_load(sel_table_t->schidx);
-    assert(sch_get_field(sel_schema,  "SCORE", field) == SCHEMA_SUCCESS);
-    tab_for_each_element(sel_table_t, chunk5, chblix5, &element, field){
-        assert(element != value);
-    }
+        sel_table_t = tab_select_op(pager, db,table, schema, &sel_field, "SELECT", COND_LTE, &value, DT_FLOAT);
+        sel_schema = sch_load(pager, sel_table_t->schidx);
+        assert(sch_get_field(pager, sel_schema,  "SCORE", field) == SCHEMA_SUCCESS);
+        tab_for_each_element(pager, sel_table_t, chunk4, chblix4, &element, field){
+            assert(element <= value);
+        }
+        tab_drop(pager, db, sel_table_t);
+
+        value = 10.5f;
+        sel_table_t = tab_select_op(pager, db,table, schema, &sel_field, "SELECT", COND_NEQ, &value, DT_FLOAT);
+        sel_schema = sch_load(pager, sel_table_t->schidx);
+        assert(sch_get_field(pager, sel_schema,  "SCORE", field) == SCHEMA_SUCCESS);
+        tab_for_each_element(pager, sel_table_t, chunk5, chblix5, &element, field){
+            assert(element != value);
+        }
 
-    free(field);
+        free(field);
 
-    tab_drop(db, sel_table_t);
-    db_drop();
+        tab_drop(pager, db, sel_table_t);
+    }
+    db_drop(pager);
 }
 
 DEFINE_TEST(update_row_op){
-    db_t* db = db_init("test.db");
+    pager_t* pager = db_init("test.db");
+    db_t* db = db_get(pager);
     assert(db != NULL);
-    table_t* table = table_student(db, 1);
+    table_t* table = table_student(pager, db, 1);
     float value = 20.5f;
-    schema_t* schema = sch_load(table->schidx);
+    schema_t* schema = sch_load(pager, table->schidx);
     tab_row(
             int64_t ID;
             char NAME[10];
@@ -342,28 +543,31 @@ DEFINE_TEST(update_row_op){
     row.SCORE = 10.5f;
     row.PASS = true;
     field_t field;
-    sch_get_field(schema, "SCORE", &field);
-    int res = tab_update_row_op(db,table, schema, &field, COND_EQ, &value, DT_FLOAT, &row);
+    sch_get_field(pager, schema, "SCORE", &field);
+    int res = tab_update_row_op(pager, db,table, schema, &field, COND_EQ, &value, DT_FLOAT, &row);
     assert(res == TABLE_SUCCESS);
     bool flag = false;
-    tab_for_each_row(table, chunk, chblix, &row, schema){
-        if(row.ID == 10){
-            assert(row.SCORE == 10.5f);
-            flag = true;
+    {
+        tab_for_each_row(pager, table, chunk, chblix, &row, schema){
+            if(row.ID == 10){
+                assert(row.SCORE == 10.5f);
+                flag = true;
+            }
         }
+        assert(flag);
+        tab_drop(pager, db,table);
     }
-    assert(flag);
-    tab_drop(db,table);
-    db_drop();
+    db_drop(pager);
 }
 
 DEFINE_TEST(update_element_op){
-    db_t* db = db_init("test.db");
+    pager_t* pager = db_init("test.db");
+    db_t* db = db_get(pager);
     assert(db != NULL);
-    table_t* table = table_student(db, 1);
+    table_t* table = table_student(pager, db, 1);
     char* value = malloc(10);
     strncpy(value, "Nick", 10);
-    schema_t* schema = sch_load(table->schidx);
+    schema_t* schema = sch_load(pager, table->schidx);
     tab_row(
             int64_t ID;
             char NAME[10];
@@ -371,30 +575,33 @@ DEFINE_TEST(update_element_op){
             bool PASS;
     );
     float element = 10.5f;
-    int res = tab_update_element_op(db,table_index(table), &element, "SCORE", "NAME", COND_EQ, value, DT_CHAR);
+    int res = tab_update_element_op(pager, db,table_index(table), &element, "SCORE", "NAME", COND_EQ, value, DT_CHAR);
     assert(res == TABLE_SUCCESS);
     field_t field;
-    sch_get_field(schema, "SCORE", &field);
+    sch_get_field(pager, schema, "SCORE", &field);
     bool flag = false;
-    tab_for_each_row(table, chunk, chblix, &row, schema){
-        if(strcmp(row.NAME, "Nick") == 0){
-            assert(row.SCORE == 10.5f);
-            flag = true;
+    {
+        tab_for_each_row(pager, table, chunk, chblix, &row, schema){
+            if(strcmp(row.NAME, "Nick") == 0){
+                assert(row.SCORE == 10.5f);
+                flag = true;
+            }
         }
+        assert(flag);
+        free(value);
+        tab_drop(pager, db,table);
     }
-    assert(flag);
-    free(value);
-    tab_drop(db,table);
-    db_drop();
+    db_drop(pager);
 }
 
 DEFINE_TEST(delete_op){
-    db_t* db = db_init("test.db");
+    pager_t* pager = db_init("test.db");
+    db_t* db = db_get(pager);
     assert(db != NULL);
-    table_t* table = table_student(db, 1);
+    table_t* table = table_student(pager, db, 1);
     char* value = malloc(10);
     strncpy(value, "Nick", 10);
-    schema_t* schema = sch_load(table->schidx);
+    schema_t* schema = sch_load(pager, table->schidx);
     tab_row(
             int64_t ID;
             char NAME[10];
@@ -402,27 +609,254 @@ DEFINE_TEST(delete_op){
             bool PASS;
     );
     field_t delete_field;
-    assert(sch_get_field(schema, "NAME", &delete_field) == SCHEMA_SUCCESS);
-    int res = tab_delete_op(db,table, schema, &delete_field, COND_EQ, value);
+    assert(sch_get_field(pager, schema, "NAME", &delete_field) == SCHEMA_SUCCESS);
+    int res = tab_delete_op(pager, db,table, schema, &delete_field, COND_EQ, value);
     assert(res == TABLE_SUCCESS);
     field_t field;
-    sch_get_field(schema, "SCORE", &field);
-    tab_for_each_row(table, chunk2, chblix, &row, schema){
-        if(strcmp(row.NAME, "Nick") == 0){
-            assert(false);
+    sch_get_field(pager, schema, "SCORE", &field);
+    {
+        tab_for_each_row(pager, table, chunk2, chblix, &row, schema){
+            if(strcmp(row.NAME, "Nick") == 0){
+                assert(false);
+            }
         }
+        free(value);
+        tab_drop(pager, db,table);
     }
-    free(value);
-    tab_drop(db,table);
-    db_drop();
+    db_drop(pager);
 }
 
 
+DEFINE_TEST(compaction){
+    pager_t* pager = db_init("test.db");
+    db_t* db = db_get(pager);
+    table_t* bank = table_bank(pager, db, 2000);
+    table_t* table = table_student(pager, db, 1);
+    schema_t* schema = sch_load(pager, table->schidx);
+    tab_row(
+            int64_t ID;
+            char NAME[10];
+            float SCORE;
+            bool PASS;
+    );
+    int64_t tabix = table_index(table);
+    assert(tab_drop(pager, db, bank) == TABLE_SUCCESS);
+    int64_t step, moves = 0;
+    while((step = db_compact(pager, 16)) > 0){
+        moves += step;
+    }
+    assert(step == 0);
+    assert(moves > 0);
+    /* pages of table handles at the end of file are skipped, the rest of table is moved */
+    row.ID = 5;
+    strncpy(row.NAME, "Bob", 10);
+    assert(tab_insert(pager, table, schema, &row) != ROWID_FAIL);
+    int64_t ids = 0;
+    {
+        tab_for_each_row(pager, table, chunk, chblix, &row, schema){
+            ids += row.ID;
+        }
+        assert(ids == 1 + 2 + 3 + 4 + 5);
+    }
+    db_close(pager);
+
+    pager = db_init("test.db");
+    db = db_get(pager);
+    table = tab_load(pager, tabix);
+    assert(table != NULL);
+    schema = sch_load(pager, table->schidx);
+    ids = 0;
+    {
+        tab_for_each_row(pager, table, chunk2, chblix2, &row, schema){
+            ids += row.ID;
+        }
+        assert(ids == 1 + 2 + 3 + 4 + 5);
+    }
+    db_drop(pager);
+}
 
+DEFINE_TEST(compaction_shrink){
+    pager_t* pager = db_init("test.db");
+    db_t* db = db_get(pager);
+    table_t* table = table_student(pager, db, 1);
+    schema_t* schema = sch_load(pager, table->schidx);
+    table_t* bank = table_bank(pager, db, 2000);
+    tab_row(
+            int64_t ID;
+            char NAME[10];
+            float SCORE;
+            bool PASS;
+    );
+    /* rows added after bank lie at the end of file */
+    int64_t count = 2000;
+    for(row.ID = 5; row.ID <= count; row.ID++){
+        strncpy(row.NAME, "Bob", 10);
+        row.SCORE = 50.5f;
+        row.PASS = true;
+        assert(tab_insert(pager, table, schema, &row) != ROWID_FAIL);
+    }
+    int64_t tabix = table_index(table);
+    assert(tab_drop(pager, db, bank) == TABLE_SUCCESS);
+    off_t size = pg_file_size(pager);
+    int64_t step, moves = 0;
+    while((step = db_compact(pager, 16)) > 0){
+        moves += step;
+    }
+    assert(step == 0);
+    assert(moves > 0);
+    assert(pg_file_size(pager) < size);
+    /* handles of table stay valid, their pages aren't moved */
+    int64_t ids = 0;
+    {
+        tab_for_each_row(pager, table, chunk, chblix, &row, schema){
+            ids += row.ID;
+        }
+        assert(ids == count * (count + 1) / 2);
+        row.ID = count + 1;
+        assert(tab_insert(pager, table, schema, &row) != ROWID_FAIL);
+    }
+    db_close(pager);
+
+    pager = db_init("test.db");
+    db = db_get(pager);
+    assert(mtab_find_table_by_name(pager, db->meta_table_idx, "STUDENTS") == tabix);
+    table = tab_load(pager, tabix);
+    assert(table != NULL);
+    schema = sch_load(pager, table->schidx);
+    row.ID = count + 2;
+    rowid_t res = tab_insert(pager, table, schema, &row);
+    assert(res != ROWID_FAIL);
+    ids = 0;
+    {
+        tab_for_each_row(pager, table, chunk2, chblix2, &row, schema){
+            ids += row.ID;
+        }
+        assert(ids == (count + 2) * (count + 3) / 2);
+    }
+    db_drop(pager);
+}
+
+static int64_t sum_field(pager_t* pager, const char* name){
+    db_t* db = db_get(pager);
+    int64_t tabix = mtab_find_table_by_name(pager, db->meta_table_idx, name);
+    assert(tabix != TABLE_FAIL);
+    table_t* table = tab_load(pager, tabix);
+    schema_t* schema = sch_load(pager, table->schidx);
+    field_t field;
+    assert(sch_get_field(pager, schema, strcmp(name, "BANK") == 0 ? "CREDIT" : "ID", &field) == SCHEMA_SUCCESS);
+    int64_t element = 0;
+    int64_t sum = 0;
+    tab_for_each_element(pager, table, chunk, chblix, &element, (&field)){
+        sum += element;
+    }
+    return sum;
+}
+
+DEFINE_TEST(several_databases){
+    pager_t* bank = db_init("test.db");
+    pager_t* students = db_init("test2.db");
+    assert(bank && students);
+    table_bank(bank, db_get(bank), 2);
+    table_student(students, db_get(students), 1);
+    /* each database has its own tables */
+    assert(mtab_find_table_by_name(students, db_get(students)->meta_table_idx, "BANK") == TABLE_FAIL);
+    assert(sum_field(students, "STUDENTS") == 10);
+    assert(mtab_find_table_by_name(bank, db_get(bank)->meta_table_idx, "STUDENTS") == TABLE_FAIL);
+    assert(sum_field(bank, "BANK") == 120);
+    assert(db_close(bank) == DB_SUCCESS);
+    assert(db_close(students) == DB_SUCCESS);
+
+    bank = db_init("test.db");
+    students = db_init("test2.db");
+    assert(sum_field(students, "STUDENTS") == 10);
+    db_drop(students);
+    assert(sum_field(bank, "BANK") == 120);
+    db_drop(bank);
+}
+
+#define WORKERS 4
+#define WORKER_ROWS 2000
+
+typedef struct worker{
+    pager_t* pager;
+    int64_t shared;
+    int64_t id;
+} worker_t;
+
+static void* insert_worker(void* arg){
+    worker_t* worker = arg;
+    pager_t* pager = worker->pager;
+    db_attach(pager);
+    db_t db = *db_get(pager);
+    schema_t* schema = sch_init(pager);
+    pg_scoped_t schema_pin pg_pinned = {pager, pg_pin(pager, schema_index(schema))};
+    sch_add_int_field(pager, schema, "ID");
+    sch_add_varchar_field(pager, schema, "NAME");
+    char name[MAX_NAME_LENGTH];
+    snprintf(name, MAX_NAME_LENGTH, "WORKER%ld", worker->id);
+    table_t* table = tab_init(pager, &db, name, schema);
+    assert(table != NULL);
+    pg_scoped_t table_pin pg_pinned = {pager, pg_pin(pager, table_index(table))};
+    pg_scoped_t shared_pin pg_pinned = {pager, pg_pin(pager, worker->shared)};
+    table_t* shared = tab_load(pager, worker->shared);
+    pg_scoped_t shared_schema_pin pg_pinned = {pager, pg_pin(pager, shared->schidx)};
+    schema_t* shared_schema = sch_load(pager, shared->schidx);
+    tab_row(
+            int64_t ID;
+            vch_ticket_t NAME;
+    );
+    char str[MAX_NAME_LENGTH];
+    for(int64_t i = 0; i < WORKER_ROWS; i++){
+        row.ID = i;
+        row.NAME = vch_add(pager, db.varchar_mgr_idx, name);
+        rowid_t rowid = tab_insert(pager, table, schema, &row);
+        assert(rowid != ROWID_FAIL);
+        assert(tab_select_row(pager, table, rowid, &row) == TABLE_SUCCESS);
+        assert(row.ID == i);
+        vch_ticket_t ticket = row.NAME;
+        assert(vch_get(pager, db.varchar_mgr_idx, &ticket, str) == LB_SUCCESS && strcmp(str, name) == 0);
+        row.ID = 1;
+        rowid = tab_insert(pager, shared, shared_schema, &row);
+        assert(rowid != ROWID_FAIL);
+    }
+    db_detach(pager);
+    return NULL;
+}
+
+DEFINE_TEST(concurrent_inserts){
+    pager_t* pager = db_init("test.db");
+    assert(pager != NULL);
+    schema_t* schema = sch_init(pager);
+    sch_add_int_field(pager, schema, "ID");
+    sch_add_varchar_field(pager, schema, "NAME");
+    table_t* shared = tab_init(pager, db_get(pager), "SHARED", schema);
+    assert(shared != NULL);
+    worker_t workers[WORKERS];
+    pthread_t threads[WORKERS];
+    for(int64_t i = 0; i < WORKERS; i++){
+        workers[i] = (worker_t){.pager = pager, .shared = table_index(shared), .id = i};
+        assert(pthread_create(&threads[i], NULL, insert_worker, &workers[i]) == 0);
+    }
+    for(int64_t i = 0; i < WORKERS; i++){
+        pthread_join(threads[i], NULL);
+    }
+    /* every worker has filled its own table and added its rows to shared one */
+    char name[MAX_NAME_LENGTH];
+    for(int64_t i = 0; i < WORKERS; i++){
+        snprintf(name, MAX_NAME_LENGTH, "WORKER%ld", i);
+        assert(sum_field(pager, name) == (int64_t)WORKER_ROWS * (WORKER_ROWS - 1) / 2);
+    }
+    assert(sum_field(pager, "SHARED") == (int64_t)WORKERS * WORKER_ROWS);
+    db_drop(pager);
+}
 
 int main(){
     RUN_SINGLE_TEST(create_add_foreach);
     RUN_SINGLE_TEST(update);
+    RUN_SINGLE_TEST(row_view);
+    RUN_SINGLE_TEST(read_only);
+    RUN_SINGLE_TEST(cursor);
+    RUN_SINGLE_TEST(cursor_write);
     RUN_SINGLE_TEST(delete);
     RUN_SINGLE_TEST(get_table_after_close);
     RUN_SINGLE_TEST(varchar);
@@ -433,4 +867,8 @@ int main(){
     RUN_SINGLE_TEST(update_row_op);
     RUN_SINGLE_TEST(update_element_op);
     RUN_SINGLE_TEST(delete_op);
+    RUN_SINGLE_TEST(compaction);
+    RUN_SINGLE_TEST(compaction_shrink);
+    RUN_SINGLE_TEST(several_databases);
+    RUN_SINGLE_TEST(concurrent_inserts);
 }